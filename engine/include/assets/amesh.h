@@ -0,0 +1,59 @@
+#ifndef ATOM_AMESH_H
+#define ATOM_AMESH_H
+
+#include <assets/mesh.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// cooked mesh container. a fixed header followed by sections at aligned
+// offsets, laid out so a memory map can be handed to the renderer as is
+#define AMESH_MAGIC     "AMSH"
+#define AMESH_VERSION   1
+#define AMESH_ALIGNMENT 64
+
+#define AMESH_HAS_NORMALS   (1u << 0)
+#define AMESH_HAS_TEXCOORDS (1u << 1)
+
+// byte range within the file, size 0 when absent
+typedef struct {
+  uint64_t offset;
+  uint64_t size;
+} amesh_section;
+
+typedef struct {
+  uint64_t first_index;  // into the index section, after the full mesh
+  uint64_t idx_count;
+  float    error;
+  uint32_t reserved;
+} amesh_lod;
+
+typedef struct {
+  char     magic[4];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t vertex_format;  // layout of the gpu vertex section
+  uint64_t vert_count;
+  uint64_t idx_count;      // full mesh only, lods follow it in the index section
+  uint64_t meshlet_count;
+  uint32_t lod_count;
+  uint32_t index_size;     // bytes per gpu index, 2 under 65536 vertices
+  float    bounds_min[3];
+  float    bounds_max[3];
+  uint64_t file_size;
+
+  amesh_section positions;     // float3
+  amesh_section normals;       // float3
+  amesh_section texcoords;     // float2
+  amesh_section indices;       // uint32, full mesh then every lod
+  amesh_section gpu_vertices;  // interleaved in vertex_format
+  amesh_section gpu_indices;   // index section narrowed to index_size
+  amesh_section meshlets;
+  amesh_lod     lods[MESH_MAX_LODS];
+} amesh_header;
+
+// writes a processed mesh, its packed stream built in the given format
+bool amesh_write(const mesh *m, vertex_format format, const char *path);
+
+extern void load_amesh(const char *path, mesh *out);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef ATOM_ARCHIVE_H
+#define ATOM_ARCHIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// read only asset archive. a fixed header, a hashed table of contents and
+// the file data, either stored as is at page aligned offsets so it can be
+// mapped straight from the archive or split into chunks that are lz4
+// compressed on their own and decompressed in parallel
+#define ARCHIVE_MAGIC      "APAK"
+#define ARCHIVE_VERSION    1
+#define ARCHIVE_CHUNK_SIZE 65536
+#define ARCHIVE_ALIGNMENT  4096
+
+typedef struct {
+  char     magic[4];
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t slot_count;      // power of two above entry_count
+  uint64_t chunk_count;
+  uint32_t chunk_size;
+  uint32_t reserved;
+  uint64_t slots_offset;    // uint32 entry index + 1 per slot, 0 when empty
+  uint64_t entries_offset;
+  uint64_t chunks_offset;
+  uint64_t names_offset;
+  uint64_t names_size;
+  uint64_t file_size;
+} archive_header;
+
+typedef struct {
+  uint64_t hash;         // fnv-1a of the name, its slot is the low bits
+  uint64_t offset;       // of the data, stored entries only
+  uint64_t size;         // uncompressed
+  uint64_t first_chunk;
+  uint32_t chunk_count;  // 0 when the entry is stored
+  uint32_t name_size;
+  uint64_t name_offset;  // into the name block, names are not terminated
+} archive_entry;
+
+typedef struct {
+  uint64_t offset;
+  uint32_t size;      // equal to raw_size when the chunk did not compress
+  uint32_t raw_size;  // chunk_size except for the entry's last chunk
+} archive_chunk;
+
+typedef struct {
+  const char *name;  // "/" separated, relative to the archive's root
+  const char *path;
+  bool       compress;
+} archive_source;
+
+// contents of a file, munmap-able whether it was mapped from disk or
+// decompressed, data is NULL for empty files
+typedef struct {
+  uint8_t *data;
+  size_t  size;
+} asset_file;
+
+typedef struct archive archive;
+
+// validates the whole table of contents up front, so lookups trust it
+archive *archive_open(const char *path);
+void     archive_close(archive *a);
+bool     archive_map(const archive *a, const char *name, bool writable, asset_file *out);
+
+// entries that save less than a sixteenth compressed are stored instead
+bool archive_write(const char *path, const archive_source *sources, size_t count);
+
+// makes the archive's entries readable through asset_file_map at the paths
+// they were packed from, relative to root or the working directory when
+// root is NULL. later mounts are searched first
+bool archive_mount(const char *path, const char *root);
+// loads reading from mounted archives must have finished
+void archive_unmount_all(void);
+
+// the loose file when it exists, otherwise the entry of a mounted archive.
+// writable mappings are private copies on write
+bool asset_file_map(const char *path, bool writable, asset_file *out);
+void asset_file_unmap(asset_file *file);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef ATOM_ASSETS_H
+#define ATOM_ASSETS_H
+
+#include <assets/mesh.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// processing run after a mesh is read, in this order
+#define MESH_IMPORT_NORMALS  (1u << 0)  // smooth, creased when crease_angle is set
+#define MESH_IMPORT_OPTIMIZE (1u << 1)
+#define MESH_IMPORT_LODS     (1u << 2)
+#define MESH_IMPORT_MESHLETS (1u << 3)
+
+// part of the cache key, fields of steps that are not enabled are ignored
+typedef struct {
+  uint32_t        flags;
+  float           crease_angle;
+  mesh_lod_config lods;
+} mesh_import_options;
+
+// slot index in the low bits and the slot's generation above, so a handle
+// to an unloaded asset never names whatever reuses its slot
+typedef uint32_t asset_handle;
+typedef uint32_t asset_weak_handle;
+#define ASSET_HANDLE_NONE 0
+
+typedef enum {
+  ASSET_NONE,     // stale or empty handle
+  ASSET_LOADING,
+  ASSET_READY,
+  ASSET_FAILED
+} asset_state;
+
+typedef struct {
+  size_t loaded;    // assets currently in memory
+  size_t loading;   // queued or being read by a loader thread
+  size_t requests;
+  size_t hits;      // requests answered by an asset already loaded or loading
+  size_t unloads;
+} asset_stats;
+
+// reads and processes a mesh without caching it. cooked .amesh files already
+// went through their options in atom-cook and are used as they are
+bool asset_import_mesh(const char *path, const mesh_import_options *options, mesh *out);
+
+// strong reference to the mesh for the normalized path and options, read on
+// the first request and shared by every later one. NULL options imports the
+// mesh unprocessed, ASSET_HANDLE_NONE when the file cannot be loaded
+asset_handle asset_load_mesh(const char *path, const mesh_import_options *options);
+// returns at once while loader threads read and process the mesh, which is
+// published by the assets_dispatch that finds it finished. a blocking
+// request for the same asset waits for it instead of loading it twice
+asset_handle asset_load_mesh_async(const char *path, const mesh_import_options *options);
+asset_handle asset_retain(asset_handle h);
+// the asset is unloaded with its last strong reference
+void         asset_release(asset_handle h);
+uint32_t     asset_ref_count(asset_handle h);
+
+// stays at the same address while the asset is loaded, NULL for stale
+// handles and until an async load is ready
+mesh        *asset_mesh(asset_handle h);
+asset_state  asset_get_state(asset_handle h);
+
+// weak references do not keep an asset loaded, lock hands out a new strong
+// reference while it still is and ASSET_HANDLE_NONE after it was unloaded
+asset_weak_handle asset_weak(asset_handle h);
+asset_handle      asset_lock(asset_weak_handle w);
+
+// absolute path with "." and ".." segments and repeated separators resolved
+// lexically, so spellings of one file share a cache entry
+bool asset_normalize_path(const char *path, char *out, size_t size);
+
+asset_stats asset_get_stats(void);
+
+// publishes async loads finished since the last call, main thread only.
+// returns how many completed, failed ones included
+size_t assets_dispatch(void);
+
+// stops the loader threads, unloads everything whatever references are left
+// and unmounts every archive
+void   assets_shutdown(void);
+
+#endif
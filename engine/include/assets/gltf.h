@@ -0,0 +1,51 @@
+#ifndef ATOM_GLTF_H
+#define ATOM_GLTF_H
+
+#include <assets/mesh.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GLB_MAGIC      0x46546c67u  // "glTF"
+#define GLB_CHUNK_JSON 0x4e4f534au
+#define GLB_CHUNK_BIN  0x004e4942u
+
+typedef struct {
+  const char    *json;
+  size_t        json_size;
+  const uint8_t *bin;  // NULL without a binary chunk
+  size_t        bin_size;
+} glb_chunks;
+
+// splits a glb container into its json and binary chunks
+bool glb_parse(const uint8_t *data, size_t size, glb_chunks *out);
+
+typedef struct {
+  int32_t parent;          // earlier node in the list, -1 for roots
+  int32_t mesh;            // into gltf_model.meshes, -1 for none
+  float   translation[3];
+  float   rotation[4];     // unit quaternion, xyzw
+  float   scale[3];
+  char    name[64];
+} gltf_node;
+
+typedef struct {
+  mesh      *meshes;      // one per gltf mesh with its triangle primitives merged
+  size_t    mesh_count;
+  gltf_node *nodes;       // parents always precede their children
+  size_t    node_count;
+} gltf_model;
+
+// reads a .gltf or .glb file. streams stored as float, and indices stored as
+// uint32, point straight into a private mapping of their buffer file; other
+// layouts are converted. 16-bit indices are also kept as the mesh's gpu copy
+bool gltf_load_model(const char *path, gltf_model *out);
+void gltf_model_destroy(gltf_model *model);
+
+// every mesh instance merged into one mesh with its node's world transform
+// baked in, the model is left without meshes
+bool gltf_flatten(gltf_model *model, mesh *out);
+
+extern void load_gltf(const char *path, mesh *out);
+extern void load_glb(const char *path, mesh *out);
+
+#endif
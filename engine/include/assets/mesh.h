@@ -2,25 +2,169 @@
 #define ATOM_MESH_H
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <lib/arena.h>
+
+#define MESH_MAX_LODS 8
+
+// simplified index buffer over the mesh's own vertices
+typedef struct {
+  uint32_t *indices;
+  size_t    idx_count;
+  float     error;      // object space deviation from the full mesh
+} mesh_lod;
+
+#define MESHLET_MAX_VERTICES  64
+#define MESHLET_MAX_TRIANGLES 124
+
+// contiguous run of triangles in the mesh index buffer
+typedef struct {
+  uint32_t index_offset;
+  uint32_t triangle_count;
+  uint32_t vertex_count;
+  float    center[3];     // bounding sphere
+  float    radius;
+  float    cone_apex[3];  // every triangle faces away from viewers inside the cone
+  float    cone_axis[3];
+  float    cone_cutoff;
+} meshlet;
+
+// gpu vertex layouts
+typedef enum {
+  VERTEX_FORMAT_FLOAT,            // separate float32 position/normal/texcoord streams
+  VERTEX_FORMAT_PACKED,           // interleaved packed_vertex, 20 bytes
+  VERTEX_FORMAT_PACKED_QUANTIZED  // interleaved packed_vertex_quantized, 16 bytes
+} vertex_format;
+
+#define MESH_STREAM_ALIGNMENT 64
+
+#define MESH_HAS_NORMALS   0x1u
+#define MESH_HAS_TEXCOORDS 0x2u
+
+// what owns the block a mesh's streams live in
+typedef enum {
+  MESH_STORAGE_NONE,
+  MESH_STORAGE_HEAP,    // one aligned allocation freed with the mesh
+  MESH_STORAGE_ARENA,   // carved from a caller arena and released with it
+  MESH_STORAGE_MAPPED   // private file mapping unmapped with the mesh
+} mesh_storage;
+
+// byte offsets of each stream from the start of the storage, cooked files
+// describe their sections the same way so they bind without copying
+typedef struct {
+  uint32_t flags;      // MESH_HAS_*
+  size_t   positions;
+  size_t   normals;
+  size_t   texcoords;
+  size_t   indices;
+  size_t   size;       // bytes spanned by every stream
+} mesh_layout;
 
 // struct for mesh data
 typedef struct {
+  // views into the storage through its layout. streams added after loading
+  // that the layout has no room for are separate allocations
   float     *positions;
-  float     *normals; 
-  float     *texcoords; 
-  uint32_t  *indices; 
-  size_t    *vert_count;
-  size_t    *idx_count;
+  float     *normals;
+  float     *texcoords;
+  uint32_t  *indices;
+  size_t    vert_count;
+  size_t    idx_count;
+  float     bounds_min[3];
+  float     bounds_max[3];
+  mesh_lod  lods[MESH_MAX_LODS];  // progressively coarser, lods[0] is the first reduction
+  size_t    lod_count;
+  meshlet   *meshlets;   // clusters of the full detail index buffer
+  size_t    meshlet_count;
+
+  void          *storage;
+  size_t        storage_size;
+  mesh_storage  storage_kind;
+  mesh_layout   layout;
+
+  // uploaded as is and dropped by anything editing the mesh
+  const void    *gpu_vertices;
+  size_t        gpu_vertices_size;
+  vertex_format gpu_format;
+  const void    *gpu_indices;  // full mesh then every lod, 16 bit under 65536 vertices
 } mesh;
 
+typedef struct {
+  size_t max_lods;      // levels generated beyond the full mesh
+  float  reduction;     // triangle ratio between consecutive levels
+  float  error_budget;  // max deviation as a fraction of the bounds radius
+} mesh_lod_config;
+
+// float position, octahedral snorm16 normal, half float texcoord
+typedef struct {
+  float    position[3];
+  int16_t  normal[2];
+  uint16_t texcoord[2];
+} packed_vertex;
+
+// unorm16 position relative to the mesh bounds (w is padding)
+typedef struct {
+  uint16_t position[4];
+  int16_t  normal[2];
+  uint16_t texcoord[2];
+} packed_vertex_quantized;
+
+// post-transform vertex cache statistics
+typedef struct {
+  float acmr;  // cache misses per triangle
+  float atvr;  // cache misses per referenced vertex
+} mesh_cache_stats;
+
 void load_mesh(const char *path, mesh *out);
 
 extern void load_obj(const char *path, mesh *out);
+// chunk_count 1 parses on the calling thread, 0 splits files of a megabyte or
+// more across the job workers. the mesh is the same for any chunk count
+extern void load_obj_chunked(const char *path, mesh *out, size_t chunk_count);
+// binary fbx, every polygon geometry merged in object space. only the
+// vertex, polygon, normal and uv arrays are inflated, in parallel
+extern void load_fbx(const char *path, mesh *out);
 
 void generate_normals(mesh *m);
 void generate_normals_smooth(mesh *m);
+// smooth normals averaged across vertices at the same position, except where
+// their normals are more than crease_angle radians apart so hard edges stay
+void generate_normals_creased(mesh *m, float crease_angle);
 void generate_normals_flat(mesh *m);
 
+void mesh_compute_bounds(mesh *m);
+
+mesh_cache_stats mesh_analyze_vertex_cache(const mesh *m, size_t cache_size);
+void mesh_optimize_vertex_cache(mesh *m);
+void mesh_optimize_vertex_fetch(mesh *m);
+void mesh_optimize(mesh *m);
+void mesh_optimize_indices(uint32_t *indices, size_t idx_count, size_t vert_count);
+
+size_t mesh_simplify(const mesh *m, uint32_t *out, size_t target_idx_count,
+                     float max_error, float *out_error);
+void   mesh_generate_lods(mesh *m, const mesh_lod_config *config);
+
+void   mesh_build_meshlets(mesh *m);
+size_t mesh_cull_meshlets(const mesh *m, const float planes[6][4], const float eye[3],
+                          uint8_t *visible);
+
+size_t vertex_format_stride(vertex_format format);
+void  *mesh_pack_vertices(const mesh *m, vertex_format format, size_t *out_size);
+
+mesh_layout mesh_compute_layout(size_t vert_count, size_t idx_count, uint32_t flags);
+// one block for every stream, taken from the arena when one is given.
+// normals and texcoords start zeroed
+bool mesh_allocate(mesh *m, size_t vert_count, size_t idx_count, uint32_t flags, arena *a);
+// points the streams into an existing block, which the mesh then owns
+// unless it belongs to an arena
+void mesh_bind_storage(mesh *m, void *storage, size_t size, const mesh_layout *layout,
+                       mesh_storage kind);
+
+// streams inside the storage are released with it, everything else is freed
+bool mesh_in_storage(const mesh *m, const void *stream);
+void mesh_free_stream(const mesh *m, void *stream);
+void mesh_drop_gpu_copies(mesh *m);
+
 void destroy_mesh(mesh *m);
 
 #endif
@@ -3,12 +3,22 @@
 
 #include <scene/entity.h>
 #include <lib/la.h>
+#include <stdbool.h>
+
+typedef enum {
+  LIGHT_POINT,
+  LIGHT_DIRECTIONAL
+} light_type;
 
 typedef struct {
   entity_id entity;
+  light_type type;
   vec3 position;
+  vec3 direction;  // direction the light travels, directional lights only
   vec3 color;
   float intensity;
+  float range;  // distance at which the contribution reaches zero
+  bool cast_shadows;
 } light_component;
 
 void light_component_init(light_component *l, entity_id id);
@@ -6,6 +6,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// range of the shared index buffer drawn for one detail level
+typedef struct {
+  size_t index_offset;
+  size_t index_count;
+  float error;
+} mesh_renderer_lod;
+
+typedef struct mesh_renderer_upload mesh_renderer_upload;
+
 typedef struct {
   entity_id entity;
   mesh *mesh_data;
@@ -13,11 +22,30 @@ typedef struct {
   uint32_t vao;
   uint32_t vbo_pos;
   uint32_t vbo_norm;
+  uint32_t vbo_uv;
   uint32_t ebo;
+  uint32_t index_type;
+  mesh_renderer_lod lods[MESH_MAX_LODS + 1];
+  size_t lod_count;
+  vertex_format format;
+  float color[3];     // multiplies the lit result, white unless set
+  bool flat_shading;  // one normal per triangle, drawn with the FLAT_SHADING variant
+  bool occluder;   // rasterized into the cpu occlusion buffer
+  bool is_static;  // never moves, may be kept in cached shadow cascades
+  uint32_t revision;  // bumped by every upload so caches notice reimported meshes
+  mesh_renderer_upload *upload;  // buffers still being filled, NULL when none
   bool initialized;
 } mesh_renderer_component;
 
 void mesh_renderer_component_init(mesh_renderer_component *mr, entity_id id);
+void mesh_renderer_component_upload(mesh_renderer_component *mr, mesh *m, vertex_format format);
+// starts uploading m into a second set of buffers while the current ones keep
+// drawing, m must stay alive until the upload finishes or is replaced
+bool mesh_renderer_component_upload_begin(mesh_renderer_component *mr, mesh *m,
+                                          vertex_format format);
+// writes up to max_bytes of the pending upload and returns how many it wrote.
+// the step writing the last byte switches the renderer over to m
+size_t mesh_renderer_component_upload_step(mesh_renderer_component *mr, size_t max_bytes);
 void mesh_renderer_component_cleanup(mesh_renderer_component *mr);
 
 #endif
@@ -0,0 +1,22 @@
+#ifndef ATOM_ARENA_H
+#define ATOM_ARENA_H
+
+#include <stddef.h>
+
+typedef struct arena_block arena_block;
+
+// bump allocator over a chain of blocks. allocations never move and are
+// only released together, by arena_reset or arena_destroy
+typedef struct {
+  arena_block *blocks;      // newest first
+  size_t      block_size;
+} arena;
+
+void  arena_init(arena *a, size_t block_size);
+void  arena_destroy(arena *a);
+// keeps the newest block for reuse and frees the rest
+void  arena_reset(arena *a);
+// align must be a power of two, NULL when out of memory
+void *arena_alloc(arena *a, size_t size, size_t align);
+
+#endif
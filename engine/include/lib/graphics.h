@@ -5,6 +5,7 @@
 #include <stdlib.h> 
 #include <stdio.h>
 #include <opengl/glad.h>
+#include <opengl/shader.h>
 #include <wayland-egl.h>
 
 static struct wl_egl_window *egl_window    = NULL;
@@ -19,6 +20,5 @@ extern int width;
 extern int height;
 
 void init_glad(void);
-GLuint make_program_from_files(const char *vs_path, const char *fs_path);
 
 #endif
@@ -0,0 +1,15 @@
+#ifndef ATOM_INFLATE_H
+#define ATOM_INFLATE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// decompresses a zlib stream whose inflated size is known up front, false
+// on corrupt input or when the output is not exactly dst_size bytes
+bool zlib_inflate(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+// same for a raw deflate stream without the zlib header and checksum
+bool inflate_raw(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef ATOM_JOBS_H
+#define ATOM_JOBS_H
+
+#include <stddef.h>
+
+typedef void (*job_fn)(void *ctx, size_t index);
+
+// worker_count 0 picks one worker per core minus the calling thread
+void   jobs_init(size_t worker_count);
+void   jobs_shutdown(void);
+size_t jobs_worker_count(void);
+// long lived background threads call this once so their parallel_for runs
+// inline instead of holding up the batches of the frame
+void   jobs_mark_background(void);
+
+// runs fn(ctx, 0..count-1) across the workers and the calling thread,
+// returns once every index has finished
+void   jobs_parallel_for(size_t count, job_fn fn, void *ctx);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef ATOM_JSON_H
+#define ATOM_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// flat token list over a json text that must outlive it, values are read
+// lazily so nothing is converted unless asked for
+
+#define JSON_NONE UINT32_MAX
+
+typedef enum {
+  JSON_NULL,
+  JSON_BOOL,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT
+} json_type;
+
+typedef struct {
+  json_type type;
+  uint32_t  start, end;  // byte range in the text, strings without their quotes
+  uint32_t  count;       // elements of an array, members of an object
+  uint32_t  next;        // token after this value and everything nested in it
+} json_token;
+
+// objects are followed by key, value pairs and arrays by their elements
+typedef struct {
+  const char *text;
+  json_token *tokens;
+  size_t     count;
+  size_t     capacity;
+} json_document;
+
+// token 0 is the root value
+bool json_parse(json_document *doc, const char *text, size_t len);
+void json_destroy(json_document *doc);
+
+// JSON_NONE when the key or index is missing, or tok is not an object/array
+uint32_t json_get(const json_document *doc, uint32_t object, const char *key);
+uint32_t json_at(const json_document *doc, uint32_t array, size_t index);
+size_t   json_count(const json_document *doc, uint32_t tok);
+
+// fallback when tok is missing or of another type
+int64_t  json_int(const json_document *doc, uint32_t tok, int64_t fallback);
+float    json_float(const json_document *doc, uint32_t tok, float fallback);
+bool     json_bool(const json_document *doc, uint32_t tok, bool fallback);
+
+// compares or copies a string with its escapes resolved, the copy is
+// truncated to capacity and its full length returned
+bool     json_string_eq(const json_document *doc, uint32_t tok, const char *s);
+size_t   json_string(const json_document *doc, uint32_t tok, char *out, size_t capacity);
+
+#endif
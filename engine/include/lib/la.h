@@ -452,6 +452,22 @@ static inline mat4 perspective_mat4(float fovy_radians,
   return result;
 }
 
+static inline mat4 ortho_mat4(float left, float right,
+                              float bottom, float top,
+                              float z_near, float z_far)
+{
+  mat4 result = mat4_identity();
+
+  result.m[0][0] = 2.0f / (right - left);
+  result.m[1][1] = 2.0f / (top - bottom);
+  result.m[2][2] = -2.0f / (z_far - z_near);
+  result.m[0][3] = -(right + left) / (right - left);
+  result.m[1][3] = -(top + bottom) / (top - bottom);
+  result.m[2][3] = -(z_far + z_near) / (z_far - z_near);
+
+  return result;
+}
+
 static inline mat4 translate_mat4(mat4 m, vec3 v) {
   mat4 t = mat4_identity();
   t.m[0][3] = v.x;
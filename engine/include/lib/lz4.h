@@ -0,0 +1,21 @@
+#ifndef ATOM_LZ4_H
+#define ATOM_LZ4_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// lz4 block format, no frame header or checksums. blocks of up to 64 KB
+// reference nothing outside themselves, so each one decodes on its own
+
+// largest output lz4_compress can produce for size input bytes
+size_t lz4_compress_bound(size_t size);
+
+// greedy single pass compressor, returns the compressed size or 0 when dst
+// holds less than lz4_compress_bound(src_size)
+size_t lz4_compress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+// false on corrupt input or when the output is not exactly dst_size bytes
+bool lz4_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef ATOM_PARSE_H
+#define ATOM_PARSE_H
+
+#include <stdint.h>
+
+// locale independent number parsers over a [p, end) range that need not be
+// nul terminated. both return the position after the number, or p unchanged
+// when no number starts there
+
+// correctly rounded decimal to binary32, accepts [+-]digits[.digits][(e|E)[+-]digits]
+const char *parse_float(const char *p, const char *end, float *out);
+
+// [+-]digits, wraps silently on overflow
+const char *parse_int(const char *p, const char *end, int64_t *out);
+
+#endif
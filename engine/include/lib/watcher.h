@@ -0,0 +1,17 @@
+#ifndef ATOM_WATCHER_H
+#define ATOM_WATCHER_H
+
+#include <stdbool.h>
+
+typedef void (*watch_fn)(const char *path, void *ctx);
+
+// calls fn from watcher_dispatch after the file is rewritten or replaced,
+// the inotify thread is started by the first watch
+bool watcher_add(const char *path, watch_fn fn, void *ctx);
+
+// runs the callbacks of every file changed since the last call, several
+// writes to one file in between are coalesced into a single call
+void watcher_dispatch(void);
+void watcher_shutdown(void);
+
+#endif
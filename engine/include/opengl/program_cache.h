@@ -0,0 +1,27 @@
+#ifndef ATOM_PROGRAM_CACHE_H
+#define ATOM_PROGRAM_CACHE_H
+
+#include <opengl/glad.h>
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  size_t hits;
+  size_t misses;  // no entry on disk
+  size_t stale;   // entry rejected by the driver and rebuilt
+  size_t stores;
+} program_cache_stats;
+
+// defaults to $XDG_CACHE_HOME/atom/shaders or ~/.cache/atom/shaders, NULL disables the cache
+void program_cache_set_directory(const char *dir);
+
+// hash of both stages, the define block and the driver identification strings
+uint64_t program_cache_key(const char *vs_source, const char *fs_source, const char *defines);
+
+// linked program from a cached binary, 0 when missing or rejected
+GLuint program_cache_load(uint64_t key);
+void   program_cache_store(uint64_t key, GLuint program);
+
+program_cache_stats program_cache_get_stats(void);
+
+#endif
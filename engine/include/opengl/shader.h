@@ -0,0 +1,32 @@
+#ifndef ATOM_SHADER_H
+#define ATOM_SHADER_H
+
+#include <opengl/glad.h>
+#include <stdbool.h>
+
+// program being compiled and linked, possibly off the calling thread
+typedef struct shader_build shader_build;
+
+char  *load_shader_file(const char *path);
+
+// every program builder returns 0 on failure instead of aborting, so a
+// broken edit during hot reload leaves the running program in place
+GLuint make_program_from_sources(const char *vs_source, const char *fs_source);
+// defines is a block of #define lines inserted after each stage's #version
+GLuint make_program_variant(const char *vs_source, const char *fs_source, const char *defines);
+GLuint make_program_from_files(const char *vs_path, const char *fs_path);
+
+// uses GL_KHR_parallel_shader_compile when present, otherwise a worker
+// thread with a shared context, and compiles synchronously if neither works
+shader_build *shader_build_begin(const char *vs_source, const char *fs_source, const char *defines);
+// true once shader_build_finish will not block
+bool          shader_build_poll(shader_build *b);
+// waits for the build, frees it and returns the linked program or 0 after
+// logging the compile or link errors
+GLuint        shader_build_finish(shader_build *b);
+
+// "parallel", "worker", "sync" or "unresolved" before the first build
+const char *shader_compile_mode(void);
+void        shader_compile_shutdown(void);
+
+#endif
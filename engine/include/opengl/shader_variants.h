@@ -0,0 +1,58 @@
+#ifndef ATOM_SHADER_VARIANTS_H
+#define ATOM_SHADER_VARIANTS_H
+
+#include <opengl/shader.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// index into the variant table, stable for the lifetime of the table
+typedef uint32_t shader_handle;
+#define SHADER_HANDLE_NONE 0
+
+typedef struct {
+    uint64_t key;
+    char     *vs_path;
+    char     *fs_path;
+    char     *defines;     // canonical #define block, sorted and deduplicated
+    GLuint   program;     // 0 until the first build has finished
+    shader_build *build;  // in flight build, the current program stays usable meanwhile
+    uint32_t generation;  // bumped whenever program is replaced, uniform locations must be refetched
+} shader_variant;
+
+typedef struct {
+    const char        *vs_path;
+    const char        *fs_path;
+    const char *const *defines;
+    size_t            define_count;
+} shader_variant_desc;
+
+// program for the two files compiled with the given feature defines, written
+// as "NAME" or "NAME=VALUE"; order and repeats do not matter and every
+// distinct permutation is compiled once. request returns without waiting
+// for the build, get waits for it
+shader_handle shader_variant_request(const char *vs_path, const char *fs_path,
+                                     const char *const *defines, size_t define_count);
+shader_handle shader_variant_get(const char *vs_path, const char *fs_path,
+                                 const char *const *defines, size_t define_count);
+
+// never blocks, true once shader_variant_program is usable
+bool   shader_variant_ready(shader_handle h);
+GLuint shader_variant_wait(shader_handle h);
+
+// builds every listed permutation in parallel and waits for all of them,
+// meant for level loading so no program is first compiled mid frame
+void   shader_variants_warm_up(const shader_variant_desc *descs, size_t count);
+size_t shader_variants_pending(void);
+
+// rereads a changed source file and rebuilds every variant using it in the
+// background, returns how many were started. a variant whose new build fails
+// keeps running its previous program
+size_t shader_variants_reload(const char *path);
+
+GLuint                shader_variant_program(shader_handle h);
+const shader_variant *shader_variant_info(shader_handle h);
+size_t                shader_variant_count(void);
+
+void shader_variants_destroy(void);
+
+#endif
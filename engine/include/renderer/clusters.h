@@ -0,0 +1,81 @@
+#ifndef ATOM_CLUSTERS_H
+#define ATOM_CLUSTERS_H
+
+#include <components/light.h>
+#include <components/camera.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// froxel grid, z slices are spaced exponentially between the camera planes
+#define CLUSTER_X     16
+#define CLUSTER_Y     9
+#define CLUSTER_Z     24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+
+// binding points shared with the clustered shaders
+#define CLUSTER_LIGHT_BINDING  0  // ssbo of cluster_light
+#define CLUSTER_GRID_BINDING   1  // ssbo of offset, count pairs per cluster
+#define CLUSTER_INDEX_BINDING  2  // ssbo of light indices
+#define CLUSTER_PARAMS_BINDING 0  // ubo of cluster_params
+
+// std430 layout of one light on the gpu
+typedef struct {
+  float position_range[4];  // world position and radius of influence
+  float color[4];           // color premultiplied by intensity
+} cluster_light;
+
+// std140 layout of the per frame parameters
+typedef struct {
+  uint32_t grid[4];    // CLUSTER_X, CLUSTER_Y, CLUSTER_Z, light count
+  float    slice[4];   // log depth scale and bias, tiles per pixel in x and y
+  float    eye[4];
+  float    sun_direction[4];  // first directional light, w is 1 when present
+  float    sun_color[4];
+} cluster_params;
+
+// lights overlapping one z slice, binned by the job that owns the slice
+typedef struct {
+  float    *soa;       // view space x, y, z, radius arrays of soa_capacity floats each
+  uint32_t *ids;
+  size_t   soa_count;
+  size_t   soa_capacity;
+
+  uint32_t *indices;   // light indices of every cluster in the slice, in cluster order
+  size_t   index_count;
+  size_t   index_capacity;
+  uint32_t counts[CLUSTER_X * CLUSTER_Y];
+} cluster_slice;
+
+typedef struct {
+  uint32_t light_ssbo;
+  uint32_t grid_ssbo;
+  uint32_t index_ssbo;
+  uint32_t params_ubo;
+
+  cluster_light *lights;
+  float         *view_lights;  // view space x, y, z, radius per light
+  size_t        light_count;
+  size_t        light_capacity;
+
+  uint32_t *grid;
+  uint32_t *indices;
+  size_t   index_count;
+  size_t   index_capacity;
+
+  cluster_slice slices[CLUSTER_Z];
+
+  // projection terms read by the binning jobs
+  float near_plane, far_plane;
+  float x_scale, y_scale;
+} light_clusters;
+
+void light_clusters_init(light_clusters *lc);
+void light_clusters_destroy(light_clusters *lc);
+
+// bins the point lights for this camera and uploads the grid and light buffers,
+// the first directional light is passed separately since it reaches every cluster
+void light_clusters_build(light_clusters *lc, const light_component *lights, size_t light_count,
+                          const camera_component *cam, int viewport_width, int viewport_height);
+void light_clusters_bind(const light_clusters *lc);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef ATOM_DEPTH_PREPASS_H
+#define ATOM_DEPTH_PREPASS_H
+
+#include <lib/la.h>
+#include <stdint.h>
+
+// position only program filling the depth buffer ahead of the lit pass, which
+// then tests with GL_EQUAL so every covered pixel is shaded once
+typedef struct {
+  uint32_t program;
+  int32_t  model_loc, view_loc, proj_loc;
+  int32_t  prev_program;  // restored by depth_prepass_end
+} depth_prepass;
+
+void depth_prepass_init(depth_prepass *dp);
+void depth_prepass_destroy(depth_prepass *dp);
+
+// binds the program with colour writes masked, view and proj are shared by the pass
+void depth_prepass_begin(depth_prepass *dp, const mat4 *view, const mat4 *proj);
+void depth_prepass_set_model(depth_prepass *dp, const mat4 *model);
+// restores the previous program and colour writes
+void depth_prepass_end(depth_prepass *dp);
+
+#endif
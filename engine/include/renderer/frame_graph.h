@@ -0,0 +1,113 @@
+#ifndef ATOM_FRAME_GRAPH_H
+#define ATOM_FRAME_GRAPH_H
+
+#include <renderer/gpu_profiler.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define FRAME_GRAPH_MAX_PASSES      32
+#define FRAME_GRAPH_MAX_RESOURCES   64
+#define FRAME_GRAPH_MAX_PASS_IO     8   // reads or writes declared by one pass
+#define FRAME_GRAPH_POOL_KEEP       60  // frames an unused pooled texture survives
+
+typedef uint32_t fg_handle;
+#define FG_HANDLE_NONE UINT32_MAX
+
+typedef enum {
+  FG_RESOURCE_TRANSIENT,     // texture drawn from the pool, only valid during this frame
+  FG_RESOURCE_TEXTURE,       // texture owned outside the graph, never attached automatically
+  FG_RESOURCE_FRAMEBUFFER    // framebuffer owned outside the graph, writing it keeps a pass alive
+} fg_resource_kind;
+
+typedef struct {
+  const char       *name;
+  fg_resource_kind kind;
+  int              width, height;
+  uint32_t         format;  // sized internal format, depth formats attach as depth
+  uint32_t         texture;
+  uint32_t         framebuffer;
+  int              first_pass, last_pass;  // lifetime over live passes, -1 when unused
+  bool             needed;
+} fg_resource;
+
+typedef struct frame_graph frame_graph;
+typedef void (*fg_execute_fn)(frame_graph *fg, void *ctx);
+
+typedef struct {
+  const char    *name;
+  fg_execute_fn execute;
+  void          *ctx;
+  fg_handle     reads[FRAME_GRAPH_MAX_PASS_IO];
+  fg_handle     writes[FRAME_GRAPH_MAX_PASS_IO];
+  size_t        read_count;
+  size_t        write_count;
+  bool          side_effect;  // kept even when nothing reads its output
+  bool          culled;
+} fg_pass;
+
+typedef struct {
+  uint32_t texture;
+  int      width, height;
+  uint32_t format;
+  size_t   bytes;
+  int      free_after;   // pass index after which the current user is done
+  bool     used;         // assigned this frame
+  uint32_t idle_frames;
+} fg_pooled_texture;
+
+typedef struct {
+  size_t passes;
+  size_t passes_culled;
+  size_t transient_textures;  // transient resources used by live passes
+  size_t physical_textures;   // pooled textures backing them after aliasing
+  size_t transient_bytes;     // what the transients would take without aliasing
+  size_t aliased_bytes;       // what the physical textures backing them take
+  size_t pool_bytes;          // everything the pool holds, used or idle
+} frame_graph_stats;
+
+struct frame_graph {
+  fg_pass     passes[FRAME_GRAPH_MAX_PASSES];
+  size_t      pass_count;
+  fg_resource resources[FRAME_GRAPH_MAX_RESOURCES];
+  size_t      resource_count;
+
+  fg_pooled_texture *pool;
+  size_t            pool_count;
+  size_t            pool_capacity;
+
+  uint32_t     fbo;       // re-attached for every pass writing transient textures
+  gpu_profiler *profiler; // optional, every executed pass becomes a scope
+  frame_graph_stats stats;
+};
+
+void frame_graph_init(frame_graph *fg);
+void frame_graph_destroy(frame_graph *fg);
+
+// drops last frame's passes and resources, pooled textures are kept
+void frame_graph_reset(frame_graph *fg);
+
+fg_handle frame_graph_create_texture(frame_graph *fg, const char *name, int width, int height,
+                                     uint32_t format);
+fg_handle frame_graph_import_texture(frame_graph *fg, const char *name, uint32_t texture);
+fg_handle frame_graph_import_framebuffer(frame_graph *fg, const char *name, uint32_t framebuffer,
+                                         int width, int height);
+
+// passes execute in the order they are added
+fg_handle frame_graph_add_pass(frame_graph *fg, const char *name, fg_execute_fn execute, void *ctx);
+void      frame_graph_read(frame_graph *fg, fg_handle pass, fg_handle resource);
+void      frame_graph_write(frame_graph *fg, fg_handle pass, fg_handle resource);
+void      frame_graph_set_side_effect(frame_graph *fg, fg_handle pass);
+
+// culls passes whose outputs are never consumed and assigns pooled textures,
+// transients whose lifetimes do not overlap share one texture
+void frame_graph_compile(frame_graph *fg);
+
+// binds each live pass's outputs, a framebuffer write or the transient
+// attachments with the viewport at their size, then runs it
+void frame_graph_execute(frame_graph *fg);
+
+// physical texture behind a resource, valid from compile to the next reset
+uint32_t frame_graph_texture(const frame_graph *fg, fg_handle resource);
+
+#endif
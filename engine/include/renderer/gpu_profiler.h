@@ -0,0 +1,65 @@
+#ifndef ATOM_GPU_PROFILER_H
+#define ATOM_GPU_PROFILER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define GPU_PROFILER_MAX_SCOPES 32
+// frames of queries in flight, results are read this many frames late at most
+#define GPU_PROFILER_FRAMES     4
+
+typedef struct {
+  const char *name;
+  uint32_t   depth;
+  uint32_t   begin_query;
+  uint32_t   end_query;
+} gpu_scope;
+
+// GL_TIMESTAMP queries written during one frame
+typedef struct {
+  uint32_t  queries[2 * GPU_PROFILER_MAX_SCOPES + 2];
+  gpu_scope scopes[GPU_PROFILER_MAX_SCOPES];
+  size_t    scope_count;
+  size_t    query_count;
+  uint64_t  number;
+  bool      pending;  // submitted and not read back yet
+} gpu_profiler_frame;
+
+typedef struct {
+  const char *name;
+  uint32_t   depth;  // nesting level, 0 for top level passes
+  float      ms;
+} gpu_timing;
+
+typedef struct {
+  gpu_profiler_frame frames[GPU_PROFILER_FRAMES];
+  uint64_t frame_number;  // frames begun so far
+  size_t   stack[GPU_PROFILER_MAX_SCOPES];
+  size_t   depth;
+  size_t   overflow;  // scopes begun past the nesting limit, ended without popping
+  bool     in_frame;
+
+  // latest frame whose queries were available, never waited on
+  gpu_timing timings[GPU_PROFILER_MAX_SCOPES];
+  size_t     timing_count;
+  float      frame_ms;
+  uint64_t   result_frame;   // frame number the timings belong to
+  uint64_t   frames_dropped; // frames whose slot was reused before the gpu finished them
+} gpu_profiler;
+
+void gpu_profiler_init(gpu_profiler *p);
+void gpu_profiler_destroy(gpu_profiler *p);
+
+// reads back every finished frame without stalling, then starts timing a new one
+void gpu_profiler_begin_frame(gpu_profiler *p);
+void gpu_profiler_end_frame(gpu_profiler *p);
+
+// scopes nest, name must outlive the results (string literals)
+void gpu_profiler_begin(gpu_profiler *p, const char *name);
+void gpu_profiler_end(gpu_profiler *p);
+
+// gpu time of the named top level or nested scope in the latest results, 0 if absent
+float gpu_profiler_scope_ms(const gpu_profiler *p, const char *name);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ATOM_LIT_SHADERS_H
+#define ATOM_LIT_SHADERS_H
+
+#include <lib/la.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// features of a lit variant, each one a define of the lit shader source
+#define LIT_PACKED_NORMALS 0x1u  // octahedral normals of the packed vertex formats
+#define LIT_FLAT_SHADING   0x2u
+#define LIT_CLUSTERED      0x4u  // scene lights from the cluster grid
+#define LIT_SHADOWS        0x8u  // cascaded sun shadows, only with LIT_CLUSTERED
+#define LIT_VARIANT_COUNT  16
+
+// one permutation with its own uniform locations, refetched whenever a hot
+// reload replaces its program
+typedef struct {
+  uint32_t shader;  // shader_handle, 0 until first used
+  uint32_t program;
+  uint32_t generation;
+  int32_t  model_loc, view_loc, proj_loc, normal_loc;
+  int32_t  ambient_loc, color_loc;
+  int32_t  light_pos_loc, light_color_loc, view_pos_loc;  // unclustered variants only
+} lit_variant;
+
+// the lit shader the scene draws with, indexed by feature bits so choosing
+// the variant of a draw is a lookup
+typedef struct {
+  const char  *vs_path;  // NULL until set, the scene then draws nothing lit
+  const char  *fs_path;
+  lit_variant variants[LIT_VARIANT_COUNT];
+} lit_shaders;
+
+void lit_shaders_init(lit_shaders *ls, const char *vs_path, const char *fs_path);
+
+// builds every listed feature set in parallel, meant for level loading so
+// no variant is first compiled mid frame
+void lit_shaders_warm_up(lit_shaders *ls, const uint32_t *features, size_t count);
+
+// binds the variant for features without blocking, a variant that was not
+// warmed up starts building on first use. NULL while it has no program yet
+// or when it failed to build, so the caller skips those draws
+const lit_variant *lit_shaders_use(lit_shaders *ls, uint32_t features);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef ATOM_OCCLUSION_H
+#define ATOM_OCCLUSION_H
+
+#include <assets/mesh.h>
+#include <lib/la.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OCCLUSION_WIDTH  256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_BANDS  8
+
+// low resolution cpu depth buffer of designated occluders
+typedef struct {
+  float  *depth;        // OCCLUSION_WIDTH * OCCLUSION_HEIGHT ndc depth in [0, 1]
+  float  *triangles;    // screen space x, y, z for three vertices per triangle
+  size_t triangle_count;
+  size_t triangle_capacity;
+  mat4   view_proj;
+} occlusion_buffer;
+
+void occlusion_init(occlusion_buffer *ob);
+void occlusion_destroy(occlusion_buffer *ob);
+
+void occlusion_begin(occlusion_buffer *ob, const mat4 *view_proj);
+void occlusion_add_occluder(occlusion_buffer *ob, const mesh *m, const mat4 *world);
+void occlusion_rasterize(occlusion_buffer *ob);
+
+// false when the box is fully hidden behind rasterized occluders or off screen
+bool occlusion_test_aabb(const occlusion_buffer *ob, const float min[3], const float max[3],
+                         const mat4 *world);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ATOM_RESOLUTION_H
+#define ATOM_RESOLUTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+  RESOLUTION_PRESET_PERFORMANCE,  // bilinear upscale, scale may drop to half
+  RESOLUTION_PRESET_QUALITY       // contrast adaptive sharpening, higher minimum scale
+} resolution_preset;
+
+// frame time controller and upscale pass for a scene rendered offscreen. the
+// target is expected at output size with only a corner of it rendered, so
+// scale changes never reallocate
+typedef struct {
+  uint32_t program;
+  uint32_t vao;
+  int32_t  uv_scale_loc, texel_loc, sharpness_loc;
+
+  resolution_preset preset;
+  float target_ms;   // gpu frame time the controller holds
+  float scale;       // current fraction of the output size on each axis
+  float min_scale;
+  float max_scale;
+  float sharpness;   // 0 disables the sharpening pass
+  int   render_width, render_height;
+  uint64_t last_sample;  // profiler frame the scale was last adjusted for
+} resolution_scaler;
+
+void resolution_scaler_init(resolution_scaler *rs);
+void resolution_scaler_destroy(resolution_scaler *rs);
+void resolution_scaler_set_preset(resolution_scaler *rs, resolution_preset preset);
+
+// moves the scale toward the target given a measured gpu frame time,
+// sample identifies the measurement so each one is only applied once
+void resolution_scaler_update(resolution_scaler *rs, float gpu_ms, uint64_t sample);
+
+// picks render_width and render_height for this frame
+void resolution_scaler_prepare(resolution_scaler *rs, int output_width, int output_height);
+// stretches the rendered corner of a target_width x target_height texture
+// over the bound framebuffer's viewport
+void resolution_scaler_upscale(resolution_scaler *rs, uint32_t texture,
+                               int target_width, int target_height);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef ATOM_SHADOWS_H
+#define ATOM_SHADOWS_H
+
+#include <components/light.h>
+#include <components/camera.h>
+#include <lib/la.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHADOW_CASCADES       4
+#define SHADOW_CACHED_FROM    2  // cascades from this index on keep their static casters cached
+#define SHADOW_RESOLUTION     2048
+#define SHADOW_TEXTURE_UNIT   4  // sampler2DArrayShadow binding shared with the lit shaders
+#define SHADOW_PARAMS_BINDING 1  // ubo of shadow_params
+
+// std140 layout read by the lit shaders
+typedef struct {
+  float matrices[SHADOW_CASCADES][16];  // world to shadow map uv and depth, row major
+  float splits[SHADOW_CASCADES];        // far view depth of each cascade
+  float texel_sizes[SHADOW_CASCADES];   // world size of one shadow texel
+  float info[4];                        // enabled, depth bias, cascade count
+} shadow_params;
+
+#define SHADOW_CACHED_LAYERS (SHADOW_CASCADES - SHADOW_CACHED_FROM)
+
+typedef struct {
+  uint32_t texture;        // depth array with one layer per cascade, sampled by the shaders
+  uint32_t fbos[SHADOW_CASCADES];
+  uint32_t cache_texture;  // static casters of the cached cascades
+  uint32_t cache_fbos[SHADOW_CACHED_LAYERS];
+  uint32_t program;
+  int32_t  mvp_loc;
+  uint32_t params_ubo;
+
+  float max_distance;  // view depth covered by the last cascade
+  float split_lambda;  // blend between uniform and logarithmic splits
+  float depth_bias;
+
+  mat4  light_rotation;
+  mat4  view_proj[SHADOW_CASCADES];
+  float splits[SHADOW_CASCADES];
+  float radius[SHADOW_CASCADES];
+  float center[SHADOW_CASCADES][3];  // light space, snapped to texels
+  float depth_range[SHADOW_CASCADES][2];
+
+  // what the cached cascades were rendered with
+  bool     valid[SHADOW_CASCADES];
+  vec3     cached_direction;
+  uint64_t cached_static_hash;
+
+  bool     redraw[SHADOW_CASCADES];       // set by shadow_maps_update for this frame
+  bool     has_dynamic[SHADOW_CASCADES];  // live layer holds dynamic casters over the cache
+  bool     active;
+
+  // state restored by shadow_maps_end
+  int32_t saved_fbo;
+  int32_t saved_program;
+  int32_t saved_viewport[4];
+  bool    in_pass;
+} shadow_maps;
+
+void shadow_maps_init(shadow_maps *sm);
+void shadow_maps_destroy(shadow_maps *sm);
+
+// fits the cascades to the camera and decides which ones redraw this frame,
+// static_hash changes whenever static geometry moves, appears or goes away
+void shadow_maps_update(shadow_maps *sm, const camera_component *cam, const light_component *light,
+                        uint64_t static_hash);
+
+// false when the sphere lies outside the cascade's light frustum
+bool shadow_maps_cascade_visible(const shadow_maps *sm, int cascade, vec3 center, float radius);
+
+// binds and clears the live layer, or for cached cascades the static cache layer
+void shadow_maps_begin_cascade(shadow_maps *sm, int cascade, bool cache);
+// copies the cached static casters into the live layer so dynamic ones can be drawn on top
+void shadow_maps_restore_cache(shadow_maps *sm, int cascade);
+void shadow_maps_set_model(shadow_maps *sm, int cascade, const mat4 *model);
+void shadow_maps_end(shadow_maps *sm);
+
+// binds the shadow texture and parameters, or marks shadows disabled
+void shadow_maps_bind(shadow_maps *sm);
+
+#endif
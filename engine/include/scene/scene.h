@@ -3,7 +3,46 @@
 
 #include <scene/entity.h>
 #include <scene/components.h>
+#include <renderer/occlusion.h>
+#include <renderer/clusters.h>
+#include <renderer/shadows.h>
+#include <renderer/gpu_profiler.h>
+#include <renderer/resolution.h>
+#include <renderer/frame_graph.h>
+#include <renderer/depth_prepass.h>
+#include <renderer/lit_shaders.h>
+#include <assets/gltf.h>
+#include <assets/assets.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+// counters reset by every scene_render
+typedef struct {
+  size_t draw_calls;
+  size_t triangles_submitted;  // triangles in the selected lods
+  size_t triangles_rendered;   // triangles left after cluster culling
+  size_t meshlets_visible;
+  size_t meshlets_culled;
+  size_t objects_occluded;
+  size_t occluder_triangles;  // triangles rasterized into the occlusion buffer
+  size_t light_references;    // light indices summed over all clusters
+  size_t shadow_cascades_rendered;
+  size_t shadow_draw_calls;
+  size_t prepass_draw_calls;
+  float gpu_frame_ms;  // latest finished frame, a few frames old
+  float resolution_scale;  // fraction of the output size rendered, 1 without dynamic resolution
+  size_t bytes_streamed;   // mesh data uploaded for streamed renderers
+  size_t streams_pending;  // streamed renderers still drawing their placeholder
+} render_stats;
+
+// a renderer drawing an asset that may still be loading, see scene_stream_mesh
+typedef struct {
+  entity_id     entity;
+  asset_handle  asset;      // the scene's own reference
+  vertex_format format;
+  bool          uploading;
+  bool          done;       // switched over, or given up on a failed load
+} mesh_stream;
 
 typedef struct {
   transform_component *transforms;
@@ -26,7 +65,34 @@ typedef struct {
   size_t controller_count;
   size_t controller_capacity;
 
+  mesh_stream *streams;
+  size_t stream_count;
+  size_t stream_capacity;
+
   entity_id active_camera;
+
+  float lod_threshold;  // max screen space error in pixels before a finer lod is used
+  bool cluster_culling; // frustum and backface cone culling of meshlets, needs GL_CULL_FACE
+  bool occlusion_culling; // skip objects hidden behind mesh renderers marked as occluders
+  bool clustered_lighting; // bin scene lights into the froxel grid for the clustered shaders
+  bool gpu_profiling; // time every pass with timestamp queries, results in profiler
+  bool dynamic_resolution; // render at a scale holding resolution.target_ms, then upscale
+  bool depth_prepass; // lay down depth first so the lit pass shades each pixel once
+
+  size_t upload_budget_bytes; // streamed mesh data written to the gpu per frame
+  float upload_budget_ms;     // stops writing early once this much cpu time went to it
+
+  occlusion_buffer occlusion;
+  light_clusters clusters;
+  shadow_maps shadows;  // driven by the first shadow casting directional light
+  gpu_profiler profiler;
+  resolution_scaler resolution;
+  frame_graph graph;  // rebuilt by every scene_render, keeps its texture pool
+  depth_prepass prepass;
+  lit_shaders lit;  // set with lit_shaders_init after scene_init
+  vec3 ambient;     // added by the clustered variants ahead of every light
+
+  render_stats stats;
 } scene;
 
 void scene_init(scene *s);
@@ -46,6 +112,24 @@ light_component* scene_get_light(scene *s, entity_id id);
 camera_component* scene_get_camera(scene *s, entity_id id);
 controller_component* scene_get_controller(scene *s, entity_id id);
 
+// moves fresh into m and re-uploads every renderer drawing m, so the
+// pointer held by components keeps working across a reimport
+size_t scene_replace_mesh(scene *s, mesh *m, mesh *fresh);
+
+// renderer for an asset loaded with asset_load_mesh_async. placeholder, when
+// given, draws until the asset is ready, then scene_render uploads the real
+// mesh over as many frames as the upload budget needs. a failed load keeps
+// the placeholder. the scene holds its own reference until it is destroyed
+mesh_renderer_component* scene_stream_mesh(scene *s, entity_id id, asset_handle asset,
+                                           vertex_format format, mesh *placeholder);
+
+// an entity per node, its transform parented as in the file and roots
+// parented to parent, plus a renderer for every node with a mesh. the
+// renderers draw the model's meshes, so the model must outlive them. out
+// receives the entities in node order when given, returns how many
+size_t scene_instantiate_gltf(scene *s, gltf_model *model, entity_id parent, vertex_format format,
+                              entity_id *out);
+
 void scene_update_transforms(scene *s);
 void scene_render(scene *s);
 
@@ -0,0 +1,551 @@
+// MAP_ANONYMOUS is not in POSIX, decompressed entries live in anonymous
+// mappings so every asset_file is released the same way
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#include <assets/archive.h>
+#include <assets/assets.h>
+#include <lib/jobs.h>
+#include <lib/lz4.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAX_MOUNTS 16
+
+struct archive {
+  int                  fd;        // kept open to map stored entries
+  const uint8_t        *data;
+  size_t               size;
+  const archive_header *header;
+  const uint32_t       *slots;
+  const archive_entry  *entries;
+  const archive_chunk  *chunks;
+  const char           *names;
+};
+
+typedef struct {
+  archive *archive;
+  char    *root;  // normalized
+  size_t  root_len;
+} mount_point;
+
+static mount_point     mounts[MAX_MOUNTS];
+static size_t          mount_count;
+static pthread_mutex_t mount_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t hash_name(const char *name, size_t size) {
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    h = (h ^ (unsigned char)name[i]) * 1099511628211ull;
+  }
+  return h;
+}
+
+// lives with the file layer so loaders link without the asset manager
+bool asset_normalize_path(const char *path, char *out, size_t size) {
+  if (!path || !*path || size < 2) return false;
+
+  char joined[PATH_MAX * 2];
+  if (path[0] == '/') {
+    if (strlen(path) >= sizeof(joined)) return false;
+    strcpy(joined, path);
+  } else {
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) return false;
+    int n = snprintf(joined, sizeof(joined), "%s/%s", cwd, path);
+    if (n < 0 || (size_t)n >= sizeof(joined)) return false;
+  }
+
+  // segments are appended one at a time, ".." drops back to the last slash
+  size_t len = 0;
+  const char *s = joined;
+  while (*s) {
+    while (*s == '/') s++;
+    const char *end = s;
+    while (*end && *end != '/') end++;
+    size_t n = (size_t)(end - s);
+
+    if (n == 0 || (n == 1 && s[0] == '.')) {
+      // nothing to append
+    } else if (n == 2 && s[0] == '.' && s[1] == '.') {
+      while (len > 0 && out[len - 1] != '/') len--;
+      if (len > 0) len--;
+    } else {
+      if (len + 1 + n + 1 > size) return false;
+      out[len++] = '/';
+      memcpy(out + len, s, n);
+      len += n;
+    }
+    s = end;
+  }
+  if (len == 0) out[len++] = '/';
+  out[len] = '\0';
+  return true;
+}
+
+static bool range_valid(uint64_t offset, uint64_t size, uint64_t file_size) {
+  return offset <= file_size && size <= file_size - offset;
+}
+
+static bool entry_valid(const archive *a, const archive_entry *e) {
+  const archive_header *h = a->header;
+  if (!range_valid(e->name_offset, e->name_size, h->names_size) ||
+      e->hash != hash_name(a->names + e->name_offset, e->name_size)) {
+    return false;
+  }
+  if (e->chunk_count == 0) return range_valid(e->offset, e->size, a->size);
+
+  if (e->chunk_count != (e->size + ARCHIVE_CHUNK_SIZE - 1) / ARCHIVE_CHUNK_SIZE ||
+      e->first_chunk > h->chunk_count || e->chunk_count > h->chunk_count - e->first_chunk) {
+    return false;
+  }
+  for (uint32_t i = 0; i < e->chunk_count; i++) {
+    const archive_chunk *c = &a->chunks[e->first_chunk + i];
+    uint64_t raw = e->size - (uint64_t)i * ARCHIVE_CHUNK_SIZE;
+    if (raw > ARCHIVE_CHUNK_SIZE) raw = ARCHIVE_CHUNK_SIZE;
+    if (c->raw_size != raw || c->size > lz4_compress_bound(raw) ||
+        !range_valid(c->offset, c->size, a->size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool contents_valid(archive *a) {
+  const archive_header *h = a->header;
+  uint64_t n = h->entry_count, s = h->slot_count;
+  if (memcmp(h->magic, ARCHIVE_MAGIC, 4) != 0 || h->version != ARCHIVE_VERSION ||
+      h->file_size != a->size || h->chunk_size != ARCHIVE_CHUNK_SIZE) {
+    return false;
+  }
+  if (s == 0 || (s & (s - 1)) != 0 || s <= n) return false;
+  if (h->slots_offset % 8 || h->entries_offset % 8 || h->chunks_offset % 8 ||
+      h->chunk_count > a->size / sizeof(archive_chunk) ||
+      !range_valid(h->slots_offset, s * sizeof(uint32_t), a->size) ||
+      !range_valid(h->entries_offset, n * sizeof(archive_entry), a->size) ||
+      !range_valid(h->chunks_offset, h->chunk_count * sizeof(archive_chunk), a->size) ||
+      !range_valid(h->names_offset, h->names_size, a->size)) {
+    return false;
+  }
+
+  a->slots = (const uint32_t *)(a->data + h->slots_offset);
+  a->entries = (const archive_entry *)(a->data + h->entries_offset);
+  a->chunks = (const archive_chunk *)(a->data + h->chunks_offset);
+  a->names = (const char *)(a->data + h->names_offset);
+  for (uint64_t i = 0; i < s; i++) {
+    if (a->slots[i] > n) return false;
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    if (!entry_valid(a, &a->entries[i])) return false;
+  }
+  return true;
+}
+
+archive *archive_open(const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "archive_open: cannot open '%s'\n", path);
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(archive_header)) {
+    fprintf(stderr, "archive_open: '%s' is too small\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  // only the table of contents and the chunks that get read are paged in
+  size_t size = (size_t)st.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "archive_open: cannot map '%s'\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  archive *a = calloc(1, sizeof(archive));
+  a->fd = fd;
+  a->data = data;
+  a->size = size;
+  a->header = data;
+  if (!contents_valid(a)) {
+    fprintf(stderr, "archive_open: '%s' is not a version %d archive\n", path, ARCHIVE_VERSION);
+    archive_close(a);
+    return NULL;
+  }
+  return a;
+}
+
+void archive_close(archive *a) {
+  if (!a) return;
+  munmap((void *)a->data, a->size);
+  close(a->fd);
+  free(a);
+}
+
+static const archive_entry *find_entry(const archive *a, const char *name) {
+  size_t len = strlen(name);
+  uint64_t hash = hash_name(name, len);
+  uint32_t mask = a->header->slot_count - 1;
+  uint32_t slot = (uint32_t)hash & mask;
+  for (uint32_t probe = 0; probe <= mask; probe++, slot = (slot + 1) & mask) {
+    uint32_t index = a->slots[slot];
+    if (index == 0) return NULL;
+    const archive_entry *e = &a->entries[index - 1];
+    if (e->hash == hash && e->name_size == len && memcmp(a->names + e->name_offset, name, len) == 0) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static uint8_t *map_anonymous(size_t size) {
+  void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return data == MAP_FAILED ? NULL : data;
+}
+
+typedef struct {
+  const archive       *archive;
+  const archive_entry *entry;
+  uint8_t             *out;
+  size_t              corrupt;
+} unpack_job;
+
+static void unpack_chunk(void *ctx, size_t index) {
+  unpack_job *job = ctx;
+  const archive_chunk *c = &job->archive->chunks[job->entry->first_chunk + index];
+  const uint8_t *src = job->archive->data + c->offset;
+  uint8_t *dst = job->out + index * ARCHIVE_CHUNK_SIZE;
+
+  if (c->size == c->raw_size) {
+    memcpy(dst, src, c->size);
+  } else if (!lz4_decompress(src, c->size, dst, c->raw_size)) {
+    __atomic_add_fetch(&job->corrupt, 1, __ATOMIC_RELAXED);
+  }
+}
+
+bool archive_map(const archive *a, const char *name, bool writable, asset_file *out) {
+  *out = (asset_file){ NULL, 0 };
+  const archive_entry *e = find_entry(a, name);
+  if (!e) return false;
+  size_t size = (size_t)e->size;
+  if (size == 0) return true;
+
+  int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  if (e->chunk_count == 0) {
+    // stored entries share the page cache with the archive, unless pages
+    // are larger than the alignment they were written at
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0 && e->offset % (uint64_t)page == 0) {
+      void *data = mmap(NULL, size, prot, MAP_PRIVATE, a->fd, (off_t)e->offset);
+      if (data != MAP_FAILED) {
+        *out = (asset_file){ data, size };
+        return true;
+      }
+    }
+  }
+
+  uint8_t *data = map_anonymous(size);
+  if (!data) return false;
+  if (e->chunk_count == 0) {
+    memcpy(data, a->data + e->offset, size);
+  } else {
+    unpack_job job = { a, e, data, 0 };
+    jobs_parallel_for(e->chunk_count, unpack_chunk, &job);
+    if (job.corrupt) {
+      fprintf(stderr, "archive: %zu corrupt chunks in '%s'\n", job.corrupt, name);
+      munmap(data, size);
+      return false;
+    }
+  }
+  if (!writable) mprotect(data, size, PROT_READ);
+  *out = (asset_file){ data, size };
+  return true;
+}
+
+typedef struct {
+  const uint8_t *src;
+  size_t        raw_size;
+  uint8_t       *out;
+  size_t        size;  // raw_size when compressing did not pay off
+} pack_chunk;
+
+static void pack_chunk_job(void *ctx, size_t index) {
+  pack_chunk *c = (pack_chunk *)ctx + index;
+  size_t bound = lz4_compress_bound(c->raw_size);
+  c->out = malloc(bound);
+  c->size = lz4_compress(c->src, c->raw_size, c->out, bound);
+  if (c->size == 0 || c->size >= c->raw_size) c->size = c->raw_size;
+}
+
+typedef struct {
+  FILE     *file;
+  uint64_t offset;
+  bool     ok;
+} archive_writer;
+
+static void write_bytes(archive_writer *w, uint64_t offset, const void *data, size_t size) {
+  static const uint8_t zeros[ARCHIVE_ALIGNMENT];
+  while (w->offset < offset) {
+    size_t pad = offset - w->offset < sizeof(zeros) ? (size_t)(offset - w->offset) : sizeof(zeros);
+    if (fwrite(zeros, 1, pad, w->file) != pad) w->ok = false;
+    w->offset += pad;
+  }
+  if (size && fwrite(data, 1, size, w->file) != size) w->ok = false;
+  w->offset += size;
+}
+
+static uint64_t align_up(uint64_t v, uint64_t alignment) {
+  return (v + alignment - 1) / alignment * alignment;
+}
+
+bool archive_write(const char *path, const archive_source *sources, size_t count) {
+  if (count >= UINT32_MAX / 2) {
+    fprintf(stderr, "archive_write: too many files\n");
+    return false;
+  }
+
+  asset_file *files = calloc(count ? count : 1, sizeof(asset_file));
+  archive_entry *entries = calloc(count ? count : 1, sizeof(archive_entry));
+  uint32_t slot_count = 1;
+  while (slot_count <= count * 2) slot_count <<= 1;
+  uint32_t *slots = calloc(slot_count, sizeof(uint32_t));
+  size_t names_size = 0, chunk_total = 0;
+  bool ok = true;
+
+  for (size_t i = 0; i < count && ok; i++) {
+    if (!asset_file_map(sources[i].path, false, &files[i])) {
+      fprintf(stderr, "archive_write: cannot read '%s'\n", sources[i].path);
+      ok = false;
+      break;
+    }
+    archive_entry *e = &entries[i];
+    size_t len = strlen(sources[i].name);
+    e->hash = hash_name(sources[i].name, len);
+    e->size = files[i].size;
+    e->name_offset = names_size;
+    e->name_size = (uint32_t)len;
+    names_size += len;
+    if (sources[i].compress && files[i].size > 0) {
+      e->first_chunk = chunk_total;
+      e->chunk_count = (uint32_t)((files[i].size + ARCHIVE_CHUNK_SIZE - 1) / ARCHIVE_CHUNK_SIZE);
+      chunk_total += e->chunk_count;
+    }
+
+    uint32_t mask = slot_count - 1, slot = (uint32_t)e->hash & mask;
+    while (slots[slot] && ok) {
+      const archive_source *other = &sources[slots[slot] - 1];
+      if (strcmp(other->name, sources[i].name) == 0) {
+        fprintf(stderr, "archive_write: '%s' is packed twice\n", sources[i].name);
+        ok = false;
+      }
+      slot = (slot + 1) & mask;
+    }
+    slots[slot] = (uint32_t)i + 1;
+  }
+
+  // every chunk of every file is compressed at once, files that do not
+  // shrink by a sixteenth are then stored whole
+  pack_chunk *chunks = calloc(chunk_total ? chunk_total : 1, sizeof(pack_chunk));
+  size_t kept = 0;
+  if (ok) {
+    for (size_t i = 0; i < count; i++) {
+      for (uint32_t c = 0; c < entries[i].chunk_count; c++) {
+        size_t start = (size_t)c * ARCHIVE_CHUNK_SIZE;
+        size_t raw = files[i].size - start;
+        chunks[entries[i].first_chunk + c] = (pack_chunk){
+          files[i].data + start, raw < ARCHIVE_CHUNK_SIZE ? raw : ARCHIVE_CHUNK_SIZE, NULL, 0
+        };
+      }
+    }
+    jobs_parallel_for(chunk_total, pack_chunk_job, chunks);
+
+    for (size_t i = 0; i < count; i++) {
+      archive_entry *e = &entries[i];
+      uint64_t packed = 0;
+      for (uint32_t c = 0; c < e->chunk_count; c++) packed += chunks[e->first_chunk + c].size;
+      if (e->chunk_count && packed > e->size - e->size / 16) e->chunk_count = 0;
+      kept += e->chunk_count;
+    }
+  }
+
+  archive_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, ARCHIVE_MAGIC, 4);
+  h.version = ARCHIVE_VERSION;
+  h.entry_count = (uint32_t)count;
+  h.slot_count = slot_count;
+  h.chunk_count = kept;
+  h.chunk_size = ARCHIVE_CHUNK_SIZE;
+  h.slots_offset = sizeof(archive_header);
+  h.entries_offset = align_up(h.slots_offset + (uint64_t)slot_count * sizeof(uint32_t), 8);
+  h.chunks_offset = h.entries_offset + count * sizeof(archive_entry);
+  h.names_offset = h.chunks_offset + kept * sizeof(archive_chunk);
+  h.names_size = names_size;
+
+  // data follows the names in source order, stored entries page aligned
+  archive_chunk *table = calloc(kept ? kept : 1, sizeof(archive_chunk));
+  size_t *packed_first = calloc(count ? count : 1, sizeof(size_t));
+  uint64_t offset = h.names_offset + names_size;
+  size_t next_chunk = 0;
+  for (size_t i = 0; i < count && ok; i++) {
+    archive_entry *e = &entries[i];
+    if (e->chunk_count == 0) {
+      if (e->size) offset = align_up(offset, ARCHIVE_ALIGNMENT);
+      e->offset = offset;
+      e->first_chunk = 0;
+      offset += e->size;
+      continue;
+    }
+    const pack_chunk *src = &chunks[e->first_chunk];
+    packed_first[i] = (size_t)e->first_chunk;
+    e->offset = offset;
+    e->first_chunk = next_chunk;
+    for (uint32_t c = 0; c < e->chunk_count; c++) {
+      table[next_chunk++] = (archive_chunk){ offset, (uint32_t)src[c].size, (uint32_t)src[c].raw_size };
+      offset += src[c].size;
+    }
+  }
+  h.file_size = offset;
+
+  size_t path_len = strlen(path);
+  char *tmp_path = malloc(path_len + 5);
+  memcpy(tmp_path, path, path_len);
+  memcpy(tmp_path + path_len, ".tmp", 5);
+
+  archive_writer w = { NULL, 0, ok };
+  if (ok) {
+    w.file = fopen(tmp_path, "wb");
+    if (!w.file) {
+      fprintf(stderr, "archive_write: cannot open '%s'\n", tmp_path);
+      w.ok = ok = false;
+    }
+  }
+
+  if (w.file) {
+    write_bytes(&w, 0, &h, sizeof(h));
+    write_bytes(&w, h.slots_offset, slots, slot_count * sizeof(uint32_t));
+    write_bytes(&w, h.entries_offset, entries, count * sizeof(archive_entry));
+    write_bytes(&w, h.chunks_offset, table, kept * sizeof(archive_chunk));
+    for (size_t i = 0; i < count; i++) {
+      write_bytes(&w, h.names_offset + entries[i].name_offset, sources[i].name, entries[i].name_size);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      const archive_entry *e = &entries[i];
+      if (e->chunk_count == 0) {
+        write_bytes(&w, e->offset, files[i].data, (size_t)e->size);
+        continue;
+      }
+      for (uint32_t c = 0; c < e->chunk_count; c++) {
+        const archive_chunk *t = &table[e->first_chunk + c];
+        const pack_chunk *p = &chunks[packed_first[i] + c];
+        write_bytes(&w, t->offset, t->size == t->raw_size ? p->src : p->out, t->size);
+      }
+    }
+
+    if (fclose(w.file) != 0) w.ok = false;
+    if (w.ok && rename(tmp_path, path) != 0) w.ok = false;
+    if (!w.ok) {
+      fprintf(stderr, "archive_write: failed writing '%s'\n", path);
+      remove(tmp_path);
+    }
+  }
+
+  for (size_t i = 0; i < chunk_total; i++) free(chunks[i].out);
+  for (size_t i = 0; i < count; i++) asset_file_unmap(&files[i]);
+  free(tmp_path);
+  free(chunks);
+  free(table);
+  free(packed_first);
+  free(slots);
+  free(entries);
+  free(files);
+  return w.ok;
+}
+
+static const char *entry_name(const mount_point *m, const char *path) {
+  if (m->root_len == 1) return path + 1;
+  if (strncmp(path, m->root, m->root_len) != 0 || path[m->root_len] != '/') return NULL;
+  return path + m->root_len + 1;
+}
+
+bool archive_mount(const char *path, const char *root) {
+  char normalized[PATH_MAX];
+  if (!asset_normalize_path(root ? root : ".", normalized, sizeof(normalized))) {
+    fprintf(stderr, "archive_mount: cannot resolve root of '%s'\n", path);
+    return false;
+  }
+  archive *a = archive_open(path);
+  if (!a) return false;
+
+  pthread_mutex_lock(&mount_lock);
+  if (mount_count == MAX_MOUNTS) {
+    pthread_mutex_unlock(&mount_lock);
+    fprintf(stderr, "archive_mount: more than %d archives mounted\n", MAX_MOUNTS);
+    archive_close(a);
+    return false;
+  }
+  mounts[mount_count++] = (mount_point){ a, strdup(normalized), strlen(normalized) };
+  pthread_mutex_unlock(&mount_lock);
+  return true;
+}
+
+void archive_unmount_all(void) {
+  pthread_mutex_lock(&mount_lock);
+  for (size_t i = 0; i < mount_count; i++) {
+    archive_close(mounts[i].archive);
+    free(mounts[i].root);
+  }
+  mount_count = 0;
+  pthread_mutex_unlock(&mount_lock);
+}
+
+bool asset_file_map(const char *path, bool writable, asset_file *out) {
+  *out = (asset_file){ NULL, 0 };
+  int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+
+  // loose files win, so edited sources are picked up over a packed build
+  int fd = open(path, O_RDONLY);
+  if (fd >= 0) {
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (ok && st.st_size > 0) {
+      void *data = mmap(NULL, (size_t)st.st_size, prot, MAP_PRIVATE, fd, 0);
+      ok = data != MAP_FAILED;
+      if (ok) *out = (asset_file){ data, (size_t)st.st_size };
+    }
+    close(fd);
+    return ok;
+  }
+
+  // archives are closed only once no load is running, so the snapshot stays
+  // valid with the lock released and loader threads unpack side by side
+  mount_point search[MAX_MOUNTS];
+  pthread_mutex_lock(&mount_lock);
+  size_t count = mount_count;
+  memcpy(search, mounts, count * sizeof(mount_point));
+  pthread_mutex_unlock(&mount_lock);
+  if (count == 0) return false;
+
+  char normalized[PATH_MAX];
+  if (!asset_normalize_path(path, normalized, sizeof(normalized))) return false;
+  for (size_t i = count; i-- > 0;) {
+    const char *name = entry_name(&search[i], normalized);
+    if (name && archive_map(search[i].archive, name, writable, out)) return true;
+  }
+  return false;
+}
+
+void asset_file_unmap(asset_file *file) {
+  if (file->data) munmap(file->data, file->size);
+  file->data = NULL;
+  file->size = 0;
+}
@@ -0,0 +1,551 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/assets.h>
+#include <assets/archive.h>
+#include <lib/jobs.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+
+#define INDEX_BITS 20
+#define INDEX_MASK ((1u << INDEX_BITS) - 1)
+#define MAX_ASSETS INDEX_MASK
+#define LOADER_THREADS 2
+
+// owned by a loader thread from the moment it leaves the queue until
+// assets_dispatch takes it off the completed list
+typedef struct asset_request asset_request;
+struct asset_request {
+  asset_request       *next;
+  uint32_t            index;
+  char                *path;
+  mesh_import_options options;
+  mesh                result;
+  bool                ok;
+  bool                done;
+};
+
+typedef struct {
+  uint64_t            key;
+  char                *path;     // normalized, NULL while the slot is free
+  mesh_import_options options;
+  mesh                *data;
+  asset_state         state;
+  asset_request       *request;  // while loading
+  bool                cached;    // reachable through the key table
+  uint32_t            refs;
+  uint32_t            generation;
+  uint32_t            next_free;
+} asset_entry;
+
+// slot 0 is reserved so ASSET_HANDLE_NONE never names an asset
+static asset_entry *entries;
+static uint32_t    entry_count;
+static uint32_t    entry_capacity;
+static uint32_t    free_list;
+
+// open addressing from key to slot index, 0 marks an empty slot
+static uint32_t *slots;
+static size_t   slot_capacity;
+static size_t   slot_used;
+
+static asset_stats stats;
+
+// the loader threads only touch requests, entries stay on the main thread
+static pthread_t       loaders[LOADER_THREADS];
+static size_t          loader_count;
+static bool            loaders_started;
+static bool            quitting;
+static asset_request   *pending, *pending_tail;
+static asset_request   *completed;
+static pthread_mutex_t lock     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake     = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  finished = PTHREAD_COND_INITIALIZER;
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t size) {
+  const unsigned char *p = data;
+  for (size_t i = 0; i < size; i++) {
+    h = (h ^ p[i]) * 1099511628211ull;
+  }
+  return h;
+}
+
+static char *copy_string(const char *s) {
+  size_t len = strlen(s);
+  char *out = malloc(len + 1);
+  memcpy(out, s, len + 1);
+  return out;
+}
+
+// zeroes whatever the enabled steps do not read, so equal imports compare
+// and hash equal whatever the caller left in the other fields
+static mesh_import_options canonical_options(const mesh_import_options *options) {
+  mesh_import_options o = { 0 };
+  if (!options) return o;
+  o.flags = options->flags & (MESH_IMPORT_NORMALS | MESH_IMPORT_OPTIMIZE |
+                              MESH_IMPORT_LODS | MESH_IMPORT_MESHLETS);
+  if ((o.flags & MESH_IMPORT_NORMALS) && options->crease_angle > 0.0f) {
+    o.crease_angle = options->crease_angle;
+  }
+  if ((o.flags & MESH_IMPORT_LODS) && options->lods.max_lods > 0) {
+    o.lods = options->lods;
+  } else {
+    o.flags &= ~MESH_IMPORT_LODS;
+  }
+  return o;
+}
+
+static bool same_options(const mesh_import_options *a, const mesh_import_options *b) {
+  return a->flags == b->flags && a->crease_angle == b->crease_angle &&
+         a->lods.max_lods == b->lods.max_lods && a->lods.reduction == b->lods.reduction &&
+         a->lods.error_budget == b->lods.error_budget;
+}
+
+static uint64_t options_key(const char *path, const mesh_import_options *o) {
+  uint64_t h = 14695981039346656037ull;
+  h = hash_bytes(h, path, strlen(path) + 1);
+  h = hash_bytes(h, &o->flags, sizeof(o->flags));
+  h = hash_bytes(h, &o->crease_angle, sizeof(o->crease_angle));
+  h = hash_bytes(h, &o->lods.max_lods, sizeof(o->lods.max_lods));
+  h = hash_bytes(h, &o->lods.reduction, sizeof(o->lods.reduction));
+  return hash_bytes(h, &o->lods.error_budget, sizeof(o->lods.error_budget));
+}
+
+static bool has_extension(const char *path, const char *ext) {
+  const char *dot = strrchr(path, '.');
+  return dot && strcmp(dot + 1, ext) == 0;
+}
+
+bool asset_import_mesh(const char *path, const mesh_import_options *options, mesh *out) {
+  load_mesh(path, out);
+  if (!out->positions || !out->indices || !out->vert_count || !out->idx_count) {
+    destroy_mesh(out);
+    return false;
+  }
+  if (!options || has_extension(path, "amesh")) return true;
+
+  mesh_import_options o = canonical_options(options);
+  if (o.flags & MESH_IMPORT_NORMALS) {
+    if (o.crease_angle > 0.0f) {
+      generate_normals_creased(out, o.crease_angle);
+    } else {
+      generate_normals(out);
+    }
+  }
+  if (o.flags & MESH_IMPORT_OPTIMIZE) mesh_optimize(out);
+  if (o.flags & MESH_IMPORT_LODS) mesh_generate_lods(out, &o.lods);
+  if (o.flags & MESH_IMPORT_MESHLETS) mesh_build_meshlets(out);
+  return true;
+}
+
+static asset_entry *resolve(asset_handle h) {
+  uint32_t index = h & INDEX_MASK;
+  if (index == 0 || index >= entry_count) return NULL;
+  asset_entry *e = &entries[index];
+  // entries released while their load is still running wait for dispatch
+  if (!e->path || e->refs == 0 || e->generation != h >> INDEX_BITS) return NULL;
+  return e;
+}
+
+static asset_handle handle_of(uint32_t index) {
+  return entries[index].generation << INDEX_BITS | index;
+}
+
+static void insert_slot(uint32_t index) {
+  size_t mask = slot_capacity - 1;
+  size_t i = (size_t)entries[index].key & mask;
+  while (slots[i]) i = (i + 1) & mask;
+  slots[i] = index;
+}
+
+static void grow_slots(void) {
+  free(slots);
+  slot_capacity = slot_capacity ? slot_capacity * 2 : 64;
+  slots = calloc(slot_capacity, sizeof(uint32_t));
+  for (uint32_t index = 1; index < entry_count; index++) {
+    if (entries[index].cached) insert_slot(index);
+  }
+}
+
+// backward shift deletion keeps every probe chain unbroken without tombstones
+static void remove_slot(uint32_t index) {
+  size_t mask = slot_capacity - 1;
+  size_t i = (size_t)entries[index].key & mask;
+  while (slots[i] != index) i = (i + 1) & mask;
+
+  for (size_t j = (i + 1) & mask; slots[j]; j = (j + 1) & mask) {
+    size_t home = (size_t)entries[slots[j]].key & mask;
+    // the entry at j may fill the hole at i unless its home lies between them
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+  slots[i] = 0;
+  slot_used--;
+}
+
+static uint32_t find(uint64_t key, const char *path, const mesh_import_options *o) {
+  if (!slot_capacity) return 0;
+  size_t mask = slot_capacity - 1;
+  for (size_t i = (size_t)key & mask; slots[i]; i = (i + 1) & mask) {
+    asset_entry *e = &entries[slots[i]];
+    if (e->key == key && strcmp(e->path, path) == 0 && same_options(&e->options, o)) {
+      return slots[i];
+    }
+  }
+  return 0;
+}
+
+static uint32_t allocate_entry(void) {
+  if (free_list) {
+    uint32_t index = free_list;
+    free_list = entries[index].next_free;
+    return index;
+  }
+  if (entry_count == 0) entry_count = 1;
+  if (entry_count > MAX_ASSETS) return 0;
+  if (entry_count >= entry_capacity) {
+    entry_capacity = entry_capacity ? entry_capacity * 2 : 16;
+    entries = realloc(entries, entry_capacity * sizeof(asset_entry));
+  }
+  entries[entry_count].generation = 0;
+  return entry_count++;
+}
+
+static void uncache(uint32_t index) {
+  if (!entries[index].cached) return;
+  remove_slot(index);
+  entries[index].cached = false;
+}
+
+static void unload(uint32_t index) {
+  asset_entry *e = &entries[index];
+  uncache(index);
+  if (e->data) {
+    destroy_mesh(e->data);
+    free(e->data);
+    stats.loaded--;
+    stats.unloads++;
+  }
+  free(e->path);
+  e->path = NULL;
+  e->data = NULL;
+  e->request = NULL;
+  e->refs = 0;
+  e->next_free = free_list;
+  free_list = index;
+}
+
+static uint32_t create_entry(const char *path, uint64_t key, const mesh_import_options *o) {
+  uint32_t index = allocate_entry();
+  if (!index) {
+    fprintf(stderr, "asset_load_mesh: more than %u assets loaded\n", MAX_ASSETS);
+    return 0;
+  }
+
+  // keep the table at most half full, grown before the new entry is live
+  if (2 * (slot_used + 1) > slot_capacity) grow_slots();
+
+  asset_entry *e = &entries[index];
+  // generation 0 would let a handle to slot 0 through, so it is skipped
+  e->generation = (e->generation + 1) & (UINT32_MAX >> INDEX_BITS);
+  if (e->generation == 0) e->generation = 1;
+  e->key = key;
+  e->path = copy_string(path);
+  e->options = *o;
+  e->data = NULL;
+  e->state = ASSET_LOADING;
+  e->request = NULL;
+  e->cached = true;
+  e->refs = 1;
+  e->next_free = 0;
+
+  insert_slot(index);
+  slot_used++;
+  return index;
+}
+
+static void free_request(asset_request *r) {
+  free(r->path);
+  free(r);
+}
+
+// hands the import result to its entry, or drops it when every reference
+// went away while it loaded
+static void publish(asset_request *r) {
+  asset_entry *e = &entries[r->index];
+  e->request = NULL;
+  stats.loading--;
+
+  if (e->refs == 0) {
+    if (r->ok) destroy_mesh(&r->result);
+    unload(r->index);
+  } else if (r->ok) {
+    e->data = malloc(sizeof(mesh));
+    *e->data = r->result;
+    e->state = ASSET_READY;
+    stats.loaded++;
+  } else {
+    fprintf(stderr, "asset_load_mesh: failed to load '%s'\n", e->path);
+    // a later request tries the file again
+    e->state = ASSET_FAILED;
+    uncache(r->index);
+  }
+  free_request(r);
+}
+
+static void *loader_main(void *arg) {
+  (void)arg;
+  jobs_mark_background();
+
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (!quitting && !pending) {
+      pthread_cond_wait(&wake, &lock);
+    }
+    if (quitting) break;
+
+    asset_request *r = pending;
+    pending = r->next;
+    if (!pending) pending_tail = NULL;
+    pthread_mutex_unlock(&lock);
+
+    r->ok = asset_import_mesh(r->path, &r->options, &r->result);
+
+    pthread_mutex_lock(&lock);
+    r->done = true;
+    r->next = completed;
+    completed = r;
+    pthread_cond_broadcast(&finished);
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+static void start_loaders(void) {
+  if (loaders_started) return;
+  loaders_started = true;
+
+  quitting = false;
+  for (size_t i = 0; i < LOADER_THREADS; i++) {
+    if (pthread_create(&loaders[i], NULL, loader_main, NULL) != 0) {
+      fprintf(stderr, "asset_load_mesh_async: could only start %zu of %d loaders\n",
+              i, LOADER_THREADS);
+      break;
+    }
+    loader_count++;
+  }
+}
+
+// removes a request no loader picked up yet, false once one has
+static bool take_pending(asset_request *r) {
+  pthread_mutex_lock(&lock);
+  asset_request **link = &pending;
+  while (*link && *link != r) link = &(*link)->next;
+  bool found = *link != NULL;
+  if (found) {
+    *link = r->next;
+    if (pending_tail == r) {
+      pending_tail = NULL;
+      for (asset_request *p = pending; p; p = p->next) pending_tail = p;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  return found;
+}
+
+// blocking requests finish a queued load themselves rather than wait in line
+static void wait_for(uint32_t index) {
+  asset_request *r = entries[index].request;
+  if (take_pending(r)) {
+    r->ok = asset_import_mesh(r->path, &r->options, &r->result);
+  } else {
+    pthread_mutex_lock(&lock);
+    while (!r->done) {
+      pthread_cond_wait(&finished, &lock);
+    }
+    asset_request **link = &completed;
+    while (*link != r) link = &(*link)->next;
+    *link = r->next;
+    pthread_mutex_unlock(&lock);
+  }
+  publish(r);
+}
+
+static asset_handle request_mesh(const char *path, const mesh_import_options *options, bool async) {
+  char normalized[PATH_MAX];
+  if (!asset_normalize_path(path, normalized, sizeof(normalized))) {
+    fprintf(stderr, "asset_load_mesh: path '%s' is too long\n", path);
+    return ASSET_HANDLE_NONE;
+  }
+  mesh_import_options o = canonical_options(options);
+  uint64_t key = options_key(normalized, &o);
+  stats.requests++;
+
+  uint32_t index = find(key, normalized, &o);
+  if (index) {
+    stats.hits++;
+    entries[index].refs++;
+  } else {
+    index = create_entry(normalized, key, &o);
+    if (!index) return ASSET_HANDLE_NONE;
+
+    asset_request *r = calloc(1, sizeof(asset_request));
+    r->index = index;
+    r->path = copy_string(normalized);
+    r->options = o;
+    entries[index].request = r;
+    stats.loading++;
+
+    if (async) start_loaders();
+    if (async && loader_count) {
+      pthread_mutex_lock(&lock);
+      if (pending_tail) {
+        pending_tail->next = r;
+      } else {
+        pending = r;
+      }
+      pending_tail = r;
+      pthread_cond_signal(&wake);
+      pthread_mutex_unlock(&lock);
+    } else {
+      r->ok = asset_import_mesh(normalized, &o, &r->result);
+      publish(r);
+    }
+  }
+
+  asset_handle h = handle_of(index);
+  if (async) return h;
+
+  if (entries[index].state == ASSET_LOADING) wait_for(index);
+  if (entries[index].state != ASSET_READY) {
+    asset_release(h);
+    return ASSET_HANDLE_NONE;
+  }
+  return h;
+}
+
+asset_handle asset_load_mesh(const char *path, const mesh_import_options *options) {
+  return request_mesh(path, options, false);
+}
+
+asset_handle asset_load_mesh_async(const char *path, const mesh_import_options *options) {
+  return request_mesh(path, options, true);
+}
+
+asset_handle asset_retain(asset_handle h) {
+  asset_entry *e = resolve(h);
+  if (!e) return ASSET_HANDLE_NONE;
+  e->refs++;
+  return h;
+}
+
+void asset_release(asset_handle h) {
+  asset_entry *e = resolve(h);
+  if (!e || --e->refs > 0) return;
+
+  uint32_t index = h & INDEX_MASK;
+  if (e->state == ASSET_LOADING) {
+    if (!take_pending(e->request)) {
+      // a loader holds the request, publish frees the slot once it is done
+      uncache(index);
+      return;
+    }
+    free_request(e->request);
+    stats.loading--;
+  }
+  unload(index);
+}
+
+uint32_t asset_ref_count(asset_handle h) {
+  asset_entry *e = resolve(h);
+  return e ? e->refs : 0;
+}
+
+mesh *asset_mesh(asset_handle h) {
+  asset_entry *e = resolve(h);
+  return e ? e->data : NULL;
+}
+
+asset_state asset_get_state(asset_handle h) {
+  asset_entry *e = resolve(h);
+  return e ? e->state : ASSET_NONE;
+}
+
+asset_weak_handle asset_weak(asset_handle h) {
+  return resolve(h) ? h : ASSET_HANDLE_NONE;
+}
+
+asset_handle asset_lock(asset_weak_handle w) {
+  return asset_retain(w);
+}
+
+asset_stats asset_get_stats(void) {
+  return stats;
+}
+
+size_t assets_dispatch(void) {
+  pthread_mutex_lock(&lock);
+  asset_request *r = completed;
+  completed = NULL;
+  pthread_mutex_unlock(&lock);
+
+  // completed is newest first, published in the order the loads finished
+  asset_request *ordered = NULL;
+  while (r) {
+    asset_request *next = r->next;
+    r->next = ordered;
+    ordered = r;
+    r = next;
+  }
+
+  size_t count = 0;
+  while (ordered) {
+    asset_request *next = ordered->next;
+    publish(ordered);
+    ordered = next;
+    count++;
+  }
+  return count;
+}
+
+void assets_shutdown(void) {
+  pthread_mutex_lock(&lock);
+  quitting = true;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+  for (size_t i = 0; i < loader_count; i++) {
+    pthread_join(loaders[i], NULL);
+  }
+  loader_count = 0;
+  loaders_started = false;
+  quitting = false;
+
+  // loads still queued are dropped, finished ones were never published
+  asset_request *lists[2] = { pending, completed };
+  for (int l = 0; l < 2; l++) {
+    asset_request *r = lists[l];
+    while (r) {
+      asset_request *next = r->next;
+      if (r->ok) destroy_mesh(&r->result);
+      free_request(r);
+      r = next;
+    }
+  }
+  pending = pending_tail = completed = NULL;
+
+  for (uint32_t index = 1; index < entry_count; index++) {
+    if (entries[index].path) unload(index);
+  }
+  free(entries);
+  free(slots);
+  entries = NULL;
+  slots = NULL;
+  entry_count = entry_capacity = free_list = 0;
+  slot_capacity = slot_used = 0;
+  stats.loading = 0;
+  archive_unmount_all();
+}
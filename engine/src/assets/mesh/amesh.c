@@ -0,0 +1,212 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/amesh.h>
+#include <assets/archive.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+void load_amesh(const char *path, mesh *out)
+__attribute__((alias("at_load_amesh")));
+
+typedef struct {
+  FILE     *file;
+  uint64_t offset;
+  bool     ok;
+} amesh_writer;
+
+static amesh_section write_section(amesh_writer *w, const void *data, size_t size) {
+  static const uint8_t zeros[AMESH_ALIGNMENT];
+  if (!data || size == 0) return (amesh_section){ 0, 0 };
+
+  size_t pad = (size_t)((AMESH_ALIGNMENT - w->offset % AMESH_ALIGNMENT) % AMESH_ALIGNMENT);
+  if (pad && fwrite(zeros, 1, pad, w->file) != pad) w->ok = false;
+  w->offset += pad;
+
+  amesh_section s = { w->offset, size };
+  if (fwrite(data, 1, size, w->file) != size) w->ok = false;
+  w->offset += size;
+  return s;
+}
+
+bool amesh_write(const mesh *m, vertex_format format, const char *path) {
+  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    fprintf(stderr, "amesh_write: mesh has no geometry\n");
+    return false;
+  }
+
+  size_t vc = m->vert_count;
+  amesh_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, AMESH_MAGIC, 4);
+  h.version = AMESH_VERSION;
+  h.flags = (m->normals ? AMESH_HAS_NORMALS : 0) | (m->texcoords ? AMESH_HAS_TEXCOORDS : 0);
+  h.vertex_format = (uint32_t)format;
+  h.vert_count = vc;
+  h.idx_count = m->idx_count;
+  h.meshlet_count = m->meshlet_count;
+  h.lod_count = (uint32_t)m->lod_count;
+  h.index_size = vc < 65536 ? 2 : 4;
+  memcpy(h.bounds_min, m->bounds_min, sizeof(h.bounds_min));
+  memcpy(h.bounds_max, m->bounds_max, sizeof(h.bounds_max));
+
+  // the index section is exactly the buffer the renderer builds
+  size_t total = m->idx_count;
+  for (size_t l = 0; l < m->lod_count; l++) {
+    h.lods[l] = (amesh_lod){ total, m->lods[l].idx_count, m->lods[l].error, 0 };
+    total += m->lods[l].idx_count;
+  }
+  uint32_t *indices = malloc((total ? total : 1) * sizeof(uint32_t));
+  memcpy(indices, m->indices, m->idx_count * sizeof(uint32_t));
+  for (size_t l = 0; l < m->lod_count; l++) {
+    memcpy(indices + h.lods[l].first_index, m->lods[l].indices, m->lods[l].idx_count * sizeof(uint32_t));
+  }
+
+  uint16_t *short_indices = NULL;
+  if (h.index_size == 2) {
+    short_indices = malloc((total ? total : 1) * sizeof(uint16_t));
+    for (size_t i = 0; i < total; i++) short_indices[i] = (uint16_t)indices[i];
+  }
+
+  size_t packed_size = 0;
+  void *packed = format == VERTEX_FORMAT_FLOAT ? NULL : mesh_pack_vertices(m, format, &packed_size);
+  if (format != VERTEX_FORMAT_FLOAT && !packed) {
+    fprintf(stderr, "amesh_write: could not pack vertices\n");
+    free(indices);
+    free(short_indices);
+    return false;
+  }
+
+  // written beside the target and renamed over it, so a reader never maps
+  // a half written file
+  size_t path_len = strlen(path);
+  char *tmp_path = malloc(path_len + 5);
+  memcpy(tmp_path, path, path_len);
+  memcpy(tmp_path + path_len, ".tmp", 5);
+
+  amesh_writer w = { fopen(tmp_path, "wb"), 0, true };
+  if (!w.file) {
+    fprintf(stderr, "amesh_write: cannot open '%s'\n", tmp_path);
+    free(tmp_path);
+    free(indices);
+    free(short_indices);
+    free(packed);
+    return false;
+  }
+
+  if (fwrite(&h, sizeof(h), 1, w.file) != 1) w.ok = false;
+  w.offset = sizeof(h);
+
+  h.positions = write_section(&w, m->positions, vc * 3 * sizeof(float));
+  h.normals = write_section(&w, m->normals, vc * 3 * sizeof(float));
+  h.texcoords = write_section(&w, m->texcoords, vc * 2 * sizeof(float));
+  h.indices = write_section(&w, indices, total * sizeof(uint32_t));
+  h.gpu_vertices = write_section(&w, packed, packed_size);
+  h.gpu_indices = short_indices ? write_section(&w, short_indices, total * sizeof(uint16_t)) : h.indices;
+  h.meshlets = write_section(&w, m->meshlets, m->meshlet_count * sizeof(meshlet));
+  h.file_size = w.offset;
+
+  if (fseek(w.file, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, w.file) != 1) w.ok = false;
+  if (fclose(w.file) != 0) w.ok = false;
+
+  if (w.ok && rename(tmp_path, path) != 0) w.ok = false;
+  if (!w.ok) {
+    fprintf(stderr, "amesh_write: failed writing '%s'\n", path);
+    remove(tmp_path);
+  }
+
+  free(tmp_path);
+  free(indices);
+  free(short_indices);
+  free(packed);
+  return w.ok;
+}
+
+static bool section_valid(const amesh_section *s, uint64_t expected, uint64_t file_size) {
+  if (s->size == 0) return expected == 0;
+  return s->size == expected && s->offset % AMESH_ALIGNMENT == 0 &&
+         s->offset <= file_size && s->size <= file_size - s->offset;
+}
+
+// the header is checked against the file, section contents are trusted as
+// the cooker wrote them
+static bool header_valid(const amesh_header *h, uint64_t file_size) {
+  if (memcmp(h->magic, AMESH_MAGIC, 4) != 0 || h->version != AMESH_VERSION) return false;
+  if (h->file_size != file_size || h->lod_count > MESH_MAX_LODS) return false;
+  if (h->vertex_format > VERTEX_FORMAT_PACKED_QUANTIZED) return false;
+  if (h->index_size != (h->vert_count < 65536 ? 2u : 4u)) return false;
+  if (h->vert_count == 0 || h->idx_count == 0) return false;
+  if (h->vert_count > file_size || h->idx_count > file_size || h->meshlet_count > file_size) return false;
+
+  uint64_t vc = h->vert_count;
+  uint64_t total = h->idx_count;
+  for (uint32_t l = 0; l < h->lod_count; l++) {
+    if (h->lods[l].first_index != total || h->lods[l].idx_count > file_size) return false;
+    total += h->lods[l].idx_count;
+  }
+
+  uint64_t stride = vertex_format_stride((vertex_format)h->vertex_format);
+  return section_valid(&h->positions, vc * 3 * sizeof(float), file_size) &&
+         section_valid(&h->normals, (h->flags & AMESH_HAS_NORMALS) ? vc * 3 * sizeof(float) : 0,
+                       file_size) &&
+         section_valid(&h->texcoords, (h->flags & AMESH_HAS_TEXCOORDS) ? vc * 2 * sizeof(float) : 0,
+                       file_size) &&
+         section_valid(&h->indices, total * sizeof(uint32_t), file_size) &&
+         section_valid(&h->gpu_vertices, vc * stride, file_size) &&
+         section_valid(&h->gpu_indices, total * h->index_size, file_size) &&
+         section_valid(&h->meshlets, h->meshlet_count * sizeof(meshlet), file_size);
+}
+
+void at_load_amesh(const char *path, mesh *out) {
+  // private and writable so the mesh can still be edited in place, pages
+  // are only copied when touched
+  asset_file file;
+  if (!asset_file_map(path, true, &file)) {
+    fprintf(stderr, "load_amesh: cannot open '%s'\n", path);
+    return;
+  }
+  uint8_t *data = file.data;
+  size_t size = file.size;
+  if (size < sizeof(amesh_header)) {
+    fprintf(stderr, "load_amesh: '%s' is too small\n", path);
+    asset_file_unmap(&file);
+    return;
+  }
+
+  const amesh_header *h = (const amesh_header *)data;
+  if (!header_valid(h, size)) {
+    fprintf(stderr, "load_amesh: '%s' is not a version %d amesh file\n", path, AMESH_VERSION);
+    asset_file_unmap(&file);
+    return;
+  }
+  posix_madvise(data, size, POSIX_MADV_WILLNEED);
+
+  // the sections are the mesh's layout, with the whole file as its storage
+  mesh_layout layout = {
+    .flags = (h->normals.size ? MESH_HAS_NORMALS : 0) | (h->texcoords.size ? MESH_HAS_TEXCOORDS : 0),
+    .positions = (size_t)h->positions.offset,
+    .normals = (size_t)h->normals.offset,
+    .texcoords = (size_t)h->texcoords.offset,
+    .indices = (size_t)h->indices.offset,
+    .size = size
+  };
+  mesh_bind_storage(out, data, size, &layout, MESH_STORAGE_MAPPED);
+  out->vert_count = (size_t)h->vert_count;
+  out->idx_count = (size_t)h->idx_count;
+  memcpy(out->bounds_min, h->bounds_min, sizeof(out->bounds_min));
+  memcpy(out->bounds_max, h->bounds_max, sizeof(out->bounds_max));
+
+  out->lod_count = h->lod_count;
+  for (uint32_t l = 0; l < h->lod_count; l++) {
+    out->lods[l] = (mesh_lod){
+      out->indices + h->lods[l].first_index, (size_t)h->lods[l].idx_count, h->lods[l].error
+    };
+  }
+  out->meshlets = h->meshlets.size ? (meshlet *)(data + h->meshlets.offset) : NULL;
+  out->meshlet_count = (size_t)h->meshlet_count;
+
+  out->gpu_format = (vertex_format)h->vertex_format;
+  out->gpu_vertices = h->gpu_vertices.size ? data + h->gpu_vertices.offset : NULL;
+  out->gpu_vertices_size = (size_t)h->gpu_vertices.size;
+  out->gpu_indices = data + h->gpu_indices.offset;
+}
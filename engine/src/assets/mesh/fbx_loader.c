@@ -0,0 +1,521 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/mesh.h>
+#include <assets/archive.h>
+#include <lib/inflate.h>
+#include <lib/jobs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+void load_fbx(const char *path, mesh *out)
+__attribute__((alias("at_load_fbx")));
+
+#define FBX_MAGIC        "Kaydara FBX Binary  \0\x1a"
+#define FBX_MAGIC_SIZE   23
+#define FBX_HEADER_SIZE  27
+#define FBX_WIDE_VERSION 7500  // record fields grow to 64 bits from here on
+
+#define FBX_NONE     0xffffffffu
+#define FBX_NO_ARRAY (-1)
+
+typedef struct {
+  const uint8_t *data;
+  size_t        size;
+  uint32_t      version;
+  bool          corrupt;
+} fbx_file;
+
+// one node record, offsets are from the start of the file
+typedef struct {
+  const char *name;
+  size_t     name_len;
+  size_t     props;      // first property
+  size_t     children;   // end of the properties, first nested record
+  size_t     end;
+} fbx_node;
+
+typedef struct {
+  char          type;
+  const uint8_t *data;
+  uint32_t      count;     // elements for arrays, bytes for strings and raw data
+  uint32_t      encoding;  // 1 for zlib compressed arrays
+  uint32_t      size;      // stored bytes
+} fbx_prop;
+
+// property array decoded to float or int32, whatever width the file used
+typedef struct {
+  fbx_prop prop;
+  bool     as_float;
+  void     *values;
+  bool     ok;
+} fbx_array;
+
+typedef enum {
+  FBX_BY_POLYGON_VERTEX,
+  FBX_BY_VERTEX,
+  FBX_BY_POLYGON,
+  FBX_ALL_SAME
+} fbx_mapping;
+
+// normals or uvs of a geometry, arrays are slots in the load's array list
+typedef struct {
+  int         values;
+  int         index;  // FBX_NO_ARRAY unless the reference is IndexToDirect
+  fbx_mapping mapping;
+  bool        indexed;
+  bool        present;
+} fbx_layer;
+
+typedef struct {
+  int       positions;
+  int       polygons;
+  fbx_layer normals;
+  fbx_layer uvs;
+} fbx_geometry;
+
+typedef struct {
+  fbx_file     file;
+  fbx_array    *arrays;
+  size_t       array_count, array_capacity;
+  fbx_geometry *geometries;
+  size_t       geometry_count, geometry_capacity;
+} fbx_load;
+
+static void *grow_array(void *array, size_t count, size_t *capacity, size_t element_size) {
+  if (count < *capacity) return array;
+  *capacity = *capacity ? *capacity * 2 : 16;
+  return realloc(array, *capacity * element_size);
+}
+
+static uint32_t read_u32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_u64(const uint8_t *p) {
+  return (uint64_t)read_u32(p) | ((uint64_t)read_u32(p + 4) << 32);
+}
+
+// reads the record at cursor and moves past it, false at the null record
+// closing the list or when no record fits before limit
+static bool next_node(fbx_file *f, size_t *cursor, size_t limit, fbx_node *n) {
+  bool wide = f->version >= FBX_WIDE_VERSION;
+  size_t header = wide ? 25 : 13;
+  if (*cursor > limit || limit - *cursor < header) return false;
+
+  const uint8_t *p = f->data + *cursor;
+  uint64_t end  = wide ? read_u64(p) : read_u32(p);
+  uint64_t list = wide ? read_u64(p + 16) : read_u32(p + 8);
+  if (end == 0) return false;
+
+  n->name = (const char *)p + header;
+  n->name_len = p[header - 1];
+  n->props = *cursor + header + n->name_len;
+  if (end > limit || n->props > end || list > end - n->props) {
+    f->corrupt = true;
+    return false;
+  }
+  n->children = n->props + (size_t)list;
+  n->end = (size_t)end;
+  *cursor = n->end;
+  return true;
+}
+
+static bool node_is(const fbx_node *n, const char *name) {
+  return strlen(name) == n->name_len && memcmp(n->name, name, n->name_len) == 0;
+}
+
+static bool first_prop(const fbx_file *f, const fbx_node *n, fbx_prop *p) {
+  if (n->props >= n->children) return false;
+  const uint8_t *d = f->data + n->props;
+  size_t left = n->children - n->props - 1;
+  p->type = (char)*d++;
+  p->encoding = 0;
+
+  switch (p->type) {
+  case 'C': p->count = p->size = 1; break;
+  case 'Y': p->count = p->size = 2; break;
+  case 'I': case 'F': p->count = p->size = 4; break;
+  case 'D': case 'L': p->count = p->size = 8; break;
+  case 'f': case 'd': case 'l': case 'i': case 'b':
+    if (left < 12) return false;
+    p->count = read_u32(d);
+    p->encoding = read_u32(d + 4);
+    p->size = read_u32(d + 8);
+    d += 12;
+    left -= 12;
+    break;
+  case 'S': case 'R':
+    if (left < 4) return false;
+    p->count = p->size = read_u32(d);
+    d += 4;
+    left -= 4;
+    break;
+  default:
+    return false;
+  }
+
+  if (p->size > left) return false;
+  p->data = d;
+  return true;
+}
+
+static bool prop_is(const fbx_prop *p, const char *s) {
+  return (p->type == 'S' || p->type == 'R') && strlen(s) == p->count &&
+         memcmp(p->data, s, p->count) == 0;
+}
+
+static size_t element_size(char type) {
+  switch (type) {
+  case 'f': case 'i': return 4;
+  case 'd': case 'l': return 8;
+  default:            return 1;
+  }
+}
+
+// queues the node's array for decoding, FBX_NO_ARRAY when it holds none of
+// the wanted type
+static int queue_array(fbx_load *l, const fbx_node *n, bool as_float) {
+  fbx_prop p;
+  if (!first_prop(&l->file, n, &p)) return FBX_NO_ARRAY;
+  bool usable = as_float ? (p.type == 'f' || p.type == 'd') : (p.type == 'i' || p.type == 'l');
+  if (!usable || p.encoding > 1) return FBX_NO_ARRAY;
+
+  l->arrays = grow_array(l->arrays, l->array_count, &l->array_capacity, sizeof(fbx_array));
+  l->arrays[l->array_count] = (fbx_array){ .prop = p, .as_float = as_float };
+  return (int)l->array_count++;
+}
+
+static void read_layer(fbx_load *l, const fbx_node *element, const char *values_name,
+                       const char *index_name, fbx_layer *layer) {
+  layer->values = layer->index = FBX_NO_ARRAY;
+  layer->mapping = FBX_BY_POLYGON_VERTEX;
+  layer->indexed = false;
+  layer->present = true;
+
+  fbx_node n;
+  size_t cursor = element->children;
+  while (next_node(&l->file, &cursor, element->end, &n)) {
+    fbx_prop p;
+    if (node_is(&n, values_name)) {
+      layer->values = queue_array(l, &n, true);
+    } else if (node_is(&n, index_name)) {
+      layer->index = queue_array(l, &n, false);
+    } else if (node_is(&n, "MappingInformationType") && first_prop(&l->file, &n, &p)) {
+      if (prop_is(&p, "ByVertice") || prop_is(&p, "ByVertex")) layer->mapping = FBX_BY_VERTEX;
+      else if (prop_is(&p, "ByPolygon")) layer->mapping = FBX_BY_POLYGON;
+      else if (prop_is(&p, "AllSame")) layer->mapping = FBX_ALL_SAME;
+    } else if (node_is(&n, "ReferenceInformationType") && first_prop(&l->file, &n, &p)) {
+      layer->indexed = prop_is(&p, "IndexToDirect") || prop_is(&p, "Index");
+    }
+  }
+  if (!layer->indexed) layer->index = FBX_NO_ARRAY;
+}
+
+// only the first normal and uv layer is read, later ones are extra sets
+static void read_geometry(fbx_load *l, const fbx_node *geometry) {
+  fbx_geometry g = { FBX_NO_ARRAY, FBX_NO_ARRAY, { .present = false }, { .present = false } };
+
+  fbx_node n;
+  size_t cursor = geometry->children;
+  while (next_node(&l->file, &cursor, geometry->end, &n)) {
+    if (node_is(&n, "Vertices")) {
+      g.positions = queue_array(l, &n, true);
+    } else if (node_is(&n, "PolygonVertexIndex")) {
+      g.polygons = queue_array(l, &n, false);
+    } else if (node_is(&n, "LayerElementNormal") && !g.normals.present) {
+      read_layer(l, &n, "Normals", "NormalsIndex", &g.normals);
+    } else if (node_is(&n, "LayerElementUV") && !g.uvs.present) {
+      read_layer(l, &n, "UV", "UVIndex", &g.uvs);
+    }
+  }
+
+  // shapes and curves are geometry too but carry no polygons
+  if (g.positions == FBX_NO_ARRAY || g.polygons == FBX_NO_ARRAY) return;
+  l->geometries = grow_array(l->geometries, l->geometry_count, &l->geometry_capacity, sizeof(fbx_geometry));
+  l->geometries[l->geometry_count++] = g;
+}
+
+static bool read_objects(fbx_load *l) {
+  fbx_node top, n;
+  size_t cursor = FBX_HEADER_SIZE;
+  while (next_node(&l->file, &cursor, l->file.size, &top)) {
+    if (!node_is(&top, "Objects")) continue;
+
+    size_t child = top.children;
+    while (next_node(&l->file, &child, top.end, &n)) {
+      if (node_is(&n, "Geometry")) read_geometry(l, &n);
+    }
+    return !l->file.corrupt;
+  }
+  return false;
+}
+
+// inflates or copies one array, 32-bit arrays inflate straight into place
+static void decode_array(void *ctx, size_t index) {
+  fbx_array *a = &((fbx_array *)ctx)[index];
+  size_t count = a->prop.count;
+  size_t width = element_size(a->prop.type);
+  size_t raw_size = count * width;
+
+  // deflate expands at most about 1032:1, larger counts are corrupt
+  if (a->prop.encoding == 1 ? raw_size / 1032 > a->prop.size : raw_size != a->prop.size) return;
+  a->values = malloc(count ? count * 4 : 4);
+  if (!a->values) return;
+
+  const uint8_t *raw = a->prop.data;
+  uint8_t *scratch = NULL;
+  if (a->prop.encoding == 1) {
+    uint8_t *dst = width == 4 ? a->values : (scratch = malloc(raw_size ? raw_size : 1));
+    if (!dst || !zlib_inflate(a->prop.data, a->prop.size, dst, raw_size)) {
+      free(scratch);
+      return;
+    }
+    raw = dst;
+  }
+
+  if (width == 4) {
+    if (raw != a->values) memcpy(a->values, raw, raw_size);
+  } else if (a->as_float) {
+    float *out = a->values;
+    for (size_t i = 0; i < count; i++) {
+      double d;
+      memcpy(&d, raw + i * 8, 8);
+      out[i] = (float)d;
+    }
+  } else {
+    int32_t *out = a->values;
+    for (size_t i = 0; i < count; i++) {
+      int64_t v;
+      memcpy(&v, raw + i * 8, 8);
+      out[i] = v < INT32_MIN || v > INT32_MAX ? INT32_MIN : (int32_t)v;
+    }
+  }
+  free(scratch);
+  a->ok = true;
+}
+
+static const fbx_array *array_at(const fbx_load *l, int slot) {
+  return slot == FBX_NO_ARRAY || !l->arrays[slot].ok ? NULL : &l->arrays[slot];
+}
+
+// element of the layer used by a polygon corner, FBX_NONE when it has none
+static uint32_t layer_element(const fbx_load *l, const fbx_layer *layer, int components,
+                              size_t corner, uint32_t vertex, size_t polygon) {
+  const fbx_array *values = array_at(l, layer->values);
+  if (!layer->present || !values) return FBX_NONE;
+
+  size_t i;
+  switch (layer->mapping) {
+  case FBX_BY_VERTEX:  i = vertex;  break;
+  case FBX_BY_POLYGON: i = polygon; break;
+  case FBX_ALL_SAME:   i = 0;       break;
+  default:             i = corner;  break;
+  }
+
+  if (layer->indexed) {
+    const fbx_array *index = array_at(l, layer->index);
+    if (!index || i >= index->prop.count) return FBX_NONE;
+    int32_t direct = ((const int32_t *)index->values)[i];
+    if (direct < 0) return FBX_NONE;
+    i = (size_t)direct;
+  }
+  return i < values->prop.count / components ? (uint32_t)i : FBX_NONE;
+}
+
+// exporters mostly write normals per polygon corner, so corners are matched
+// on their attribute values instead of element indices
+typedef struct {
+  uint32_t position;  // offset by the geometry's first vertex
+  uint32_t normal[3];  // float bits, zero when missing
+  uint32_t texcoord[2];
+} fbx_key;
+
+typedef struct {
+  fbx_key  *keys;      // per output vertex
+  uint32_t *slots;     // vertex + 1, 0 when empty
+  size_t   slot_mask;
+
+  float    *positions;
+  float    *normals;
+  float    *texcoords;
+  uint32_t *indices;
+  size_t   vertex_count, index_count;
+} fbx_builder;
+
+static uint32_t hash_key(const fbx_key *k) {
+  uint64_t h = k->position * 0x9e3779b97f4a7c15ull;
+  h ^= (k->normal[0] ^ (uint64_t)k->normal[1] << 32) * 0xc2b2ae3d27d4eb4full;
+  h ^= (k->normal[2] ^ (uint64_t)k->texcoord[0] << 32) * 0x165667b19e3779f9ull;
+  h ^= k->texcoord[1] * 0xd6e8feb86659fd93ull;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 32;
+  return (uint32_t)h;
+}
+
+static uint32_t emit_vertex(fbx_builder *b, const float *position, uint32_t position_index,
+                            const float *normal, const float *texcoord) {
+  fbx_key key;
+  memset(&key, 0, sizeof(key));
+  key.position = position_index;
+  if (normal) memcpy(key.normal, normal, sizeof(key.normal));
+  if (texcoord) memcpy(key.texcoord, texcoord, sizeof(key.texcoord));
+
+  size_t slot = hash_key(&key) & b->slot_mask;
+  while (b->slots[slot]) {
+    if (memcmp(&b->keys[b->slots[slot] - 1], &key, sizeof(key)) == 0) return b->slots[slot] - 1;
+    slot = (slot + 1) & b->slot_mask;
+  }
+
+  uint32_t v = (uint32_t)b->vertex_count++;
+  b->slots[slot] = v + 1;
+  b->keys[v] = key;
+  memcpy(b->positions + 3 * v, position, 3 * sizeof(float));
+  if (b->normals) memcpy(b->normals + 3 * v, key.normal, sizeof(key.normal));
+  if (b->texcoords) memcpy(b->texcoords + 2 * v, key.texcoord, sizeof(key.texcoord));
+  return v;
+}
+
+// polygons close on a negative index, stored as the bitwise not of the
+// vertex. polygons with too few corners or indices out of range are dropped
+static size_t build_geometry(const fbx_load *l, const fbx_geometry *g, fbx_builder *b, uint32_t *position_base) {
+  const fbx_array *positions = array_at(l, g->positions);
+  const fbx_array *polygons = array_at(l, g->polygons);
+  const fbx_array *normals = array_at(l, g->normals.values);
+  const fbx_array *uvs = array_at(l, g->uvs.values);
+  if (!positions || !polygons) return 0;
+
+  const float *pos = positions->values;
+  const int32_t *corners = polygons->values;
+  size_t vertex_count = positions->prop.count / 3;
+  size_t dropped = 0, polygon = 0, start = 0;
+
+  for (size_t c = 0; c < polygons->prop.count; c++) {
+    if (corners[c] >= 0) continue;
+
+    size_t n = c + 1 - start;
+    bool valid = n >= 3;
+    for (size_t k = start; k <= c && valid; k++) {
+      uint32_t v = (uint32_t)(corners[k] < 0 ? ~corners[k] : corners[k]);
+      valid = v < vertex_count;
+    }
+
+    if (valid) {
+      uint32_t first = 0, previous = 0;
+      for (size_t k = 0; k < n; k++) {
+        size_t corner = start + k;
+        uint32_t v = (uint32_t)(corners[corner] < 0 ? ~corners[corner] : corners[corner]);
+        uint32_t nm = layer_element(l, &g->normals, 3, corner, v, polygon);
+        uint32_t uv = layer_element(l, &g->uvs, 2, corner, v, polygon);
+
+        uint32_t out = emit_vertex(b, pos + 3 * v, *position_base + v,
+                                   nm == FBX_NONE ? NULL : (const float *)normals->values + 3 * nm,
+                                   uv == FBX_NONE ? NULL : (const float *)uvs->values + 2 * uv);
+
+        // fan around the first corner
+        if (k == 0) first = out;
+        if (k >= 2) {
+          b->indices[b->index_count++] = first;
+          b->indices[b->index_count++] = previous;
+          b->indices[b->index_count++] = out;
+        }
+        previous = out;
+      }
+    } else {
+      dropped++;
+    }
+    polygon++;
+    start = c + 1;
+  }
+  // trailing corners without a closing index never formed a polygon
+  if (start < polygons->prop.count) dropped++;
+
+  *position_base += (uint32_t)vertex_count;
+  return dropped;
+}
+
+static void build_mesh(const fbx_load *l, mesh *out) {
+  size_t corner_count = 0;
+  bool has_normals = false, has_texcoords = false;
+  for (size_t i = 0; i < l->geometry_count; i++) {
+    const fbx_geometry *g = &l->geometries[i];
+    const fbx_array *polygons = array_at(l, g->polygons);
+    if (!array_at(l, g->positions) || !polygons) continue;
+    corner_count += polygons->prop.count;
+    has_normals |= array_at(l, g->normals.values) != NULL;
+    has_texcoords |= array_at(l, g->uvs.values) != NULL;
+  }
+
+  // every corner makes at most one vertex and one triangle
+  size_t slot_count = 16;
+  while (slot_count < corner_count * 2) slot_count *= 2;
+  size_t alloc = corner_count ? corner_count : 1;
+
+  fbx_builder b = {
+    .keys = malloc(alloc * sizeof(fbx_key)),
+    .slots = calloc(slot_count, sizeof(uint32_t)),
+    .slot_mask = slot_count - 1,
+    .positions = malloc(alloc * 3 * sizeof(float)),
+    .normals = has_normals ? calloc(alloc * 3, sizeof(float)) : NULL,
+    .texcoords = has_texcoords ? calloc(alloc * 2, sizeof(float)) : NULL,
+    .indices = malloc(alloc * 3 * sizeof(uint32_t))
+  };
+
+  uint32_t position_base = 0;
+  size_t dropped = 0;
+  for (size_t i = 0; i < l->geometry_count; i++) {
+    dropped += build_geometry(l, &l->geometries[i], &b, &position_base);
+  }
+  if (dropped) fprintf(stderr, "load_fbx: dropped %zu invalid polygons\n", dropped);
+
+  free(b.keys);
+  free(b.slots);
+
+  // the final counts are only known now, so the streams are copied into one block
+  uint32_t flags = (has_normals ? MESH_HAS_NORMALS : 0) | (has_texcoords ? MESH_HAS_TEXCOORDS : 0);
+  size_t vc = b.vertex_count;
+  if (mesh_allocate(out, vc, b.index_count, flags, NULL)) {
+    memcpy(out->positions, b.positions, vc * 3 * sizeof(float));
+    if (has_normals) memcpy(out->normals, b.normals, vc * 3 * sizeof(float));
+    if (has_texcoords) memcpy(out->texcoords, b.texcoords, vc * 2 * sizeof(float));
+    memcpy(out->indices, b.indices, b.index_count * sizeof(uint32_t));
+  }
+  free(b.positions);
+  free(b.normals);
+  free(b.texcoords);
+  free(b.indices);
+}
+
+void at_load_fbx(const char *path, mesh *out) {
+  asset_file file;
+  if (!asset_file_map(path, false, &file)) {
+    fprintf(stderr, "load_fbx: cannot open '%s'\n", path);
+    return;
+  }
+  const uint8_t *data = file.data;
+  size_t size = file.size;
+
+  // ascii fbx files are not supported
+  if (size < FBX_HEADER_SIZE || memcmp(data, FBX_MAGIC, FBX_MAGIC_SIZE) != 0) {
+    fprintf(stderr, "load_fbx: '%s' is not a binary fbx file\n", path);
+    asset_file_unmap(&file);
+    return;
+  }
+
+  fbx_load l = { .file = { data, size, read_u32(data + FBX_MAGIC_SIZE), false } };
+  if (!read_objects(&l)) {
+    fprintf(stderr, "load_fbx: no readable objects in '%s'\n", path);
+  } else {
+    // only the property arrays the mesh needs are ever inflated
+    jobs_parallel_for(l.array_count, decode_array, l.arrays);
+    size_t corrupt = 0;
+    for (size_t i = 0; i < l.array_count; i++) corrupt += !l.arrays[i].ok;
+    if (corrupt) fprintf(stderr, "load_fbx: skipped %zu corrupt property arrays in '%s'\n", corrupt, path);
+    build_mesh(&l, out);
+  }
+
+  for (size_t i = 0; i < l.array_count; i++) free(l.arrays[i].values);
+  free(l.arrays);
+  free(l.geometries);
+  asset_file_unmap(&file);
+}
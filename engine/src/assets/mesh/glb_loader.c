@@ -0,0 +1,52 @@
+#include <assets/gltf.h>
+#include <stdio.h>
+#include <string.h>
+
+void load_glb(const char *path, mesh *out)
+__attribute__((alias("at_load_glb")));
+
+static uint32_t read_u32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 12 byte header followed by length prefixed chunks, json first and the
+// binary chunk, when there is one, second
+bool glb_parse(const uint8_t *data, size_t size, glb_chunks *out) {
+  memset(out, 0, sizeof(glb_chunks));
+  if (size < 20 || read_u32(data) != GLB_MAGIC || read_u32(data + 4) != 2) return false;
+
+  size_t length = read_u32(data + 8);
+  if (length > size) return false;
+
+  size_t offset = 12;
+  for (int chunk = 0; offset + 8 <= length; chunk++) {
+    size_t   chunk_size = read_u32(data + offset);
+    uint32_t chunk_type = read_u32(data + offset + 4);
+    offset += 8;
+    if (chunk_size > length - offset) return false;
+
+    if (chunk == 0) {
+      if (chunk_type != GLB_CHUNK_JSON) return false;
+      out->json = (const char *)(data + offset);
+      out->json_size = chunk_size;
+    } else if (chunk == 1 && chunk_type == GLB_CHUNK_BIN) {
+      out->bin = data + offset;
+      out->bin_size = chunk_size;
+    }
+    // unknown chunks are skipped as the spec asks
+    offset += (chunk_size + 3) & ~(size_t)3;
+  }
+
+  // json chunks are padded with spaces, which the parser skips
+  return out->json != NULL;
+}
+
+void at_load_glb(const char *path, mesh *out) {
+  gltf_model model;
+  if (!gltf_load_model(path, &model)) {
+    fprintf(stderr, "load_glb: failed to load '%s'\n", path);
+    return;
+  }
+  gltf_flatten(&model, out);
+  gltf_model_destroy(&model);
+}
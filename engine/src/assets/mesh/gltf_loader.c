@@ -0,0 +1,900 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/gltf.h>
+#include <assets/archive.h>
+#include <lib/json.h>
+#include <lib/la.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+void load_gltf(const char *path, mesh *out)
+__attribute__((alias("at_load_gltf")));
+
+#define GLTF_BYTE           5120
+#define GLTF_UNSIGNED_BYTE  5121
+#define GLTF_SHORT          5122
+#define GLTF_UNSIGNED_SHORT 5123
+#define GLTF_UNSIGNED_INT   5125
+#define GLTF_FLOAT          5126
+
+#define GLTF_TRIANGLES 4
+
+typedef struct {
+  const uint8_t *data;
+  size_t        size;
+  char          *file;         // file the bytes live in, NULL for data uris
+  size_t        file_offset;
+  uint8_t       *decoded;      // data uri contents
+  asset_file    mapping;      // contents of an external buffer file
+} gltf_buffer;
+
+typedef struct {
+  uint32_t buffer;
+  size_t   offset, length, stride;
+} gltf_view;
+
+typedef struct {
+  int32_t  view;  // -1 reads as zeros
+  size_t   offset;
+  uint32_t component_type;
+  uint32_t components;
+  size_t   count;
+  size_t   stride;
+  bool     normalized;
+  bool     sparse;
+  bool     has_bounds;
+  float    min[3], max[3];
+} gltf_accessor;
+
+typedef struct {
+  const char    *path;
+  json_document doc;
+  gltf_buffer   *buffers;
+  size_t        buffer_count;
+  gltf_view     *views;
+  size_t        view_count;
+  gltf_accessor *accessors;
+  size_t        accessor_count;
+} gltf_import;
+
+static bool map_file(const char *path, bool writable, asset_file *out) {
+  if (!asset_file_map(path, writable, out)) return false;
+  if (out->size > 0) return true;
+  asset_file_unmap(out);
+  return false;
+}
+
+static size_t component_size(uint32_t type) {
+  switch (type) {
+  case GLTF_BYTE:
+  case GLTF_UNSIGNED_BYTE:  return 1;
+  case GLTF_SHORT:
+  case GLTF_UNSIGNED_SHORT: return 2;
+  case GLTF_UNSIGNED_INT:
+  case GLTF_FLOAT:          return 4;
+  default:                  return 0;
+  }
+}
+
+static int base64_value(char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+static uint8_t *base64_decode(const char *s, size_t len, size_t *out_size) {
+  uint8_t *out = malloc(len / 4 * 3 + 3);
+  size_t n = 0;
+  uint32_t bits = 0;
+  int count = 0;
+  for (size_t i = 0; i < len && s[i] != '='; i++) {
+    int v = base64_value(s[i]);
+    if (v < 0) {
+      free(out);
+      return NULL;
+    }
+    bits = (bits << 6) | (uint32_t)v;
+    if (++count == 4) {
+      out[n++] = (uint8_t)(bits >> 16);
+      out[n++] = (uint8_t)(bits >> 8);
+      out[n++] = (uint8_t)bits;
+      bits = 0;
+      count = 0;
+    }
+  }
+  if (count == 3) {
+    out[n++] = (uint8_t)(bits >> 10);
+    out[n++] = (uint8_t)(bits >> 2);
+  } else if (count == 2) {
+    out[n++] = (uint8_t)(bits >> 4);
+  }
+  *out_size = n;
+  return out;
+}
+
+// relative uris resolve against the directory of the document, with
+// percent escapes decoded
+static char *resolve_uri(const char *base, const char *uri) {
+  const char *slash = strrchr(base, '/');
+  size_t dir = slash ? (size_t)(slash - base) + 1 : 0;
+  char *path = malloc(dir + strlen(uri) + 1);
+  memcpy(path, base, dir);
+
+  size_t n = dir;
+  for (const char *p = uri; *p; p++) {
+    if (p[0] == '%' && p[1] && p[2]) {
+      char hex[3] = { p[1], p[2], 0 };
+      char *end;
+      long v = strtol(hex, &end, 16);
+      if (*end == '\0') {
+        path[n++] = (char)v;
+        p += 2;
+        continue;
+      }
+    }
+    path[n++] = *p;
+  }
+  path[n] = '\0';
+  return path;
+}
+
+static bool load_buffers(gltf_import *imp, const glb_chunks *chunks, const uint8_t *file) {
+  const json_document *doc = &imp->doc;
+  uint32_t list = json_get(doc, 0, "buffers");
+  imp->buffer_count = json_count(doc, list);
+  imp->buffers = calloc(imp->buffer_count ? imp->buffer_count : 1, sizeof(gltf_buffer));
+
+  for (size_t i = 0; i < imp->buffer_count; i++) {
+    uint32_t b = json_at(doc, list, i);
+    gltf_buffer *buf = &imp->buffers[i];
+    int64_t length = json_int(doc, json_get(doc, b, "byteLength"), -1);
+    uint32_t uri_tok = json_get(doc, b, "uri");
+
+    if (uri_tok == JSON_NONE) {
+      // the glb binary chunk, which may be padded beyond byteLength
+      if (i != 0 || !chunks->bin) {
+        fprintf(stderr, "gltf: buffer %zu has no data\n", i);
+        return false;
+      }
+      buf->data = chunks->bin;
+      buf->size = chunks->bin_size;
+      buf->file = strdup(imp->path);
+      buf->file_offset = (size_t)(chunks->bin - file);
+    } else {
+      size_t uri_len = json_string(doc, uri_tok, NULL, 0);
+      char *uri = malloc(uri_len + 1);
+      json_string(doc, uri_tok, uri, uri_len + 1);
+
+      if (strncmp(uri, "data:", 5) == 0) {
+        const char *comma = strstr(uri, ";base64,");
+        if (comma) {
+          buf->decoded = base64_decode(comma + 8, strlen(comma + 8), &buf->size);
+        }
+        buf->data = buf->decoded;
+      } else {
+        buf->file = resolve_uri(imp->path, uri);
+        map_file(buf->file, false, &buf->mapping);
+        buf->data = buf->mapping.data;
+        buf->size = buf->mapping.size;
+      }
+
+      if (!buf->data) {
+        fprintf(stderr, "gltf: cannot read buffer '%s'\n", buf->file ? buf->file : "data uri");
+        free(uri);
+        return false;
+      }
+      free(uri);
+    }
+
+    if (length < 0 || (size_t)length > buf->size) {
+      fprintf(stderr, "gltf: buffer %zu is shorter than its byteLength\n", i);
+      return false;
+    }
+    buf->size = (size_t)length;
+  }
+  return true;
+}
+
+static bool load_views(gltf_import *imp) {
+  const json_document *doc = &imp->doc;
+  uint32_t list = json_get(doc, 0, "bufferViews");
+  imp->view_count = json_count(doc, list);
+  imp->views = calloc(imp->view_count ? imp->view_count : 1, sizeof(gltf_view));
+
+  for (size_t i = 0; i < imp->view_count; i++) {
+    uint32_t v = json_at(doc, list, i);
+    int64_t buffer = json_int(doc, json_get(doc, v, "buffer"), -1);
+    int64_t offset = json_int(doc, json_get(doc, v, "byteOffset"), 0);
+    int64_t length = json_int(doc, json_get(doc, v, "byteLength"), -1);
+    int64_t stride = json_int(doc, json_get(doc, v, "byteStride"), 0);
+
+    if (buffer < 0 || (size_t)buffer >= imp->buffer_count || offset < 0 || length < 0 ||
+        stride < 0 || (size_t)offset > imp->buffers[buffer].size ||
+        (size_t)length > imp->buffers[buffer].size - (size_t)offset) {
+      fprintf(stderr, "gltf: bufferView %zu is out of range\n", i);
+      return false;
+    }
+    imp->views[i] = (gltf_view){ (uint32_t)buffer, (size_t)offset, (size_t)length, (size_t)stride };
+  }
+  return true;
+}
+
+static uint32_t type_components(const json_document *doc, uint32_t tok) {
+  if (json_string_eq(doc, tok, "SCALAR")) return 1;
+  if (json_string_eq(doc, tok, "VEC2")) return 2;
+  if (json_string_eq(doc, tok, "VEC3")) return 3;
+  if (json_string_eq(doc, tok, "VEC4")) return 4;
+  return 0;  // matrices are never read as vertex data here
+}
+
+static bool load_accessors(gltf_import *imp) {
+  const json_document *doc = &imp->doc;
+  uint32_t list = json_get(doc, 0, "accessors");
+  imp->accessor_count = json_count(doc, list);
+  imp->accessors = calloc(imp->accessor_count ? imp->accessor_count : 1, sizeof(gltf_accessor));
+
+  for (size_t i = 0; i < imp->accessor_count; i++) {
+    uint32_t a = json_at(doc, list, i);
+    gltf_accessor *acc = &imp->accessors[i];
+    int64_t view = json_int(doc, json_get(doc, a, "bufferView"), -1);
+    int64_t offset = json_int(doc, json_get(doc, a, "byteOffset"), 0);
+    int64_t count = json_int(doc, json_get(doc, a, "count"), -1);
+
+    acc->view = view >= 0 && (size_t)view < imp->view_count ? (int32_t)view : -1;
+    acc->offset = offset > 0 ? (size_t)offset : 0;
+    acc->component_type = (uint32_t)json_int(doc, json_get(doc, a, "componentType"), 0);
+    acc->components = type_components(doc, json_get(doc, a, "type"));
+    acc->count = count > 0 ? (size_t)count : 0;
+    acc->normalized = json_bool(doc, json_get(doc, a, "normalized"), false);
+    acc->sparse = json_get(doc, a, "sparse") != JSON_NONE;
+
+    size_t element = component_size(acc->component_type) * acc->components;
+    if (count < 0 || offset < 0 || (view >= 0 && acc->view < 0)) {
+      fprintf(stderr, "gltf: accessor %zu is invalid\n", i);
+      return false;
+    }
+    if (element == 0) continue;
+
+    if (acc->view >= 0) {
+      const gltf_view *v = &imp->views[acc->view];
+      acc->stride = v->stride ? v->stride : element;
+      size_t span = acc->count ? acc->stride * (acc->count - 1) + element : 0;
+      if (acc->offset > v->length || span > v->length - acc->offset) {
+        fprintf(stderr, "gltf: accessor %zu overruns its bufferView\n", i);
+        return false;
+      }
+    }
+
+    uint32_t min = json_get(doc, a, "min"), max = json_get(doc, a, "max");
+    if (acc->components == 3 && json_count(doc, min) == 3 && json_count(doc, max) == 3) {
+      acc->has_bounds = true;
+      for (uint32_t k = 0; k < 3; k++) {
+        acc->min[k] = json_float(doc, json_at(doc, min, k), 0.0f);
+        acc->max[k] = json_float(doc, json_at(doc, max, k), 0.0f);
+      }
+    }
+  }
+  return true;
+}
+
+static const uint8_t *accessor_data(const gltf_import *imp, const gltf_accessor *acc) {
+  if (acc->view < 0) return NULL;
+  const gltf_view *v = &imp->views[acc->view];
+  return imp->buffers[v->buffer].data + v->offset + acc->offset;
+}
+
+static float read_component(const uint8_t *p, uint32_t type, bool normalized) {
+  switch (type) {
+  case GLTF_FLOAT: {
+    float f;
+    memcpy(&f, p, sizeof(f));
+    return f;
+  }
+  case GLTF_BYTE: {
+    float v = (float)(int8_t)p[0];
+    return normalized ? fmaxf(v / 127.0f, -1.0f) : v;
+  }
+  case GLTF_UNSIGNED_BYTE:
+    return normalized ? (float)p[0] / 255.0f : (float)p[0];
+  case GLTF_SHORT: {
+    int16_t s;
+    memcpy(&s, p, sizeof(s));
+    return normalized ? fmaxf((float)s / 32767.0f, -1.0f) : (float)s;
+  }
+  case GLTF_UNSIGNED_SHORT: {
+    uint16_t s;
+    memcpy(&s, p, sizeof(s));
+    return normalized ? (float)s / 65535.0f : (float)s;
+  }
+  case GLTF_UNSIGNED_INT: {
+    uint32_t u;
+    memcpy(&u, p, sizeof(u));
+    return normalized ? (float)u / 4294967295.0f : (float)u;
+  }
+  default:
+    return 0.0f;
+  }
+}
+
+// converts into n floats per element, missing components read as zero
+static void read_floats(const gltf_import *imp, const gltf_accessor *acc, uint32_t n, float *out) {
+  const uint8_t *data = accessor_data(imp, acc);
+  size_t size = component_size(acc->component_type);
+  for (size_t i = 0; i < acc->count; i++) {
+    for (uint32_t k = 0; k < n; k++) {
+      out[i * n + k] = data && k < acc->components
+        ? read_component(data + i * acc->stride + k * size, acc->component_type, acc->normalized)
+        : 0.0f;
+    }
+  }
+}
+
+static bool read_indices(const gltf_import *imp, const gltf_accessor *acc, uint32_t base,
+                         size_t vert_count, uint32_t *out) {
+  const uint8_t *data = accessor_data(imp, acc);
+  if (!data) return false;
+
+  for (size_t i = 0; i < acc->count; i++) {
+    const uint8_t *p = data + i * acc->stride;
+    uint32_t v;
+    if (acc->component_type == GLTF_UNSIGNED_BYTE) {
+      v = p[0];
+    } else if (acc->component_type == GLTF_UNSIGNED_SHORT) {
+      uint16_t s;
+      memcpy(&s, p, sizeof(s));
+      v = s;
+    } else {
+      memcpy(&v, p, sizeof(v));
+    }
+    if (v >= vert_count) return false;
+    out[i] = base + v;
+  }
+  return true;
+}
+
+// offset of the accessor within its buffer file when it can be used in
+// place as a tightly packed array of the given type, SIZE_MAX otherwise
+static size_t alias_offset(const gltf_import *imp, const gltf_accessor *acc, uint32_t type,
+                           uint32_t components, const char *file) {
+  size_t element = component_size(type) * components;
+  if (acc->view < 0 || acc->sparse || acc->normalized || acc->component_type != type ||
+      acc->components != components || acc->stride != element) {
+    return SIZE_MAX;
+  }
+
+  const gltf_view *v = &imp->views[acc->view];
+  const gltf_buffer *b = &imp->buffers[v->buffer];
+  if (!b->file || strcmp(b->file, file) != 0) return SIZE_MAX;
+
+  size_t offset = b->file_offset + v->offset + acc->offset;
+  return offset % component_size(type) == 0 ? offset : SIZE_MAX;
+}
+
+static const gltf_accessor *attribute(const gltf_import *imp, uint32_t prim, const char *name) {
+  uint32_t attrs = json_get(&imp->doc, prim, "attributes");
+  int64_t a = json_int(&imp->doc, json_get(&imp->doc, attrs, name), -1);
+  return a >= 0 && (size_t)a < imp->accessor_count ? &imp->accessors[a] : NULL;
+}
+
+static const gltf_accessor *index_accessor(const gltf_import *imp, uint32_t prim) {
+  int64_t a = json_int(&imp->doc, json_get(&imp->doc, prim, "indices"), -1);
+  return a >= 0 && (size_t)a < imp->accessor_count ? &imp->accessors[a] : NULL;
+}
+
+static bool valid_vertex_accessor(const gltf_accessor *acc, uint32_t min_components) {
+  return acc && !acc->sparse && acc->components >= min_components &&
+         component_size(acc->component_type) > 0;
+}
+
+static bool valid_index_accessor(const gltf_accessor *acc) {
+  return acc && !acc->sparse && acc->view >= 0 && acc->components == 1 &&
+         (acc->component_type == GLTF_UNSIGNED_BYTE || acc->component_type == GLTF_UNSIGNED_SHORT ||
+          acc->component_type == GLTF_UNSIGNED_INT);
+}
+
+// with a single primitive every stream already laid out the way the mesh
+// stores it is used from a private mapping of its file
+static void alias_primitive(const gltf_import *imp, uint32_t prim, mesh *m) {
+  const gltf_accessor *pos = attribute(imp, prim, "POSITION");
+  const gltf_accessor *nrm = attribute(imp, prim, "NORMAL");
+  const gltf_accessor *uv  = attribute(imp, prim, "TEXCOORD_0");
+  const gltf_accessor *idx = index_accessor(imp, prim);
+
+  if (pos->view < 0) return;
+  const char *file = imp->buffers[imp->views[pos->view].buffer].file;
+  if (!file || alias_offset(imp, pos, GLTF_FLOAT, 3, file) == SIZE_MAX) return;
+
+  asset_file mapping;
+  if (!map_file(file, true, &mapping)) return;
+  uint8_t *base = mapping.data;
+  size_t size = mapping.size;
+
+  mesh_layout layout = { .positions = alias_offset(imp, pos, GLTF_FLOAT, 3, file), .size = size };
+  if (nrm && nrm->count == pos->count && alias_offset(imp, nrm, GLTF_FLOAT, 3, file) != SIZE_MAX) {
+    layout.normals = alias_offset(imp, nrm, GLTF_FLOAT, 3, file);
+    layout.flags |= MESH_HAS_NORMALS;
+  }
+  if (uv && uv->count == pos->count && alias_offset(imp, uv, GLTF_FLOAT, 2, file) != SIZE_MAX) {
+    layout.texcoords = alias_offset(imp, uv, GLTF_FLOAT, 2, file);
+    layout.flags |= MESH_HAS_TEXCOORDS;
+  }
+
+  // only whole triangle lists can be used as they are
+  size_t vc = pos->count;
+  bool whole = idx && idx->count % 3 == 0;
+  size_t u32 = whole ? alias_offset(imp, idx, GLTF_UNSIGNED_INT, 1, file) : SIZE_MAX;
+  size_t u16 = whole ? alias_offset(imp, idx, GLTF_UNSIGNED_SHORT, 1, file) : SIZE_MAX;
+  layout.indices = u32 != SIZE_MAX ? u32 : 0;
+
+  mesh_bind_storage(m, base, size, &layout, MESH_STORAGE_MAPPED);
+  if (u32 == SIZE_MAX) m->indices = NULL;
+  if (u32 != SIZE_MAX && vc >= 65536) {
+    m->gpu_indices = m->indices;
+  } else if (u16 != SIZE_MAX && vc < 65536) {
+    m->gpu_indices = base + u16;
+  }
+}
+
+static bool load_mesh_primitives(const gltf_import *imp, uint32_t mesh_tok, size_t index, mesh *m) {
+  const json_document *doc = &imp->doc;
+  uint32_t prims = json_get(doc, mesh_tok, "primitives");
+
+  size_t vc = 0, ic = 0, used = 0, skipped = 0;
+  bool normals = true, texcoords = false, float_bounds = true;
+  uint32_t single = JSON_NONE;
+  for (size_t p = 0; p < json_count(doc, prims); p++) {
+    uint32_t prim = json_at(doc, prims, p);
+    const gltf_accessor *pos = attribute(imp, prim, "POSITION");
+    const gltf_accessor *idx = index_accessor(imp, prim);
+    if (json_int(doc, json_get(doc, prim, "mode"), GLTF_TRIANGLES) != GLTF_TRIANGLES ||
+        !valid_vertex_accessor(pos, 3) || (idx && !valid_index_accessor(idx))) {
+      skipped++;
+      continue;
+    }
+    const gltf_accessor *nrm = attribute(imp, prim, "NORMAL");
+    const gltf_accessor *uv = attribute(imp, prim, "TEXCOORD_0");
+    normals &= valid_vertex_accessor(nrm, 3) && nrm->count == pos->count;
+    texcoords |= valid_vertex_accessor(uv, 2) && uv->count == pos->count;
+    float_bounds &= pos->has_bounds && pos->component_type == GLTF_FLOAT && !pos->normalized;
+
+    vc += pos->count;
+    ic += (idx ? idx->count : pos->count) / 3 * 3;
+    single = prim;
+    used++;
+  }
+  if (skipped) {
+    fprintf(stderr, "gltf: mesh %zu skipped %zu non triangle or invalid primitives\n", index, skipped);
+  }
+  // a mesh with nothing drawable stays empty
+  if (used == 0 || vc == 0) return true;
+  if (vc > UINT32_MAX) return false;
+
+  m->vert_count = vc;
+  m->idx_count = ic;
+  if (used == 1) alias_primitive(imp, single, m);
+
+  // whatever could not be aliased is converted, into one block when
+  // nothing was and into separate streams next to the mapping otherwise
+  bool fill_positions = !m->positions, fill_normals = normals && !m->normals;
+  bool fill_texcoords = texcoords && !m->texcoords, fill_indices = !m->indices;
+  if (!m->storage) {
+    uint32_t flags = (normals ? MESH_HAS_NORMALS : 0) | (texcoords ? MESH_HAS_TEXCOORDS : 0);
+    if (!mesh_allocate(m, vc, ic, flags, NULL)) return false;
+  } else {
+    if (fill_normals) m->normals = malloc(vc * 3 * sizeof(float));
+    if (fill_texcoords) m->texcoords = calloc(vc * 2, sizeof(float));
+    if (fill_indices) m->indices = malloc((ic ? ic : 1) * sizeof(uint32_t));
+  }
+
+  size_t vbase = 0, ibase = 0;
+  for (size_t p = 0; p < json_count(doc, prims); p++) {
+    uint32_t prim = json_at(doc, prims, p);
+    const gltf_accessor *pos = attribute(imp, prim, "POSITION");
+    const gltf_accessor *idx = index_accessor(imp, prim);
+    if (json_int(doc, json_get(doc, prim, "mode"), GLTF_TRIANGLES) != GLTF_TRIANGLES ||
+        !valid_vertex_accessor(pos, 3) || (idx && !valid_index_accessor(idx))) {
+      continue;
+    }
+    const gltf_accessor *nrm = attribute(imp, prim, "NORMAL");
+    const gltf_accessor *uv = attribute(imp, prim, "TEXCOORD_0");
+
+    if (fill_positions) read_floats(imp, pos, 3, m->positions + vbase * 3);
+    if (fill_normals) read_floats(imp, nrm, 3, m->normals + vbase * 3);
+    if (fill_texcoords && valid_vertex_accessor(uv, 2) && uv->count == pos->count) {
+      read_floats(imp, uv, 2, m->texcoords + vbase * 2);
+    }
+
+    size_t count = (idx ? idx->count : pos->count) / 3 * 3;
+    if (!idx) {
+      for (size_t i = 0; i < count; i++) m->indices[ibase + i] = (uint32_t)(vbase + i);
+    } else if (fill_indices) {
+      uint32_t *scratch = count == idx->count ? m->indices + ibase : malloc(idx->count * sizeof(uint32_t));
+      bool ok = read_indices(imp, idx, (uint32_t)vbase, pos->count, scratch);
+      if (scratch != m->indices + ibase) {
+        memcpy(m->indices + ibase, scratch, count * sizeof(uint32_t));
+        free(scratch);
+      }
+      if (!ok) {
+        fprintf(stderr, "gltf: mesh %zu has indices past its vertices\n", index);
+        return false;
+      }
+    } else {
+      // aliased indices are still checked once before anything trusts them
+      for (size_t i = 0; i < count; i++) {
+        if (m->indices[i] >= vc) {
+          fprintf(stderr, "gltf: mesh %zu has indices past its vertices\n", index);
+          return false;
+        }
+      }
+    }
+    vbase += pos->count;
+    ibase += count;
+  }
+
+  if (float_bounds) {
+    for (int k = 0; k < 3; k++) {
+      m->bounds_min[k] = INFINITY;
+      m->bounds_max[k] = -INFINITY;
+    }
+    for (size_t p = 0; p < json_count(doc, prims); p++) {
+      const gltf_accessor *pos = attribute(imp, json_at(doc, prims, p), "POSITION");
+      if (!pos || !pos->has_bounds) continue;
+      for (int k = 0; k < 3; k++) {
+        m->bounds_min[k] = fminf(m->bounds_min[k], pos->min[k]);
+        m->bounds_max[k] = fmaxf(m->bounds_max[k], pos->max[k]);
+      }
+    }
+  } else {
+    mesh_compute_bounds(m);
+  }
+  return true;
+}
+
+static void quat_from_matrix(const float r[3][3], float q[4]) {
+  float trace = r[0][0] + r[1][1] + r[2][2];
+  if (trace > 0.0f) {
+    float s = sqrtf(trace + 1.0f) * 2.0f;
+    q[3] = 0.25f * s;
+    q[0] = (r[2][1] - r[1][2]) / s;
+    q[1] = (r[0][2] - r[2][0]) / s;
+    q[2] = (r[1][0] - r[0][1]) / s;
+  } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+    float s = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+    q[3] = (r[2][1] - r[1][2]) / s;
+    q[0] = 0.25f * s;
+    q[1] = (r[0][1] + r[1][0]) / s;
+    q[2] = (r[0][2] + r[2][0]) / s;
+  } else if (r[1][1] > r[2][2]) {
+    float s = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+    q[3] = (r[0][2] - r[2][0]) / s;
+    q[0] = (r[0][1] + r[1][0]) / s;
+    q[1] = 0.25f * s;
+    q[2] = (r[1][2] + r[2][1]) / s;
+  } else {
+    float s = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+    q[3] = (r[1][0] - r[0][1]) / s;
+    q[0] = (r[0][2] + r[2][0]) / s;
+    q[1] = (r[1][2] + r[2][1]) / s;
+    q[2] = 0.25f * s;
+  }
+}
+
+static void read_node(const json_document *doc, uint32_t tok, gltf_node *node) {
+  static const float identity_rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+  memcpy(node->rotation, identity_rotation, sizeof(node->rotation));
+  for (int k = 0; k < 3; k++) {
+    node->translation[k] = 0.0f;
+    node->scale[k] = 1.0f;
+  }
+  json_string(doc, json_get(doc, tok, "name"), node->name, sizeof(node->name));
+
+  uint32_t matrix = json_get(doc, tok, "matrix");
+  if (json_count(doc, matrix) == 16) {
+    // column major, decomposed assuming no shear
+    float m[4][4];
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) m[r][c] = json_float(doc, json_at(doc, matrix, (size_t)(c * 4 + r)), 0.0f);
+    }
+    float r[3][3];
+    for (int c = 0; c < 3; c++) {
+      node->translation[c] = m[c][3];
+      node->scale[c] = sqrtf(m[0][c] * m[0][c] + m[1][c] * m[1][c] + m[2][c] * m[2][c]);
+    }
+    float det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if (det < 0.0f) node->scale[0] = -node->scale[0];
+    for (int rr = 0; rr < 3; rr++) {
+      for (int c = 0; c < 3; c++) r[rr][c] = node->scale[c] != 0.0f ? m[rr][c] / node->scale[c] : 0.0f;
+    }
+    quat_from_matrix(r, node->rotation);
+    return;
+  }
+
+  uint32_t t = json_get(doc, tok, "translation");
+  uint32_t q = json_get(doc, tok, "rotation");
+  uint32_t s = json_get(doc, tok, "scale");
+  for (int k = 0; k < 3; k++) {
+    node->translation[k] = json_float(doc, json_at(doc, t, (size_t)k), node->translation[k]);
+    node->scale[k] = json_float(doc, json_at(doc, s, (size_t)k), node->scale[k]);
+  }
+  for (int k = 0; k < 4; k++) {
+    node->rotation[k] = json_float(doc, json_at(doc, q, (size_t)k), node->rotation[k]);
+  }
+}
+
+// nodes are listed breadth first from the roots so parents come first,
+// nodes reached twice or through a cycle are dropped
+static bool load_nodes(const gltf_import *imp, gltf_model *model) {
+  const json_document *doc = &imp->doc;
+  uint32_t list = json_get(doc, 0, "nodes");
+  size_t count = json_count(doc, list);
+  if (count == 0) return true;
+
+  int32_t *parent = malloc(count * sizeof(int32_t));
+  int32_t *order = malloc(count * sizeof(int32_t));
+  int32_t *remap = malloc(count * sizeof(int32_t));
+  uint32_t *toks = malloc(count * sizeof(uint32_t));
+  for (size_t i = 0; i < count; i++) {
+    parent[i] = -1;
+    remap[i] = -1;
+    toks[i] = json_at(doc, list, i);
+  }
+  for (size_t i = 0; i < count; i++) {
+    uint32_t children = json_get(doc, toks[i], "children");
+    for (size_t c = 0; c < json_count(doc, children); c++) {
+      int64_t child = json_int(doc, json_at(doc, children, c), -1);
+      if (child < 0 || (size_t)child >= count || (size_t)child == i || parent[child] >= 0) continue;
+      parent[child] = (int32_t)i;
+    }
+  }
+
+  size_t head = 0, tail = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (parent[i] < 0) {
+      remap[i] = (int32_t)tail;
+      order[tail++] = (int32_t)i;
+    }
+  }
+  while (head < tail) {
+    int32_t n = order[head++];
+    uint32_t children = json_get(doc, toks[n], "children");
+    for (size_t c = 0; c < json_count(doc, children); c++) {
+      int64_t child = json_int(doc, json_at(doc, children, c), -1);
+      if (child < 0 || (size_t)child >= count || parent[child] != n || remap[child] >= 0) continue;
+      remap[child] = (int32_t)tail;
+      order[tail++] = (int32_t)child;
+    }
+  }
+
+  model->nodes = calloc(tail ? tail : 1, sizeof(gltf_node));
+  model->node_count = tail;
+  for (size_t i = 0; i < tail; i++) {
+    int32_t n = order[i];
+    gltf_node *node = &model->nodes[i];
+    read_node(doc, toks[n], node);
+    node->parent = parent[n] >= 0 ? remap[parent[n]] : -1;
+    int64_t m = json_int(doc, json_get(doc, toks[n], "mesh"), -1);
+    node->mesh = m >= 0 && (size_t)m < model->mesh_count ? (int32_t)m : -1;
+  }
+
+  if (tail < count) fprintf(stderr, "gltf: dropped %zu nodes caught in cycles\n", count - tail);
+  free(parent);
+  free(order);
+  free(remap);
+  free(toks);
+  return true;
+}
+
+static void free_import(gltf_import *imp) {
+  for (size_t i = 0; i < imp->buffer_count; i++) {
+    gltf_buffer *b = &imp->buffers[i];
+    asset_file_unmap(&b->mapping);
+    free(b->decoded);
+    free(b->file);
+  }
+  free(imp->buffers);
+  free(imp->views);
+  free(imp->accessors);
+  json_destroy(&imp->doc);
+}
+
+bool gltf_load_model(const char *path, gltf_model *out) {
+  memset(out, 0, sizeof(gltf_model));
+
+  asset_file mapping;
+  if (!map_file(path, false, &mapping)) {
+    fprintf(stderr, "gltf: cannot open '%s'\n", path);
+    return false;
+  }
+  const uint8_t *file = mapping.data;
+  size_t size = mapping.size;
+
+  glb_chunks chunks = { (const char *)file, size, NULL, 0 };
+  if (size >= 4 && file[0] == 'g' && file[1] == 'l' && file[2] == 'T' && file[3] == 'F' &&
+      !glb_parse(file, size, &chunks)) {
+    fprintf(stderr, "gltf: '%s' is not a valid glb container\n", path);
+    asset_file_unmap(&mapping);
+    return false;
+  }
+
+  gltf_import imp;
+  memset(&imp, 0, sizeof(imp));
+  imp.path = path;
+  bool ok = json_parse(&imp.doc, chunks.json, chunks.json_size) &&
+            imp.doc.tokens[0].type == JSON_OBJECT &&
+            load_buffers(&imp, &chunks, file) && load_views(&imp) && load_accessors(&imp);
+
+  if (ok) {
+    uint32_t meshes = json_get(&imp.doc, 0, "meshes");
+    out->mesh_count = json_count(&imp.doc, meshes);
+    out->meshes = calloc(out->mesh_count ? out->mesh_count : 1, sizeof(mesh));
+    for (size_t i = 0; i < out->mesh_count && ok; i++) {
+      ok = load_mesh_primitives(&imp, json_at(&imp.doc, meshes, i), i, &out->meshes[i]);
+    }
+  }
+  ok = ok && load_nodes(&imp, out);
+
+  free_import(&imp);
+  asset_file_unmap(&mapping);
+  if (!ok) gltf_model_destroy(out);
+  return ok;
+}
+
+void gltf_model_destroy(gltf_model *model) {
+  for (size_t i = 0; i < model->mesh_count; i++) {
+    destroy_mesh(&model->meshes[i]);
+  }
+  free(model->meshes);
+  free(model->nodes);
+  memset(model, 0, sizeof(gltf_model));
+}
+
+static mat4 node_matrix(const gltf_node *n) {
+  float x = n->rotation[0], y = n->rotation[1], z = n->rotation[2], w = n->rotation[3];
+  float r[3][3] = {
+    { 1 - 2*(y*y + z*z), 2*(x*y - w*z),     2*(x*z + w*y)     },
+    { 2*(x*y + w*z),     1 - 2*(x*x + z*z), 2*(y*z - w*x)     },
+    { 2*(x*z - w*y),     2*(y*z + w*x),     1 - 2*(x*x + y*y) }
+  };
+  mat4 m = mat4_identity();
+  for (int row = 0; row < 3; row++) {
+    for (int c = 0; c < 3; c++) m.m[row][c] = r[row][c] * n->scale[c];
+    m.m[row][3] = n->translation[row];
+  }
+  return m;
+}
+
+static bool is_identity(const mat4 *m) {
+  mat4 id = mat4_identity();
+  return memcmp(m, &id, sizeof(mat4)) == 0;
+}
+
+bool gltf_flatten(gltf_model *model, mesh *out) {
+  memset(out, 0, sizeof(mesh));
+
+  // meshes without nodes are taken as they are
+  size_t instance_count = 0;
+  for (size_t i = 0; i < model->node_count; i++) instance_count += model->nodes[i].mesh >= 0;
+  bool nodeless = instance_count == 0;
+  if (nodeless) instance_count = model->mesh_count;
+  if (instance_count == 0) return false;
+
+  mat4 *world = malloc((model->node_count ? model->node_count : 1) * sizeof(mat4));
+  int32_t *instances = malloc(instance_count * sizeof(int32_t));
+  size_t n = 0;
+  for (size_t i = 0; i < model->node_count; i++) {
+    const gltf_node *node = &model->nodes[i];
+    world[i] = node_matrix(node);
+    if (node->parent >= 0) world[i] = mat_mul(world[node->parent], world[i]);
+    if (node->mesh >= 0) instances[n++] = (int32_t)i;
+  }
+  if (nodeless) {
+    for (size_t i = 0; i < instance_count; i++) instances[i] = -1 - (int32_t)i;
+  }
+
+  // a lone untransformed instance keeps its mapped streams
+  if (instance_count == 1) {
+    int32_t inst = instances[0];
+    size_t index = inst >= 0 ? (size_t)model->nodes[inst].mesh : 0;
+    if (inst < 0 || is_identity(&world[inst])) {
+      *out = model->meshes[index];
+      memset(&model->meshes[index], 0, sizeof(mesh));
+      free(world);
+      free(instances);
+      return out->positions != NULL;
+    }
+  }
+
+  size_t vc = 0, ic = 0;
+  bool normals = true, texcoords = false;
+  for (size_t i = 0; i < instance_count; i++) {
+    const mesh *m = &model->meshes[instances[i] >= 0 ? model->nodes[instances[i]].mesh : -1 - instances[i]];
+    if (!m->positions) continue;
+    vc += m->vert_count;
+    ic += m->idx_count;
+    normals &= m->normals != NULL;
+    texcoords |= m->texcoords != NULL;
+  }
+  if (vc == 0 || vc > UINT32_MAX) {
+    free(world);
+    free(instances);
+    return false;
+  }
+
+  uint32_t flags = (normals ? MESH_HAS_NORMALS : 0) | (texcoords ? MESH_HAS_TEXCOORDS : 0);
+  if (!mesh_allocate(out, vc, ic, flags, NULL)) {
+    free(world);
+    free(instances);
+    return false;
+  }
+
+  size_t vbase = 0, ibase = 0;
+  for (size_t i = 0; i < instance_count; i++) {
+    const mesh *m = &model->meshes[instances[i] >= 0 ? model->nodes[instances[i]].mesh : -1 - instances[i]];
+    if (!m->positions) continue;
+    mat4 w = instances[i] >= 0 ? world[instances[i]] : mat4_identity();
+
+    // normals go through the cofactor matrix, the inverse transpose up to scale
+    float c[3][3];
+    for (int r = 0; r < 3; r++) {
+      for (int k = 0; k < 3; k++) {
+        int r1 = (r + 1) % 3, r2 = (r + 2) % 3, k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+        c[r][k] = w.m[r1][k1] * w.m[r2][k2] - w.m[r1][k2] * w.m[r2][k1];
+      }
+    }
+    float det = w.m[0][0] * c[0][0] + w.m[0][1] * c[0][1] + w.m[0][2] * c[0][2];
+
+    size_t mvc = m->vert_count;
+    for (size_t v = 0; v < mvc; v++) {
+      const float *p = &m->positions[3 * v];
+      float *o = &out->positions[3 * (vbase + v)];
+      for (int r = 0; r < 3; r++) {
+        o[r] = w.m[r][0] * p[0] + w.m[r][1] * p[1] + w.m[r][2] * p[2] + w.m[r][3];
+      }
+      if (normals) {
+        const float *nm = &m->normals[3 * v];
+        vec3 t = {
+          c[0][0] * nm[0] + c[0][1] * nm[1] + c[0][2] * nm[2],
+          c[1][0] * nm[0] + c[1][1] * nm[1] + c[1][2] * nm[2],
+          c[2][0] * nm[0] + c[2][1] * nm[1] + c[2][2] * nm[2]
+        };
+        t = vec3_normalize(t);
+        memcpy(&out->normals[3 * (vbase + v)], &t, sizeof(t));
+      }
+      if (texcoords && m->texcoords) {
+        memcpy(&out->texcoords[2 * (vbase + v)], &m->texcoords[2 * v], 2 * sizeof(float));
+      }
+    }
+
+    // mirroring transforms flip the winding back
+    size_t mic = m->idx_count;
+    for (size_t t = 0; t < mic; t += 3) {
+      uint32_t *o = &out->indices[ibase + t];
+      o[0] = (uint32_t)vbase + m->indices[t];
+      o[1] = (uint32_t)vbase + m->indices[t + (det < 0.0f ? 2 : 1)];
+      o[2] = (uint32_t)vbase + m->indices[t + (det < 0.0f ? 1 : 2)];
+    }
+    vbase += mvc;
+    ibase += mic;
+  }
+
+  free(world);
+  free(instances);
+  mesh_compute_bounds(out);
+  return true;
+}
+
+void at_load_gltf(const char *path, mesh *out) {
+  gltf_model model;
+  if (!gltf_load_model(path, &model)) {
+    fprintf(stderr, "load_gltf: failed to load '%s'\n", path);
+    return;
+  }
+  gltf_flatten(&model, out);
+  gltf_model_destroy(&model);
+}
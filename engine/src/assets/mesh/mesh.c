@@ -1,9 +1,13 @@
 #include <assets/mesh.h>
+#include <assets/amesh.h>
+#include <assets/gltf.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <lib/la.h>
+#include <lib/jobs.h>
+#include <lib/trig.h>
 
 typedef void (*mesh_loader)(const char *, mesh *); 
 
@@ -11,11 +15,17 @@ static const struct {
   const char  *ext;
   mesh_loader fun;
 } loaders[] = {
-  { "obj", load_obj },
-  { NULL , NULL     }
+  { "obj"  , load_obj   },
+  { "gltf" , load_gltf  },
+  { "glb"  , load_glb   },
+  { "fbx"  , load_fbx   },
+  { "amesh", load_amesh },
+  { NULL   , NULL       }
 };
 
 void load_mesh(const char *path, mesh *out) {
+  memset(out, 0, sizeof(*out));
+
   const char *dot = strrchr(path, '.');
   if (!dot || dot == path) {
     fprintf(stderr, "load_mesh: no valid extension on '%s'\n", path);
@@ -28,6 +38,8 @@ void load_mesh(const char *path, mesh *out) {
   for (i = 0 ; loaders[i].ext ; i++) {
     if (strcmp(ext, loaders[i].ext) == 0) {
       loaders[i].fun(path, out); 
+      // mapped meshes take their bounds from the file
+      if (out->storage_kind != MESH_STORAGE_MAPPED) mesh_compute_bounds(out);
       return;
     }
   }
@@ -35,69 +47,199 @@ void load_mesh(const char *path, mesh *out) {
   fprintf(stderr, "Unsupported file format '.%s'\n", ext);
 }
 
-void generate_normals_smooth(mesh *m) {
-  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
-    return;
-  }
+#define WELD_DISTANCE   1e-3f  // vertices closer than this share their normal
+#define NORMALS_BATCH   16384  // elements per job
 
-  size_t vc = *m->vert_count;
-  size_t ic = *m->idx_count;
+typedef struct {
+  const mesh *m;
+  size_t     vert_count;
+  size_t     tri_count;
+  float      cos_crease;  // below -1 when every welded vertex is merged
 
-  if (m->normals) free(m->normals);
-  m->normals = calloc(vc * 3, sizeof(float));
+  float    *face_normals;  // area weighted, per triangle
+  uint32_t *vert_start;    // vertex to triangle adjacency
+  uint32_t *vert_tris;
+  float    *accumulated;   // sum over each vertex's own triangles
 
-  for (size_t i = 0; i < ic; i += 3) {
-    uint32_t i0 = m->indices[i + 0];
-    uint32_t i1 = m->indices[i + 1];
-    uint32_t i2 = m->indices[i + 2];
+  uint32_t *bucket_start;  // vertices grouped by the hash of their grid cell
+  uint32_t *bucket_verts;
+  size_t   bucket_mask;
+
+  float *out;
+} normals_job;
+
+static void weld_cell(const float *p, int64_t cell[3]) {
+  for (int k = 0; k < 3; k++) cell[k] = (int64_t)floorf(p[k] / WELD_DISTANCE);
+}
+
+static size_t weld_bucket(const int64_t cell[3], size_t mask) {
+  uint64_t h = (uint64_t)cell[0] * 0x9e3779b97f4a7c15ull;
+  h ^= (uint64_t)cell[1] * 0xc2b2ae3d27d4eb4full;
+  h ^= (uint64_t)cell[2] * 0x165667b19e3779f9ull;
+  h ^= h >> 32;
+  return (size_t)h & mask;
+}
+
+static void face_normals_batch(void *ctx, size_t batch) {
+  normals_job *j = ctx;
+  const mesh *m = j->m;
+  size_t end = (batch + 1) * NORMALS_BATCH < j->tri_count ? (batch + 1) * NORMALS_BATCH : j->tri_count;
+
+  for (size_t t = batch * NORMALS_BATCH; t < end; t++) {
+    uint32_t i0 = m->indices[3*t + 0];
+    uint32_t i1 = m->indices[3*t + 1];
+    uint32_t i2 = m->indices[3*t + 2];
 
     vec3 v0 = { m->positions[3*i0+0], m->positions[3*i0+1], m->positions[3*i0+2] };
     vec3 v1 = { m->positions[3*i1+0], m->positions[3*i1+1], m->positions[3*i1+2] };
     vec3 v2 = { m->positions[3*i2+0], m->positions[3*i2+1], m->positions[3*i2+2] };
 
-    vec3 e1 = vec_sum(v1, vec_negate(v0));
-    vec3 e2 = vec_sum(v2, vec_negate(v0));
-    vec3 n = vec_cross(e1, e2);
+    vec3 n = vec_cross(vec_sum(v1, vec_negate(v0)), vec_sum(v2, vec_negate(v0)));
+    j->face_normals[3*t + 0] = n.x;
+    j->face_normals[3*t + 1] = n.y;
+    j->face_normals[3*t + 2] = n.z;
+  }
+}
+
+// gathering per vertex instead of scattering per face keeps the jobs free of
+// shared writes and the summation order the same as a serial pass
+static void accumulate_batch(void *ctx, size_t batch) {
+  normals_job *j = ctx;
+  size_t end = (batch + 1) * NORMALS_BATCH < j->vert_count ? (batch + 1) * NORMALS_BATCH : j->vert_count;
 
-    m->normals[3*i0+0] += n.x; m->normals[3*i0+1] += n.y; m->normals[3*i0+2] += n.z;
-    m->normals[3*i1+0] += n.x; m->normals[3*i1+1] += n.y; m->normals[3*i1+2] += n.z;
-    m->normals[3*i2+0] += n.x; m->normals[3*i2+1] += n.y; m->normals[3*i2+2] += n.z;
+  for (size_t v = batch * NORMALS_BATCH; v < end; v++) {
+    float n[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t k = j->vert_start[v]; k < j->vert_start[v + 1]; k++) {
+      const float *f = &j->face_normals[3 * j->vert_tris[k]];
+      n[0] += f[0];
+      n[1] += f[1];
+      n[2] += f[2];
+    }
+    memcpy(&j->accumulated[3*v], n, sizeof(n));
   }
+}
+
+static bool within_crease(const normals_job *j, const float *a, const float *b) {
+  if (j->cos_crease < -1.0f) return true;
+
+  float la = sqrtf(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]);
+  float lb = sqrtf(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
+  if (la == 0.0f || lb == 0.0f) return true;
+  return (a[0]*b[0] + a[1]*b[1] + a[2]*b[2]) >= j->cos_crease * la * lb;
+}
+
+// sums every vertex within the weld distance, found in the 27 grid cells
+// around the vertex's own
+static void weld_batch(void *ctx, size_t batch) {
+  normals_job *j = ctx;
+  const float *positions = j->m->positions;
+  size_t end = (batch + 1) * NORMALS_BATCH < j->vert_count ? (batch + 1) * NORMALS_BATCH : j->vert_count;
 
-  float *averaged_normals = calloc(vc * 3, sizeof(float));
+  for (size_t v = batch * NORMALS_BATCH; v < end; v++) {
+    const float *p = &positions[3*v];
+    const float *own = &j->accumulated[3*v];
+    int64_t cell[3];
+    weld_cell(p, cell);
 
-  for (size_t i = 0; i < vc; i++) {
-    vec3 pos_i = { m->positions[3*i+0], m->positions[3*i+1], m->positions[3*i+2] };
-    vec3 normal_sum = { m->normals[3*i+0], m->normals[3*i+1], m->normals[3*i+2] };
+    vec3 sum = { 0.0f, 0.0f, 0.0f };
+    for (int dz = -1; dz <= 1; dz++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+          int64_t neighbour[3] = { cell[0] + dx, cell[1] + dy, cell[2] + dz };
+          size_t bucket = weld_bucket(neighbour, j->bucket_mask);
 
-    for (size_t j = 0; j < vc; j++) {
-      if (i == j) continue;
+          for (uint32_t k = j->bucket_start[bucket]; k < j->bucket_start[bucket + 1]; k++) {
+            uint32_t u = j->bucket_verts[k];
+            const float *q = &positions[3*u];
 
-      vec3 pos_j = { m->positions[3*j+0], m->positions[3*j+1], m->positions[3*j+2] };
-      vec3 diff = vec_sum(pos_i, vec_negate(pos_j));
-      float dist_sq = vec_dot(diff, diff);
+            // buckets are shared by colliding cells, only this cell's vertices count
+            int64_t other[3];
+            weld_cell(q, other);
+            if (other[0] != neighbour[0] || other[1] != neighbour[1] || other[2] != neighbour[2]) continue;
 
-      if (dist_sq < 1e-6f) {
-        normal_sum.x += m->normals[3*j+0];
-        normal_sum.y += m->normals[3*j+1];
-        normal_sum.z += m->normals[3*j+2];
+            vec3 diff = { p[0] - q[0], p[1] - q[1], p[2] - q[2] };
+            if (vec_dot(diff, diff) >= WELD_DISTANCE * WELD_DISTANCE) continue;
+
+            const float *n = &j->accumulated[3*u];
+            if (u != v && !within_crease(j, own, n)) continue;
+            sum.x += n[0];
+            sum.y += n[1];
+            sum.z += n[2];
+          }
+        }
       }
     }
 
-    averaged_normals[3*i+0] = normal_sum.x;
-    averaged_normals[3*i+1] = normal_sum.y;
-    averaged_normals[3*i+2] = normal_sum.z;
+    vec3 n = vec_normalize(sum);
+    j->out[3*v + 0] = n.x;
+    j->out[3*v + 1] = n.y;
+    j->out[3*v + 2] = n.z;
   }
+}
 
-  for (size_t i = 0; i < vc; i++) {
-    vec3 n = { averaged_normals[3*i+0], averaged_normals[3*i+1], averaged_normals[3*i+2] };
-    n = vec_normalize(n);
-    m->normals[3*i+0] = n.x;
-    m->normals[3*i+1] = n.y;
-    m->normals[3*i+2] = n.z;
+void generate_normals_creased(mesh *m, float crease_angle) {
+  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    return;
   }
 
-  free(averaged_normals);
+  size_t vc = m->vert_count;
+  size_t ic = m->idx_count;
+
+  normals_job j = {
+    .m = m, .vert_count = vc, .tri_count = ic / 3,
+    .cos_crease = crease_angle >= PI ? -2.0f : cosf(crease_angle)
+  };
+  j.face_normals = malloc((j.tri_count ? j.tri_count : 1) * 3 * sizeof(float));
+  j.accumulated  = malloc((vc ? vc : 1) * 3 * sizeof(float));
+  // an existing normal stream is overwritten in place, every vertex is written
+  j.out          = m->normals ? m->normals : calloc(vc * 3, sizeof(float));
+
+  // vertex to triangle adjacency by counting sort, in triangle order
+  j.vert_start = calloc(vc + 1, sizeof(uint32_t));
+  j.vert_tris  = malloc((ic ? ic : 1) * sizeof(uint32_t));
+  for (size_t i = 0; i < j.tri_count * 3; i++) j.vert_start[m->indices[i] + 1]++;
+  for (size_t v = 0; v < vc; v++) j.vert_start[v + 1] += j.vert_start[v];
+  uint32_t *fill = malloc((vc ? vc : 1) * sizeof(uint32_t));
+  memcpy(fill, j.vert_start, vc * sizeof(uint32_t));
+  for (size_t i = 0; i < j.tri_count * 3; i++) j.vert_tris[fill[m->indices[i]]++] = (uint32_t)(i / 3);
+
+  // vertices bucketed by grid cell the same way
+  size_t buckets = 16;
+  while (buckets < vc * 2) buckets *= 2;
+  j.bucket_mask  = buckets - 1;
+  j.bucket_start = calloc(buckets + 1, sizeof(uint32_t));
+  j.bucket_verts = malloc((vc ? vc : 1) * sizeof(uint32_t));
+  uint32_t *vert_bucket = malloc((vc ? vc : 1) * sizeof(uint32_t));
+  for (size_t v = 0; v < vc; v++) {
+    int64_t cell[3];
+    weld_cell(&m->positions[3*v], cell);
+    vert_bucket[v] = (uint32_t)weld_bucket(cell, j.bucket_mask);
+    j.bucket_start[vert_bucket[v] + 1]++;
+  }
+  for (size_t b = 0; b < buckets; b++) j.bucket_start[b + 1] += j.bucket_start[b];
+  fill = realloc(fill, buckets * sizeof(uint32_t));
+  memcpy(fill, j.bucket_start, buckets * sizeof(uint32_t));
+  for (size_t v = 0; v < vc; v++) j.bucket_verts[fill[vert_bucket[v]]++] = (uint32_t)v;
+  free(vert_bucket);
+  free(fill);
+
+  jobs_parallel_for((j.tri_count + NORMALS_BATCH - 1) / NORMALS_BATCH, face_normals_batch, &j);
+  jobs_parallel_for((vc + NORMALS_BATCH - 1) / NORMALS_BATCH, accumulate_batch, &j);
+  jobs_parallel_for((vc + NORMALS_BATCH - 1) / NORMALS_BATCH, weld_batch, &j);
+
+  m->normals = j.out;
+  mesh_drop_gpu_copies(m);
+
+  free(j.face_normals);
+  free(j.accumulated);
+  free(j.vert_start);
+  free(j.vert_tris);
+  free(j.bucket_start);
+  free(j.bucket_verts);
+}
+
+void generate_normals_smooth(mesh *m) {
+  generate_normals_creased(m, PI);
 }
 
 void generate_normals_flat(mesh *m) {
@@ -105,11 +247,15 @@ void generate_normals_flat(mesh *m) {
     return;
   }
 
-  size_t vc = *m->vert_count;
-  size_t ic = *m->idx_count;
+  size_t vc = m->vert_count;
+  size_t ic = m->idx_count;
 
-  if (m->normals) free(m->normals);
-  m->normals = calloc(vc * 3, sizeof(float));
+  if (m->normals) {
+    memset(m->normals, 0, vc * 3 * sizeof(float));
+  } else {
+    m->normals = calloc(vc * 3, sizeof(float));
+  }
+  mesh_drop_gpu_copies(m);
 
   for (size_t i = 0; i < ic; i += 3) {
     uint32_t i0 = m->indices[i + 0];
@@ -130,15 +276,27 @@ void generate_normals_flat(mesh *m) {
   }
 }
 
-void generate_normals(mesh *m) {
-  generate_normals_smooth(m);
+void mesh_compute_bounds(mesh *m) {
+  if (!m->positions || !m->vert_count || m->vert_count == 0) {
+    memset(m->bounds_min, 0, sizeof(m->bounds_min));
+    memset(m->bounds_max, 0, sizeof(m->bounds_max));
+    return;
+  }
+
+  for (int k = 0; k < 3; k++) {
+    m->bounds_min[k] = m->positions[k];
+    m->bounds_max[k] = m->positions[k];
+  }
+
+  for (size_t i = 1; i < m->vert_count; i++) {
+    for (int k = 0; k < 3; k++) {
+      float p = m->positions[3*i + k];
+      if (p < m->bounds_min[k]) m->bounds_min[k] = p;
+      if (p > m->bounds_max[k]) m->bounds_max[k] = p;
+    }
+  }
 }
 
-void destroy_mesh(mesh *m) {
-  free(m->positions);
-  free(m->normals);
-  free(m->texcoords);
-  free(m->indices);
-  free(m->vert_count);
-  free(m->idx_count);
+void generate_normals(mesh *m) {
+  generate_normals_smooth(m);
 }
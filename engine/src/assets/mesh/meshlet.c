@@ -0,0 +1,202 @@
+#include <assets/mesh.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+static void compute_meshlet_bounds(const mesh *m, meshlet *ml) {
+  const uint32_t *idx = &m->indices[ml->index_offset];
+  size_t          ic  = ml->triangle_count * 3;
+
+  float lo[3] = {  INFINITY,  INFINITY,  INFINITY };
+  float hi[3] = { -INFINITY, -INFINITY, -INFINITY };
+  for (size_t i = 0; i < ic; i++) {
+    const float *p = &m->positions[3 * idx[i]];
+    for (int k = 0; k < 3; k++) {
+      lo[k] = fminf(lo[k], p[k]);
+      hi[k] = fmaxf(hi[k], p[k]);
+    }
+  }
+
+  float radius_sq = 0.0f;
+  for (int k = 0; k < 3; k++) ml->center[k] = 0.5f * (lo[k] + hi[k]);
+  for (size_t i = 0; i < ic; i++) {
+    const float *p = &m->positions[3 * idx[i]];
+    float dx = p[0] - ml->center[0], dy = p[1] - ml->center[1], dz = p[2] - ml->center[2];
+    radius_sq = fmaxf(radius_sq, dx*dx + dy*dy + dz*dz);
+  }
+  ml->radius = sqrtf(radius_sq);
+
+  // normal cone from the average facing of the cluster
+  float axis[3] = { 0.0f, 0.0f, 0.0f };
+  for (size_t i = 0; i < ic; i += 3) {
+    const float *p0 = &m->positions[3 * idx[i+0]];
+    const float *p1 = &m->positions[3 * idx[i+1]];
+    const float *p2 = &m->positions[3 * idx[i+2]];
+    float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    float n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+    float len   = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    if (len == 0.0f) continue;
+    for (int k = 0; k < 3; k++) axis[k] += n[k] / len;
+  }
+
+  float axis_len = sqrtf(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+  memcpy(ml->cone_apex, ml->center, sizeof(ml->cone_apex));
+  memset(ml->cone_axis, 0, sizeof(ml->cone_axis));
+  ml->cone_cutoff = 1.0f;
+  if (axis_len == 0.0f) return;
+  for (int k = 0; k < 3; k++) axis[k] /= axis_len;
+
+  float min_dp = 1.0f;
+  float max_t  = 0.0f;
+  for (size_t i = 0; i < ic; i += 3) {
+    const float *p0 = &m->positions[3 * idx[i+0]];
+    const float *p1 = &m->positions[3 * idx[i+1]];
+    const float *p2 = &m->positions[3 * idx[i+2]];
+    float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    float n[3]  = { e1[1]*e2[2] - e1[2]*e2[1], e1[2]*e2[0] - e1[0]*e2[2], e1[0]*e2[1] - e1[1]*e2[0] };
+    float len   = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    if (len == 0.0f) continue;
+    for (int k = 0; k < 3; k++) n[k] /= len;
+
+    float dp = axis[0]*n[0] + axis[1]*n[1] + axis[2]*n[2];
+    min_dp = fminf(min_dp, dp);
+    if (dp <= 0.0f) continue;
+
+    // push the apex back along the axis until it is behind this triangle's plane
+    float dc = (ml->center[0] - p0[0]) * n[0] + (ml->center[1] - p0[1]) * n[1]
+             + (ml->center[2] - p0[2]) * n[2];
+    max_t = fmaxf(max_t, dc / dp);
+  }
+
+  // wider than a hemisphere, no viewpoint sees only back faces
+  if (min_dp <= 0.1f) return;
+
+  for (int k = 0; k < 3; k++) {
+    ml->cone_apex[k] = ml->center[k] - axis[k] * max_t;
+    ml->cone_axis[k] = axis[k];
+  }
+  ml->cone_cutoff = sqrtf(1.0f - min_dp * min_dp);
+}
+
+// greedy clustering in index order, so a prior vertex cache pass keeps
+// clusters spatially compact
+void mesh_build_meshlets(mesh *m) {
+  mesh_free_stream(m, m->meshlets);
+  m->meshlets = NULL;
+  m->meshlet_count = 0;
+
+  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    return;
+  }
+
+  size_t vc = m->vert_count;
+  size_t tc = m->idx_count / 3;
+
+  size_t    capacity = tc / MESHLET_MAX_TRIANGLES + 1;
+  meshlet  *meshlets = malloc(capacity * sizeof(meshlet));
+  uint32_t *seen     = calloc(vc, sizeof(uint32_t));
+  size_t    count    = 0;
+
+  meshlet current = {0};
+  for (size_t t = 0; t < tc; t++) {
+    const uint32_t *tri = &m->indices[3 * t];
+    uint32_t stamp = (uint32_t)count + 1;
+
+    uint32_t fresh = 0;
+    for (int c = 0; c < 3; c++) {
+      bool repeat = (c > 0 && tri[c] == tri[0]) || (c > 1 && tri[c] == tri[1]);
+      if (seen[tri[c]] != stamp && !repeat) fresh++;
+    }
+
+    if (current.triangle_count == MESHLET_MAX_TRIANGLES ||
+        current.vertex_count + fresh > MESHLET_MAX_VERTICES) {
+      if (count == capacity) {
+        capacity *= 2;
+        meshlets = realloc(meshlets, capacity * sizeof(meshlet));
+      }
+      meshlets[count++] = current;
+      current = (meshlet){ .index_offset = (uint32_t)(3 * t) };
+      stamp = (uint32_t)count + 1;
+      fresh = 3 - (tri[1] == tri[0]) - (tri[2] == tri[0] || tri[2] == tri[1]);
+    }
+
+    for (int c = 0; c < 3; c++) seen[tri[c]] = stamp;
+    current.vertex_count += fresh;
+    current.triangle_count++;
+  }
+
+  if (current.triangle_count) {
+    if (count == capacity) {
+      meshlets = realloc(meshlets, (capacity + 1) * sizeof(meshlet));
+    }
+    meshlets[count++] = current;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    compute_meshlet_bounds(m, &meshlets[i]);
+  }
+
+  free(seen);
+  m->meshlets = meshlets;
+  m->meshlet_count = count;
+}
+
+// planes and eye are in mesh space, planes normalized with inside positive
+size_t mesh_cull_meshlets(const mesh *m, const float planes[6][4], const float eye[3],
+                          uint8_t *visible) {
+  size_t count = 0;
+
+#if defined(__SSE__)
+  __m128 ax = _mm_setr_ps(planes[0][0], planes[1][0], planes[2][0], planes[3][0]);
+  __m128 ay = _mm_setr_ps(planes[0][1], planes[1][1], planes[2][1], planes[3][1]);
+  __m128 az = _mm_setr_ps(planes[0][2], planes[1][2], planes[2][2], planes[3][2]);
+  __m128 aw = _mm_setr_ps(planes[0][3], planes[1][3], planes[2][3], planes[3][3]);
+  __m128 bx = _mm_setr_ps(planes[4][0], planes[5][0], planes[4][0], planes[5][0]);
+  __m128 by = _mm_setr_ps(planes[4][1], planes[5][1], planes[4][1], planes[5][1]);
+  __m128 bz = _mm_setr_ps(planes[4][2], planes[5][2], planes[4][2], planes[5][2]);
+  __m128 bw = _mm_setr_ps(planes[4][3], planes[5][3], planes[4][3], planes[5][3]);
+#endif
+
+  for (size_t i = 0; i < m->meshlet_count; i++) {
+    const meshlet *ml = &m->meshlets[i];
+
+#if defined(__SSE__)
+    __m128 cx = _mm_set1_ps(ml->center[0]);
+    __m128 cy = _mm_set1_ps(ml->center[1]);
+    __m128 cz = _mm_set1_ps(ml->center[2]);
+    __m128 nr = _mm_set1_ps(-ml->radius);
+
+    __m128 da = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, cx), _mm_mul_ps(ay, cy)),
+                           _mm_add_ps(_mm_mul_ps(az, cz), aw));
+    __m128 db = _mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, cx), _mm_mul_ps(by, cy)),
+                           _mm_add_ps(_mm_mul_ps(bz, cz), bw));
+    int outside = _mm_movemask_ps(_mm_cmplt_ps(da, nr)) | _mm_movemask_ps(_mm_cmplt_ps(db, nr));
+#else
+    int outside = 0;
+    for (int p = 0; p < 6; p++) {
+      float d = planes[p][0] * ml->center[0] + planes[p][1] * ml->center[1]
+              + planes[p][2] * ml->center[2] + planes[p][3];
+      if (d < -ml->radius) outside = 1;
+    }
+#endif
+
+    if (!outside && ml->cone_cutoff < 1.0f) {
+      float d[3] = { ml->cone_apex[0] - eye[0], ml->cone_apex[1] - eye[1], ml->cone_apex[2] - eye[2] };
+      float len  = sqrtf(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+      float dp   = d[0]*ml->cone_axis[0] + d[1]*ml->cone_axis[1] + d[2]*ml->cone_axis[2];
+      if (dp > ml->cone_cutoff * len) outside = 1;
+    }
+
+    visible[i] = !outside;
+    count += !outside;
+  }
+
+  return count;
+}
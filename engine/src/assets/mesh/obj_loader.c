@@ -1,294 +1,477 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assets/mesh.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <sys/mman.h>
+#include <assets/archive.h>
 #include <lib/la.h>
+#include <lib/parse.h>
+#include <lib/jobs.h>
 
 void load_obj(const char *path, mesh *out)
 __attribute__((alias("at_load_obj")));
 
+void load_obj_chunked(const char *path, mesh *out, size_t chunk_count)
+__attribute__((alias("at_load_obj_chunked")));
+
+#define OBJ_MIN_CHUNK_BYTES   (256 * 1024)
+#define OBJ_CHUNKS_PER_WORKER 4
+
+// face corner links during deduplication, bit 31 marks a first occurrence
+#define LINK_NONE  0xffffffffu
+#define LINK_FIRST 0x80000000u
+
 typedef struct {
   uint32_t position_index;
   uint32_t texcoord_index;
   uint32_t normal_index;
 } vertex_key;
 
+// face corner as written, relative indices are resolved against the chunk's
+// own element counts and still need the chunk's base added
+typedef struct {
+  int32_t index[3];
+  uint8_t relative;  // bit per component
+} obj_corner;
+
 typedef struct {
   vertex_key key;
-  uint64_t   hash;
-  uint32_t   index;
+  uint32_t   first;  // corner that introduced the key
 } hash_entry;
 
-static uint64_t fnv1a_64(const void *data, size_t length) {
-  const uint8_t *bytes = (const uint8_t *)data;
-  uint64_t       h     = 14695981039346656037ULL;
-  const uint64_t prime = 1099511628211ULL;
-  for (size_t i = 0; i < length; i++) {
-    h ^= (uint64_t)bytes[i];
-    h *= prime;
-  }
+// one line aligned slice of the file and what it declares
+typedef struct {
+  const char *begin, *end;
+
+  float  *positions;
+  size_t pos_count, pos_capacity;
+  float  *texcoords;
+  size_t tc_count, tc_capacity;
+  float  *normals;
+  size_t nm_count, nm_capacity;
+
+  obj_corner *corners;
+  size_t     corner_count, corner_capacity;
+  uint32_t   *face_sizes;
+  size_t     face_count, face_capacity;
+
+  size_t pos_base, tc_base, nm_base;
+  size_t corner_base;
+  size_t triangle_count, triangle_base;
+  size_t vertex_count, vertex_base;  // first occurrences of keys in this chunk
+  size_t invalid_faces;
+  bool   has_texcoords, has_normals;
+} obj_chunk;
 
-  return h + 1;
+typedef struct {
+  obj_chunk *chunks;
+  size_t    chunk_count;
+  size_t    partition_count;
+
+  size_t pos_count, tc_count, nm_count;
+  size_t corner_count;
+
+  float *positions;  // every chunk's elements in file order
+  float *texcoords;
+  float *normals;
+
+  vertex_key *keys;    // per corner, position 0 for corners of dropped faces
+  uint32_t   *hashes;
+  uint32_t   *links;   // first occurrence's vertex, or the corner that introduced the key
+
+  mesh     *out;     // streams are emitted straight into its storage
+  float    *out_positions;
+  float    *out_texcoords;
+  float    *out_normals;
+  uint32_t *indices;
+} obj_load;
+
+static void *grow_array(void *array, size_t count, size_t *capacity, size_t element_size) {
+  if (count < *capacity) return array;
+  *capacity = *capacity ? *capacity * 2 : 256;
+  return realloc(array, *capacity * element_size);
 }
 
-static bool ht_insert(hash_entry *table,
-                      size_t        capacity,
-                      vertex_key    key,
-                      uint32_t     *out_index,
-                      uint32_t     *unique_count)
-{
-  uint64_t hash = fnv1a_64(&key, sizeof(key));
-  size_t   idx  = hash % capacity;
-  size_t   step = 1;
-
-  while (table[idx].hash) {
-    if (table[idx].hash == hash
-      && table[idx].key.position_index == key.position_index
-      && table[idx].key.texcoord_index  == key.texcoord_index
-      && table[idx].key.normal_index    == key.normal_index)
-    {
-      *out_index = table[idx].index;
-      return false;
+static inline const char *skip_blanks(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t')) p++;
+  return p;
+}
+
+static inline const char *skip_line(const char *p, const char *end) {
+  const char *nl = memchr(p, '\n', (size_t)(end - p));
+  return nl ? nl + 1 : end;
+}
+
+// appends count floats separated by blanks, missing ones stay zero
+static const char *parse_floats(const char *p, const char *end, float **array, size_t *length,
+                                size_t *capacity, int count) {
+  *array = grow_array(*array, *length, capacity, count * sizeof(float));
+  float *out = *array + *length * count;
+  for (int i = 0; i < count; i++) {
+    out[i] = 0.0f;
+    p = parse_float(skip_blanks(p, end), end, &out[i]);
+  }
+  (*length)++;
+  return p;
+}
+
+// v, v/vt, v//vn or v/vt/vn, negative indices count back from the latest element
+static const char *parse_corner(obj_chunk *c, const char *p, const char *end, obj_corner *corner) {
+  int64_t index[3] = { 0, 0, 0 };
+  size_t counts[3] = { c->pos_count, c->tc_count, c->nm_count };
+
+  p = parse_int(p, end, &index[0]);
+  if (p < end && *p == '/') {
+    p = parse_int(p + 1, end, &index[1]);
+    if (p < end && *p == '/') {
+      p = parse_int(p + 1, end, &index[2]);
     }
+  }
 
-    idx = (idx + step * step) % capacity;
-    step++;
+  corner->relative = 0;
+  for (int k = 0; k < 3; k++) {
+    if (index[k] < 0) {
+      index[k] += (int64_t)counts[k] + 1;
+      corner->relative |= 1 << k;
+    }
+    corner->index[k] = (int32_t)index[k];
   }
 
-  table[idx].hash  = hash;
-  table[idx].key   = key;
-  table[idx].index = *unique_count;
-  *out_index       = (*unique_count)++;
-  return true;
+  // anything else up to the next blank belongs to this corner and is ignored
+  while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+  return p;
 }
 
-static void parse_face_token(const char *token,
-                             size_t     *out_pindex,
-                             size_t     *out_tindex,
-                             size_t     *out_nindex)
-{
-  *out_pindex = 0;
-  *out_tindex = 0;
-  *out_nindex = 0;
-
-  const char *slash1 = strchr(token, '/');
-  if (!slash1) {
-    *out_pindex = atoi(token);
-    return;
+static const char *parse_face(obj_chunk *c, const char *p, const char *end) {
+  uint32_t size = 0;
+  for (;;) {
+    p = skip_blanks(p, end);
+    if (p == end || *p == '\r' || *p == '\n' || *p == '#') break;
+
+    c->corners = grow_array(c->corners, c->corner_count, &c->corner_capacity, sizeof(obj_corner));
+    p = parse_corner(c, p, end, &c->corners[c->corner_count++]);
+    size++;
   }
 
-  *out_pindex = atoi(token);
-  const char *slash2 = strchr(slash1 + 1, '/');
+  c->face_sizes = grow_array(c->face_sizes, c->face_count, &c->face_capacity, sizeof(uint32_t));
+  c->face_sizes[c->face_count++] = size;
+  return p;
+}
 
-  if (!slash2) {
-    *out_tindex = atoi(slash1 + 1);
-  } else if (slash2 == slash1 + 1) {
-    *out_nindex = atoi(slash2 + 1);
-  } else {
-    *out_tindex = atoi(slash1 + 1);
-    *out_nindex = atoi(slash2 + 1);
+static void parse_chunk(void *ctx, size_t index) {
+  obj_chunk *c = &((obj_load *)ctx)->chunks[index];
+  const char *p = c->begin, *end = c->end;
+
+  while (p < end) {
+    p = skip_blanks(p, end);
+    if (p == end) break;
+
+    bool blank = p + 1 < end && (p[1] == ' ' || p[1] == '\t');
+    bool blank2 = p + 2 < end && (p[2] == ' ' || p[2] == '\t');
+    if (*p == 'v' && blank) {
+      p = parse_floats(p + 1, end, &c->positions, &c->pos_count, &c->pos_capacity, 3);
+    } else if (blank2 && *p == 'v' && p[1] == 't') {
+      p = parse_floats(p + 2, end, &c->texcoords, &c->tc_count, &c->tc_capacity, 2);
+    } else if (blank2 && *p == 'v' && p[1] == 'n') {
+      p = parse_floats(p + 2, end, &c->normals, &c->nm_count, &c->nm_capacity, 3);
+    } else if (*p == 'f' && blank) {
+      p = parse_face(c, p + 1, end);
+    }
+
+    p = skip_line(p, end);
   }
 }
 
-void at_load_obj(const char *path, mesh *out) {
-  FILE   *file = fopen(path, "r");
-  if (!file) {
-    fprintf(stderr, "load_obj: cannot open '%s'\n", path);
-    return;
-  }
+// one based index into the whole file, 0 when it points at nothing
+static uint32_t resolve_index(const obj_corner *corner, int k, size_t base, size_t count) {
+  int64_t index = corner->index[k];
+  if (corner->relative & (1 << k)) index += (int64_t)base;
+  return index > 0 && (uint64_t)index <= count ? (uint32_t)index : 0;
+}
 
-  // original vertex arrays
-  size_t pos_capacity = 256, pos_count = 0;
-  vec3  *positions    = malloc(pos_capacity * sizeof(vec3));
-
-  size_t tc_capacity = 256, tc_count = 0;
-  vec2  *texcoords   = malloc(tc_capacity * sizeof(vec2));
-
-  size_t nm_capacity = 256, nm_count = 0;
-  vec3  *normals     = malloc(nm_capacity * sizeof(vec3));
-
-  // hash table and output arrays
-  size_t     ht_capacity     = 1024;
-  hash_entry *hash_table     = calloc(ht_capacity, sizeof(hash_entry));
-  uint32_t    unique_vertices = 0;
-
-  size_t out_capacity     = 256;
-  size_t out_vertex_count = 0;
-  float  *out_positions   = malloc(out_capacity * 3 * sizeof(float));
-  float  *out_texcoords   = NULL;
-  float  *out_normals     = NULL;
-
-  size_t idx_capacity = 256, idx_count = 0;
-  uint32_t *out_indices = malloc(idx_capacity * sizeof(uint32_t));
-
-  char line[1024];
-  while (fgets(line, sizeof(line), file)) {
-    if (strncmp(line, "v ", 2) == 0) {
-      // position
-      if (pos_count >= pos_capacity) {
-        pos_capacity *= 2;
-        positions    = realloc(positions, pos_capacity * sizeof(vec3));
-      }
-      sscanf(line + 2, "%f %f %f",
-             &positions[pos_count].x,
-             &positions[pos_count].y,
-             &positions[pos_count].z);
-      pos_count++;
-
-    } else if (strncmp(line, "vt ", 3) == 0) {
-      // texcoord
-      if (tc_count >= tc_capacity) {
-        tc_capacity *= 2;
-        texcoords    = realloc(texcoords, tc_capacity * sizeof(vec2));
+static uint32_t hash_key(vertex_key k) {
+  uint64_t h = k.position_index * 0x9e3779b97f4a7c15ull;
+  h ^= k.texcoord_index * 0xc2b2ae3d27d4eb4full;
+  h ^= k.normal_index * 0x165667b19e3779f9ull;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 32;
+  return (uint32_t)h;
+}
+
+// copies the chunk's elements to their place in the file wide arrays
+static void merge_elements(obj_load *l, obj_chunk *c) {
+  if (c->pos_count) memcpy(l->positions + 3 * c->pos_base, c->positions, c->pos_count * 3 * sizeof(float));
+  if (c->tc_count)  memcpy(l->texcoords + 2 * c->tc_base, c->texcoords, c->tc_count * 2 * sizeof(float));
+  if (c->nm_count)  memcpy(l->normals + 3 * c->nm_base, c->normals, c->nm_count * 3 * sizeof(float));
+  free(c->positions);
+  free(c->texcoords);
+  free(c->normals);
+  c->positions = c->texcoords = c->normals = NULL;
+}
+
+// faces with an index out of range or fewer than three corners are dropped
+static void resolve_chunk(void *ctx, size_t index) {
+  obj_load *l = ctx;
+  obj_chunk *c = &l->chunks[index];
+  merge_elements(l, c);
+
+  const obj_corner *corner = c->corners;
+  vertex_key *keys = l->keys + c->corner_base;
+  uint32_t *hashes = l->hashes + c->corner_base;
+
+  for (size_t f = 0; f < c->face_count; f++) {
+    uint32_t size = c->face_sizes[f];
+    bool valid = size >= 3;
+
+    for (uint32_t i = 0; i < size; i++) {
+      const obj_corner *oc = &corner[i];
+      bool has_texcoord = oc->index[1] || (oc->relative & 2);
+      bool has_normal = oc->index[2] || (oc->relative & 4);
+
+      vertex_key key = {
+        resolve_index(oc, 0, c->pos_base, l->pos_count),
+        has_texcoord ? resolve_index(oc, 1, c->tc_base, l->tc_count) : 0,
+        has_normal ? resolve_index(oc, 2, c->nm_base, l->nm_count) : 0
+      };
+      if (!key.position_index || (has_texcoord && !key.texcoord_index) ||
+          (has_normal && !key.normal_index)) {
+        valid = false;
       }
-      sscanf(line + 3, "%f %f",
-             &texcoords[tc_count].x,
-             &texcoords[tc_count].y);
-      tc_count++;
-
-    } else if (strncmp(line, "vn ", 3) == 0) {
-      // normal
-      if (nm_count >= nm_capacity) {
-        nm_capacity *= 2;
-        normals     = realloc(normals, nm_capacity * sizeof(vec3));
+      keys[i] = key;
+    }
+
+    if (valid) {
+      for (uint32_t i = 0; i < size; i++) {
+        hashes[i] = hash_key(keys[i]);
+        c->has_texcoords |= keys[i].texcoord_index != 0;
+        c->has_normals |= keys[i].normal_index != 0;
       }
-      sscanf(line + 3, "%f %f %f",
-             &normals[nm_count].x,
-             &normals[nm_count].y,
-             &normals[nm_count].z);
-      nm_count++;
-
-    } else if (strncmp(line, "f ", 2) == 0) {
-      // face
-      char *token = strtok(line + 2, " \r\n");
-      while (token) {
-        size_t pidx, tidx, nidx;
-        parse_face_token(token, &pidx, &tidx, &nidx);
-
-        // handle negative indices
-        if ((int)pidx < 0) pidx = pos_count + pidx + 1;
-        if ((int)tidx < 0) tidx = tc_count  + tidx + 1;
-        if ((int)nidx < 0) nidx = nm_count  + nidx + 1;
-
-        vertex_key key = {
-          .position_index = (uint32_t)pidx,
-          .texcoord_index = (uint32_t)tidx,
-          .normal_index   = (uint32_t)nidx
-        };
-
-        uint32_t vertex_index;
-        if (unique_vertices * 2 > ht_capacity) {
-          // save old entries
-          size_t old_capacity = ht_capacity;
-          hash_entry *old_table = hash_table;
-
-          // allocate new table
-          ht_capacity *= 2;
-          hash_table = calloc(ht_capacity, sizeof(hash_entry));
-
-          // rehash all existing entries
-          for (size_t i = 0; i < old_capacity; i++) {
-            if (old_table[i].hash) {
-              uint64_t hash = old_table[i].hash;
-              size_t idx = hash % ht_capacity;
-              size_t step = 1;
-
-              while (hash_table[idx].hash) {
-                idx = (idx + step * step) % ht_capacity;
-                step++;
-              }
-
-              hash_table[idx] = old_table[i];
-            }
-          }
-
-          free(old_table);
-        }
-
-        bool is_new = ht_insert(hash_table,
-                                ht_capacity,
-                                key,
-                                &vertex_index,
-                                &unique_vertices);
-
-        if (is_new) {
-          // emit new vertex
-          if (out_vertex_count >= out_capacity) {
-            out_capacity   *= 2;
-            out_positions  = realloc(out_positions,
-                                     out_capacity * 3 * sizeof(float));
-          }
-          out_positions[3 * vertex_index + 0] =
-            positions[key.position_index - 1].x;
-          out_positions[3 * vertex_index + 1] =
-            positions[key.position_index - 1].y;
-          out_positions[3 * vertex_index + 2] =
-            positions[key.position_index - 1].z;
-
-          if (key.texcoord_index) {
-            if (!out_texcoords) {
-              out_texcoords = malloc(out_capacity * 2 * sizeof(float));
-            }
-            if (out_vertex_count >= out_capacity) {
-              out_texcoords = realloc(out_texcoords,
-                                      out_capacity * 2 * sizeof(float));
-            }
-            out_texcoords[2 * vertex_index + 0] =
-              texcoords[key.texcoord_index - 1].x;
-            out_texcoords[2 * vertex_index + 1] =
-              texcoords[key.texcoord_index - 1].y;
-          }
-
-          if (key.normal_index) {
-            if (!out_normals) {
-              out_normals = malloc(out_capacity * 3 * sizeof(float));
-            }
-            if (out_vertex_count >= out_capacity) {
-              out_normals = realloc(out_normals,
-                                    out_capacity * 3 * sizeof(float));
-            }
-            out_normals[3 * vertex_index + 0] =
-              normals[key.normal_index - 1].x;
-            out_normals[3 * vertex_index + 1] =
-              normals[key.normal_index - 1].y;
-            out_normals[3 * vertex_index + 2] =
-              normals[key.normal_index - 1].z;
-          }
-
-          out_vertex_count++;
-        }
-
-        // record index
-        if (idx_count >= idx_capacity) {
-          idx_capacity = idx_capacity * 2;
-          out_indices  = realloc(out_indices,
-                                 idx_capacity * sizeof(uint32_t));
-        }
-        out_indices[idx_count++] = vertex_index;
-
-        token = strtok(NULL, " \r\n");
+      c->triangle_count += size - 2;
+    } else {
+      for (uint32_t i = 0; i < size; i++) keys[i].position_index = 0;
+      c->invalid_faces++;
+    }
+
+    corner += size;
+    keys += size;
+    hashes += size;
+  }
+}
+
+static inline size_t partition_of(uint32_t hash, size_t partition_count) {
+  return (size_t)(((uint64_t)hash * partition_count) >> 32);
+}
+
+// every partition owns the keys hashing into it and walks all corners in file
+// order, so the corner introducing each key is the same as in a serial pass
+static void dedup_partition(void *ctx, size_t partition) {
+  obj_load *l = ctx;
+
+  size_t count = 0;
+  for (size_t c = 0; c < l->corner_count; c++) {
+    if (l->keys[c].position_index && partition_of(l->hashes[c], l->partition_count) == partition) count++;
+  }
+  if (!count) return;
+
+  size_t capacity = 16;
+  while (capacity < count * 2) capacity *= 2;
+  size_t mask = capacity - 1;
+  hash_entry *table = calloc(capacity, sizeof(hash_entry));
+
+  for (size_t c = 0; c < l->corner_count; c++) {
+    vertex_key key = l->keys[c];
+    if (!key.position_index || partition_of(l->hashes[c], l->partition_count) != partition) continue;
+
+    size_t slot = l->hashes[c] & mask;
+    while (table[slot].key.position_index &&
+           (table[slot].key.position_index != key.position_index ||
+            table[slot].key.texcoord_index != key.texcoord_index ||
+            table[slot].key.normal_index != key.normal_index)) {
+      slot = (slot + 1) & mask;
+    }
+
+    if (table[slot].key.position_index) {
+      l->links[c] = table[slot].first;
+    } else {
+      table[slot] = (hash_entry){ key, (uint32_t)c };
+      l->links[c] = LINK_FIRST;
+    }
+  }
+
+  free(table);
+}
+
+static void count_vertices(void *ctx, size_t index) {
+  obj_load *l = ctx;
+  obj_chunk *c = &l->chunks[index];
+  for (size_t i = c->corner_base; i < c->corner_base + c->corner_count; i++) {
+    if (l->links[i] == LINK_FIRST) c->vertex_count++;
+  }
+}
+
+// numbers first occurrences in file order and copies their attributes
+static void emit_vertices(void *ctx, size_t index) {
+  obj_load *l = ctx;
+  obj_chunk *c = &l->chunks[index];
+
+  uint32_t vertex = (uint32_t)c->vertex_base;
+  for (size_t i = c->corner_base; i < c->corner_base + c->corner_count; i++) {
+    if (l->links[i] != LINK_FIRST) continue;
+
+    vertex_key key = l->keys[i];
+    memcpy(&l->out_positions[3 * vertex], &l->positions[3 * (key.position_index - 1)],
+           3 * sizeof(float));
+    if (key.texcoord_index) {
+      memcpy(&l->out_texcoords[2 * vertex], &l->texcoords[2 * (key.texcoord_index - 1)],
+             2 * sizeof(float));
+    }
+    if (key.normal_index) {
+      memcpy(&l->out_normals[3 * vertex], &l->normals[3 * (key.normal_index - 1)],
+             3 * sizeof(float));
+    }
+    l->links[i] = LINK_FIRST | vertex++;
+  }
+}
+
+static inline uint32_t corner_vertex(const obj_load *l, size_t corner) {
+  uint32_t link = l->links[corner];
+  if (!(link & LINK_FIRST)) link = l->links[link];
+  return link & ~LINK_FIRST;
+}
+
+// polygons are triangulated as fans around their first corner
+static void emit_triangles(void *ctx, size_t index) {
+  obj_load *l = ctx;
+  obj_chunk *c = &l->chunks[index];
+
+  uint32_t *out = l->indices + 3 * c->triangle_base;
+  size_t corner = c->corner_base;
+  for (size_t f = 0; f < c->face_count; f++) {
+    uint32_t size = c->face_sizes[f];
+    if (l->keys[corner].position_index) {
+      uint32_t first = corner_vertex(l, corner);
+      for (uint32_t i = 2; i < size; i++) {
+        *out++ = first;
+        *out++ = corner_vertex(l, corner + i - 1);
+        *out++ = corner_vertex(l, corner + i);
       }
     }
+    corner += size;
   }
+}
+
+static size_t pick_chunk_count(size_t size, size_t requested) {
+  size_t count = requested;
+  if (!count) {
+    count = size < 4 * OBJ_MIN_CHUNK_BYTES ? 1 : (jobs_worker_count() + 1) * OBJ_CHUNKS_PER_WORKER;
+  }
+  size_t most = size / OBJ_MIN_CHUNK_BYTES;
+  if (requested == 0 && count > most) count = most;
+  return count ? count : 1;
+}
+
+static void load_mapped(obj_load *l, const char *data, size_t size, size_t chunk_count) {
+  l->chunk_count = chunk_count;
+  l->chunks = calloc(chunk_count, sizeof(obj_chunk));
+
+  // chunks end just past a newline so no line straddles two of them
+  const char *begin = data, *end = data + size;
+  for (size_t i = 0; i < chunk_count; i++) {
+    const char *split = i + 1 == chunk_count ? end : data + size / chunk_count * (i + 1);
+    if (split < begin) split = begin;
+    if (split < end) split = skip_line(split, end);
+    l->chunks[i].begin = begin;
+    l->chunks[i].end = split;
+    begin = split;
+  }
+
+  jobs_parallel_for(chunk_count, parse_chunk, l);
+
+  for (size_t i = 0; i < chunk_count; i++) {
+    obj_chunk *c = &l->chunks[i];
+    c->pos_base = l->pos_count;
+    c->tc_base = l->tc_count;
+    c->nm_base = l->nm_count;
+    c->corner_base = l->corner_count;
+    l->pos_count += c->pos_count;
+    l->tc_count += c->tc_count;
+    l->nm_count += c->nm_count;
+    l->corner_count += c->corner_count;
+  }
+
+  l->positions = malloc((l->pos_count ? l->pos_count : 1) * 3 * sizeof(float));
+  l->texcoords = malloc((l->tc_count ? l->tc_count : 1) * 2 * sizeof(float));
+  l->normals = malloc((l->nm_count ? l->nm_count : 1) * 3 * sizeof(float));
+  l->keys = malloc((l->corner_count ? l->corner_count : 1) * sizeof(vertex_key));
+  l->hashes = malloc((l->corner_count ? l->corner_count : 1) * sizeof(uint32_t));
+  l->links = malloc((l->corner_count ? l->corner_count : 1) * sizeof(uint32_t));
+  for (size_t i = 0; i < l->corner_count; i++) l->links[i] = LINK_NONE;
+
+  jobs_parallel_for(chunk_count, resolve_chunk, l);
+
+  l->partition_count = chunk_count > 1 ? jobs_worker_count() + 1 : 1;
+  jobs_parallel_for(l->partition_count, dedup_partition, l);
+  jobs_parallel_for(chunk_count, count_vertices, l);
+
+  size_t vertex_count = 0, triangle_count = 0, invalid_faces = 0;
+  bool has_texcoords = false, has_normals = false;
+  for (size_t i = 0; i < chunk_count; i++) {
+    obj_chunk *c = &l->chunks[i];
+    c->vertex_base = vertex_count;
+    c->triangle_base = triangle_count;
+    vertex_count += c->vertex_count;
+    triangle_count += c->triangle_count;
+    invalid_faces += c->invalid_faces;
+    has_texcoords |= c->has_texcoords;
+    has_normals |= c->has_normals;
+  }
+  if (invalid_faces) {
+    fprintf(stderr, "load_obj: skipped %zu faces with invalid indices\n", invalid_faces);
+  }
+
+  // vertices without a texcoord or normal get zeros when others have one
+  uint32_t flags = (has_normals ? MESH_HAS_NORMALS : 0) | (has_texcoords ? MESH_HAS_TEXCOORDS : 0);
+  if (!mesh_allocate(l->out, vertex_count, triangle_count * 3, flags, NULL)) return;
+  l->out_positions = l->out->positions;
+  l->out_texcoords = l->out->texcoords;
+  l->out_normals = l->out->normals;
+  l->indices = l->out->indices;
 
-  fclose(file);
+  jobs_parallel_for(chunk_count, emit_vertices, l);
+  jobs_parallel_for(chunk_count, emit_triangles, l);
+}
+
+void at_load_obj_chunked(const char *path, mesh *out, size_t chunk_count) {
+  asset_file file;
+  if (!asset_file_map(path, false, &file)) {
+    fprintf(stderr, "load_obj: cannot open '%s'\n", path);
+    return;
+  }
 
-  // populate mesh
-  out->positions  = out_positions;
-  out->texcoords  = out_texcoords;
-  out->normals    = out_normals;
-  out->indices    = out_indices;
-  out->vert_count = malloc(sizeof(size_t));
-  out->idx_count  = malloc(sizeof(size_t));
-  *out->vert_count = out_vertex_count;
-  *out->idx_count  = idx_count;
+  // the file is scanned in place, an empty one maps nothing
+  if (file.data) posix_madvise(file.data, file.size, POSIX_MADV_SEQUENTIAL);
+  obj_load l = { .out = out };
+  load_mapped(&l, (const char *)file.data, file.size, pick_chunk_count(file.size, chunk_count));
+  asset_file_unmap(&file);
 
   // cleanup
-  free(positions);
-  free(texcoords);
-  free(normals);
-  free(hash_table);
+  for (size_t i = 0; i < l.chunk_count; i++) {
+    free(l.chunks[i].corners);
+    free(l.chunks[i].face_sizes);
+  }
+  free(l.chunks);
+  free(l.positions);
+  free(l.texcoords);
+  free(l.normals);
+  free(l.keys);
+  free(l.hashes);
+  free(l.links);
 }
 
+void at_load_obj(const char *path, mesh *out) {
+  at_load_obj_chunked(path, out, 0);
+}
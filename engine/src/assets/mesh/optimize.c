@@ -0,0 +1,218 @@
+#include <assets/mesh.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define VERTEX_CACHE_SIZE 16
+
+mesh_cache_stats mesh_analyze_vertex_cache(const mesh *m, size_t cache_size) {
+  mesh_cache_stats stats = {0};
+  if (!m->indices || !m->vert_count || !m->idx_count || m->idx_count < 3) {
+    return stats;
+  }
+
+  size_t vc = m->vert_count;
+  size_t ic = m->idx_count;
+
+  // fifo cache model, timestamps tell whether a vertex is still resident
+  uint32_t *stamp = calloc(vc, sizeof(uint32_t));
+  bool     *used  = calloc(vc, sizeof(bool));
+  uint32_t  time  = (uint32_t)cache_size + 1;
+  size_t    misses = 0;
+  size_t    unique = 0;
+
+  for (size_t i = 0; i < ic; i++) {
+    uint32_t v = m->indices[i];
+    if (!used[v]) {
+      used[v] = true;
+      unique++;
+    }
+    if (time - stamp[v] > cache_size) {
+      stamp[v] = time++;
+      misses++;
+    }
+  }
+
+  stats.acmr = (float)misses / (float)(ic / 3);
+  stats.atvr = unique ? (float)misses / (float)unique : 0.0f;
+
+  free(stamp);
+  free(used);
+  return stats;
+}
+
+static uint32_t skip_dead_end(const uint32_t *live, uint32_t *dead_end, size_t *dead_end_top,
+                              size_t vc, size_t *cursor) {
+  while (*dead_end_top) {
+    uint32_t v = dead_end[--(*dead_end_top)];
+    if (live[v]) return v;
+  }
+
+  while (*cursor < vc) {
+    if (live[*cursor]) return (uint32_t)*cursor;
+    (*cursor)++;
+  }
+
+  return UINT32_MAX;
+}
+
+// tipsify (sander, nehab, barczak 2007)
+void mesh_optimize_indices(uint32_t *indices, size_t idx_count, size_t vert_count) {
+  if (!indices || idx_count < 3) {
+    return;
+  }
+
+  size_t vc = vert_count;
+  size_t ic = idx_count - idx_count % 3;
+  size_t tc = ic / 3;
+  const uint32_t k = VERTEX_CACHE_SIZE;
+
+  // vertex -> triangle adjacency
+  uint32_t *live   = calloc(vc, sizeof(uint32_t));
+  uint32_t *offset = calloc(vc + 1, sizeof(uint32_t));
+  uint32_t *adj    = malloc(ic * sizeof(uint32_t));
+
+  for (size_t i = 0; i < ic; i++) live[indices[i]]++;
+  for (size_t v = 0; v < vc; v++) offset[v + 1] = offset[v] + live[v];
+
+  uint32_t *fill = malloc(vc * sizeof(uint32_t));
+  memcpy(fill, offset, vc * sizeof(uint32_t));
+  for (size_t i = 0; i < ic; i++) adj[fill[indices[i]]++] = (uint32_t)(i / 3);
+  free(fill);
+
+  uint32_t *stamp    = calloc(vc, sizeof(uint32_t));
+  uint32_t *dead_end = malloc(ic * sizeof(uint32_t));
+  uint32_t *cand     = malloc(ic * sizeof(uint32_t));
+  bool     *emitted  = calloc(tc, sizeof(bool));
+  uint32_t *out      = malloc(ic * sizeof(uint32_t));
+
+  size_t   dead_end_top = 0;
+  size_t   cursor       = 0;
+  size_t   out_count    = 0;
+  uint32_t time         = k + 1;
+  uint32_t fan          = 0;
+
+  while (fan != UINT32_MAX) {
+    size_t cand_count = 0;
+
+    for (uint32_t a = offset[fan]; a < offset[fan + 1]; a++) {
+      uint32_t t = adj[a];
+      if (emitted[t]) continue;
+
+      for (int c = 0; c < 3; c++) {
+        uint32_t v = indices[3*t + c];
+        out[out_count++] = v;
+        dead_end[dead_end_top++] = v;
+        cand[cand_count++] = v;
+        live[v]--;
+        if (time - stamp[v] > k) {
+          stamp[v] = time++;
+        }
+      }
+      emitted[t] = true;
+    }
+
+    // prefer the candidate that stays in cache longest without being evicted
+    uint32_t best          = UINT32_MAX;
+    int64_t  best_priority = -1;
+    for (size_t c = 0; c < cand_count; c++) {
+      uint32_t v = cand[c];
+      if (!live[v]) continue;
+
+      int64_t priority = 0;
+      if ((int64_t)time - stamp[v] + 2 * (int64_t)live[v] <= k) {
+        priority = (int64_t)time - stamp[v];
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        best = v;
+      }
+    }
+
+    if (best == UINT32_MAX) {
+      best = skip_dead_end(live, dead_end, &dead_end_top, vc, &cursor);
+    }
+    fan = best;
+  }
+
+  memcpy(indices, out, ic * sizeof(uint32_t));
+
+  free(live);
+  free(offset);
+  free(adj);
+  free(stamp);
+  free(dead_end);
+  free(cand);
+  free(emitted);
+  free(out);
+}
+
+void mesh_optimize_vertex_cache(mesh *m) {
+  if (!m->indices || !m->vert_count || !m->idx_count) {
+    return;
+  }
+
+  mesh_optimize_indices(m->indices, m->idx_count, m->vert_count);
+  for (size_t l = 0; l < m->lod_count; l++) {
+    mesh_optimize_indices(m->lods[l].indices, m->lods[l].idx_count, m->vert_count);
+  }
+  mesh_drop_gpu_copies(m);
+}
+
+static void remap_stream(float *stream, size_t components, const uint32_t *remap, size_t vc) {
+  if (!stream) return;
+
+  // the reordered copy goes back in place so the stream keeps its storage
+  float *dst = malloc(vc * components * sizeof(float));
+  for (size_t v = 0; v < vc; v++) {
+    memcpy(&dst[components * remap[v]], &stream[components * v], components * sizeof(float));
+  }
+  memcpy(stream, dst, vc * components * sizeof(float));
+  free(dst);
+}
+
+// lay vertices out in the order the index buffer first touches them
+void mesh_optimize_vertex_fetch(mesh *m) {
+  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    return;
+  }
+
+  size_t vc = m->vert_count;
+  size_t ic = m->idx_count;
+
+  uint32_t *remap = malloc(vc * sizeof(uint32_t));
+  memset(remap, 0xff, vc * sizeof(uint32_t));
+
+  uint32_t next = 0;
+  for (size_t i = 0; i < ic; i++) {
+    uint32_t v = m->indices[i];
+    if (remap[v] == UINT32_MAX) remap[v] = next++;
+    m->indices[i] = remap[v];
+  }
+
+  for (size_t l = 0; l < m->lod_count; l++) {
+    mesh_lod *lod = &m->lods[l];
+    for (size_t i = 0; i < lod->idx_count; i++) {
+      uint32_t v = lod->indices[i];
+      if (remap[v] == UINT32_MAX) remap[v] = next++;
+      lod->indices[i] = remap[v];
+    }
+  }
+
+  // unreferenced vertices keep their relative order at the end
+  for (size_t v = 0; v < vc; v++) {
+    if (remap[v] == UINT32_MAX) remap[v] = next++;
+  }
+
+  remap_stream(m->positions, 3, remap, vc);
+  remap_stream(m->normals,   3, remap, vc);
+  remap_stream(m->texcoords, 2, remap, vc);
+  mesh_drop_gpu_copies(m);
+
+  free(remap);
+}
+
+void mesh_optimize(mesh *m) {
+  mesh_optimize_vertex_cache(m);
+  mesh_optimize_vertex_fetch(m);
+}
@@ -0,0 +1,132 @@
+#include <assets/mesh.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static uint16_t float_to_half(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+
+  uint32_t sign = (x >> 16) & 0x8000;
+  int32_t  exp  = (int32_t)((x >> 23) & 0xff) - 127 + 15;
+  uint32_t mant = x & 0x7fffff;
+
+  if (((x >> 23) & 0xff) == 0xff) {
+    // inf / nan
+    return (uint16_t)(sign | 0x7c00 | (mant ? 0x200 : 0));
+  }
+  if (exp >= 31) {
+    return (uint16_t)(sign | 0x7c00);
+  }
+  if (exp <= 0) {
+    if (exp < -10) return (uint16_t)sign;
+    // subnormal, round to nearest even
+    mant |= 0x800000;
+    uint32_t shift = (uint32_t)(14 - exp);
+    uint32_t half  = mant >> shift;
+    uint32_t rem   = mant & ((1u << shift) - 1);
+    uint32_t mid   = 1u << (shift - 1);
+    if (rem > mid || (rem == mid && (half & 1))) half++;
+    return (uint16_t)(sign | half);
+  }
+
+  uint32_t half = sign | ((uint32_t)exp << 10) | (mant >> 13);
+  uint32_t rem  = mant & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) half++;
+  return (uint16_t)half;
+}
+
+static int16_t to_snorm16(float v) {
+  if (v >  1.0f) v =  1.0f;
+  if (v < -1.0f) v = -1.0f;
+  return (int16_t)lrintf(v * 32767.0f);
+}
+
+static uint16_t to_unorm16(float v) {
+  if (v > 1.0f) v = 1.0f;
+  if (v < 0.0f) v = 0.0f;
+  return (uint16_t)lrintf(v * 65535.0f);
+}
+
+// octahedral mapping of a unit vector onto the [-1, 1] square
+static void oct_encode(const float *n, int16_t out[2]) {
+  float x = n ? n[0] : 0.0f;
+  float y = n ? n[1] : 0.0f;
+  float z = n ? n[2] : 1.0f;
+
+  float l1 = fabsf(x) + fabsf(y) + fabsf(z);
+  if (l1 == 0.0f) {
+    out[0] = 0;
+    out[1] = 0;
+    return;
+  }
+
+  float u = x / l1;
+  float v = y / l1;
+  if (z < 0.0f) {
+    float fu = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+    float fv = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+    u = fu;
+    v = fv;
+  }
+
+  out[0] = to_snorm16(u);
+  out[1] = to_snorm16(v);
+}
+
+size_t vertex_format_stride(vertex_format format) {
+  switch (format) {
+    case VERTEX_FORMAT_PACKED:           return sizeof(packed_vertex);
+    case VERTEX_FORMAT_PACKED_QUANTIZED: return sizeof(packed_vertex_quantized);
+    case VERTEX_FORMAT_FLOAT:
+    default:                             return 0;
+  }
+}
+
+void *mesh_pack_vertices(const mesh *m, vertex_format format, size_t *out_size) {
+  size_t stride = vertex_format_stride(format);
+  if (!stride || !m->positions || !m->vert_count) {
+    return NULL;
+  }
+
+  size_t vc = m->vert_count;
+  uint8_t *data = calloc(vc ? vc : 1, stride);
+  if (!data) return NULL;
+
+  float extent[3];
+  for (int k = 0; k < 3; k++) {
+    extent[k] = m->bounds_max[k] - m->bounds_min[k];
+  }
+
+  for (size_t i = 0; i < vc; i++) {
+    const float *p  = &m->positions[3*i];
+    const float *n  = m->normals ? &m->normals[3*i] : NULL;
+    const float *uv = m->texcoords ? &m->texcoords[2*i] : NULL;
+
+    int16_t  normal[2];
+    uint16_t texcoord[2] = {
+      float_to_half(uv ? uv[0] : 0.0f),
+      float_to_half(uv ? uv[1] : 0.0f)
+    };
+    oct_encode(n, normal);
+
+    if (format == VERTEX_FORMAT_PACKED) {
+      packed_vertex *v = (packed_vertex *)data + i;
+      memcpy(v->position, p, sizeof(v->position));
+      memcpy(v->normal, normal, sizeof(v->normal));
+      memcpy(v->texcoord, texcoord, sizeof(v->texcoord));
+    } else {
+      packed_vertex_quantized *v = (packed_vertex_quantized *)data + i;
+      for (int k = 0; k < 3; k++) {
+        float t = extent[k] > 0.0f ? (p[k] - m->bounds_min[k]) / extent[k] : 0.0f;
+        v->position[k] = to_unorm16(t);
+      }
+      v->position[3] = 0;
+      memcpy(v->normal, normal, sizeof(v->normal));
+      memcpy(v->texcoord, texcoord, sizeof(v->texcoord));
+    }
+  }
+
+  if (out_size) *out_size = vc * stride;
+  return data;
+}
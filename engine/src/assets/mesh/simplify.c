@@ -0,0 +1,351 @@
+#include <assets/mesh.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+
+// symmetric 4x4 plane quadric (garland & heckbert 1997)
+typedef struct {
+  double xx, xy, xz, xw, yy, yz, yw, zz, zw, ww;
+  double weight;
+} quadric;
+
+typedef struct {
+  float    x, y, z;
+  uint32_t index;
+} sorted_position;
+
+typedef struct {
+  uint32_t from;
+  uint32_t to;
+  float    cost;
+} collapse;
+
+static void quadric_add_plane(quadric *q, double a, double b, double c, double d, double w) {
+  q->xx += w * a * a; q->xy += w * a * b; q->xz += w * a * c; q->xw += w * a * d;
+  q->yy += w * b * b; q->yz += w * b * c; q->yw += w * b * d;
+  q->zz += w * c * c; q->zw += w * c * d;
+  q->ww += w * d * d;
+  q->weight += w;
+}
+
+static void quadric_add(quadric *q, const quadric *r) {
+  q->xx += r->xx; q->xy += r->xy; q->xz += r->xz; q->xw += r->xw;
+  q->yy += r->yy; q->yz += r->yz; q->yw += r->yw;
+  q->zz += r->zz; q->zw += r->zw;
+  q->ww += r->ww;
+  q->weight += r->weight;
+}
+
+// area weighted mean squared distance from p to the accumulated planes
+static double quadric_error(const quadric *q, const float *p) {
+  double x = p[0], y = p[1], z = p[2];
+  double e = q->xx * x * x + 2.0 * q->xy * x * y + 2.0 * q->xz * x * z + 2.0 * q->xw * x
+           + q->yy * y * y + 2.0 * q->yz * y * z + 2.0 * q->yw * y
+           + q->zz * z * z + 2.0 * q->zw * z
+           + q->ww;
+  return q->weight > 0.0 ? fabs(e) / q->weight : fabs(e);
+}
+
+static int compare_position(const void *a, const void *b) {
+  const sorted_position *pa = a, *pb = b;
+  if (pa->x != pb->x) return pa->x < pb->x ? -1 : 1;
+  if (pa->y != pb->y) return pa->y < pb->y ? -1 : 1;
+  if (pa->z != pb->z) return pa->z < pb->z ? -1 : 1;
+  return pa->index < pb->index ? -1 : (pa->index > pb->index);
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : (x > y);
+}
+
+static int compare_collapse(const void *a, const void *b) {
+  const collapse *ca = a, *cb = b;
+  return ca->cost < cb->cost ? -1 : (ca->cost > cb->cost);
+}
+
+static bool same_attributes(const mesh *m, uint32_t a, uint32_t b) {
+  if (m->normals) {
+    const float *na = &m->normals[3*a], *nb = &m->normals[3*b];
+    if (na[0]*nb[0] + na[1]*nb[1] + na[2]*nb[2] < 0.999f) return false;
+  }
+  if (m->texcoords) {
+    const float *ta = &m->texcoords[2*a], *tb = &m->texcoords[2*b];
+    if (fabsf(ta[0] - tb[0]) > 1e-5f || fabsf(ta[1] - tb[1]) > 1e-5f) return false;
+  }
+  return true;
+}
+
+// map every vertex onto the first vertex sharing its position and attributes,
+// vertices split by an attribute seam stay separate and show up as borders
+static uint32_t *weld_vertices(const mesh *m, size_t vc) {
+  sorted_position *sorted = malloc(vc * sizeof(sorted_position));
+  uint32_t        *remap  = malloc(vc * sizeof(uint32_t));
+
+  for (size_t v = 0; v < vc; v++) {
+    sorted[v] = (sorted_position){
+      m->positions[3*v+0], m->positions[3*v+1], m->positions[3*v+2], (uint32_t)v
+    };
+    remap[v] = (uint32_t)v;
+  }
+  qsort(sorted, vc, sizeof(sorted_position), compare_position);
+
+  size_t start = 0;
+  while (start < vc) {
+    size_t end = start + 1;
+    while (end < vc && sorted[end].x == sorted[start].x
+                    && sorted[end].y == sorted[start].y
+                    && sorted[end].z == sorted[start].z) {
+      end++;
+    }
+
+    for (size_t i = start + 1; i < end; i++) {
+      for (size_t j = start; j < i; j++) {
+        uint32_t rep = sorted[j].index;
+        if (remap[rep] == rep && same_attributes(m, sorted[i].index, rep)) {
+          remap[sorted[i].index] = rep;
+          break;
+        }
+      }
+    }
+    start = end;
+  }
+
+  free(sorted);
+  return remap;
+}
+
+static void triangle_normal(const float *p0, const float *p1, const float *p2, double n[3]) {
+  double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+  double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+  n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+  n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+  n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static size_t collect_edges(const uint32_t *idx, size_t count, uint64_t *edges) {
+  size_t n = 0;
+  for (size_t i = 0; i < count; i += 3) {
+    for (int e = 0; e < 3; e++) {
+      uint32_t a = idx[i + e];
+      uint32_t b = idx[i + (e + 1) % 3];
+      uint32_t lo = a < b ? a : b;
+      uint32_t hi = a < b ? b : a;
+      edges[n++] = ((uint64_t)lo << 32) | hi;
+    }
+  }
+  qsort(edges, n, sizeof(uint64_t), compare_u64);
+  return n;
+}
+
+static size_t remove_degenerate(uint32_t *idx, size_t count, const uint32_t *remap) {
+  size_t out = 0;
+  for (size_t i = 0; i < count; i += 3) {
+    uint32_t a = remap[idx[i+0]], b = remap[idx[i+1]], c = remap[idx[i+2]];
+    if (a == b || b == c || a == c) continue;
+    idx[out++] = a;
+    idx[out++] = b;
+    idx[out++] = c;
+  }
+  return out;
+}
+
+// edge collapse simplification onto existing vertices, writes at most
+// idx_count indices to out and returns how many were written
+size_t mesh_simplify(const mesh *m, uint32_t *out, size_t target_idx_count,
+                     float max_error, float *out_error) {
+  if (out_error) *out_error = 0.0f;
+  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    return 0;
+  }
+
+  size_t vc = m->vert_count;
+  size_t ic = m->idx_count - m->idx_count % 3;
+
+  uint32_t *remap = weld_vertices(m, vc);
+  memcpy(out, m->indices, ic * sizeof(uint32_t));
+  size_t count = remove_degenerate(out, ic, remap);
+
+  quadric *quadrics = calloc(vc, sizeof(quadric));
+  for (size_t i = 0; i < count; i += 3) {
+    const float *p0 = &m->positions[3*out[i+0]];
+    const float *p1 = &m->positions[3*out[i+1]];
+    const float *p2 = &m->positions[3*out[i+2]];
+
+    double n[3];
+    triangle_normal(p0, p1, p2, n);
+    double len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+    if (len == 0.0) continue;
+
+    double a = n[0] / len, b = n[1] / len, c = n[2] / len;
+    double d = -(a * p0[0] + b * p0[1] + c * p0[2]);
+    for (int k = 0; k < 3; k++) {
+      quadric_add_plane(&quadrics[out[i+k]], a, b, c, d, 0.5 * len);
+    }
+  }
+
+  // borders and non-manifold edges never move
+  uint64_t *edges  = malloc(ic * sizeof(uint64_t));
+  bool     *locked = calloc(vc, sizeof(bool));
+  size_t    edge_count = collect_edges(out, count, edges);
+  for (size_t e = 0; e < edge_count;) {
+    size_t run = 1;
+    while (e + run < edge_count && edges[e + run] == edges[e]) run++;
+    if (run != 2) {
+      locked[edges[e] >> 32] = true;
+      locked[edges[e] & 0xffffffff] = true;
+    }
+    e += run;
+  }
+
+  uint32_t *collapse_to = malloc(vc * sizeof(uint32_t));
+  uint32_t *adj_offset  = malloc((vc + 1) * sizeof(uint32_t));
+  uint32_t *adj         = malloc(ic * sizeof(uint32_t));
+  uint32_t *fill        = malloc(vc * sizeof(uint32_t));
+  bool     *touched     = malloc(vc * sizeof(bool));
+  collapse *candidates  = malloc(ic * sizeof(collapse));
+
+  double max_error_sq = (double)max_error * (double)max_error;
+  double result_error = 0.0;
+
+  while (count > target_idx_count) {
+    // vertex -> triangle adjacency for this pass
+    memset(adj_offset, 0, (vc + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < count; i++) adj_offset[out[i] + 1]++;
+    for (size_t v = 0; v < vc; v++) adj_offset[v + 1] += adj_offset[v];
+    memcpy(fill, adj_offset, vc * sizeof(uint32_t));
+    for (size_t i = 0; i < count; i++) adj[fill[out[i]]++] = (uint32_t)(i / 3);
+
+    edge_count = collect_edges(out, count, edges);
+    size_t candidate_count = 0;
+    for (size_t e = 0; e < edge_count; e++) {
+      if (e > 0 && edges[e] == edges[e - 1]) continue;
+
+      uint32_t a = (uint32_t)(edges[e] >> 32);
+      uint32_t b = (uint32_t)(edges[e] & 0xffffffff);
+      if (locked[a] && locked[b]) continue;
+
+      quadric q = quadrics[a];
+      quadric_add(&q, &quadrics[b]);
+
+      double cost_ab = locked[a] ? INFINITY : quadric_error(&q, &m->positions[3*b]);
+      double cost_ba = locked[b] ? INFINITY : quadric_error(&q, &m->positions[3*a]);
+
+      candidates[candidate_count++] = cost_ab <= cost_ba
+        ? (collapse){ a, b, (float)cost_ab }
+        : (collapse){ b, a, (float)cost_ba };
+    }
+    qsort(candidates, candidate_count, sizeof(collapse), compare_collapse);
+
+    for (size_t v = 0; v < vc; v++) collapse_to[v] = (uint32_t)v;
+    memset(touched, 0, vc * sizeof(bool));
+
+    size_t removed   = 0;
+    size_t collapses = 0;
+    for (size_t c = 0; c < candidate_count; c++) {
+      collapse col = candidates[c];
+      if (col.cost > max_error_sq) break;
+      if (touched[col.from] || touched[col.to]) continue;
+
+      // reject collapses that flip or squash a surviving triangle
+      bool   ok    = true;
+      size_t kills = 0;
+      for (uint32_t t = adj_offset[col.from]; t < adj_offset[col.from + 1] && ok; t++) {
+        const uint32_t *tri = &out[3 * adj[t]];
+        if (tri[0] == col.to || tri[1] == col.to || tri[2] == col.to) {
+          kills++;
+          continue;
+        }
+
+        const float *p[3], *q[3];
+        for (int k = 0; k < 3; k++) {
+          p[k] = &m->positions[3 * tri[k]];
+          q[k] = tri[k] == col.from ? &m->positions[3 * col.to] : p[k];
+        }
+
+        double before[3], after[3];
+        triangle_normal(p[0], p[1], p[2], before);
+        triangle_normal(q[0], q[1], q[2], after);
+        double d  = before[0]*after[0] + before[1]*after[1] + before[2]*after[2];
+        double lb = sqrt(before[0]*before[0] + before[1]*before[1] + before[2]*before[2]);
+        double la = sqrt(after[0]*after[0] + after[1]*after[1] + after[2]*after[2]);
+        if (d <= 0.25 * lb * la) ok = false;
+      }
+      if (!ok) continue;
+
+      collapse_to[col.from] = col.to;
+      quadric_add(&quadrics[col.to], &quadrics[col.from]);
+      for (uint32_t t = adj_offset[col.from]; t < adj_offset[col.from + 1]; t++) {
+        const uint32_t *tri = &out[3 * adj[t]];
+        touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+      }
+      if (col.cost > result_error) result_error = col.cost;
+
+      collapses++;
+      removed += kills;
+      if (count - removed * 3 <= target_idx_count) break;
+    }
+
+    if (!collapses) break;
+    count = remove_degenerate(out, count, collapse_to);
+  }
+
+  if (out_error) *out_error = (float)sqrt(result_error);
+
+  free(remap);
+  free(quadrics);
+  free(edges);
+  free(locked);
+  free(collapse_to);
+  free(adj_offset);
+  free(adj);
+  free(fill);
+  free(touched);
+  free(candidates);
+  return count;
+}
+
+void mesh_generate_lods(mesh *m, const mesh_lod_config *config) {
+  for (size_t l = 0; l < m->lod_count; l++) {
+    mesh_free_stream(m, m->lods[l].indices);
+  }
+  m->lod_count = 0;
+  mesh_drop_gpu_copies(m);
+
+  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    return;
+  }
+
+  size_t ic = m->idx_count;
+  float dx = m->bounds_max[0] - m->bounds_min[0];
+  float dy = m->bounds_max[1] - m->bounds_min[1];
+  float dz = m->bounds_max[2] - m->bounds_min[2];
+  float max_error = config->error_budget * 0.5f * sqrtf(dx*dx + dy*dy + dz*dz);
+
+  size_t levels = config->max_lods < MESH_MAX_LODS ? config->max_lods : MESH_MAX_LODS;
+  size_t prev   = ic;
+
+  for (size_t l = 0; l < levels; l++) {
+    size_t target = (size_t)((float)prev * config->reduction);
+    target -= target % 3;
+    if (target < 3) break;
+
+    float     error;
+    uint32_t *indices = malloc(ic * sizeof(uint32_t));
+    size_t    count   = mesh_simplify(m, indices, target, max_error, &error);
+
+    // the error budget stopped us before a worthwhile reduction
+    if (count == 0 || (float)count > (float)prev * 0.9f) {
+      free(indices);
+      break;
+    }
+
+    indices = realloc(indices, count * sizeof(uint32_t));
+    mesh_optimize_indices(indices, count, m->vert_count);
+
+    m->lods[l] = (mesh_lod){ indices, count, error };
+    m->lod_count++;
+    prev = count;
+  }
+}
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/mesh.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/mman.h>
+
+static size_t align_stream(size_t offset) {
+  return (offset + MESH_STREAM_ALIGNMENT - 1) & ~(size_t)(MESH_STREAM_ALIGNMENT - 1);
+}
+
+mesh_layout mesh_compute_layout(size_t vert_count, size_t idx_count, uint32_t flags) {
+  mesh_layout l = { .flags = flags };
+  size_t offset = align_stream(vert_count * 3 * sizeof(float));
+  if (flags & MESH_HAS_NORMALS) {
+    l.normals = offset;
+    offset = align_stream(offset + vert_count * 3 * sizeof(float));
+  }
+  if (flags & MESH_HAS_TEXCOORDS) {
+    l.texcoords = offset;
+    offset = align_stream(offset + vert_count * 2 * sizeof(float));
+  }
+  l.indices = offset;
+  l.size = align_stream(offset + idx_count * sizeof(uint32_t));
+  return l;
+}
+
+void mesh_bind_storage(mesh *m, void *storage, size_t size, const mesh_layout *layout,
+                       mesh_storage kind) {
+  uint8_t *base = storage;
+  m->storage = storage;
+  m->storage_size = size;
+  m->storage_kind = kind;
+  m->layout = *layout;
+  m->positions = (float *)(base + layout->positions);
+  m->normals = layout->flags & MESH_HAS_NORMALS ? (float *)(base + layout->normals) : NULL;
+  m->texcoords = layout->flags & MESH_HAS_TEXCOORDS ? (float *)(base + layout->texcoords) : NULL;
+  m->indices = (uint32_t *)(base + layout->indices);
+}
+
+bool mesh_allocate(mesh *m, size_t vert_count, size_t idx_count, uint32_t flags, arena *a) {
+  mesh_layout layout = mesh_compute_layout(vert_count, idx_count, flags);
+  size_t size = layout.size ? layout.size : MESH_STREAM_ALIGNMENT;
+
+  void *storage = NULL;
+  if (a) {
+    storage = arena_alloc(a, size, MESH_STREAM_ALIGNMENT);
+  } else if (posix_memalign(&storage, MESH_STREAM_ALIGNMENT, size) != 0) {
+    storage = NULL;
+  }
+  if (!storage) {
+    fprintf(stderr, "mesh_allocate: out of memory for %zu vertices\n", vert_count);
+    return false;
+  }
+
+  mesh_bind_storage(m, storage, size, &layout, a ? MESH_STORAGE_ARENA : MESH_STORAGE_HEAP);
+  m->vert_count = vert_count;
+  m->idx_count = idx_count;
+  if (m->normals) memset(m->normals, 0, vert_count * 3 * sizeof(float));
+  if (m->texcoords) memset(m->texcoords, 0, vert_count * 2 * sizeof(float));
+  return true;
+}
+
+bool mesh_in_storage(const mesh *m, const void *stream) {
+  uintptr_t p = (uintptr_t)stream;
+  uintptr_t base = (uintptr_t)m->storage;
+  return m->storage && p >= base && p < base + m->storage_size;
+}
+
+void mesh_free_stream(const mesh *m, void *stream) {
+  if (!mesh_in_storage(m, stream)) free(stream);
+}
+
+void mesh_drop_gpu_copies(mesh *m) {
+  m->gpu_vertices = NULL;
+  m->gpu_vertices_size = 0;
+  m->gpu_indices = NULL;
+}
+
+void destroy_mesh(mesh *m) {
+  mesh_free_stream(m, m->positions);
+  mesh_free_stream(m, m->normals);
+  mesh_free_stream(m, m->texcoords);
+  mesh_free_stream(m, m->indices);
+  m->positions = m->normals = m->texcoords = NULL;
+  m->indices = NULL;
+  m->vert_count = m->idx_count = 0;
+  for (size_t l = 0; l < m->lod_count; l++) {
+    mesh_free_stream(m, m->lods[l].indices);
+  }
+  m->lod_count = 0;
+  mesh_free_stream(m, m->meshlets);
+  m->meshlets = NULL;
+  m->meshlet_count = 0;
+  mesh_drop_gpu_copies(m);
+
+  if (m->storage_kind == MESH_STORAGE_HEAP) {
+    free(m->storage);
+  } else if (m->storage_kind == MESH_STORAGE_MAPPED) {
+    munmap(m->storage, m->storage_size);
+  }
+  m->storage = NULL;
+  m->storage_size = 0;
+  m->storage_kind = MESH_STORAGE_NONE;
+}
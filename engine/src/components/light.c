@@ -4,6 +4,9 @@
 void light_component_init(light_component *l, entity_id id) {
   memset(l, 0, sizeof(light_component));
   l->entity = id;
+  l->type = LIGHT_POINT;
+  l->direction = (vec3){0, -1, 0};
   l->color = (vec3){1, 1, 1};
   l->intensity = 1.0f;
+  l->range = 10.0f;
 }
@@ -1,19 +1,233 @@
 #include <components/mesh_renderer.h>
 #include <opengl/glad.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
 
 void mesh_renderer_component_init(mesh_renderer_component *mr, entity_id id) {
   memset(mr, 0, sizeof(mesh_renderer_component));
   mr->entity = id;
+  mr->color[0] = mr->color[1] = mr->color[2] = 1.0f;
   mr->initialized = false;
 }
 
+// a buffer allocated up front and filled by later steps
+typedef struct {
+  uint32_t   target;
+  uint32_t   buffer;
+  const void *data;
+  void       *owned;  // freed once written
+  size_t     size;
+  size_t     written;
+} upload_segment;
+
+struct mesh_renderer_upload {
+  mesh_renderer_component next;  // switched to once every segment is written
+  upload_segment segments[4];
+  size_t segment_count;
+  size_t current;
+};
+
+static uint32_t stage_buffer(mesh_renderer_upload *up, uint32_t target, const void *data,
+                             void *owned, size_t size) {
+  uint32_t buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(target, buffer);
+  glBufferData(target, size, NULL, GL_STATIC_DRAW);
+  up->segments[up->segment_count++] = (upload_segment){ target, buffer, data, owned, size, 0 };
+  return buffer;
+}
+
+static void stage_float_streams(mesh_renderer_upload *up, mesh *m) {
+  mesh_renderer_component *mr = &up->next;
+  size_t vc = m->vert_count;
+
+  mr->vbo_pos = stage_buffer(up, GL_ARRAY_BUFFER, m->positions, NULL, 3 * vc * sizeof(float));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+  if (m->normals) {
+    mr->vbo_norm = stage_buffer(up, GL_ARRAY_BUFFER, m->normals, NULL, 3 * vc * sizeof(float));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+  }
+
+  if (m->texcoords) {
+    mr->vbo_uv = stage_buffer(up, GL_ARRAY_BUFFER, m->texcoords, NULL, 2 * vc * sizeof(float));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+  }
+}
+
+static bool stage_packed_stream(mesh_renderer_upload *up, mesh *m, vertex_format format) {
+  // cooked meshes already hold the stream in the requested layout
+  bool cooked = m->gpu_vertices && m->gpu_format == format;
+  size_t size = m->gpu_vertices_size;
+  void *packed = cooked ? (void *)m->gpu_vertices : mesh_pack_vertices(m, format, &size);
+  if (!packed) return false;
+
+  GLsizei stride = (GLsizei)vertex_format_stride(format);
+
+  // position, normal and texcoord share one buffer
+  up->next.vbo_pos = stage_buffer(up, GL_ARRAY_BUFFER, packed, cooked ? NULL : packed, size);
+
+  if (format == VERTEX_FORMAT_PACKED_QUANTIZED) {
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                          (void*)offsetof(packed_vertex_quantized, position));
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride,
+                          (void*)offsetof(packed_vertex_quantized, normal));
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                          (void*)offsetof(packed_vertex_quantized, texcoord));
+  } else {
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride,
+                          (void*)offsetof(packed_vertex, position));
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride,
+                          (void*)offsetof(packed_vertex, normal));
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                          (void*)offsetof(packed_vertex, texcoord));
+  }
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+  return true;
+}
+
+// full mesh followed by every lod, 16-bit whenever every vertex is
+// addressable with them
+static void *pack_indices(const mesh *m, const mesh_renderer_lod *lods, size_t lod_count,
+                          size_t ic, uint32_t index_type) {
+  uint32_t *all_indices = malloc(ic * sizeof(uint32_t));
+  memcpy(all_indices, m->indices, m->idx_count * sizeof(uint32_t));
+  for (size_t l = 1; l < lod_count; l++) {
+    memcpy(all_indices + lods[l].index_offset, m->lods[l - 1].indices,
+           lods[l].index_count * sizeof(uint32_t));
+  }
+  if (index_type != GL_UNSIGNED_SHORT) return all_indices;
+
+  uint16_t *short_indices = malloc(ic * sizeof(uint16_t));
+  for (size_t i = 0; i < ic; i++) {
+    short_indices[i] = (uint16_t)all_indices[i];
+  }
+  free(all_indices);
+  return short_indices;
+}
+
+static void delete_objects(mesh_renderer_component *mr) {
+  glDeleteBuffers(1, &mr->ebo);
+  glDeleteBuffers(1, &mr->vbo_uv);
+  glDeleteBuffers(1, &mr->vbo_norm);
+  glDeleteBuffers(1, &mr->vbo_pos);
+  glDeleteVertexArrays(1, &mr->vao);
+  mr->ebo = mr->vbo_uv = mr->vbo_norm = mr->vbo_pos = mr->vao = 0;
+}
+
+static void discard_upload(mesh_renderer_component *mr) {
+  mesh_renderer_upload *up = mr->upload;
+  if (!up) return;
+  for (size_t i = 0; i < up->segment_count; i++) free(up->segments[i].owned);
+  delete_objects(&up->next);
+  free(up);
+  mr->upload = NULL;
+}
+
+bool mesh_renderer_component_upload_begin(mesh_renderer_component *mr, mesh *m,
+                                          vertex_format format) {
+  if (!m || !m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    return false;
+  }
+
+  discard_upload(mr);
+  mesh_renderer_upload *up = calloc(1, sizeof(mesh_renderer_upload));
+  mesh_renderer_component *next = &up->next;
+  next->mesh_data = m;
+  next->format = format;
+
+  glGenVertexArrays(1, &next->vao);
+  glBindVertexArray(next->vao);
+
+  if (format == VERTEX_FORMAT_FLOAT || !stage_packed_stream(up, m, format)) {
+    next->format = VERTEX_FORMAT_FLOAT;
+    stage_float_streams(up, m);
+  }
+
+  // full mesh followed by every lod in one index buffer
+  next->lods[0] = (mesh_renderer_lod){ 0, m->idx_count, 0.0f };
+  next->lod_count = 1;
+  size_t ic = m->idx_count;
+  for (size_t l = 0; l < m->lod_count; l++) {
+    next->lods[next->lod_count++] = (mesh_renderer_lod){ ic, m->lods[l].idx_count, m->lods[l].error };
+    ic += m->lods[l].idx_count;
+  }
+
+  next->index_type = m->vert_count < 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  size_t index_size = next->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+  // cooked meshes store this exact buffer
+  void *owned = m->gpu_indices ? NULL : pack_indices(m, next->lods, next->lod_count, ic, next->index_type);
+  const void *indices = m->gpu_indices ? m->gpu_indices : owned;
+  next->ebo = stage_buffer(up, GL_ELEMENT_ARRAY_BUFFER, indices, owned, ic * index_size);
+
+  glBindVertexArray(0);
+  mr->upload = up;
+  return true;
+}
+
+size_t mesh_renderer_component_upload_step(mesh_renderer_component *mr, size_t max_bytes) {
+  mesh_renderer_upload *up = mr->upload;
+  if (!up) return 0;
+
+  // the element buffer binding belongs to the vao being filled
+  glBindVertexArray(up->next.vao);
+  size_t written = 0;
+  while (up->current < up->segment_count && written < max_bytes) {
+    upload_segment *seg = &up->segments[up->current];
+    size_t n = seg->size - seg->written;
+    if (n > max_bytes - written) n = max_bytes - written;
+
+    glBindBuffer(seg->target, seg->buffer);
+    glBufferSubData(seg->target, (GLintptr)seg->written, (GLsizeiptr)n,
+                    (const char *)seg->data + seg->written);
+    seg->written += n;
+    written += n;
+    if (seg->written == seg->size) {
+      free(seg->owned);
+      seg->owned = NULL;
+      up->current++;
+    }
+  }
+  glBindVertexArray(0);
+  if (up->current < up->segment_count) return written;
+
+  // everything is on the gpu, the previous buffers go and the new ones draw
+  if (mr->initialized) delete_objects(mr);
+  mesh_renderer_component *next = &up->next;
+  mr->mesh_data = next->mesh_data;
+  mr->format = next->format;
+  mr->vao = next->vao;
+  mr->vbo_pos = next->vbo_pos;
+  mr->vbo_norm = next->vbo_norm;
+  mr->vbo_uv = next->vbo_uv;
+  mr->ebo = next->ebo;
+  mr->index_type = next->index_type;
+  memcpy(mr->lods, next->lods, sizeof(mr->lods));
+  mr->lod_count = next->lod_count;
+  mr->revision++;
+  mr->initialized = true;
+  free(up);
+  mr->upload = NULL;
+  return written;
+}
+
+void mesh_renderer_component_upload(mesh_renderer_component *mr, mesh *m, vertex_format format) {
+  if (mesh_renderer_component_upload_begin(mr, m, format)) {
+    mesh_renderer_component_upload_step(mr, SIZE_MAX);
+  }
+}
+
 void mesh_renderer_component_cleanup(mesh_renderer_component *mr) {
+  discard_upload(mr);
   if (mr->initialized) {
-    glDeleteBuffers(1, &mr->ebo);
-    glDeleteBuffers(1, &mr->vbo_norm);
-    glDeleteBuffers(1, &mr->vbo_pos);
-    glDeleteVertexArrays(1, &mr->vao);
+    delete_objects(mr);
     mr->initialized = false;
   }
 }
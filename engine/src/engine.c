@@ -11,6 +11,9 @@
 #include <window/window.h>
 #include <window/xdg-shell-client-protocol.h>
 #include <lib/graphics.h>
+#include <lib/jobs.h>
+#include <lib/watcher.h>
+#include <assets/assets.h>
 
 int width = 1080;
 int height = 1920;
@@ -80,6 +83,7 @@ int atom_run(atom_config *config, atom_callbacks *callbacks) {
   init_glad();
 
   input_init();
+  jobs_init(0);
 
   if (callbacks->init) {
     callbacks->init();
@@ -95,6 +99,8 @@ int atom_run(atom_config *config, atom_callbacks *callbacks) {
     last_t = now;
 
     input_update(dt);
+    watcher_dispatch();
+    assets_dispatch();
 
     if (callbacks->update) {
       callbacks->update(dt);
@@ -112,6 +118,11 @@ int atom_run(atom_config *config, atom_callbacks *callbacks) {
     callbacks->cleanup();
   }
 
+  assets_shutdown();
+  watcher_shutdown();
+  shader_compile_shutdown();
+  jobs_shutdown();
+
   eglDestroySurface(egl_display, egl_surface);
   eglDestroyContext(egl_display, egl_context);
   eglTerminate(egl_display);
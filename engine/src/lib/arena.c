@@ -0,0 +1,61 @@
+#include <lib/arena.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+struct arena_block {
+  arena_block *next;
+  size_t      size;
+  size_t      used;
+  unsigned char data[];  // allocations align themselves
+};
+
+void arena_init(arena *a, size_t block_size) {
+  a->blocks = NULL;
+  a->block_size = block_size ? block_size : 1 << 20;
+}
+
+void arena_destroy(arena *a) {
+  arena_block *b = a->blocks;
+  while (b) {
+    arena_block *next = b->next;
+    free(b);
+    b = next;
+  }
+  a->blocks = NULL;
+}
+
+void arena_reset(arena *a) {
+  if (!a->blocks) return;
+  arena_block *keep = a->blocks;
+  a->blocks = keep->next;
+  arena_destroy(a);
+  keep->next = NULL;
+  keep->used = 0;
+  a->blocks = keep;
+}
+
+void *arena_alloc(arena *a, size_t size, size_t align) {
+  arena_block *b = a->blocks;
+  if (b) {
+    uintptr_t base = (uintptr_t)b->data;
+    size_t offset = (size_t)(((base + b->used + align - 1) & ~(uintptr_t)(align - 1)) - base);
+    if (offset <= b->size && size <= b->size - offset) {
+      b->used = offset + size;
+      return (char *)b->data + offset;
+    }
+  }
+
+  // oversized requests get a block of their own
+  size_t capacity = size + align > a->block_size ? size + align : a->block_size;
+  b = malloc(sizeof(arena_block) + capacity);
+  if (!b) return NULL;
+  b->next = a->blocks;
+  b->size = capacity;
+  b->used = 0;
+  a->blocks = b;
+
+  uintptr_t base = (uintptr_t)b->data;
+  size_t offset = (size_t)(((base + align - 1) & ~(uintptr_t)(align - 1)) - base);
+  b->used = offset + size;
+  return (char *)b->data + offset;
+}
@@ -0,0 +1,302 @@
+#include <lib/inflate.h>
+#include <string.h>
+
+#define FAST_BITS 10
+#define MAX_BITS  15
+
+// lsb first bit reader, past the end it feeds zero bytes and counts them
+// so a stream that relied on them can be rejected
+typedef struct {
+  const uint8_t *src, *end;
+  uint64_t bits;
+  int      count;
+  size_t   padding;
+} bit_reader;
+
+static void refill(bit_reader *br) {
+  while (br->count <= 56) {
+    uint64_t b = 0;
+    if (br->src < br->end) {
+      b = *br->src++;
+    } else {
+      br->padding++;
+    }
+    br->bits |= b << br->count;
+    br->count += 8;
+  }
+}
+
+static uint32_t take(bit_reader *br, int n) {
+  uint32_t v = (uint32_t)(br->bits & ((1ull << n) - 1));
+  br->bits >>= n;
+  br->count -= n;
+  return v;
+}
+
+static bool overran(const bit_reader *br) {
+  return br->padding * 8 > (size_t)br->count;
+}
+
+// canonical huffman code. codes up to FAST_BITS long resolve with a single
+// lookup, longer ones walk the code lengths
+typedef struct {
+  uint16_t fast[1 << FAST_BITS];  // symbol << 4 | length, 0 for longer codes
+  uint16_t count[MAX_BITS + 1];
+  uint16_t symbol[288];
+} huffman;
+
+static bool build_huffman(huffman *h, const uint8_t *lengths, int n) {
+  memset(h->count, 0, sizeof(h->count));
+  memset(h->fast, 0, sizeof(h->fast));
+  for (int i = 0; i < n; i++) h->count[lengths[i]]++;
+  h->count[0] = 0;
+
+  // over subscribed sets are corrupt, incomplete ones are allowed as the
+  // format permits them for single distance codes
+  int left = 1;
+  for (int len = 1; len <= MAX_BITS; len++) {
+    left = (left << 1) - h->count[len];
+    if (left < 0) return false;
+  }
+
+  uint16_t offset[MAX_BITS + 2];
+  offset[1] = 0;
+  for (int len = 1; len <= MAX_BITS; len++) offset[len + 1] = offset[len] + h->count[len];
+  for (int i = 0; i < n; i++) {
+    if (lengths[i]) h->symbol[offset[lengths[i]]++] = (uint16_t)i;
+  }
+
+  uint32_t code = 0;
+  int index = 0;
+  for (int len = 1; len <= FAST_BITS; len++) {
+    for (int k = 0; k < h->count[len]; k++, index++, code++) {
+      uint32_t reversed = 0;
+      for (int b = 0; b < len; b++) reversed |= ((code >> b) & 1u) << (len - 1 - b);
+      for (uint32_t fill = reversed; fill < (1u << FAST_BITS); fill += 1u << len) {
+        h->fast[fill] = (uint16_t)(h->symbol[index] << 4 | len);
+      }
+    }
+    code <<= 1;
+  }
+  return true;
+}
+
+// the reader holds at least MAX_BITS bits when this is called
+static int decode(bit_reader *br, const huffman *h) {
+  uint16_t entry = h->fast[br->bits & ((1u << FAST_BITS) - 1)];
+  if (entry) {
+    take(br, entry & 15);
+    return entry >> 4;
+  }
+
+  int code = 0, first = 0, index = 0;
+  for (int len = 1; len <= MAX_BITS; len++) {
+    code |= (int)((br->bits >> (len - 1)) & 1);
+    int count = h->count[len];
+    if (code - first < count) {
+      take(br, len);
+      return h->symbol[index + code - first];
+    }
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+static const uint16_t length_base[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef struct {
+  bit_reader br;
+  uint8_t    *dst;
+  size_t     pos, size;
+  huffman    lit, dist;
+} inflater;
+
+static bool inflate_codes(inflater *z) {
+  for (;;) {
+    refill(&z->br);
+    int sym = decode(&z->br, &z->lit);
+    if (sym < 0) return false;
+
+    if (sym < 256) {
+      if (z->pos == z->size) return false;
+      z->dst[z->pos++] = (uint8_t)sym;
+      continue;
+    }
+    if (sym == 256) return !overran(&z->br);
+    if (sym > 285) return false;
+
+    sym -= 257;
+    size_t length = length_base[sym] + take(&z->br, length_extra[sym]);
+    int d = decode(&z->br, &z->dist);
+    if (d < 0 || d > 29) return false;
+    size_t distance = dist_base[d] + take(&z->br, dist_extra[d]);
+    if (distance > z->pos || length > z->size - z->pos) return false;
+
+    // matches may overlap their own output
+    uint8_t *out = z->dst + z->pos;
+    const uint8_t *from = out - distance;
+    if (distance >= length) {
+      memcpy(out, from, length);
+    } else {
+      for (size_t i = 0; i < length; i++) out[i] = from[i];
+    }
+    z->pos += length;
+  }
+}
+
+static bool inflate_stored(inflater *z) {
+  // back to a byte boundary, whole bytes still in the bit buffer come first
+  take(&z->br, z->br.count & 7);
+  refill(&z->br);
+  uint32_t len = take(&z->br, 16);
+  uint32_t nlen = take(&z->br, 16);
+  if ((len ^ 0xffff) != nlen || len > z->size - z->pos) return false;
+
+  while (len > 0 && z->br.count >= 8) {
+    z->dst[z->pos++] = (uint8_t)take(&z->br, 8);
+    len--;
+  }
+  if (overran(&z->br)) return false;
+  if (len > 0) {
+    // the buffer drained without padding, so the rest is read directly
+    if ((size_t)(z->br.end - z->br.src) < len) return false;
+    memcpy(z->dst + z->pos, z->br.src, len);
+    z->br.src += len;
+    z->pos += len;
+  }
+  return true;
+}
+
+static bool inflate_fixed(inflater *z) {
+  uint8_t lengths[288];
+  memset(lengths, 8, 144);
+  memset(lengths + 144, 9, 112);
+  memset(lengths + 256, 7, 24);
+  memset(lengths + 280, 8, 8);
+  build_huffman(&z->lit, lengths, 288);
+  memset(lengths, 5, 30);
+  build_huffman(&z->dist, lengths, 30);
+  return inflate_codes(z);
+}
+
+static bool inflate_dynamic(inflater *z) {
+  static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+  refill(&z->br);
+  int nlen = (int)take(&z->br, 5) + 257;
+  int ndist = (int)take(&z->br, 5) + 1;
+  int ncode = (int)take(&z->br, 4) + 4;
+  if (nlen > 286 || ndist > 30) return false;
+
+  uint8_t lengths[320];
+  memset(lengths, 0, 19);
+  refill(&z->br);
+  for (int i = 0; i < ncode; i++) lengths[order[i]] = (uint8_t)take(&z->br, 3);
+  huffman code_lengths;
+  if (!build_huffman(&code_lengths, lengths, 19)) return false;
+
+  for (int i = 0; i < nlen + ndist; ) {
+    refill(&z->br);
+    int sym = decode(&z->br, &code_lengths);
+    if (sym < 0) return false;
+    if (sym < 16) {
+      lengths[i++] = (uint8_t)sym;
+      continue;
+    }
+
+    uint8_t value = 0;
+    int repeat;
+    if (sym == 16) {
+      if (i == 0) return false;
+      value = lengths[i - 1];
+      repeat = 3 + (int)take(&z->br, 2);
+    } else if (sym == 17) {
+      repeat = 3 + (int)take(&z->br, 3);
+    } else {
+      repeat = 11 + (int)take(&z->br, 7);
+    }
+    if (i + repeat > nlen + ndist) return false;
+    memset(lengths + i, value, (size_t)repeat);
+    i += repeat;
+  }
+  if (lengths[256] == 0) return false;
+
+  return build_huffman(&z->lit, lengths, nlen) &&
+         build_huffman(&z->dist, lengths + nlen, ndist) &&
+         inflate_codes(z);
+}
+
+static bool inflate_stream(inflater *z) {
+  bool last = false;
+  while (!last) {
+    refill(&z->br);
+    last = take(&z->br, 1);
+    uint32_t type = take(&z->br, 2);
+
+    bool ok;
+    switch (type) {
+    case 0:  ok = inflate_stored(z); break;
+    case 1:  ok = inflate_fixed(z); break;
+    case 2:  ok = inflate_dynamic(z); break;
+    default: ok = false; break;
+    }
+    if (!ok || overran(&z->br)) return false;
+  }
+  return z->pos == z->size;
+}
+
+bool inflate_raw(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+  inflater z;
+  memset(&z.br, 0, sizeof(z.br));
+  z.br.src = src;
+  z.br.end = src + src_size;
+  z.dst = dst;
+  z.pos = 0;
+  z.size = dst_size;
+  return inflate_stream(&z);
+}
+
+static uint32_t adler32(const uint8_t *p, size_t n) {
+  uint32_t a = 1, b = 0;
+  while (n > 0) {
+    // 5552 bytes is the most that can be summed before b may overflow
+    size_t block = n < 5552 ? n : 5552;
+    n -= block;
+    while (block--) {
+      a += *p++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return b << 16 | a;
+}
+
+bool zlib_inflate(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+  if (src_size < 6) return false;
+  // deflate with a window of at most 32 KB and no preset dictionary
+  if ((src[0] & 15) != 8 || (src[0] >> 4) > 7 || (src[1] & 0x20) ||
+      ((uint32_t)src[0] << 8 | src[1]) % 31 != 0) {
+    return false;
+  }
+  if (!inflate_raw(src + 2, src_size - 6, dst, dst_size)) return false;
+
+  const uint8_t *tail = src + src_size - 4;
+  uint32_t expected = (uint32_t)tail[0] << 24 | (uint32_t)tail[1] << 16 | (uint32_t)tail[2] << 8 | tail[3];
+  return adler32(dst, dst_size) == expected;
+}
@@ -0,0 +1,144 @@
+#define _POSIX_C_SOURCE 200809L
+#include <lib/jobs.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define JOBS_MAX_WORKERS 64
+
+typedef struct {
+  job_fn fn;
+  void   *ctx;
+  size_t count;
+  size_t next;
+  size_t done;
+  size_t users;
+} job_batch;
+
+static pthread_t       workers[JOBS_MAX_WORKERS];
+static size_t          worker_count;
+static bool            initialized;
+static bool            quitting;
+static uint64_t        generation;
+static job_batch       *current;
+static pthread_mutex_t lock        = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t submit_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake        = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  finished    = PTHREAD_COND_INITIALIZER;
+static __thread bool   is_worker;  // or a background thread, both run nested work inline
+
+static void run_batch(job_batch *b) {
+  size_t i;
+  while ((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) < b->count) {
+    b->fn(b->ctx, i);
+    if (__atomic_add_fetch(&b->done, 1, __ATOMIC_ACQ_REL) == b->count) {
+      pthread_mutex_lock(&lock);
+      pthread_cond_broadcast(&finished);
+      pthread_mutex_unlock(&lock);
+    }
+  }
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  is_worker = true;
+
+  uint64_t seen = 0;
+  pthread_mutex_lock(&lock);
+  for (;;) {
+    while (!quitting && !(current && generation != seen)) {
+      pthread_cond_wait(&wake, &lock);
+    }
+    if (quitting) break;
+
+    seen = generation;
+    job_batch *b = current;
+    b->users++;
+    pthread_mutex_unlock(&lock);
+
+    run_batch(b);
+
+    pthread_mutex_lock(&lock);
+    if (--b->users == 0) {
+      pthread_cond_broadcast(&finished);
+    }
+  }
+  pthread_mutex_unlock(&lock);
+  return NULL;
+}
+
+void jobs_init(size_t count) {
+  if (initialized) return;
+
+  if (count == 0) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    count = cores > 1 ? (size_t)cores - 1 : 0;
+  }
+  if (count > JOBS_MAX_WORKERS) count = JOBS_MAX_WORKERS;
+
+  quitting = false;
+  worker_count = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (pthread_create(&workers[i], NULL, worker_main, NULL) != 0) {
+      fprintf(stderr, "jobs_init: could only start %zu of %zu workers\n", i, count);
+      break;
+    }
+    worker_count++;
+  }
+  initialized = true;
+}
+
+void jobs_shutdown(void) {
+  if (!initialized) return;
+
+  pthread_mutex_lock(&lock);
+  quitting = true;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+
+  for (size_t i = 0; i < worker_count; i++) {
+    pthread_join(workers[i], NULL);
+  }
+  worker_count = 0;
+  initialized = false;
+}
+
+size_t jobs_worker_count(void) {
+  return worker_count;
+}
+
+void jobs_mark_background(void) {
+  is_worker = true;
+}
+
+void jobs_parallel_for(size_t count, job_fn fn, void *ctx) {
+  if (!initialized) jobs_init(0);
+
+  // nested or trivial work runs inline
+  if (worker_count == 0 || count < 2 || is_worker) {
+    for (size_t i = 0; i < count; i++) fn(ctx, i);
+    return;
+  }
+
+  pthread_mutex_lock(&submit_lock);
+
+  job_batch b = { fn, ctx, count, 0, 0, 0 };
+  pthread_mutex_lock(&lock);
+  current = &b;
+  generation++;
+  pthread_cond_broadcast(&wake);
+  pthread_mutex_unlock(&lock);
+
+  run_batch(&b);
+
+  pthread_mutex_lock(&lock);
+  while (__atomic_load_n(&b.done, __ATOMIC_ACQUIRE) < count || b.users > 0) {
+    pthread_cond_wait(&finished, &lock);
+  }
+  current = NULL;
+  pthread_mutex_unlock(&lock);
+
+  pthread_mutex_unlock(&submit_lock);
+}
@@ -0,0 +1,339 @@
+#include <lib/json.h>
+#include <lib/parse.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define JSON_MAX_DEPTH 128
+
+typedef struct {
+  json_document *doc;
+  const char    *text;
+  size_t        pos, len;
+  int           depth;
+} json_parser;
+
+static void skip_space(json_parser *jp) {
+  while (jp->pos < jp->len) {
+    char c = jp->text[jp->pos];
+    if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+    jp->pos++;
+  }
+}
+
+static uint32_t push_token(json_parser *jp, json_type type, size_t start) {
+  json_document *doc = jp->doc;
+  if (doc->count == doc->capacity) {
+    doc->capacity = doc->capacity ? doc->capacity * 2 : 256;
+    doc->tokens = realloc(doc->tokens, doc->capacity * sizeof(json_token));
+  }
+  doc->tokens[doc->count] = (json_token){ type, (uint32_t)start, (uint32_t)start, 0, 0 };
+  return (uint32_t)doc->count++;
+}
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool parse_string(json_parser *jp) {
+  size_t start = ++jp->pos;
+  while (jp->pos < jp->len) {
+    unsigned char c = (unsigned char)jp->text[jp->pos];
+    if (c == '"') {
+      uint32_t tok = push_token(jp, JSON_STRING, start);
+      jp->doc->tokens[tok].end = (uint32_t)jp->pos;
+      jp->doc->tokens[tok].next = tok + 1;
+      jp->pos++;
+      return true;
+    }
+    if (c < 0x20) return false;
+    if (c == '\\') {
+      if (++jp->pos >= jp->len) return false;
+      char e = jp->text[jp->pos];
+      if (e == 'u') {
+        if (jp->pos + 4 >= jp->len) return false;
+        for (int k = 1; k <= 4; k++) {
+          if (hex_digit(jp->text[jp->pos + k]) < 0) return false;
+        }
+        jp->pos += 4;
+      } else if (!strchr("\"\\/bfnrt", e) || e == '\0') {
+        return false;
+      }
+    }
+    jp->pos++;
+  }
+  return false;
+}
+
+static bool is_digit(const json_parser *jp) {
+  return jp->pos < jp->len && jp->text[jp->pos] >= '0' && jp->text[jp->pos] <= '9';
+}
+
+static bool parse_number(json_parser *jp) {
+  size_t start = jp->pos;
+  if (jp->text[jp->pos] == '-') jp->pos++;
+  if (!is_digit(jp)) return false;
+  if (jp->text[jp->pos] == '0') {
+    jp->pos++;
+  } else {
+    while (is_digit(jp)) jp->pos++;
+  }
+  if (jp->pos < jp->len && jp->text[jp->pos] == '.') {
+    jp->pos++;
+    if (!is_digit(jp)) return false;
+    while (is_digit(jp)) jp->pos++;
+  }
+  if (jp->pos < jp->len && (jp->text[jp->pos] == 'e' || jp->text[jp->pos] == 'E')) {
+    jp->pos++;
+    if (jp->pos < jp->len && (jp->text[jp->pos] == '+' || jp->text[jp->pos] == '-')) jp->pos++;
+    if (!is_digit(jp)) return false;
+    while (is_digit(jp)) jp->pos++;
+  }
+
+  uint32_t tok = push_token(jp, JSON_NUMBER, start);
+  jp->doc->tokens[tok].end = (uint32_t)jp->pos;
+  jp->doc->tokens[tok].next = tok + 1;
+  return true;
+}
+
+static bool parse_literal(json_parser *jp, const char *word, json_type type) {
+  size_t n = strlen(word);
+  if (jp->len - jp->pos < n || memcmp(jp->text + jp->pos, word, n) != 0) return false;
+
+  uint32_t tok = push_token(jp, type, jp->pos);
+  jp->pos += n;
+  jp->doc->tokens[tok].end = (uint32_t)jp->pos;
+  jp->doc->tokens[tok].next = tok + 1;
+  return true;
+}
+
+static bool parse_value(json_parser *jp);
+
+// arrays and objects share one loop, objects read a key and a colon first
+static bool parse_container(json_parser *jp, json_type type, char close) {
+  if (++jp->depth > JSON_MAX_DEPTH) return false;
+
+  uint32_t tok = push_token(jp, type, jp->pos++);
+  uint32_t count = 0;
+  skip_space(jp);
+  if (jp->pos < jp->len && jp->text[jp->pos] == close) {
+    jp->pos++;
+  } else {
+    for (;;) {
+      if (type == JSON_OBJECT) {
+        skip_space(jp);
+        if (jp->pos >= jp->len || jp->text[jp->pos] != '"' || !parse_string(jp)) return false;
+        skip_space(jp);
+        if (jp->pos >= jp->len || jp->text[jp->pos] != ':') return false;
+        jp->pos++;
+      }
+      if (!parse_value(jp)) return false;
+      count++;
+
+      skip_space(jp);
+      if (jp->pos >= jp->len) return false;
+      char c = jp->text[jp->pos++];
+      if (c == close) break;
+      if (c != ',') return false;
+    }
+  }
+
+  json_token *t = &jp->doc->tokens[tok];
+  t->end = (uint32_t)jp->pos;
+  t->count = count;
+  t->next = (uint32_t)jp->doc->count;
+  jp->depth--;
+  return true;
+}
+
+static bool parse_value(json_parser *jp) {
+  skip_space(jp);
+  if (jp->pos >= jp->len) return false;
+
+  switch (jp->text[jp->pos]) {
+  case '{': return parse_container(jp, JSON_OBJECT, '}');
+  case '[': return parse_container(jp, JSON_ARRAY, ']');
+  case '"': return parse_string(jp);
+  case 't': return parse_literal(jp, "true", JSON_BOOL);
+  case 'f': return parse_literal(jp, "false", JSON_BOOL);
+  case 'n': return parse_literal(jp, "null", JSON_NULL);
+  default:  return parse_number(jp);
+  }
+}
+
+bool json_parse(json_document *doc, const char *text, size_t len) {
+  memset(doc, 0, sizeof(json_document));
+  doc->text = text;
+  if (len >= UINT32_MAX) return false;
+
+  json_parser jp = { doc, text, 0, len, 0 };
+  bool ok = parse_value(&jp);
+  skip_space(&jp);
+  if (!ok || jp.pos != len) {
+    fprintf(stderr, "json_parse: syntax error near byte %zu\n", jp.pos);
+    json_destroy(doc);
+    return false;
+  }
+  return true;
+}
+
+void json_destroy(json_document *doc) {
+  free(doc->tokens);
+  doc->tokens = NULL;
+  doc->count = doc->capacity = 0;
+}
+
+uint32_t json_get(const json_document *doc, uint32_t object, const char *key) {
+  if (object >= doc->count || doc->tokens[object].type != JSON_OBJECT) return JSON_NONE;
+
+  uint32_t member = object + 1;
+  for (uint32_t i = 0; i < doc->tokens[object].count; i++) {
+    if (json_string_eq(doc, member, key)) return member + 1;
+    member = doc->tokens[member + 1].next;
+  }
+  return JSON_NONE;
+}
+
+uint32_t json_at(const json_document *doc, uint32_t array, size_t index) {
+  if (array >= doc->count || doc->tokens[array].type != JSON_ARRAY) return JSON_NONE;
+  if (index >= doc->tokens[array].count) return JSON_NONE;
+
+  uint32_t element = array + 1;
+  for (size_t i = 0; i < index; i++) element = doc->tokens[element].next;
+  return element;
+}
+
+size_t json_count(const json_document *doc, uint32_t tok) {
+  if (tok >= doc->count) return 0;
+  json_type type = doc->tokens[tok].type;
+  return type == JSON_ARRAY || type == JSON_OBJECT ? doc->tokens[tok].count : 0;
+}
+
+int64_t json_int(const json_document *doc, uint32_t tok, int64_t fallback) {
+  if (tok >= doc->count || doc->tokens[tok].type != JSON_NUMBER) return fallback;
+
+  const char *p = doc->text + doc->tokens[tok].start;
+  const char *end = doc->text + doc->tokens[tok].end;
+  int64_t value;
+  if (parse_int(p, end, &value) == end) return value;
+
+  // written with a fraction or exponent
+  float f;
+  parse_float(p, end, &f);
+  return (int64_t)f;
+}
+
+float json_float(const json_document *doc, uint32_t tok, float fallback) {
+  if (tok >= doc->count || doc->tokens[tok].type != JSON_NUMBER) return fallback;
+
+  float value;
+  const char *p = doc->text + doc->tokens[tok].start;
+  const char *end = doc->text + doc->tokens[tok].end;
+  return parse_float(p, end, &value) == p ? fallback : value;
+}
+
+bool json_bool(const json_document *doc, uint32_t tok, bool fallback) {
+  if (tok >= doc->count || doc->tokens[tok].type != JSON_BOOL) return fallback;
+  return doc->text[doc->tokens[tok].start] == 't';
+}
+
+static uint32_t read_hex4(const char *p) {
+  uint32_t v = 0;
+  for (int k = 0; k < 4; k++) v = (v << 4) | (uint32_t)hex_digit(p[k]);
+  return v;
+}
+
+// decodes one character of a validated string into utf-8, returns the
+// number of bytes written and advances *p
+static size_t decode_char(const char **p, const char *end, char out[4]) {
+  const char *s = *p;
+  if (*s != '\\') {
+    out[0] = *s;
+    *p = s + 1;
+    return 1;
+  }
+
+  char e = s[1];
+  *p = s + 2;
+  switch (e) {
+  case 'b': out[0] = '\b'; return 1;
+  case 'f': out[0] = '\f'; return 1;
+  case 'n': out[0] = '\n'; return 1;
+  case 'r': out[0] = '\r'; return 1;
+  case 't': out[0] = '\t'; return 1;
+  case 'u': break;
+  default:  out[0] = e;    return 1;
+  }
+
+  uint32_t cp = read_hex4(s + 2);
+  *p = s + 6;
+  if (cp >= 0xd800 && cp < 0xdc00 && end - *p >= 6 && (*p)[0] == '\\' && (*p)[1] == 'u') {
+    uint32_t low = read_hex4(*p + 2);
+    if (low >= 0xdc00 && low < 0xe000) {
+      cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+      *p += 6;
+    }
+  }
+
+  if (cp < 0x80) {
+    out[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = (char)(0xc0 | (cp >> 6));
+    out[1] = (char)(0x80 | (cp & 0x3f));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (char)(0xe0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    out[2] = (char)(0x80 | (cp & 0x3f));
+    return 3;
+  }
+  out[0] = (char)(0xf0 | (cp >> 18));
+  out[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+  out[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+  out[3] = (char)(0x80 | (cp & 0x3f));
+  return 4;
+}
+
+bool json_string_eq(const json_document *doc, uint32_t tok, const char *s) {
+  if (tok >= doc->count || doc->tokens[tok].type != JSON_STRING) return false;
+
+  const char *p = doc->text + doc->tokens[tok].start;
+  const char *end = doc->text + doc->tokens[tok].end;
+  size_t n = strlen(s);
+  if (!memchr(p, '\\', (size_t)(end - p))) {
+    return (size_t)(end - p) == n && memcmp(p, s, n) == 0;
+  }
+
+  while (p < end) {
+    char c[4];
+    size_t len = decode_char(&p, end, c);
+    if (len > n || memcmp(c, s, len) != 0) return false;
+    s += len;
+    n -= len;
+  }
+  return n == 0;
+}
+
+size_t json_string(const json_document *doc, uint32_t tok, char *out, size_t capacity) {
+  if (capacity) out[0] = '\0';
+  if (tok >= doc->count || doc->tokens[tok].type != JSON_STRING) return 0;
+
+  const char *p = doc->text + doc->tokens[tok].start;
+  const char *end = doc->text + doc->tokens[tok].end;
+  size_t written = 0;
+  while (p < end) {
+    char c[4];
+    size_t len = decode_char(&p, end, c);
+    for (size_t k = 0; k < len; k++, written++) {
+      if (written + 1 < capacity) out[written] = c[k];
+    }
+  }
+  if (capacity) out[written < capacity ? written : capacity - 1] = '\0';
+  return written;
+}
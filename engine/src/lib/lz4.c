@@ -0,0 +1,142 @@
+#include <lib/lz4.h>
+#include <string.h>
+
+#define MIN_MATCH     4
+#define LAST_LITERALS 5   // the format ends every block with literals
+#define MATCH_LIMIT   12  // no match may start closer than this to the end
+#define MAX_OFFSET    65535
+#define HASH_BITS     14
+
+static uint32_t read32(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint32_t hash4(uint32_t v) {
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// lengths past the 15 held in the token continue as bytes, 255 meaning more follow
+static uint8_t *write_length(uint8_t *op, size_t length) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (uint8_t)length;
+  return op;
+}
+
+static uint8_t *write_literals(uint8_t *op, uint8_t *token, const uint8_t *literals, size_t count) {
+  *token = (uint8_t)((count < 15 ? count : 15) << 4);
+  if (count >= 15) op = write_length(op, count - 15);
+  memcpy(op, literals, count);
+  return op + count;
+}
+
+size_t lz4_compress_bound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+size_t lz4_compress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+  if (dst_size < lz4_compress_bound(src_size)) return 0;
+
+  // positions of the last sequence seen per hash, stale ones are caught by
+  // comparing the bytes
+  uint32_t table[1 << HASH_BITS];
+  memset(table, 0, sizeof(table));
+
+  const uint8_t *ip = src, *anchor = src, *end = src + src_size;
+  uint8_t *op = dst;
+  if (src_size > MATCH_LIMIT) {
+    const uint8_t *match_end = end - LAST_LITERALS;
+    const uint8_t *search_end = end - MATCH_LIMIT;
+    size_t misses = 0;
+
+    while (ip < search_end) {
+      uint32_t sequence = read32(ip);
+      uint32_t h = hash4(sequence);
+      const uint8_t *ref = src + table[h];
+      table[h] = (uint32_t)(ip - src);
+      if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != sequence) {
+        // data that does not compress is skipped through faster and faster
+        ip += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+
+      while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+        ip--;
+        ref--;
+      }
+      size_t length = MIN_MATCH;
+      while (ip + length < match_end && ip[length] == ref[length]) length++;
+
+      uint8_t *token = op++;
+      op = write_literals(op, token, anchor, (size_t)(ip - anchor));
+      size_t offset = (size_t)(ip - ref);
+      *op++ = (uint8_t)offset;
+      *op++ = (uint8_t)(offset >> 8);
+      size_t extra = length - MIN_MATCH;
+      *token |= (uint8_t)(extra < 15 ? extra : 15);
+      if (extra >= 15) op = write_length(op, extra - 15);
+
+      ip += length;
+      anchor = ip;
+      if (ip < search_end) table[hash4(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+    }
+  }
+
+  uint8_t *token = op++;
+  op = write_literals(op, token, anchor, (size_t)(end - anchor));
+  return (size_t)(op - dst);
+}
+
+static bool read_length(const uint8_t **ip, const uint8_t *end, size_t *length) {
+  uint8_t b;
+  do {
+    if (*ip >= end) return false;
+    b = *(*ip)++;
+    *length += b;
+  } while (b == 255);
+  return true;
+}
+
+bool lz4_decompress(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+  const uint8_t *ip = src, *end = src + src_size;
+  uint8_t *op = dst, *out_end = dst + dst_size;
+
+  for (;;) {
+    if (ip >= end) return false;
+    uint8_t token = *ip++;
+
+    size_t literals = token >> 4;
+    if (literals == 15 && !read_length(&ip, end, &literals)) return false;
+    if (literals > (size_t)(end - ip) || literals > (size_t)(out_end - op)) return false;
+    memcpy(op, ip, literals);
+    op += literals;
+    ip += literals;
+
+    // the last sequence stops after its literals
+    if (ip == end) return op == out_end;
+
+    if (end - ip < 2) return false;
+    size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst)) return false;
+
+    size_t length = token & 15;
+    if (length == 15 && !read_length(&ip, end, &length)) return false;
+    length += MIN_MATCH;
+    if (length > (size_t)(out_end - op)) return false;
+
+    // matches may overlap their own output
+    const uint8_t *from = op - offset;
+    if (offset >= length) {
+      memcpy(op, from, length);
+    } else {
+      for (size_t i = 0; i < length; i++) op[i] = from[i];
+    }
+    op += length;
+  }
+}
@@ -0,0 +1,200 @@
+#define _POSIX_C_SOURCE 200809L
+#include <opengl/program_cache.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define CACHE_MAGIC   0x42535441u  // "ATSB"
+#define CACHE_VERSION 1u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+} cache_header;
+
+static char cache_dir[1024];
+static int  cache_dir_state;  // 0 unresolved, 1 usable, -1 disabled
+static program_cache_stats stats;
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+static uint64_t hash_string(uint64_t h, const char *s) {
+    if (!s) s = "";
+    // length first so adjacent strings cannot alias
+    size_t len = strlen(s);
+    h = fnv1a(h, &len, sizeof(len));
+    return fnv1a(h, s, len);
+}
+
+static int make_dirs(const char *path) {
+    char buf[1024];
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(buf)) return -1;
+    memcpy(buf, path, len + 1);
+
+    for (char *p = buf + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(buf, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    if (mkdir(buf, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+static const char *resolve_dir(void) {
+    if (cache_dir_state == 0) {
+        const char *xdg  = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        if (xdg && *xdg) {
+            snprintf(cache_dir, sizeof(cache_dir), "%s/atom/shaders", xdg);
+        } else if (home && *home) {
+            snprintf(cache_dir, sizeof(cache_dir), "%s/.cache/atom/shaders", home);
+        } else {
+            cache_dir_state = -1;
+            return NULL;
+        }
+        cache_dir_state = 1;
+    }
+
+    if (cache_dir_state < 0) return NULL;
+
+    // created on first use so a read only setup only fails when storing
+    static int created;
+    if (!created) {
+        if (make_dirs(cache_dir) != 0) {
+            fprintf(stderr, "Shader cache disabled, cannot create %s\n", cache_dir);
+            cache_dir_state = -1;
+            return NULL;
+        }
+        created = 1;
+    }
+    return cache_dir;
+}
+
+void program_cache_set_directory(const char *dir) {
+    if (!dir) {
+        cache_dir_state = -1;
+        return;
+    }
+    snprintf(cache_dir, sizeof(cache_dir), "%s", dir);
+    cache_dir_state = 1;
+}
+
+uint64_t program_cache_key(const char *vs_source, const char *fs_source, const char *defines) {
+    uint64_t h = 14695981039346656037ull;
+    h = hash_string(h, vs_source);
+    h = hash_string(h, fs_source);
+    h = hash_string(h, defines);
+    h = hash_string(h, (const char *)glGetString(GL_VENDOR));
+    h = hash_string(h, (const char *)glGetString(GL_RENDERER));
+    h = hash_string(h, (const char *)glGetString(GL_VERSION));
+    return h;
+}
+
+static void entry_path(char *out, size_t size, const char *dir, uint64_t key) {
+    snprintf(out, size, "%s/%016llx.bin", dir, (unsigned long long)key);
+}
+
+GLuint program_cache_load(uint64_t key) {
+    const char *dir = resolve_dir();
+    if (!dir) return 0;
+
+    char path[1200];
+    entry_path(path, sizeof(path), dir, key);
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        stats.misses++;
+        return 0;
+    }
+
+    cache_header h;
+    void *binary = NULL;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 &&
+             h.magic == CACHE_MAGIC && h.version == CACHE_VERSION && h.key == key;
+    if (ok) {
+        binary = malloc(h.length);
+        ok = binary && fread(binary, 1, h.length, f) == h.length;
+    }
+    fclose(f);
+
+    GLuint p = 0;
+    if (ok) {
+        p = glCreateProgram();
+        glProgramBinary(p, h.format, binary, (GLsizei)h.length);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(p, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            // driver update or format change, caller recompiles and overwrites
+            glDeleteProgram(p);
+            p = 0;
+        }
+    }
+    free(binary);
+
+    if (p) {
+        stats.hits++;
+    } else {
+        stats.stale++;
+    }
+    return p;
+}
+
+void program_cache_store(uint64_t key, GLuint program) {
+    const char *dir = resolve_dir();
+    if (!dir) return;
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    void *binary = malloc((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary);
+    if (written <= 0) {
+        free(binary);
+        return;
+    }
+
+    cache_header h = { CACHE_MAGIC, CACHE_VERSION, key, format, (uint32_t)written };
+
+    char path[1200], tmp[1210];
+    entry_path(path, sizeof(path), dir, key);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    // write beside the entry and rename so readers never see a partial file
+    FILE *f = fopen(tmp, "wb");
+    if (f) {
+        int ok = fwrite(&h, sizeof(h), 1, f) == 1 &&
+                 fwrite(binary, 1, (size_t)written, f) == (size_t)written;
+        ok = fclose(f) == 0 && ok;
+        if (ok && rename(tmp, path) == 0) {
+            stats.stores++;
+        } else {
+            remove(tmp);
+        }
+    }
+    free(binary);
+}
+
+program_cache_stats program_cache_get_stats(void) {
+    return stats;
+}
@@ -1,67 +1,357 @@
-#include <opengl/glad.h>
+#define _POSIX_C_SOURCE 200809L
+#include <opengl/shader.h>
+#include <opengl/program_cache.h>
+#include <assets/archive.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-static char *load_shader_file(const char *path) {
-    FILE *f = fopen(path, "rb");
-    if (!f) {
+// GL_KHR_parallel_shader_compile, not part of the generated loader
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (*max_compiler_threads_fn)(GLuint count);
+
+typedef enum {
+    COMPILE_UNRESOLVED,
+    COMPILE_PARALLEL,  // driver compiles in the background, completion is queried
+    COMPILE_WORKER,    // our own thread with a context sharing objects with the main one
+    COMPILE_SYNC
+} compile_mode;
+
+struct shader_build {
+    char     *vs;
+    char     *fs;
+    GLuint   v, f, program;
+    uint64_t key;
+    bool     cached;
+    int      done;
+    shader_build *next;
+};
+
+static compile_mode mode;
+
+static pthread_t       worker;
+static EGLDisplay      worker_display;
+static EGLContext      worker_context;
+static int             worker_state;  // 0 starting, 1 running, -1 failed
+static bool            quitting;
+static shader_build    *queue_head;
+static shader_build    *queue_tail;
+static pthread_mutex_t lock     = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  wake     = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  finished = PTHREAD_COND_INITIALIZER;
+
+char *load_shader_file(const char *path) {
+    asset_file file;
+    if (!asset_file_map(path, false, &file)) {
         fprintf(stderr, "Failed to open shader: %s\n", path);
         return NULL;
     }
-    fseek(f, 0, SEEK_END);
-    long len = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    char *buf = malloc(len + 1);
-    fread(buf, 1, len, f);
-    buf[len] = '\0';
-    fclose(f);
+    char *buf = malloc(file.size + 1);
+    if (file.size) memcpy(buf, file.data, file.size);
+    buf[file.size] = '\0';
+    asset_file_unmap(&file);
     return buf;
 }
 
-static GLuint compile_shader(GLenum type, const char *src) {
-    GLuint sh = glCreateShader(type);
-    glShaderSource(sh, 1, &src, NULL);
-    glCompileShader(sh);
-
+static bool check_shader(GLuint sh) {
     GLint ok;
     glGetShaderiv(sh, GL_COMPILE_STATUS, &ok);
     if (!ok) {
         char buf[512];
         glGetShaderInfoLog(sh, 512, NULL, buf);
         fprintf(stderr, "Shader compile error: %s\n", buf);
-        exit(1);
     }
-    return sh;
+    return ok;
+}
+
+// places the define block right after the #version line, the #line
+// directive keeps compiler messages pointing at lines of the original file
+static char *inject_defines(const char *src, const char *defines) {
+    const char *body = src;
+    if (strncmp(src, "#version", 8) == 0) {
+        const char *nl = strchr(src, '\n');
+        body = nl ? nl + 1 : src + strlen(src);
+    }
+
+    size_t head = (size_t)(body - src);
+    size_t dlen = strlen(defines);
+    size_t blen = strlen(body);
+    char *out = malloc(head + dlen + 16 + blen + 1);
+    memcpy(out, src, head);
+    memcpy(out + head, defines, dlen);
+    int n = sprintf(out + head + dlen, "#line %d\n", head ? 2 : 1);
+    memcpy(out + head + dlen + n, body, blen + 1);
+    return out;
+}
+
+static char *stage_source(const char *src, const char *defines) {
+    if (defines && *defines) return inject_defines(src, defines);
+
+    size_t len = strlen(src);
+    char *out = malloc(len + 1);
+    memcpy(out, src, len + 1);
+    return out;
+}
+
+// issues every command without reading back any status, so a driver that
+// compiles in the background is never forced to wait here
+static void submit_build(shader_build *b) {
+    const char *vs = b->vs;
+    const char *fs = b->fs;
+
+    b->v = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(b->v, 1, &vs, NULL);
+    glCompileShader(b->v);
+
+    b->f = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(b->f, 1, &fs, NULL);
+    glCompileShader(b->f);
+
+    b->program = glCreateProgram();
+    glAttachShader(b->program, b->v);
+    glAttachShader(b->program, b->f);
+    glBindAttribLocation(b->program, 0, "aPos");
+    glProgramParameteri(b->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(b->program);
+}
+
+static void *worker_main(void *arg) {
+    (void)arg;
+
+    // the bound api is per thread
+    eglBindAPI(EGL_OPENGL_API);
+    bool current = eglMakeCurrent(worker_display, EGL_NO_SURFACE, EGL_NO_SURFACE, worker_context);
+
+    pthread_mutex_lock(&lock);
+    worker_state = current ? 1 : -1;
+    pthread_cond_broadcast(&finished);
+    pthread_mutex_unlock(&lock);
+    if (!current) return NULL;
+
+    for (;;) {
+        pthread_mutex_lock(&lock);
+        while (!queue_head && !quitting) {
+            pthread_cond_wait(&wake, &lock);
+        }
+        shader_build *b = queue_head;
+        if (b) {
+            queue_head = b->next;
+            if (!queue_head) queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&lock);
+        if (!b) break;
+
+        submit_build(b);
+        // the objects are only complete for the main context after a finish
+        glFinish();
+
+        pthread_mutex_lock(&lock);
+        __atomic_store_n(&b->done, 1, __ATOMIC_RELEASE);
+        pthread_cond_broadcast(&finished);
+        pthread_mutex_unlock(&lock);
+    }
+
+    eglMakeCurrent(worker_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    return NULL;
+}
+
+static bool has_extension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *ext = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (ext && strcmp(ext, name) == 0) return true;
+    }
+    return false;
+}
+
+static bool start_worker(void) {
+    EGLDisplay display = eglGetCurrentDisplay();
+    EGLContext shared  = eglGetCurrentContext();
+    if (display == EGL_NO_DISPLAY || shared == EGL_NO_CONTEXT) return false;
+
+    EGLint config_id = 0;
+    eglQueryContext(display, shared, EGL_CONFIG_ID, &config_id);
+    // id 0 means the context was created without a config, EGL_KHR_no_config_context
+    EGLConfig cfg = EGL_NO_CONFIG_KHR;
+    if (config_id != 0) {
+        const EGLint cfg_attribs[] = { EGL_CONFIG_ID, config_id, EGL_NONE };
+        EGLint num_cfg = 0;
+        if (!eglChooseConfig(display, cfg_attribs, &cfg, 1, &num_cfg) || num_cfg == 0) return false;
+    }
+
+    const EGLint ctx_attribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 5,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK,
+        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    worker_context = eglCreateContext(display, cfg, shared, ctx_attribs);
+    if (worker_context == EGL_NO_CONTEXT) return false;
+    worker_display = display;
+
+    worker_state = 0;
+    quitting = false;
+    if (pthread_create(&worker, NULL, worker_main, NULL) != 0) {
+        eglDestroyContext(display, worker_context);
+        return false;
+    }
+
+    // a context without a surface needs EGL_KHR_surfaceless_context
+    pthread_mutex_lock(&lock);
+    while (worker_state == 0) {
+        pthread_cond_wait(&finished, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (worker_state < 0) {
+        pthread_join(worker, NULL);
+        eglDestroyContext(display, worker_context);
+        return false;
+    }
+    return true;
+}
+
+static void resolve_mode(void) {
+    if (mode != COMPILE_UNRESOLVED) return;
+
+    if (has_extension("GL_KHR_parallel_shader_compile")) {
+        max_compiler_threads_fn max_threads =
+            (max_compiler_threads_fn)eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (max_threads) {
+            // let the driver pick how many threads it uses
+            max_threads(0xFFFFFFFFu);
+            mode = COMPILE_PARALLEL;
+            return;
+        }
+    }
+    mode = start_worker() ? COMPILE_WORKER : COMPILE_SYNC;
+}
+
+const char *shader_compile_mode(void) {
+    switch (mode) {
+    case COMPILE_PARALLEL: return "parallel";
+    case COMPILE_WORKER:   return "worker";
+    case COMPILE_SYNC:     return "sync";
+    default:               return "unresolved";
+    }
+}
+
+shader_build *shader_build_begin(const char *vs_source, const char *fs_source, const char *defines) {
+    resolve_mode();
+
+    shader_build *b = calloc(1, sizeof(shader_build));
+    b->key = program_cache_key(vs_source, fs_source, defines);
+    b->program = program_cache_load(b->key);
+    if (b->program) {
+        b->cached = true;
+        b->done = 1;
+        return b;
+    }
+
+    b->vs = stage_source(vs_source, defines);
+    b->fs = stage_source(fs_source, defines);
+
+    if (mode == COMPILE_WORKER) {
+        pthread_mutex_lock(&lock);
+        if (queue_tail) {
+            queue_tail->next = b;
+        } else {
+            queue_head = b;
+        }
+        queue_tail = b;
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&lock);
+    } else {
+        submit_build(b);
+        b->done = mode == COMPILE_SYNC;
+    }
+    return b;
+}
+
+bool shader_build_poll(shader_build *b) {
+    if (__atomic_load_n(&b->done, __ATOMIC_ACQUIRE)) return true;
+
+    if (mode == COMPILE_PARALLEL) {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(b->program, GL_COMPLETION_STATUS_KHR, &complete);
+        b->done = complete == GL_TRUE;
+    }
+    return b->done;
+}
+
+GLuint shader_build_finish(shader_build *b) {
+    if (mode == COMPILE_WORKER && !__atomic_load_n(&b->done, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&lock);
+        while (!__atomic_load_n(&b->done, __ATOMIC_ACQUIRE)) {
+            pthread_cond_wait(&finished, &lock);
+        }
+        pthread_mutex_unlock(&lock);
+    }
+
+    // status queries block on the parallel path until the driver is done
+    GLuint p = b->program;
+    if (!b->cached) {
+        bool compiled = check_shader(b->v) & check_shader(b->f);
+
+        GLint ok;
+        glGetProgramiv(p, GL_LINK_STATUS, &ok);
+        if (compiled && !ok) {
+            char buf[512];
+            glGetProgramInfoLog(p, 512, NULL, buf);
+            fprintf(stderr, "Program link error: %s\n", buf);
+        }
+        glDeleteShader(b->v);
+        glDeleteShader(b->f);
+
+        if (compiled && ok) {
+            program_cache_store(b->key, p);
+        } else {
+            glDeleteProgram(p);
+            p = 0;
+        }
+    }
+
+    free(b->vs);
+    free(b->fs);
+    free(b);
+    return p;
+}
+
+void shader_compile_shutdown(void) {
+    if (mode == COMPILE_WORKER) {
+        pthread_mutex_lock(&lock);
+        quitting = true;
+        pthread_cond_broadcast(&wake);
+        pthread_mutex_unlock(&lock);
+
+        pthread_join(worker, NULL);
+        eglDestroyContext(worker_display, worker_context);
+    }
+    mode = COMPILE_UNRESOLVED;
+}
+
+GLuint make_program_variant(const char *vs_source, const char *fs_source, const char *defines) {
+    return shader_build_finish(shader_build_begin(vs_source, fs_source, defines));
+}
+
+GLuint make_program_from_sources(const char *vs_source, const char *fs_source) {
+    return make_program_variant(vs_source, fs_source, NULL);
 }
 
 GLuint make_program_from_files(const char *vs_path, const char *fs_path) {
     char *vs_source = load_shader_file(vs_path);
     char *fs_source = load_shader_file(fs_path);
-    if (!vs_source || !fs_source) {
-        exit(1);
+    GLuint p = 0;
+    if (vs_source && fs_source) {
+        p = make_program_from_sources(vs_source, fs_source);
     }
 
-    GLuint v = compile_shader(GL_VERTEX_SHADER, vs_source);
-    GLuint f = compile_shader(GL_FRAGMENT_SHADER, fs_source);
-
     free(vs_source);
     free(fs_source);
-
-    GLuint p = glCreateProgram();
-    glAttachShader(p, v);
-    glAttachShader(p, f);
-    glBindAttribLocation(p, 0, "aPos");
-    glLinkProgram(p);
-
-    GLint ok;
-    glGetProgramiv(p, GL_LINK_STATUS, &ok);
-    if (!ok) {
-        char buf[512];
-        glGetProgramInfoLog(p, 512, NULL, buf);
-        fprintf(stderr, "Program link error: %s\n", buf);
-        exit(1);
-    }
-    glDeleteShader(v);
-    glDeleteShader(f);
     return p;
 }
@@ -0,0 +1,271 @@
+#include <opengl/shader_variants.h>
+#include <opengl/shader.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char *path;
+    char *text;
+} shader_source;
+
+// slot 0 is reserved so SHADER_HANDLE_NONE never names a variant
+static shader_variant *variants;
+static size_t          variant_count;
+static size_t          variant_capacity;
+
+// open addressing from key to handle, 0 marks an empty slot
+static shader_handle *slots;
+static size_t         slot_capacity;
+
+static shader_source *sources;
+static size_t         source_count;
+
+static uint64_t hash_bytes(uint64_t h, const char *s) {
+    for (; *s; s++) {
+        h = (h ^ (unsigned char)*s) * 1099511628211ull;
+    }
+    return (h ^ 0xff) * 1099511628211ull;
+}
+
+static char *copy_string(const char *s) {
+    size_t len = strlen(s);
+    char *out = malloc(len + 1);
+    memcpy(out, s, len + 1);
+    return out;
+}
+
+static const char *source_text(const char *path) {
+    for (size_t i = 0; i < source_count; i++) {
+        if (strcmp(sources[i].path, path) == 0) return sources[i].text;
+    }
+
+    char *text = load_shader_file(path);
+    if (!text) return NULL;
+
+    sources = realloc(sources, (source_count + 1) * sizeof(shader_source));
+    sources[source_count].path = copy_string(path);
+    sources[source_count].text = text;
+    return sources[source_count++].text;
+}
+
+static int compare_defines(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static char *canonical_defines(const char *const *defines, size_t count) {
+    const char **sorted = malloc((count ? count : 1) * sizeof(char *));
+    memcpy(sorted, defines, count * sizeof(char *));
+    qsort(sorted, count, sizeof(char *), compare_defines);
+
+    size_t size = 1;
+    for (size_t i = 0; i < count; i++) size += strlen(sorted[i]) + 16;
+
+    char  *out = malloc(size);
+    size_t len = 0;
+    out[0] = '\0';
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && strcmp(sorted[i], sorted[i - 1]) == 0) continue;
+
+        const char *eq = strchr(sorted[i], '=');
+        if (eq) {
+            len += sprintf(out + len, "#define %.*s %s\n", (int)(eq - sorted[i]), sorted[i], eq + 1);
+        } else {
+            len += sprintf(out + len, "#define %s 1\n", sorted[i]);
+        }
+    }
+    free(sorted);
+    return out;
+}
+
+static void insert_slot(shader_handle h) {
+    size_t mask = slot_capacity - 1;
+    size_t i = (size_t)variants[h].key & mask;
+    while (slots[i]) i = (i + 1) & mask;
+    slots[i] = h;
+}
+
+static void grow_slots(void) {
+    free(slots);
+    slot_capacity = slot_capacity ? slot_capacity * 2 : 64;
+    slots = calloc(slot_capacity, sizeof(shader_handle));
+    for (shader_handle h = 1; h < variant_count; h++) insert_slot(h);
+}
+
+shader_handle shader_variant_request(const char *vs_path, const char *fs_path,
+                                     const char *const *defines, size_t define_count) {
+    char *block = canonical_defines(defines, define_count);
+
+    uint64_t key = 14695981039346656037ull;
+    key = hash_bytes(key, vs_path);
+    key = hash_bytes(key, fs_path);
+    key = hash_bytes(key, block);
+
+    if (slot_capacity) {
+        size_t mask = slot_capacity - 1;
+        for (size_t i = (size_t)key & mask; slots[i]; i = (i + 1) & mask) {
+            shader_variant *v = &variants[slots[i]];
+            if (v->key == key && strcmp(v->vs_path, vs_path) == 0 &&
+                strcmp(v->fs_path, fs_path) == 0 && strcmp(v->defines, block) == 0) {
+                free(block);
+                return slots[i];
+            }
+        }
+    }
+
+    const char *vs = source_text(vs_path);
+    const char *fs = source_text(fs_path);
+    if (!vs || !fs) {
+        free(block);
+        return SHADER_HANDLE_NONE;
+    }
+
+    if (variant_count == 0) variant_count = 1;
+    if (variant_count >= variant_capacity) {
+        variant_capacity = variant_capacity ? variant_capacity * 2 : 16;
+        variants = realloc(variants, variant_capacity * sizeof(shader_variant));
+    }
+
+    shader_handle h = (shader_handle)variant_count++;
+    variants[h] = (shader_variant){
+        .key        = key,
+        .vs_path    = copy_string(vs_path),
+        .fs_path    = copy_string(fs_path),
+        .defines    = block,
+        .build      = shader_build_begin(vs, fs, block)
+    };
+
+    // keep the table at most half full
+    if (2 * variant_count > slot_capacity) {
+        grow_slots();
+    } else {
+        insert_slot(h);
+    }
+    return h;
+}
+
+shader_handle shader_variant_get(const char *vs_path, const char *fs_path,
+                                 const char *const *defines, size_t define_count) {
+    shader_handle h = shader_variant_request(vs_path, fs_path, defines, define_count);
+    shader_variant_wait(h);
+    return h;
+}
+
+// a failed build keeps whatever program the variant already had
+static void finish_build(shader_variant *v) {
+    GLuint p = shader_build_finish(v->build);
+    v->build = NULL;
+    if (!p) {
+        fprintf(stderr, "Shader variant %s + %s failed%s\n", v->vs_path, v->fs_path,
+                v->program ? ", keeping the previous program" : "");
+        return;
+    }
+
+    if (v->program) glDeleteProgram(v->program);
+    v->program = p;
+    v->generation++;
+}
+
+bool shader_variant_ready(shader_handle h) {
+    if (h == SHADER_HANDLE_NONE || h >= variant_count) return false;
+
+    shader_variant *v = &variants[h];
+    if (v->build && shader_build_poll(v->build)) {
+        finish_build(v);
+    }
+    return v->program != 0;
+}
+
+GLuint shader_variant_wait(shader_handle h) {
+    if (h == SHADER_HANDLE_NONE || h >= variant_count) return 0;
+
+    shader_variant *v = &variants[h];
+    if (v->build) {
+        finish_build(v);
+    }
+    return v->program;
+}
+
+size_t shader_variants_reload(const char *path) {
+    shader_source *src = NULL;
+    for (size_t i = 0; i < source_count; i++) {
+        if (strcmp(sources[i].path, path) == 0) src = &sources[i];
+    }
+    if (!src) return 0;
+
+    char *text = load_shader_file(path);
+    if (!text) return 0;
+    if (strcmp(text, src->text) == 0) {
+        free(text);
+        return 0;
+    }
+    free(src->text);
+    src->text = text;
+
+    size_t rebuilt = 0;
+    for (shader_handle h = 1; h < variant_count; h++) {
+        shader_variant *v = &variants[h];
+        if (strcmp(v->vs_path, path) != 0 && strcmp(v->fs_path, path) != 0) continue;
+
+        if (v->build) finish_build(v);
+        v->build = shader_build_begin(source_text(v->vs_path), source_text(v->fs_path), v->defines);
+        rebuilt++;
+    }
+    return rebuilt;
+}
+
+void shader_variants_warm_up(const shader_variant_desc *descs, size_t count) {
+    // submit everything first so the driver or worker overlaps the builds
+    shader_handle *handles = malloc((count ? count : 1) * sizeof(shader_handle));
+    for (size_t i = 0; i < count; i++) {
+        handles[i] = shader_variant_request(descs[i].vs_path, descs[i].fs_path,
+                                            descs[i].defines, descs[i].define_count);
+    }
+    for (size_t i = 0; i < count; i++) {
+        shader_variant_wait(handles[i]);
+    }
+    free(handles);
+}
+
+size_t shader_variants_pending(void) {
+    size_t pending = 0;
+    for (shader_handle h = 1; h < variant_count; h++) {
+        if (variants[h].build) pending++;
+    }
+    return pending;
+}
+
+GLuint shader_variant_program(shader_handle h) {
+    if (h == SHADER_HANDLE_NONE || h >= variant_count) return 0;
+    return variants[h].program;
+}
+
+const shader_variant *shader_variant_info(shader_handle h) {
+    if (h == SHADER_HANDLE_NONE || h >= variant_count) return NULL;
+    return &variants[h];
+}
+
+size_t shader_variant_count(void) {
+    return variant_count ? variant_count - 1 : 0;
+}
+
+void shader_variants_destroy(void) {
+    for (shader_handle h = 1; h < variant_count; h++) {
+        shader_variant_wait(h);
+        glDeleteProgram(variants[h].program);
+        free(variants[h].vs_path);
+        free(variants[h].fs_path);
+        free(variants[h].defines);
+    }
+    for (size_t i = 0; i < source_count; i++) {
+        free(sources[i].path);
+        free(sources[i].text);
+    }
+    free(variants);
+    free(slots);
+    free(sources);
+    variants = NULL;
+    slots = NULL;
+    sources = NULL;
+    variant_count = variant_capacity = slot_capacity = source_count = 0;
+}
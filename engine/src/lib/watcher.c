@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+#include <lib/watcher.h>
+#include <sys/inotify.h>
+#include <pthread.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// editors often save by writing a new file and renaming it over the old
+// one, so the containing directory is watched and events filtered by name
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+typedef struct {
+  char     *path;
+  char     *name;  // points into path
+  int      wd;
+  watch_fn fn;
+  void     *ctx;
+  bool     pending;
+} watch;
+
+static watch           *watches;
+static size_t          watch_count;
+static size_t          watch_capacity;
+static int             notify_fd = -1;
+static int             wake_pipe[2] = { -1, -1 };
+static pthread_t       thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void mark_changed(int wd, const char *name) {
+  pthread_mutex_lock(&lock);
+  for (size_t i = 0; i < watch_count; i++) {
+    if (watches[i].wd == wd && strcmp(watches[i].name, name) == 0) {
+      watches[i].pending = true;
+    }
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+static void *watcher_main(void *arg) {
+  (void)arg;
+
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  struct pollfd fds[2] = {
+    { notify_fd,    POLLIN, 0 },
+    { wake_pipe[0], POLLIN, 0 }
+  };
+
+  for (;;) {
+    if (poll(fds, 2, -1) < 0) continue;
+    if (fds[1].revents) break;
+    if (!(fds[0].revents & POLLIN)) continue;
+
+    ssize_t len = read(notify_fd, buf, sizeof(buf));
+    if (len <= 0) continue;
+
+    for (char *p = buf; p < buf + len; ) {
+      const struct inotify_event *e = (const struct inotify_event *)p;
+      if (e->len > 0) mark_changed(e->wd, e->name);
+      p += sizeof(struct inotify_event) + e->len;
+    }
+  }
+  return NULL;
+}
+
+static bool start(void) {
+  if (notify_fd >= 0) return true;
+
+  notify_fd = inotify_init();
+  if (notify_fd < 0) {
+    fprintf(stderr, "watcher: inotify unavailable, hot reload disabled\n");
+    return false;
+  }
+  if (pipe(wake_pipe) != 0 || pthread_create(&thread, NULL, watcher_main, NULL) != 0) {
+    fprintf(stderr, "watcher: failed to start thread\n");
+    close(notify_fd);
+    notify_fd = -1;
+    return false;
+  }
+  return true;
+}
+
+bool watcher_add(const char *path, watch_fn fn, void *ctx) {
+  if (!start()) return false;
+
+  size_t len = strlen(path);
+  char *copy = malloc(len + 1);
+  memcpy(copy, path, len + 1);
+
+  char *slash = strrchr(copy, '/');
+  int wd;
+  if (slash) {
+    *slash = '\0';
+    wd = inotify_add_watch(notify_fd, slash == copy ? "/" : copy, WATCH_EVENTS);
+    *slash = '/';
+  } else {
+    wd = inotify_add_watch(notify_fd, ".", WATCH_EVENTS);
+  }
+  if (wd < 0) {
+    fprintf(stderr, "watcher: cannot watch %s\n", path);
+    free(copy);
+    return false;
+  }
+
+  pthread_mutex_lock(&lock);
+  if (watch_count == watch_capacity) {
+    watch_capacity = watch_capacity ? watch_capacity * 2 : 16;
+    watches = realloc(watches, watch_capacity * sizeof(watch));
+  }
+  watches[watch_count++] = (watch){
+    .path = copy,
+    .name = slash ? slash + 1 : copy,
+    .wd   = wd,
+    .fn   = fn,
+    .ctx  = ctx
+  };
+  pthread_mutex_unlock(&lock);
+  return true;
+}
+
+void watcher_dispatch(void) {
+  if (notify_fd < 0) return;
+
+  // collected first so callbacks may add watches or take their time
+  watch changed[64];
+  size_t count = 0;
+
+  pthread_mutex_lock(&lock);
+  for (size_t i = 0; i < watch_count && count < 64; i++) {
+    if (!watches[i].pending) continue;
+    watches[i].pending = false;
+    changed[count++] = watches[i];
+  }
+  pthread_mutex_unlock(&lock);
+
+  for (size_t i = 0; i < count; i++) {
+    changed[i].fn(changed[i].path, changed[i].ctx);
+  }
+}
+
+void watcher_shutdown(void) {
+  if (notify_fd < 0) return;
+
+  ssize_t n = write(wake_pipe[1], "q", 1);
+  (void)n;
+  pthread_join(thread, NULL);
+
+  close(wake_pipe[0]);
+  close(wake_pipe[1]);
+  close(notify_fd);
+  wake_pipe[0] = wake_pipe[1] = notify_fd = -1;
+
+  for (size_t i = 0; i < watch_count; i++) {
+    free(watches[i].path);
+  }
+  free(watches);
+  watches = NULL;
+  watch_count = watch_capacity = 0;
+}
@@ -0,0 +1,249 @@
+#include <renderer/clusters.h>
+#include <opengl/glad.h>
+#include <lib/jobs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+void light_clusters_init(light_clusters *lc) {
+  memset(lc, 0, sizeof(light_clusters));
+  lc->grid = calloc(2 * CLUSTER_COUNT, sizeof(uint32_t));
+}
+
+void light_clusters_destroy(light_clusters *lc) {
+  uint32_t buffers[] = { lc->light_ssbo, lc->grid_ssbo, lc->index_ssbo, lc->params_ubo };
+  if (lc->light_ssbo) glDeleteBuffers(4, buffers);
+
+  for (int z = 0; z < CLUSTER_Z; z++) {
+    free(lc->slices[z].soa);
+    free(lc->slices[z].ids);
+    free(lc->slices[z].indices);
+  }
+  free(lc->lights);
+  free(lc->view_lights);
+  free(lc->grid);
+  free(lc->indices);
+  memset(lc, 0, sizeof(light_clusters));
+}
+
+static float slice_depth(const light_clusters *lc, int z) {
+  return lc->near_plane * powf(lc->far_plane / lc->near_plane, (float)z / (float)CLUSTER_Z);
+}
+
+static void slice_push_index(cluster_slice *sl, uint32_t id) {
+  if (sl->index_count == sl->index_capacity) {
+    sl->index_capacity = sl->index_capacity ? sl->index_capacity * 2 : 256;
+    sl->indices = realloc(sl->indices, sl->index_capacity * sizeof(uint32_t));
+  }
+  sl->indices[sl->index_count++] = id;
+}
+
+// bins every light overlapping slice z into its tiles, one job per slice
+static void bin_slice(void *ctx, size_t z) {
+  light_clusters *lc = ctx;
+  cluster_slice  *sl = &lc->slices[z];
+
+  float dn = slice_depth(lc, (int)z);
+  float df = slice_depth(lc, (int)z + 1);
+
+  // gather the lights whose depth range touches the slice, padded to a multiple of four
+  size_t need = (lc->light_count + 3) & ~(size_t)3;
+  if (need > sl->soa_capacity) {
+    sl->soa_capacity = need;
+    sl->soa = realloc(sl->soa, 4 * need * sizeof(float));
+    sl->ids = realloc(sl->ids, need * sizeof(uint32_t));
+  }
+  float *sx = sl->soa;
+  float *sy = sl->soa + sl->soa_capacity;
+  float *sz = sl->soa + 2 * sl->soa_capacity;
+  float *sr = sl->soa + 3 * sl->soa_capacity;
+
+  size_t n = 0;
+  for (size_t i = 0; i < lc->light_count; i++) {
+    const float *l = &lc->view_lights[4 * i];
+    float depth = -l[2];
+    if (depth + l[3] < dn || depth - l[3] > df) continue;
+    sx[n] = l[0]; sy[n] = l[1]; sz[n] = l[2]; sr[n] = l[3];
+    sl->ids[n++] = (uint32_t)i;
+  }
+  sl->soa_count = n;
+  for (size_t i = n; i < ((n + 3) & ~(size_t)3); i++) {
+    sx[i] = sy[i] = sz[i] = 0.0f;
+    sr[i] = -1.0f;  // never passes the distance test
+  }
+
+  sl->index_count = 0;
+  memset(sl->counts, 0, sizeof(sl->counts));
+  if (n == 0) return;
+
+  for (int ty = 0; ty < CLUSTER_Y; ty++) {
+    float ny0 = -1.0f + 2.0f * (float)ty / CLUSTER_Y;
+    float ny1 = -1.0f + 2.0f * (float)(ty + 1) / CLUSTER_Y;
+    float y_min = fminf(ny0 * dn, ny0 * df) / lc->y_scale;
+    float y_max = fmaxf(ny1 * dn, ny1 * df) / lc->y_scale;
+
+    for (int tx = 0; tx < CLUSTER_X; tx++) {
+      float nx0 = -1.0f + 2.0f * (float)tx / CLUSTER_X;
+      float nx1 = -1.0f + 2.0f * (float)(tx + 1) / CLUSTER_X;
+      float x_min = fminf(nx0 * dn, nx0 * df) / lc->x_scale;
+      float x_max = fmaxf(nx1 * dn, nx1 * df) / lc->x_scale;
+      float z_min = -df, z_max = -dn;
+
+      uint32_t before = (uint32_t)sl->index_count;
+
+#if defined(__SSE__)
+      __m128 bx0 = _mm_set1_ps(x_min), bx1 = _mm_set1_ps(x_max);
+      __m128 by0 = _mm_set1_ps(y_min), by1 = _mm_set1_ps(y_max);
+      __m128 bz0 = _mm_set1_ps(z_min), bz1 = _mm_set1_ps(z_max);
+      __m128 zero = _mm_setzero_ps();
+
+      for (size_t i = 0; i < n; i += 4) {
+        __m128 cx = _mm_loadu_ps(&sx[i]);
+        __m128 cy = _mm_loadu_ps(&sy[i]);
+        __m128 cz = _mm_loadu_ps(&sz[i]);
+        __m128 r  = _mm_loadu_ps(&sr[i]);
+
+        // distance from the sphere center to the cluster box
+        __m128 dx = _mm_max_ps(_mm_sub_ps(bx0, cx), _mm_max_ps(_mm_sub_ps(cx, bx1), zero));
+        __m128 dy = _mm_max_ps(_mm_sub_ps(by0, cy), _mm_max_ps(_mm_sub_ps(cy, by1), zero));
+        __m128 dz = _mm_max_ps(_mm_sub_ps(bz0, cz), _mm_max_ps(_mm_sub_ps(cz, bz1), zero));
+        __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        __m128 hit = _mm_and_ps(_mm_cmple_ps(d2, _mm_mul_ps(r, r)), _mm_cmpge_ps(r, zero));
+
+        int mask = _mm_movemask_ps(hit);
+        while (mask) {
+          int lane = __builtin_ctz(mask);
+          slice_push_index(sl, sl->ids[i + lane]);
+          mask &= mask - 1;
+        }
+      }
+#else
+      for (size_t i = 0; i < n; i++) {
+        float dx = fmaxf(x_min - sx[i], fmaxf(sx[i] - x_max, 0.0f));
+        float dy = fmaxf(y_min - sy[i], fmaxf(sy[i] - y_max, 0.0f));
+        float dz = fmaxf(z_min - sz[i], fmaxf(sz[i] - z_max, 0.0f));
+        if (dx*dx + dy*dy + dz*dz <= sr[i] * sr[i]) slice_push_index(sl, sl->ids[i]);
+      }
+#endif
+
+      sl->counts[ty * CLUSTER_X + tx] = (uint32_t)sl->index_count - before;
+    }
+  }
+}
+
+static void upload(uint32_t *buffer, GLenum target, size_t size, const void *data) {
+  if (!*buffer) glGenBuffers(1, buffer);
+  glBindBuffer(target, *buffer);
+  // orphan the previous frame's storage instead of waiting on it
+  glBufferData(target, size ? size : 16, NULL, GL_STREAM_DRAW);
+  if (size) glBufferSubData(target, 0, size, data);
+}
+
+void light_clusters_build(light_clusters *lc, const light_component *lights, size_t light_count,
+                          const camera_component *cam, int viewport_width, int viewport_height) {
+  if (light_count > lc->light_capacity) {
+    lc->light_capacity = light_count;
+    lc->lights      = realloc(lc->lights, light_count * sizeof(cluster_light));
+    lc->view_lights = realloc(lc->view_lights, 4 * light_count * sizeof(float));
+  }
+
+  const mat4 *view = &cam->view_matrix;
+  const light_component *sun = NULL;
+  size_t count = 0;
+  for (size_t i = 0; i < light_count; i++) {
+    const light_component *l = &lights[i];
+    if (l->type == LIGHT_DIRECTIONAL) {
+      if (!sun) sun = l;
+      continue;
+    }
+
+    cluster_light *gl = &lc->lights[count];
+    gl->position_range[0] = l->position.x;
+    gl->position_range[1] = l->position.y;
+    gl->position_range[2] = l->position.z;
+    gl->position_range[3] = l->range;
+    gl->color[0] = l->color.x * l->intensity;
+    gl->color[1] = l->color.y * l->intensity;
+    gl->color[2] = l->color.z * l->intensity;
+    gl->color[3] = 0.0f;
+
+    vec4 v = mat4_vec_mult(*view, (vec4){ l->position.x, l->position.y, l->position.z, 1.0f });
+    float *vl = &lc->view_lights[4 * count];
+    vl[0] = v.x; vl[1] = v.y; vl[2] = v.z; vl[3] = l->range;
+    count++;
+  }
+  lc->light_count = count;
+
+  lc->near_plane = cam->near_plane;
+  lc->far_plane  = cam->far_plane;
+  lc->x_scale    = cam->projection_matrix.m[0][0];
+  lc->y_scale    = cam->projection_matrix.m[1][1];
+
+  jobs_parallel_for(CLUSTER_Z, bin_slice, lc);
+
+  // stitch the per slice lists into one index buffer
+  size_t total = 0;
+  for (int z = 0; z < CLUSTER_Z; z++) total += lc->slices[z].index_count;
+  if (total > lc->index_capacity) {
+    lc->index_capacity = total;
+    lc->indices = realloc(lc->indices, total * sizeof(uint32_t));
+  }
+
+  uint32_t offset = 0;
+  for (int z = 0; z < CLUSTER_Z; z++) {
+    const cluster_slice *sl = &lc->slices[z];
+    if (sl->index_count) {
+      memcpy(&lc->indices[offset], sl->indices, sl->index_count * sizeof(uint32_t));
+    }
+
+    uint32_t *cell = &lc->grid[2 * z * CLUSTER_X * CLUSTER_Y];
+    for (int c = 0; c < CLUSTER_X * CLUSTER_Y; c++) {
+      cell[2*c + 0] = offset;
+      cell[2*c + 1] = sl->counts[c];
+      offset += sl->counts[c];
+    }
+  }
+  lc->index_count = total;
+
+  float log_ratio = logf(lc->far_plane / lc->near_plane);
+  mat4 inv_view = mat4_inverse(*view);
+  cluster_params params = {
+    .grid  = { CLUSTER_X, CLUSTER_Y, CLUSTER_Z, (uint32_t)count },
+    .slice = {
+      CLUSTER_Z / log_ratio,
+      CLUSTER_Z * logf(lc->near_plane) / log_ratio,
+      (float)CLUSTER_X / (float)viewport_width,
+      (float)CLUSTER_Y / (float)viewport_height
+    },
+    .eye = { inv_view.m[0][3], inv_view.m[1][3], inv_view.m[2][3], 1.0f }
+  };
+  if (sun) {
+    vec3 dir = vec_normalize(sun->direction);
+    params.sun_direction[0] = dir.x;
+    params.sun_direction[1] = dir.y;
+    params.sun_direction[2] = dir.z;
+    params.sun_direction[3] = 1.0f;
+    params.sun_color[0] = sun->color.x * sun->intensity;
+    params.sun_color[1] = sun->color.y * sun->intensity;
+    params.sun_color[2] = sun->color.z * sun->intensity;
+  }
+
+  upload(&lc->light_ssbo, GL_SHADER_STORAGE_BUFFER, count * sizeof(cluster_light), lc->lights);
+  upload(&lc->grid_ssbo, GL_SHADER_STORAGE_BUFFER, 2 * CLUSTER_COUNT * sizeof(uint32_t), lc->grid);
+  upload(&lc->index_ssbo, GL_SHADER_STORAGE_BUFFER, total * sizeof(uint32_t), lc->indices);
+  upload(&lc->params_ubo, GL_UNIFORM_BUFFER, sizeof(cluster_params), &params);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void light_clusters_bind(const light_clusters *lc) {
+  if (!lc->params_ubo) return;
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_LIGHT_BINDING, lc->light_ssbo);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_GRID_BINDING, lc->grid_ssbo);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_INDEX_BINDING, lc->index_ssbo);
+  glBindBufferBase(GL_UNIFORM_BUFFER, CLUSTER_PARAMS_BINDING, lc->params_ubo);
+}
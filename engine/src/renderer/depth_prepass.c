@@ -0,0 +1,57 @@
+#include <renderer/depth_prepass.h>
+#include <opengl/shader.h>
+#include <string.h>
+
+// gl_Position has to match the lit vertex shaders bit for bit for GL_EQUAL to
+// pass, so the expression is the same and both declare it invariant
+static const char *prepass_vs =
+  "#version 330 core\n"
+  "layout(location = 0) in vec3 aPos;\n"
+  "uniform mat4 uModel;\n"
+  "uniform mat4 uView;\n"
+  "uniform mat4 uProj;\n"
+  "invariant gl_Position;\n"
+  "void main() {\n"
+  "  vec3 FragPos = vec3(uModel * vec4(aPos, 1.0));\n"
+  "  gl_Position = uProj * uView * vec4(FragPos, 1.0);\n"
+  "}\n";
+
+static const char *prepass_fs =
+  "#version 330 core\n"
+  "void main() {}\n";
+
+void depth_prepass_init(depth_prepass *dp) {
+  memset(dp, 0, sizeof(depth_prepass));
+}
+
+void depth_prepass_destroy(depth_prepass *dp) {
+  if (dp->program) glDeleteProgram(dp->program);
+  memset(dp, 0, sizeof(depth_prepass));
+}
+
+void depth_prepass_begin(depth_prepass *dp, const mat4 *view, const mat4 *proj) {
+  if (!dp->program) {
+    dp->program = make_program_from_sources(prepass_vs, prepass_fs);
+    dp->model_loc = glGetUniformLocation(dp->program, "uModel");
+    dp->view_loc = glGetUniformLocation(dp->program, "uView");
+    dp->proj_loc = glGetUniformLocation(dp->program, "uProj");
+  }
+
+  glGetIntegerv(GL_CURRENT_PROGRAM, &dp->prev_program);
+  glUseProgram(dp->program);
+  glUniformMatrix4fv(dp->view_loc, 1, GL_TRUE, &view->m[0][0]);
+  glUniformMatrix4fv(dp->proj_loc, 1, GL_TRUE, &proj->m[0][0]);
+
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glDepthMask(GL_TRUE);
+  glDepthFunc(GL_LESS);
+}
+
+void depth_prepass_set_model(depth_prepass *dp, const mat4 *model) {
+  glUniformMatrix4fv(dp->model_loc, 1, GL_TRUE, &model->m[0][0]);
+}
+
+void depth_prepass_end(depth_prepass *dp) {
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glUseProgram((GLuint)dp->prev_program);
+}
@@ -0,0 +1,281 @@
+#include <renderer/frame_graph.h>
+#include <opengl/glad.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_COLOR_ATTACHMENTS 8
+
+void frame_graph_init(frame_graph *fg) {
+  memset(fg, 0, sizeof(frame_graph));
+}
+
+void frame_graph_destroy(frame_graph *fg) {
+  for (size_t i = 0; i < fg->pool_count; i++) {
+    glDeleteTextures(1, &fg->pool[i].texture);
+  }
+  free(fg->pool);
+  if (fg->fbo) glDeleteFramebuffers(1, &fg->fbo);
+  memset(fg, 0, sizeof(frame_graph));
+}
+
+void frame_graph_reset(frame_graph *fg) {
+  fg->pass_count = 0;
+  fg->resource_count = 0;
+}
+
+static bool is_depth_format(uint32_t format) {
+  return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 ||
+         format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 ||
+         format == GL_DEPTH32F_STENCIL8;
+}
+
+static size_t format_bytes(uint32_t format) {
+  switch (format) {
+  case GL_R8:               return 1;
+  case GL_RG8:
+  case GL_R16F:
+  case GL_DEPTH_COMPONENT16: return 2;
+  case GL_RGBA16F:
+  case GL_RG32F:
+  case GL_DEPTH32F_STENCIL8: return 8;
+  case GL_RGBA32F:          return 16;
+  default:                  return 4;
+  }
+}
+
+static fg_handle add_resource(frame_graph *fg, fg_resource r) {
+  if (fg->resource_count == FRAME_GRAPH_MAX_RESOURCES) return FG_HANDLE_NONE;
+  r.first_pass = r.last_pass = -1;
+  fg->resources[fg->resource_count] = r;
+  return (fg_handle)fg->resource_count++;
+}
+
+fg_handle frame_graph_create_texture(frame_graph *fg, const char *name, int width, int height,
+                                     uint32_t format) {
+  return add_resource(fg, (fg_resource){
+    .name = name, .kind = FG_RESOURCE_TRANSIENT, .width = width, .height = height, .format = format
+  });
+}
+
+fg_handle frame_graph_import_texture(frame_graph *fg, const char *name, uint32_t texture) {
+  return add_resource(fg, (fg_resource){
+    .name = name, .kind = FG_RESOURCE_TEXTURE, .texture = texture
+  });
+}
+
+fg_handle frame_graph_import_framebuffer(frame_graph *fg, const char *name, uint32_t framebuffer,
+                                         int width, int height) {
+  return add_resource(fg, (fg_resource){
+    .name = name, .kind = FG_RESOURCE_FRAMEBUFFER, .width = width, .height = height,
+    .framebuffer = framebuffer
+  });
+}
+
+fg_handle frame_graph_add_pass(frame_graph *fg, const char *name, fg_execute_fn execute, void *ctx) {
+  if (fg->pass_count == FRAME_GRAPH_MAX_PASSES) return FG_HANDLE_NONE;
+  fg->passes[fg->pass_count] = (fg_pass){ .name = name, .execute = execute, .ctx = ctx };
+  return (fg_handle)fg->pass_count++;
+}
+
+void frame_graph_read(frame_graph *fg, fg_handle pass, fg_handle resource) {
+  if (pass >= fg->pass_count || resource >= fg->resource_count) return;
+  fg_pass *p = &fg->passes[pass];
+  if (p->read_count < FRAME_GRAPH_MAX_PASS_IO) p->reads[p->read_count++] = resource;
+}
+
+void frame_graph_write(frame_graph *fg, fg_handle pass, fg_handle resource) {
+  if (pass >= fg->pass_count || resource >= fg->resource_count) return;
+  fg_pass *p = &fg->passes[pass];
+  if (p->write_count < FRAME_GRAPH_MAX_PASS_IO) p->writes[p->write_count++] = resource;
+}
+
+void frame_graph_set_side_effect(frame_graph *fg, fg_handle pass) {
+  if (pass < fg->pass_count) fg->passes[pass].side_effect = true;
+}
+
+static void extend_lifetime(fg_resource *r, int pass) {
+  if (r->kind != FG_RESOURCE_TRANSIENT) return;
+  if (r->first_pass < 0) r->first_pass = pass;
+  r->last_pass = pass;
+}
+
+// a pooled texture of the same shape whose previous user finished before
+// this pass is reused, otherwise the pool grows
+static void acquire_texture(frame_graph *fg, fg_resource *r, int pass) {
+  for (size_t i = 0; i < fg->pool_count; i++) {
+    fg_pooled_texture *t = &fg->pool[i];
+    if (t->width != r->width || t->height != r->height || t->format != r->format) continue;
+    if (t->used && t->free_after >= pass) continue;
+
+    if (!t->used) {
+      fg->stats.physical_textures++;
+      fg->stats.aliased_bytes += t->bytes;
+    }
+    t->used = true;
+    t->free_after = r->last_pass;
+    t->idle_frames = 0;
+    r->texture = t->texture;
+    return;
+  }
+
+  if (fg->pool_count == fg->pool_capacity) {
+    fg->pool_capacity = fg->pool_capacity ? fg->pool_capacity * 2 : 8;
+    fg->pool = realloc(fg->pool, fg->pool_capacity * sizeof(fg_pooled_texture));
+  }
+
+  fg_pooled_texture *t = &fg->pool[fg->pool_count++];
+  *t = (fg_pooled_texture){
+    .width = r->width, .height = r->height, .format = r->format,
+    .bytes = (size_t)r->width * (size_t)r->height * format_bytes(r->format),
+    .free_after = r->last_pass, .used = true
+  };
+  glGenTextures(1, &t->texture);
+  glBindTexture(GL_TEXTURE_2D, t->texture);
+  glTexStorage2D(GL_TEXTURE_2D, 1, r->format, r->width, r->height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  fg->stats.physical_textures++;
+  fg->stats.aliased_bytes += t->bytes;
+  r->texture = t->texture;
+}
+
+void frame_graph_compile(frame_graph *fg) {
+  memset(&fg->stats, 0, sizeof(fg->stats));
+  fg->stats.passes = fg->pass_count;
+
+  // passes are declared in execution order, so walking backwards sees every
+  // consumer of a resource before the passes that produce it
+  for (size_t i = 0; i < fg->resource_count; i++) {
+    fg->resources[i].needed = false;
+  }
+  for (size_t i = fg->pass_count; i-- > 0; ) {
+    fg_pass *p = &fg->passes[i];
+    bool live = p->side_effect;
+    for (size_t w = 0; w < p->write_count; w++) {
+      const fg_resource *r = &fg->resources[p->writes[w]];
+      if (r->kind == FG_RESOURCE_FRAMEBUFFER || r->needed) live = true;
+    }
+
+    p->culled = !live;
+    if (!live) {
+      fg->stats.passes_culled++;
+      continue;
+    }
+    for (size_t r = 0; r < p->read_count; r++) {
+      fg->resources[p->reads[r]].needed = true;
+    }
+  }
+
+  for (size_t i = 0; i < fg->pass_count; i++) {
+    fg_pass *p = &fg->passes[i];
+    if (p->culled) continue;
+    for (size_t r = 0; r < p->read_count; r++) extend_lifetime(&fg->resources[p->reads[r]], (int)i);
+    for (size_t w = 0; w < p->write_count; w++) extend_lifetime(&fg->resources[p->writes[w]], (int)i);
+  }
+
+  for (size_t i = 0; i < fg->pool_count; i++) {
+    fg->pool[i].used = false;
+  }
+  for (size_t i = 0; i < fg->pass_count; i++) {
+    for (size_t r = 0; r < fg->resource_count; r++) {
+      fg_resource *res = &fg->resources[r];
+      if (res->kind != FG_RESOURCE_TRANSIENT || res->first_pass != (int)i) continue;
+
+      fg->stats.transient_textures++;
+      fg->stats.transient_bytes += (size_t)res->width * (size_t)res->height * format_bytes(res->format);
+      acquire_texture(fg, res, (int)i);
+    }
+  }
+
+  // textures nobody asked for in a while are given back to the driver
+  for (size_t i = 0; i < fg->pool_count; ) {
+    fg_pooled_texture *t = &fg->pool[i];
+    if (!t->used && ++t->idle_frames > FRAME_GRAPH_POOL_KEEP) {
+      glDeleteTextures(1, &t->texture);
+      *t = fg->pool[--fg->pool_count];
+      continue;
+    }
+    fg->stats.pool_bytes += t->bytes;
+    i++;
+  }
+}
+
+// attaches the pass's transient outputs to the shared framebuffer
+static bool bind_transients(frame_graph *fg, const fg_pass *p) {
+  const fg_resource *first = NULL;
+  for (size_t w = 0; w < p->write_count && !first; w++) {
+    if (fg->resources[p->writes[w]].kind == FG_RESOURCE_TRANSIENT) first = &fg->resources[p->writes[w]];
+  }
+  if (!first) return false;
+
+  if (!fg->fbo) glGenFramebuffers(1, &fg->fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fg->fbo);
+
+  GLenum buffers[MAX_COLOR_ATTACHMENTS];
+  GLsizei color_count = 0;
+  uint32_t depth = 0;
+  for (size_t w = 0; w < p->write_count; w++) {
+    const fg_resource *r = &fg->resources[p->writes[w]];
+    if (r->kind != FG_RESOURCE_TRANSIENT) continue;
+
+    if (is_depth_format(r->format)) {
+      depth = r->texture;
+    } else if (color_count < MAX_COLOR_ATTACHMENTS) {
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + color_count, GL_TEXTURE_2D,
+                             r->texture, 0);
+      buffers[color_count] = GL_COLOR_ATTACHMENT0 + color_count;
+      color_count++;
+    }
+  }
+
+  // whatever the previous pass attached beyond this one's outputs is cleared
+  for (GLsizei c = color_count; c < MAX_COLOR_ATTACHMENTS; c++) {
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + c, GL_TEXTURE_2D, 0, 0);
+  }
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+
+  if (color_count > 0) {
+    glDrawBuffers(color_count, buffers);
+  } else {
+    glDrawBuffer(GL_NONE);
+  }
+  glViewport(0, 0, first->width, first->height);
+  return true;
+}
+
+void frame_graph_execute(frame_graph *fg) {
+  GLint prev_fbo;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_fbo);
+
+  for (size_t i = 0; i < fg->pass_count; i++) {
+    const fg_pass *p = &fg->passes[i];
+    if (p->culled) continue;
+
+    const fg_resource *target = NULL;
+    for (size_t w = 0; w < p->write_count && !target; w++) {
+      const fg_resource *r = &fg->resources[p->writes[w]];
+      if (r->kind == FG_RESOURCE_FRAMEBUFFER) target = r;
+    }
+    if (target) {
+      glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+      glViewport(0, 0, target->width, target->height);
+    } else {
+      bind_transients(fg, p);
+    }
+
+    if (fg->profiler) gpu_profiler_begin(fg->profiler, p->name);
+    p->execute(fg, p->ctx);
+    if (fg->profiler) gpu_profiler_end(fg->profiler);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)prev_fbo);
+}
+
+uint32_t frame_graph_texture(const frame_graph *fg, fg_handle resource) {
+  if (resource >= fg->resource_count) return 0;
+  return fg->resources[resource].texture;
+}
@@ -0,0 +1,128 @@
+#include <renderer/gpu_profiler.h>
+#include <opengl/glad.h>
+#include <string.h>
+
+#define QUERIES_PER_FRAME (2 * GPU_PROFILER_MAX_SCOPES + 2)
+
+void gpu_profiler_init(gpu_profiler *p) {
+  memset(p, 0, sizeof(gpu_profiler));
+  for (int f = 0; f < GPU_PROFILER_FRAMES; f++) {
+    glGenQueries(QUERIES_PER_FRAME, p->frames[f].queries);
+  }
+}
+
+void gpu_profiler_destroy(gpu_profiler *p) {
+  for (int f = 0; f < GPU_PROFILER_FRAMES; f++) {
+    glDeleteQueries(QUERIES_PER_FRAME, p->frames[f].queries);
+  }
+  memset(p, 0, sizeof(gpu_profiler));
+}
+
+static gpu_profiler_frame *current_frame(gpu_profiler *p) {
+  return &p->frames[(p->frame_number - 1) % GPU_PROFILER_FRAMES];
+}
+
+static uint32_t write_timestamp(gpu_profiler_frame *f) {
+  uint32_t q = (uint32_t)f->query_count++;
+  glQueryCounter(f->queries[q], GL_TIMESTAMP);
+  return q;
+}
+
+// timestamps complete in order, so the last one being available means all are
+static bool try_collect(gpu_profiler *p, gpu_profiler_frame *f) {
+  GLuint available = 0;
+  glGetQueryObjectuiv(f->queries[f->query_count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) return false;
+
+  GLuint64 times[QUERIES_PER_FRAME];
+  for (size_t q = 0; q < f->query_count; q++) {
+    glGetQueryObjectui64v(f->queries[q], GL_QUERY_RESULT, &times[q]);
+  }
+
+  p->frame_ms = (float)((double)(times[f->query_count - 1] - times[0]) * 1e-6);
+  p->timing_count = f->scope_count;
+  for (size_t s = 0; s < f->scope_count; s++) {
+    const gpu_scope *sc = &f->scopes[s];
+    p->timings[s] = (gpu_timing){
+      sc->name, sc->depth,
+      (float)((double)(times[sc->end_query] - times[sc->begin_query]) * 1e-6)
+    };
+  }
+  p->result_frame = f->number;
+  f->pending = false;
+  return true;
+}
+
+void gpu_profiler_begin_frame(gpu_profiler *p) {
+  // oldest first so the published results are always the newest available
+  for (uint64_t n = p->frame_number >= GPU_PROFILER_FRAMES ? p->frame_number - GPU_PROFILER_FRAMES + 1 : 0;
+       n < p->frame_number; n++) {
+    gpu_profiler_frame *f = &p->frames[n % GPU_PROFILER_FRAMES];
+    if (f->pending && f->number == n && !try_collect(p, f)) break;
+  }
+
+  gpu_profiler_frame *f = &p->frames[p->frame_number % GPU_PROFILER_FRAMES];
+  if (f->pending) {
+    p->frames_dropped++;
+  }
+
+  f->number = p->frame_number++;
+  f->scope_count = 0;
+  f->query_count = 0;
+  f->pending = false;
+  p->depth = 0;
+  p->overflow = 0;
+  p->in_frame = true;
+  write_timestamp(f);
+}
+
+void gpu_profiler_end_frame(gpu_profiler *p) {
+  if (!p->in_frame) return;
+
+  gpu_profiler_frame *f = current_frame(p);
+  while (p->depth > 0 || p->overflow > 0) gpu_profiler_end(p);
+  write_timestamp(f);
+  f->pending = true;
+  p->in_frame = false;
+}
+
+void gpu_profiler_begin(gpu_profiler *p, const char *name) {
+  if (!p->in_frame) return;
+  if (p->depth == GPU_PROFILER_MAX_SCOPES) {
+    p->overflow++;
+    return;
+  }
+
+  // past the scope limit the stack still balances, the scope is just not timed
+  gpu_profiler_frame *f = current_frame(p);
+  if (f->scope_count == GPU_PROFILER_MAX_SCOPES) {
+    p->stack[p->depth++] = GPU_PROFILER_MAX_SCOPES;
+    return;
+  }
+
+  size_t s = f->scope_count++;
+  f->scopes[s] = (gpu_scope){ name, (uint32_t)p->depth, write_timestamp(f), 0 };
+  p->stack[p->depth++] = s;
+}
+
+void gpu_profiler_end(gpu_profiler *p) {
+  if (!p->in_frame) return;
+  if (p->overflow > 0) {
+    p->overflow--;
+    return;
+  }
+  if (p->depth == 0) return;
+
+  gpu_profiler_frame *f = current_frame(p);
+  size_t s = p->stack[--p->depth];
+  if (s < GPU_PROFILER_MAX_SCOPES) {
+    f->scopes[s].end_query = write_timestamp(f);
+  }
+}
+
+float gpu_profiler_scope_ms(const gpu_profiler *p, const char *name) {
+  for (size_t i = 0; i < p->timing_count; i++) {
+    if (strcmp(p->timings[i].name, name) == 0) return p->timings[i].ms;
+  }
+  return 0.0f;
+}
@@ -0,0 +1,73 @@
+#include <renderer/lit_shaders.h>
+#include <opengl/shader_variants.h>
+#include <string.h>
+
+static const char *feature_names[] = { "PACKED_NORMALS", "FLAT_SHADING", "CLUSTERED", "SHADOWS" };
+
+// shadows are sampled by the clustered path only, so they are dropped without it
+static uint32_t canonical_features(uint32_t features) {
+  features &= LIT_VARIANT_COUNT - 1;
+  if (!(features & LIT_CLUSTERED)) features &= ~LIT_SHADOWS;
+  return features;
+}
+
+static size_t feature_defines(uint32_t features, const char **out) {
+  size_t count = 0;
+  for (size_t i = 0; i < sizeof(feature_names) / sizeof(feature_names[0]); i++) {
+    if (features & (1u << i)) out[count++] = feature_names[i];
+  }
+  return count;
+}
+
+void lit_shaders_init(lit_shaders *ls, const char *vs_path, const char *fs_path) {
+  memset(ls, 0, sizeof(lit_shaders));
+  ls->vs_path = vs_path;
+  ls->fs_path = fs_path;
+}
+
+void lit_shaders_warm_up(lit_shaders *ls, const uint32_t *features, size_t count) {
+  if (!ls->vs_path) return;
+  shader_variant_desc descs[LIT_VARIANT_COUNT];
+  const char *defines[LIT_VARIANT_COUNT][4];
+  if (count > LIT_VARIANT_COUNT) count = LIT_VARIANT_COUNT;
+
+  for (size_t i = 0; i < count; i++) {
+    uint32_t f = canonical_features(features[i]);
+    descs[i] = (shader_variant_desc){ ls->vs_path, ls->fs_path, defines[i], feature_defines(f, defines[i]) };
+  }
+  shader_variants_warm_up(descs, count);
+}
+
+const lit_variant *lit_shaders_use(lit_shaders *ls, uint32_t features) {
+  if (!ls->vs_path) return NULL;
+  features = canonical_features(features);
+  lit_variant *v = &ls->variants[features];
+
+  if (v->shader == SHADER_HANDLE_NONE) {
+    const char *defines[4];
+    v->shader = shader_variant_request(ls->vs_path, ls->fs_path, defines,
+                                       feature_defines(features, defines));
+  }
+  // polled, never waited on mid frame: draws are skipped until the first
+  // build lands and a variant being rebuilt keeps its previous program
+  if (!shader_variant_ready(v->shader)) return NULL;
+
+  const shader_variant *info = shader_variant_info(v->shader);
+  if (info->program != v->program || info->generation != v->generation) {
+    GLuint p = info->program;
+    v->program = p;
+    v->generation = info->generation;
+    v->model_loc = glGetUniformLocation(p, "uModel");
+    v->view_loc = glGetUniformLocation(p, "uView");
+    v->proj_loc = glGetUniformLocation(p, "uProj");
+    v->normal_loc = glGetUniformLocation(p, "uNormalMat");
+    v->ambient_loc = glGetUniformLocation(p, "uAmbient");
+    v->color_loc = glGetUniformLocation(p, "uObjectColor");
+    v->light_pos_loc = glGetUniformLocation(p, "uLightPos");
+    v->light_color_loc = glGetUniformLocation(p, "uLightColor");
+    v->view_pos_loc = glGetUniformLocation(p, "uViewPos");
+  }
+
+  glUseProgram(v->program);
+  return v;
+}
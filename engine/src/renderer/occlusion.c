@@ -0,0 +1,211 @@
+#include <renderer/occlusion.h>
+#include <lib/jobs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#define OCCLUSION_MIN_W 1e-4f
+
+void occlusion_init(occlusion_buffer *ob) {
+  memset(ob, 0, sizeof(occlusion_buffer));
+  ob->view_proj = mat4_identity();
+}
+
+void occlusion_destroy(occlusion_buffer *ob) {
+  free(ob->depth);
+  free(ob->triangles);
+  memset(ob, 0, sizeof(occlusion_buffer));
+}
+
+void occlusion_begin(occlusion_buffer *ob, const mat4 *view_proj) {
+  if (!ob->depth) {
+    ob->depth = malloc(OCCLUSION_WIDTH * OCCLUSION_HEIGHT * sizeof(float));
+  }
+  ob->view_proj = *view_proj;
+  ob->triangle_count = 0;
+}
+
+static bool project(const mat4 *mvp, const float *p, float out[3]) {
+  vec4 c = mat4_vec_mult(*mvp, (vec4){ p[0], p[1], p[2], 1.0f });
+  if (c.w < OCCLUSION_MIN_W) return false;
+
+  float inv_w = 1.0f / c.w;
+  out[0] = (c.x * inv_w * 0.5f + 0.5f) * (float)OCCLUSION_WIDTH;
+  out[1] = (c.y * inv_w * 0.5f + 0.5f) * (float)OCCLUSION_HEIGHT;
+  out[2] = c.z * inv_w * 0.5f + 0.5f;
+  return out[2] >= 0.0f;
+}
+
+// transforms and backface culls on the calling thread, triangles crossing
+// the near plane are dropped which only ever makes the buffer less occluding
+void occlusion_add_occluder(occlusion_buffer *ob, const mesh *m, const mat4 *world) {
+  if (!m->positions || !m->indices || !m->vert_count || !m->idx_count) {
+    return;
+  }
+
+  mat4 mvp = mat_mul(ob->view_proj, *world);
+  size_t tc = m->idx_count / 3;
+
+  if (ob->triangle_count + tc > ob->triangle_capacity) {
+    ob->triangle_capacity = (ob->triangle_count + tc) * 2;
+    ob->triangles = realloc(ob->triangles, ob->triangle_capacity * 9 * sizeof(float));
+  }
+
+  for (size_t t = 0; t < tc; t++) {
+    float *tri = &ob->triangles[9 * ob->triangle_count];
+    bool ok = true;
+    for (int c = 0; c < 3 && ok; c++) {
+      ok = project(&mvp, &m->positions[3 * m->indices[3*t + c]], &tri[3*c]);
+    }
+    if (!ok) continue;
+
+    float area = (tri[3] - tri[0]) * (tri[7] - tri[1]) - (tri[6] - tri[0]) * (tri[4] - tri[1]);
+    if (area <= 0.0f) continue;
+
+    ob->triangle_count++;
+  }
+}
+
+static void rasterize_band(void *ctx, size_t band) {
+  occlusion_buffer *ob = ctx;
+  int band_y0 = (int)(band * OCCLUSION_HEIGHT / OCCLUSION_BANDS);
+  int band_y1 = (int)((band + 1) * OCCLUSION_HEIGHT / OCCLUSION_BANDS);
+
+  for (int y = band_y0; y < band_y1; y++) {
+    float *row = &ob->depth[y * OCCLUSION_WIDTH];
+    for (int x = 0; x < OCCLUSION_WIDTH; x++) row[x] = 1.0f;
+  }
+
+  for (size_t t = 0; t < ob->triangle_count; t++) {
+    const float *v = &ob->triangles[9 * t];
+    float x0 = v[0], y0 = v[1], z0 = v[2];
+    float x1 = v[3], y1 = v[4], z1 = v[5];
+    float x2 = v[6], y2 = v[7], z2 = v[8];
+
+    int min_x = (int)floorf(fminf(x0, fminf(x1, x2)));
+    int max_x = (int)ceilf(fmaxf(x0, fmaxf(x1, x2)));
+    int min_y = (int)floorf(fminf(y0, fminf(y1, y2)));
+    int max_y = (int)ceilf(fmaxf(y0, fmaxf(y1, y2)));
+    if (min_x < 0) min_x = 0;
+    if (max_x > OCCLUSION_WIDTH - 1) max_x = OCCLUSION_WIDTH - 1;
+    if (min_y < band_y0) min_y = band_y0;
+    if (max_y > band_y1 - 1) max_y = band_y1 - 1;
+    if (min_x > max_x || min_y > max_y) continue;
+
+    // edge functions, positive inside a counter clockwise triangle
+    float a0 = y0 - y1, b0 = x1 - x0, c0 = -(a0 * x0 + b0 * y0);
+    float a1 = y1 - y2, b1 = x2 - x1, c1 = -(a1 * x1 + b1 * y1);
+    float a2 = y2 - y0, b2 = x0 - x2, c2 = -(a2 * x2 + b2 * y2);
+
+    // depth plane z = zx * x + zy * y + zc
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    float zx = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+    float zy = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) / area;
+    float zc = z0 - zx * x0 - zy * y0;
+
+    min_x &= ~3;
+
+    for (int y = min_y; y <= max_y; y++) {
+      float  py  = (float)y + 0.5f;
+      float *row = &ob->depth[y * OCCLUSION_WIDTH];
+
+#if defined(__SSE__)
+      __m128 px  = _mm_add_ps(_mm_set1_ps((float)min_x + 0.5f), _mm_setr_ps(0, 1, 2, 3));
+      __m128 e0  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+      __m128 e1  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+      __m128 e2  = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+      __m128 z   = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zx), px), _mm_set1_ps(zy * py + zc));
+      __m128 de0 = _mm_set1_ps(4.0f * a0);
+      __m128 de1 = _mm_set1_ps(4.0f * a1);
+      __m128 de2 = _mm_set1_ps(4.0f * a2);
+      __m128 dz  = _mm_set1_ps(4.0f * zx);
+      __m128 zero = _mm_setzero_ps();
+
+      for (int x = min_x; x <= max_x; x += 4) {
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                   _mm_cmpge_ps(e2, zero));
+        if (_mm_movemask_ps(inside)) {
+          __m128 d = _mm_loadu_ps(&row[x]);
+          __m128 nearer = _mm_min_ps(d, z);
+          _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, d)));
+        }
+        e0 = _mm_add_ps(e0, de0);
+        e1 = _mm_add_ps(e1, de1);
+        e2 = _mm_add_ps(e2, de2);
+        z  = _mm_add_ps(z, dz);
+      }
+#else
+      for (int x = min_x; x <= max_x; x++) {
+        float px = (float)x + 0.5f;
+        if (a0 * px + b0 * py + c0 < 0.0f) continue;
+        if (a1 * px + b1 * py + c1 < 0.0f) continue;
+        if (a2 * px + b2 * py + c2 < 0.0f) continue;
+        float z = zx * px + zy * py + zc;
+        if (z < row[x]) row[x] = z;
+      }
+#endif
+    }
+  }
+}
+
+void occlusion_rasterize(occlusion_buffer *ob) {
+  if (!ob->depth) return;
+  jobs_parallel_for(OCCLUSION_BANDS, rasterize_band, ob);
+}
+
+bool occlusion_test_aabb(const occlusion_buffer *ob, const float min[3], const float max[3],
+                         const mat4 *world) {
+  if (!ob->depth) return true;
+
+  mat4 mvp = mat_mul(ob->view_proj, *world);
+  float sx0 = INFINITY, sy0 = INFINITY, sx1 = -INFINITY, sy1 = -INFINITY, sz = INFINITY;
+
+  for (int c = 0; c < 8; c++) {
+    float corner[3] = {
+      (c & 1) ? max[0] : min[0],
+      (c & 2) ? max[1] : min[1],
+      (c & 4) ? max[2] : min[2]
+    };
+    float s[3];
+    if (!project(&mvp, corner, s)) return true;  // straddles the near plane
+
+    sx0 = fminf(sx0, s[0]); sx1 = fmaxf(sx1, s[0]);
+    sy0 = fminf(sy0, s[1]); sy1 = fmaxf(sy1, s[1]);
+    sz  = fminf(sz, s[2]);
+  }
+
+  int x0 = (int)floorf(sx0), x1 = (int)floorf(sx1);
+  int y0 = (int)floorf(sy0), y1 = (int)floorf(sy1);
+  if (x1 < 0 || y1 < 0 || x0 >= OCCLUSION_WIDTH || y0 >= OCCLUSION_HEIGHT) return false;
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > OCCLUSION_WIDTH - 1)  x1 = OCCLUSION_WIDTH - 1;
+  if (y1 > OCCLUSION_HEIGHT - 1) y1 = OCCLUSION_HEIGHT - 1;
+
+  // visible as soon as one covered texel is farther than the box's nearest point
+  for (int y = y0; y <= y1; y++) {
+    const float *row = &ob->depth[y * OCCLUSION_WIDTH];
+#if defined(__SSE__)
+    __m128 z    = _mm_set1_ps(sz);
+    __m128 lo   = _mm_set1_ps((float)x0);
+    __m128 hi   = _mm_set1_ps((float)x1);
+    __m128 lane = _mm_add_ps(_mm_set1_ps((float)(x0 & ~3)), _mm_setr_ps(0, 1, 2, 3));
+    for (int x = x0 & ~3; x <= x1; x += 4) {
+      __m128 in_rect = _mm_and_ps(_mm_cmpge_ps(lane, lo), _mm_cmple_ps(lane, hi));
+      __m128 behind  = _mm_cmple_ps(z, _mm_loadu_ps(&row[x]));
+      if (_mm_movemask_ps(_mm_and_ps(in_rect, behind))) return true;
+      lane = _mm_add_ps(lane, _mm_set1_ps(4.0f));
+    }
+#else
+    for (int x = x0; x <= x1; x++) {
+      if (sz <= row[x]) return true;
+    }
+#endif
+  }
+
+  return false;
+}
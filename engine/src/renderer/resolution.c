@@ -0,0 +1,126 @@
+#include <renderer/resolution.h>
+#include <opengl/shader.h>
+#include <string.h>
+#include <math.h>
+
+// fullscreen triangle from gl_VertexID, uv covers the rendered corner only
+static const char *upscale_vs =
+  "#version 330 core\n"
+  "uniform vec2 uUVScale;\n"
+  "out vec2 vUV;\n"
+  "void main() {\n"
+  "  vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+  "  vUV = p * uUVScale;\n"
+  "  gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+// bilinear upscale followed by contrast adaptive sharpening, which backs
+// off where the neighbourhood already has contrast to avoid ringing
+static const char *upscale_fs =
+  "#version 330 core\n"
+  "in vec2 vUV;\n"
+  "out vec4 FragColor;\n"
+  "uniform sampler2D uColor;\n"
+  "uniform vec2 uUVScale;\n"
+  "uniform vec2 uTexel;\n"
+  "uniform float uSharpness;\n"
+  "vec3 fetch(vec2 uv) {\n"
+  "  return texture(uColor, clamp(uv, 0.5 * uTexel, uUVScale - 0.5 * uTexel)).rgb;\n"
+  "}\n"
+  "void main() {\n"
+  "  vec3 c = fetch(vUV);\n"
+  "  if (uSharpness > 0.0) {\n"
+  "    vec3 n = fetch(vUV + vec2(0.0, uTexel.y));\n"
+  "    vec3 s = fetch(vUV - vec2(0.0, uTexel.y));\n"
+  "    vec3 e = fetch(vUV + vec2(uTexel.x, 0.0));\n"
+  "    vec3 w = fetch(vUV - vec2(uTexel.x, 0.0));\n"
+  "    vec3 mn = min(c, min(min(n, s), min(e, w)));\n"
+  "    vec3 mx = max(c, max(max(n, s), max(e, w)));\n"
+  "    vec3 amp = sqrt(clamp(min(mn, 1.0 - mx) / max(mx, vec3(1e-4)), 0.0, 1.0));\n"
+  "    vec3 k = -amp * mix(0.125, 0.2, uSharpness);\n"
+  "    c = clamp((c + k * (n + s + e + w)) / (1.0 + 4.0 * k), 0.0, 1.0);\n"
+  "  }\n"
+  "  FragColor = vec4(c, 1.0);\n"
+  "}\n";
+
+void resolution_scaler_init(resolution_scaler *rs) {
+  memset(rs, 0, sizeof(resolution_scaler));
+  rs->target_ms = 16.0f;
+  rs->scale = 1.0f;
+  resolution_scaler_set_preset(rs, RESOLUTION_PRESET_PERFORMANCE);
+}
+
+void resolution_scaler_destroy(resolution_scaler *rs) {
+  if (rs->program) {
+    glDeleteProgram(rs->program);
+    glDeleteVertexArrays(1, &rs->vao);
+  }
+  memset(rs, 0, sizeof(resolution_scaler));
+}
+
+void resolution_scaler_set_preset(resolution_scaler *rs, resolution_preset preset) {
+  rs->preset = preset;
+  rs->max_scale = 1.0f;
+  if (preset == RESOLUTION_PRESET_QUALITY) {
+    rs->min_scale = 0.7f;
+    rs->sharpness = 0.5f;
+  } else {
+    rs->min_scale = 0.5f;
+    rs->sharpness = 0.0f;
+  }
+  rs->scale = fminf(fmaxf(rs->scale, rs->min_scale), rs->max_scale);
+}
+
+void resolution_scaler_update(resolution_scaler *rs, float gpu_ms, uint64_t sample) {
+  if (gpu_ms <= 0.0f || sample == rs->last_sample) return;
+  rs->last_sample = sample;
+
+  // inside the dead band the scale holds still instead of hunting
+  float error = gpu_ms / rs->target_ms;
+  if (error > 0.95f && error < 1.05f) return;
+
+  // pixel cost grows with the square of the scale, the step is damped
+  // because measurements arrive a few frames after the change
+  float desired = rs->scale * sqrtf(1.0f / error);
+  rs->scale += 0.5f * (desired - rs->scale);
+  rs->scale = fminf(fmaxf(rs->scale, rs->min_scale), rs->max_scale);
+}
+
+void resolution_scaler_prepare(resolution_scaler *rs, int output_width, int output_height) {
+  rs->render_width  = (int)fmaxf(1.0f, roundf(rs->scale * (float)output_width));
+  rs->render_height = (int)fmaxf(1.0f, roundf(rs->scale * (float)output_height));
+}
+
+void resolution_scaler_upscale(resolution_scaler *rs, uint32_t texture,
+                               int target_width, int target_height) {
+  if (!rs->program) {
+    rs->program = make_program_from_sources(upscale_vs, upscale_fs);
+    rs->uv_scale_loc = glGetUniformLocation(rs->program, "uUVScale");
+    rs->texel_loc = glGetUniformLocation(rs->program, "uTexel");
+    rs->sharpness_loc = glGetUniformLocation(rs->program, "uSharpness");
+    glGenVertexArrays(1, &rs->vao);
+  }
+
+  GLint prev_program;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &prev_program);
+  GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+  GLboolean cull_face = glIsEnabled(GL_CULL_FACE);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+
+  glUseProgram(rs->program);
+  glUniform2f(rs->uv_scale_loc, (float)rs->render_width / (float)target_width,
+              (float)rs->render_height / (float)target_height);
+  glUniform2f(rs->texel_loc, 1.0f / (float)target_width, 1.0f / (float)target_height);
+  glUniform1f(rs->sharpness_loc, rs->sharpness);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glBindVertexArray(rs->vao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+
+  if (depth_test) glEnable(GL_DEPTH_TEST);
+  if (cull_face) glEnable(GL_CULL_FACE);
+  glUseProgram((GLuint)prev_program);
+}
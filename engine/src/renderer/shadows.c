@@ -0,0 +1,253 @@
+#include <renderer/shadows.h>
+#include <opengl/shader.h>
+#include <string.h>
+#include <math.h>
+
+static const char *depth_vs =
+  "#version 330 core\n"
+  "layout(location = 0) in vec3 aPos;\n"
+  "uniform mat4 uLightMVP;\n"
+  "void main() {\n"
+  "  gl_Position = uLightMVP * vec4(aPos, 1.0);\n"
+  "}\n";
+
+static const char *depth_fs =
+  "#version 330 core\n"
+  "void main() {}\n";
+
+void shadow_maps_init(shadow_maps *sm) {
+  memset(sm, 0, sizeof(shadow_maps));
+  sm->max_distance = 100.0f;
+  sm->split_lambda = 0.75f;
+  sm->depth_bias = 0.0005f;
+}
+
+void shadow_maps_destroy(shadow_maps *sm) {
+  if (sm->texture) {
+    glDeleteFramebuffers(SHADOW_CASCADES, sm->fbos);
+    glDeleteFramebuffers(SHADOW_CACHED_LAYERS, sm->cache_fbos);
+    glDeleteTextures(1, &sm->texture);
+    glDeleteTextures(1, &sm->cache_texture);
+    glDeleteProgram(sm->program);
+  }
+  if (sm->params_ubo) glDeleteBuffers(1, &sm->params_ubo);
+  memset(sm, 0, sizeof(shadow_maps));
+}
+
+static uint32_t create_depth_array(int layers, uint32_t *fbos) {
+  uint32_t texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, SHADOW_RESOLUTION, SHADOW_RESOLUTION,
+               layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  glGenFramebuffers(layers, fbos);
+  for (int l = 0; l < layers; l++) {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbos[l]);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, l);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+  return texture;
+}
+
+static void create_resources(shadow_maps *sm) {
+  GLint prev_fbo;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prev_fbo);
+  sm->texture = create_depth_array(SHADOW_CASCADES, sm->fbos);
+  sm->cache_texture = create_depth_array(SHADOW_CACHED_LAYERS, sm->cache_fbos);
+  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)prev_fbo);
+
+  sm->program = make_program_from_sources(depth_vs, depth_fs);
+  sm->mvp_loc = glGetUniformLocation(sm->program, "uLightMVP");
+}
+
+// bounding sphere of the view frustum slice between depths n and f, its size
+// does not change as the camera turns which keeps the cascade texels stable
+static float fit_slice(float n, float f, float tan_sq, float *center_depth) {
+  float a2 = n * n * tan_sq;
+  float b2 = f * f * tan_sq;
+  float c  = 0.5f * (n + f) + (b2 - a2) / (2.0f * (f - n));
+  if (c >= f) {
+    *center_depth = f;
+    return sqrtf(b2);
+  }
+  *center_depth = c;
+  return sqrtf((c - n) * (c - n) + a2);
+}
+
+static bool cascade_contains(const shadow_maps *sm, int c, vec3 lc, float r) {
+  return fabsf(lc.x - sm->center[c][0]) + r <= sm->radius[c] &&
+         fabsf(lc.y - sm->center[c][1]) + r <= sm->radius[c] &&
+         fabsf(lc.z - sm->center[c][2]) + r <= sm->radius[c];
+}
+
+void shadow_maps_update(shadow_maps *sm, const camera_component *cam, const light_component *light,
+                        uint64_t static_hash) {
+  sm->active = light && light->type == LIGHT_DIRECTIONAL && light->cast_shadows;
+  memset(sm->redraw, 0, sizeof(sm->redraw));
+  if (!sm->active) return;
+
+  if (!sm->texture) create_resources(sm);
+
+  vec3 dir = vec_normalize(light->direction);
+  if (vec_dot(dir, sm->cached_direction) < 0.99999f || static_hash != sm->cached_static_hash) {
+    memset(sm->valid, 0, sizeof(sm->valid));
+    sm->cached_direction = dir;
+    sm->cached_static_hash = static_hash;
+  }
+
+  vec3 up = fabsf(dir.y) > 0.99f ? (vec3){ 0.0f, 0.0f, 1.0f } : (vec3){ 0.0f, 1.0f, 0.0f };
+  vec3 origin = { 0.0f, 0.0f, 0.0f };
+  sm->light_rotation = look_at(origin, dir, up);
+
+  const mat4 *view = &cam->view_matrix;
+  mat4 inv_view = mat4_inverse(*view);
+  vec3 eye = { inv_view.m[0][3], inv_view.m[1][3], inv_view.m[2][3] };
+  vec3 forward = { -view->m[2][0], -view->m[2][1], -view->m[2][2] };
+
+  float near_plane = cam->near_plane;
+  float far_plane  = fminf(cam->far_plane, sm->max_distance);
+  float tan_x = 1.0f / cam->projection_matrix.m[0][0];
+  float tan_y = 1.0f / cam->projection_matrix.m[1][1];
+  float tan_sq = tan_x * tan_x + tan_y * tan_y;
+
+  for (int c = 0; c < SHADOW_CASCADES; c++) {
+    float p = (float)(c + 1) / SHADOW_CASCADES;
+    float log_split = near_plane * powf(far_plane / near_plane, p);
+    float uni_split = near_plane + (far_plane - near_plane) * p;
+    sm->splits[c] = sm->split_lambda * log_split + (1.0f - sm->split_lambda) * uni_split;
+  }
+
+  for (int c = 0; c < SHADOW_CASCADES; c++) {
+    float n = c == 0 ? near_plane : sm->splits[c - 1];
+    float f = sm->splits[c];
+
+    float center_depth;
+    float r = fit_slice(n, f, tan_sq, &center_depth);
+    r = ceilf(r * 16.0f) / 16.0f;
+
+    vec3 center = vec_sum(eye, vec_scale(forward, center_depth));
+    vec4 lc4 = mat4_vec_mult(sm->light_rotation, (vec4){ center.x, center.y, center.z, 1.0f });
+    vec3 lc = { lc4.x, lc4.y, lc4.z };
+
+    if (c >= SHADOW_CACHED_FROM) {
+      // cached cascades cover a padded region and only move once the slice leaves it
+      if (sm->valid[c] && cascade_contains(sm, c, lc, r)) continue;
+      r *= 1.25f;
+      sm->valid[c] = true;
+    }
+
+    float texel = 2.0f * r / SHADOW_RESOLUTION;
+    sm->radius[c] = r;
+    sm->center[c][0] = floorf(lc.x / texel) * texel;
+    sm->center[c][1] = floorf(lc.y / texel) * texel;
+    sm->center[c][2] = lc.z;
+    sm->redraw[c] = true;
+
+    // extend towards the light so casters outside the slice still land in the map
+    sm->depth_range[c][0] = -lc.z - r - sm->max_distance;
+    sm->depth_range[c][1] = -lc.z + r;
+
+    mat4 proj = ortho_mat4(sm->center[c][0] - r, sm->center[c][0] + r,
+                           sm->center[c][1] - r, sm->center[c][1] + r,
+                           sm->depth_range[c][0], sm->depth_range[c][1]);
+    sm->view_proj[c] = mat_mul(proj, sm->light_rotation);
+  }
+}
+
+bool shadow_maps_cascade_visible(const shadow_maps *sm, int cascade, vec3 center, float radius) {
+  vec4 lc = mat4_vec_mult(sm->light_rotation, (vec4){ center.x, center.y, center.z, 1.0f });
+  float r = sm->radius[cascade] + radius;
+  if (fabsf(lc.x - sm->center[cascade][0]) > r) return false;
+  if (fabsf(lc.y - sm->center[cascade][1]) > r) return false;
+  return -lc.z + radius >= sm->depth_range[cascade][0] &&
+         -lc.z - radius <= sm->depth_range[cascade][1];
+}
+
+static void begin_pass(shadow_maps *sm) {
+  if (sm->in_pass) return;
+
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sm->saved_fbo);
+  glGetIntegerv(GL_CURRENT_PROGRAM, &sm->saved_program);
+  glGetIntegerv(GL_VIEWPORT, sm->saved_viewport);
+
+  glUseProgram(sm->program);
+  glViewport(0, 0, SHADOW_RESOLUTION, SHADOW_RESOLUTION);
+  glEnable(GL_POLYGON_OFFSET_FILL);
+  glPolygonOffset(2.0f, 4.0f);
+  sm->in_pass = true;
+}
+
+void shadow_maps_begin_cascade(shadow_maps *sm, int cascade, bool cache) {
+  begin_pass(sm);
+  if (cache) {
+    glBindFramebuffer(GL_FRAMEBUFFER, sm->cache_fbos[cascade - SHADOW_CACHED_FROM]);
+  } else {
+    glBindFramebuffer(GL_FRAMEBUFFER, sm->fbos[cascade]);
+  }
+  glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void shadow_maps_restore_cache(shadow_maps *sm, int cascade) {
+  begin_pass(sm);
+  glCopyImageSubData(sm->cache_texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade - SHADOW_CACHED_FROM,
+                     sm->texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, cascade,
+                     SHADOW_RESOLUTION, SHADOW_RESOLUTION, 1);
+  glBindFramebuffer(GL_FRAMEBUFFER, sm->fbos[cascade]);
+}
+
+void shadow_maps_set_model(shadow_maps *sm, int cascade, const mat4 *model) {
+  mat4 mvp = mat_mul(sm->view_proj[cascade], *model);
+  glUniformMatrix4fv(sm->mvp_loc, 1, GL_TRUE, &mvp.m[0][0]);
+}
+
+void shadow_maps_end(shadow_maps *sm) {
+  if (!sm->in_pass) return;
+
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)sm->saved_fbo);
+  glViewport(sm->saved_viewport[0], sm->saved_viewport[1], sm->saved_viewport[2], sm->saved_viewport[3]);
+  glUseProgram((GLuint)sm->saved_program);
+  sm->in_pass = false;
+}
+
+void shadow_maps_bind(shadow_maps *sm) {
+  shadow_params params = {0};
+
+  if (sm->active) {
+    // ndc to texture space
+    mat4 bias = mat4_identity();
+    for (int k = 0; k < 3; k++) {
+      bias.m[k][k] = 0.5f;
+      bias.m[k][3] = 0.5f;
+    }
+
+    for (int c = 0; c < SHADOW_CASCADES; c++) {
+      mat4 m = mat_mul(bias, sm->view_proj[c]);
+      memcpy(params.matrices[c], &m.m[0][0], sizeof(params.matrices[c]));
+      params.splits[c] = sm->splits[c];
+      params.texel_sizes[c] = 2.0f * sm->radius[c] / SHADOW_RESOLUTION;
+    }
+    params.info[0] = 1.0f;
+    params.info[1] = sm->depth_bias;
+    params.info[2] = (float)SHADOW_CASCADES;
+
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, sm->texture);
+    glActiveTexture(GL_TEXTURE0);
+  }
+
+  if (!sm->params_ubo) glGenBuffers(1, &sm->params_ubo);
+  glBindBuffer(GL_UNIFORM_BUFFER, sm->params_ubo);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(shadow_params), &params, GL_STREAM_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_PARAMS_BINDING, sm->params_ubo);
+}
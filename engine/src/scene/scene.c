@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <opengl/glad.h>
 #include <scene/scene.h>
 #include <components/transform.h>
@@ -8,9 +9,31 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+
+// streamed uploads are written in pieces this size so the time budget is
+// checked between them
+#define STREAM_CHUNK (256 * 1024)
 
 extern int width, height;
-extern GLint model_loc, view_loc, proj_loc, normal_loc;
+
+// per draw scratch for meshlet culling
+static uint8_t      *meshlet_visible;
+static GLsizei      *range_counts;
+static const void  **range_offsets;
+static size_t        meshlet_scratch_capacity;
+
+// visible opaque draws of the current frame, nearest first
+typedef struct {
+  mesh_renderer_component *mr;
+  mat4   world;
+  size_t lod;
+  float  distance;
+} scene_draw;
+
+static scene_draw *draws;
+static size_t      draw_count;
+static size_t      draw_capacity;
 
 void scene_init(scene *s) {
   memset(s, 0, sizeof(scene));
@@ -30,18 +53,45 @@ void scene_init(scene *s) {
   s->controllers = calloc(s->controller_capacity, sizeof(controller_component));
 
   s->active_camera = ENTITY_NULL;
+  s->lod_threshold = 1.0f;
+  s->cluster_culling = true;
+  s->occlusion_culling = false;
+  s->clustered_lighting = false;
+  s->gpu_profiling = false;
+  s->dynamic_resolution = false;
+  s->depth_prepass = false;
+  s->upload_budget_bytes = 4 << 20;
+  s->upload_budget_ms = 2.0f;
+  occlusion_init(&s->occlusion);
+  light_clusters_init(&s->clusters);
+  shadow_maps_init(&s->shadows);
+  gpu_profiler_init(&s->profiler);
+  resolution_scaler_init(&s->resolution);
+  frame_graph_init(&s->graph);
+  depth_prepass_init(&s->prepass);
 }
 
 void scene_destroy(scene *s) {
   for (size_t i = 0; i < s->mesh_renderer_count; i++) {
     mesh_renderer_component_cleanup(&s->mesh_renderers[i]);
   }
+  for (size_t i = 0; i < s->stream_count; i++) {
+    asset_release(s->streams[i].asset);
+  }
 
+  free(s->streams);
   free(s->transforms);
   free(s->mesh_renderers);
   free(s->lights);
   free(s->cameras);
   free(s->controllers);
+  occlusion_destroy(&s->occlusion);
+  light_clusters_destroy(&s->clusters);
+  shadow_maps_destroy(&s->shadows);
+  gpu_profiler_destroy(&s->profiler);
+  resolution_scaler_destroy(&s->resolution);
+  frame_graph_destroy(&s->graph);
+  depth_prepass_destroy(&s->prepass);
 }
 
 entity_id scene_create_entity(scene *s) {
@@ -149,6 +199,134 @@ controller_component* scene_get_controller(scene *s, entity_id id) {
   return NULL;
 }
 
+size_t scene_replace_mesh(scene *s, mesh *m, mesh *fresh) {
+  destroy_mesh(m);
+  *m = *fresh;
+  memset(fresh, 0, sizeof(mesh));
+
+  // uploads still reading the old streams start over from the new ones
+  for (size_t i = 0; i < s->stream_count; i++) {
+    mesh_stream *st = &s->streams[i];
+    if (!st->done && asset_mesh(st->asset) == m) st->uploading = false;
+  }
+
+  size_t uploaded = 0;
+  for (size_t i = 0; i < s->mesh_renderer_count; i++) {
+    mesh_renderer_component *mr = &s->mesh_renderers[i];
+    if (mr->mesh_data != m) continue;
+    mesh_renderer_component_upload(mr, m, mr->format);
+    uploaded++;
+  }
+  return uploaded;
+}
+
+mesh_renderer_component* scene_stream_mesh(scene *s, entity_id id, asset_handle asset,
+                                           vertex_format format, mesh *placeholder) {
+  mesh_renderer_component *mr = scene_get_mesh_renderer(s, id);
+  if (!mr) mr = scene_add_mesh_renderer(s, id);
+  if (placeholder) mesh_renderer_component_upload(mr, placeholder, format);
+
+  if (s->stream_count >= s->stream_capacity) {
+    s->stream_capacity = s->stream_capacity ? s->stream_capacity * 2 : 16;
+    s->streams = realloc(s->streams, s->stream_capacity * sizeof(mesh_stream));
+  }
+  s->streams[s->stream_count++] = (mesh_stream){
+    .entity = id, .asset = asset_retain(asset), .format = format
+  };
+  return mr;
+}
+
+static double elapsed_ms(const struct timespec *since) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double)(now.tv_sec - since->tv_sec) * 1e3 + (double)(now.tv_nsec - since->tv_nsec) * 1e-6;
+}
+
+// moves ready assets onto the gpu, at most upload_budget_bytes and about
+// upload_budget_ms per frame, the first piece always goes so nothing starves
+static void stream_meshes(scene *s) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  size_t budget = s->upload_budget_bytes;
+
+  for (size_t i = 0; i < s->stream_count; i++) {
+    mesh_stream *st = &s->streams[i];
+    if (st->done) continue;
+
+    asset_state state = asset_get_state(st->asset);
+    if (state == ASSET_LOADING) {
+      s->stats.streams_pending++;
+      continue;
+    }
+    mesh_renderer_component *mr = scene_get_mesh_renderer(s, st->entity);
+    if (state != ASSET_READY || !mr) {
+      st->done = true;
+      continue;
+    }
+
+    if (!st->uploading) {
+      if (!mesh_renderer_component_upload_begin(mr, asset_mesh(st->asset), st->format)) {
+        st->done = true;
+        continue;
+      }
+      st->uploading = true;
+    }
+    while (mr->upload && budget > 0 &&
+           (s->stats.bytes_streamed == 0 || elapsed_ms(&start) < s->upload_budget_ms)) {
+      size_t n = mesh_renderer_component_upload_step(mr, budget < STREAM_CHUNK ? budget : STREAM_CHUNK);
+      budget -= n;
+      s->stats.bytes_streamed += n;
+    }
+    if (mr->upload) {
+      s->stats.streams_pending++;
+    } else {
+      st->done = true;
+    }
+  }
+}
+
+// transforms rotate by z * y * x, glTF nodes by a quaternion
+static vec3 quat_to_euler(const float q[4]) {
+  float x = q[0], y = q[1], z = q[2], w = q[3];
+  float r20 = 2.0f * (x*z - w*y);
+  if (fabsf(r20) > 0.99999f) {
+    // gimbal lock, x folds into z
+    float r01 = 2.0f * (x*y - w*z), r11 = 1.0f - 2.0f * (x*x + z*z);
+    return (vec3){ 0.0f, r20 > 0.0f ? -PI / 2 : PI / 2, atan2f(-r01, r11) };
+  }
+  return (vec3){
+    atan2f(2.0f * (y*z + w*x), 1.0f - 2.0f * (x*x + y*y)),
+    asinf(-r20),
+    atan2f(2.0f * (x*y + w*z), 1.0f - 2.0f * (y*y + z*z))
+  };
+}
+
+size_t scene_instantiate_gltf(scene *s, gltf_model *model, entity_id parent, vertex_format format,
+                              entity_id *out) {
+  entity_id *entities = malloc((model->node_count ? model->node_count : 1) * sizeof(entity_id));
+
+  for (size_t i = 0; i < model->node_count; i++) {
+    const gltf_node *node = &model->nodes[i];
+    entities[i] = scene_create_entity(s);
+
+    transform_component *t = scene_add_transform(s, entities[i]);
+    t->parent = node->parent >= 0 ? entities[node->parent] : parent;
+    t->position = (vec3){ node->translation[0], node->translation[1], node->translation[2] };
+    t->rotation = quat_to_euler(node->rotation);
+    t->scale = (vec3){ node->scale[0], node->scale[1], node->scale[2] };
+    t->dirty = true;
+
+    if (node->mesh >= 0 && model->meshes[node->mesh].positions) {
+      mesh_renderer_component *mr = scene_add_mesh_renderer(s, entities[i]);
+      mesh_renderer_component_upload(mr, &model->meshes[node->mesh], format);
+    }
+  }
+
+  if (out) memcpy(out, entities, model->node_count * sizeof(entity_id));
+  free(entities);
+  return model->node_count;
+}
+
 void scene_update_transforms(scene *s) {
   for (size_t i = 0; i < s->transform_count; i++) {
     transform_component *t = &s->transforms[i];
@@ -162,9 +340,286 @@ void scene_update_transforms(scene *s) {
   }
 }
 
-void scene_render(scene *s) {
-  camera_component *cam = scene_get_camera(s, s->active_camera);
-  if (!cam) return;
+static vec3 camera_position(const camera_component *cam) {
+  const mat4 *v = &cam->view_matrix;
+  vec3 t = { v->m[0][3], v->m[1][3], v->m[2][3] };
+  return (vec3){
+    -(v->m[0][0] * t.x + v->m[1][0] * t.y + v->m[2][0] * t.z),
+    -(v->m[0][1] * t.x + v->m[1][1] * t.y + v->m[2][1] * t.z),
+    -(v->m[0][2] * t.x + v->m[1][2] * t.y + v->m[2][2] * t.z)
+  };
+}
+
+// bounding sphere of the mesh under world, also returns the largest axis scale
+static float world_bounds(const mesh *m, const mat4 *world, vec3 *center, float *scale) {
+  vec4 local_center = {
+    0.5f * (m->bounds_min[0] + m->bounds_max[0]),
+    0.5f * (m->bounds_min[1] + m->bounds_max[1]),
+    0.5f * (m->bounds_min[2] + m->bounds_max[2]),
+    1.0f
+  };
+  vec4 c = mat4_vec_mult(*world, local_center);
+  *center = (vec3){ c.x, c.y, c.z };
+
+  *scale = 0.0f;
+  for (int k = 0; k < 3; k++) {
+    vec3 axis = { world->m[0][k], world->m[1][k], world->m[2][k] };
+    *scale = fmaxf(*scale, vec_length(axis));
+  }
+
+  vec3 extent = {
+    m->bounds_max[0] - m->bounds_min[0],
+    m->bounds_max[1] - m->bounds_min[1],
+    m->bounds_max[2] - m->bounds_min[2]
+  };
+  return 0.5f * vec_length(extent) * *scale;
+}
+
+// coarsest level whose projected error stays under the scene threshold
+static size_t select_lod(scene *s, mesh_renderer_component *mr, const mat4 *world,
+                         vec3 eye, float pixels_per_unit) {
+  if (mr->lod_count < 2) return 0;
+
+  vec3 world_center;
+  float scale;
+  float radius = world_bounds(mr->mesh_data, world, &world_center, &scale);
+  float dist = vec_distance(world_center, eye) - radius;
+  if (dist <= 0.0f) return 0;
+
+  for (size_t l = mr->lod_count - 1; l > 0; l--) {
+    float screen_error = mr->lods[l].error * scale * pixels_per_unit / dist;
+    if (screen_error <= s->lod_threshold) return l;
+  }
+  return 0;
+}
+
+// world matrix as seen by the vertex shader, which for quantized positions
+// also maps the unorm16 range back onto the mesh bounds
+static mat4 vertex_model(const mesh_renderer_component *mr, const mat4 *world) {
+  if (mr->format != VERTEX_FORMAT_PACKED_QUANTIZED) return *world;
+
+  const mesh *m = mr->mesh_data;
+  mat4 dequant = mat4_identity();
+  for (int k = 0; k < 3; k++) {
+    dequant.m[k][k] = m->bounds_max[k] - m->bounds_min[k];
+    dequant.m[k][3] = m->bounds_min[k];
+  }
+  return mat_mul(*world, dequant);
+}
+
+static void extract_frustum_planes(const mat4 *clip, float planes[6][4]) {
+  for (int p = 0; p < 6; p++) {
+    int row = p / 2;
+    float sign = (p % 2) ? -1.0f : 1.0f;
+    for (int c = 0; c < 4; c++) {
+      planes[p][c] = clip->m[3][c] + sign * clip->m[row][c];
+    }
+    float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] +
+                      planes[p][2] * planes[p][2]);
+    if (len > 0.0f) {
+      for (int c = 0; c < 4; c++) planes[p][c] /= len;
+    }
+  }
+}
+
+// draws the meshlets of the full detail level that survive culling,
+// merging neighbouring survivors into one range
+static void draw_meshlets(scene *s, mesh_renderer_component *mr, const mat4 *world,
+                          const camera_component *cam, vec3 eye, size_t index_size) {
+  mesh *m = mr->mesh_data;
+
+  if (m->meshlet_count > meshlet_scratch_capacity) {
+    meshlet_scratch_capacity = m->meshlet_count;
+    meshlet_visible = realloc(meshlet_visible, meshlet_scratch_capacity * sizeof(uint8_t));
+    range_counts    = realloc(range_counts, meshlet_scratch_capacity * sizeof(GLsizei));
+    range_offsets   = realloc(range_offsets, meshlet_scratch_capacity * sizeof(void *));
+  }
+
+  mat4 clip = mat_mul(cam->projection_matrix, mat_mul(cam->view_matrix, *world));
+  float planes[6][4];
+  extract_frustum_planes(&clip, planes);
+
+  vec4 local_eye = mat4_vec_mult(mat4_inverse(*world), (vec4){ eye.x, eye.y, eye.z, 1.0f });
+  float eye_ms[3] = { local_eye.x, local_eye.y, local_eye.z };
+
+  size_t visible = mesh_cull_meshlets(m, (const float (*)[4])planes, eye_ms, meshlet_visible);
+  s->stats.meshlets_visible += visible;
+  s->stats.meshlets_culled  += m->meshlet_count - visible;
+
+  size_t ranges = 0;
+  for (size_t i = 0; i < m->meshlet_count; i++) {
+    if (!meshlet_visible[i]) continue;
+
+    const meshlet *ml = &m->meshlets[i];
+    GLsizei count = (GLsizei)(ml->triangle_count * 3);
+    s->stats.triangles_rendered += ml->triangle_count;
+
+    if (i > 0 && meshlet_visible[i - 1]) {
+      range_counts[ranges - 1] += count;
+    } else {
+      range_counts[ranges]  = count;
+      range_offsets[ranges] = (const void *)(ml->index_offset * index_size);
+      ranges++;
+    }
+  }
+
+  if (ranges) {
+    glMultiDrawElements(GL_TRIANGLES, range_counts, mr->index_type, range_offsets, (GLsizei)ranges);
+    s->stats.draw_calls++;
+  }
+}
+
+// rasterizes every occluder into the cpu depth buffer ahead of the draws
+static void render_occluders(scene *s, const camera_component *cam) {
+  mat4 view_proj = mat_mul(cam->projection_matrix, cam->view_matrix);
+  occlusion_begin(&s->occlusion, &view_proj);
+
+  for (size_t i = 0; i < s->mesh_renderer_count; i++) {
+    mesh_renderer_component *mr = &s->mesh_renderers[i];
+    if (!mr->occluder || !mr->mesh_data) continue;
+
+    transform_component *t = scene_get_transform(s, mr->entity);
+    if (!t) continue;
+
+    occlusion_add_occluder(&s->occlusion, mr->mesh_data, &t->world_matrix);
+  }
+
+  s->stats.occluder_triangles = s->occlusion.triangle_count;
+  occlusion_rasterize(&s->occlusion);
+}
+
+static uint64_t static_geometry_hash(scene *s) {
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < s->mesh_renderer_count; i++) {
+    mesh_renderer_component *mr = &s->mesh_renderers[i];
+    if (!mr->is_static || !mr->mesh_data || !mr->initialized) continue;
+
+    transform_component *t = scene_get_transform(s, mr->entity);
+    if (!t) continue;
+
+    const unsigned char *bytes[3] = { (const unsigned char *)&mr->mesh_data,
+                                      (const unsigned char *)&mr->revision,
+                                      (const unsigned char *)&t->world_matrix };
+    size_t sizes[3] = { sizeof(mr->mesh_data), sizeof(mr->revision), sizeof(t->world_matrix) };
+    for (int b = 0; b < 3; b++) {
+      for (size_t k = 0; k < sizes[b]; k++) {
+        h = (h ^ bytes[b][k]) * 1099511628211ull;
+      }
+    }
+  }
+  return h;
+}
+
+typedef enum {
+  SHADOW_CASTERS_ALL,
+  SHADOW_CASTERS_STATIC,
+  SHADOW_CASTERS_DYNAMIC
+} shadow_casters;
+
+// draws the casters inside the cascade, or only counts them when draw is false
+static size_t draw_shadow_casters(scene *s, int cascade, shadow_casters which, bool draw) {
+  size_t count = 0;
+  for (size_t i = 0; i < s->mesh_renderer_count; i++) {
+    mesh_renderer_component *mr = &s->mesh_renderers[i];
+    if (!mr->mesh_data || !mr->initialized) continue;
+    if (which == SHADOW_CASTERS_STATIC && !mr->is_static) continue;
+    if (which == SHADOW_CASTERS_DYNAMIC && mr->is_static) continue;
+
+    transform_component *t = scene_get_transform(s, mr->entity);
+    if (!t) continue;
+
+    vec3 center;
+    float scale;
+    float radius = world_bounds(mr->mesh_data, &t->world_matrix, &center, &scale);
+    if (!shadow_maps_cascade_visible(&s->shadows, cascade, center, radius)) continue;
+
+    count++;
+    if (!draw) continue;
+
+    mat4 model = vertex_model(mr, &t->world_matrix);
+    shadow_maps_set_model(&s->shadows, cascade, &model);
+
+    size_t index_size = mr->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    glBindVertexArray(mr->vao);
+    glDrawElements(GL_TRIANGLES, (GLsizei)mr->lods[0].index_count, mr->index_type,
+                   (void*)(mr->lods[0].index_offset * index_size));
+    s->stats.shadow_draw_calls++;
+  }
+  return count;
+}
+
+// near cascades redraw every frame, cached cascades only re-render their
+// static casters when invalidated and draw dynamic casters over a copy
+static void render_shadows(scene *s, const camera_component *cam) {
+  light_component *sun = NULL;
+  for (size_t i = 0; i < s->light_count; i++) {
+    if (s->lights[i].type == LIGHT_DIRECTIONAL && s->lights[i].cast_shadows) {
+      sun = &s->lights[i];
+      break;
+    }
+  }
+
+  shadow_maps *sm = &s->shadows;
+  shadow_maps_update(sm, cam, sun, static_geometry_hash(s));
+
+  for (int c = 0; sm->active && c < SHADOW_CASCADES; c++) {
+    if (c < SHADOW_CACHED_FROM) {
+      shadow_maps_begin_cascade(sm, c, false);
+      draw_shadow_casters(s, c, SHADOW_CASTERS_ALL, true);
+      s->stats.shadow_cascades_rendered++;
+      continue;
+    }
+
+    if (sm->redraw[c]) {
+      shadow_maps_begin_cascade(sm, c, true);
+      draw_shadow_casters(s, c, SHADOW_CASTERS_STATIC, true);
+      s->stats.shadow_cascades_rendered++;
+    }
+
+    bool dynamic = draw_shadow_casters(s, c, SHADOW_CASTERS_DYNAMIC, false) > 0;
+    if (dynamic || sm->redraw[c] || sm->has_dynamic[c]) {
+      shadow_maps_restore_cache(sm, c);
+      draw_shadow_casters(s, c, SHADOW_CASTERS_DYNAMIC, true);
+    }
+    sm->has_dynamic[c] = dynamic;
+  }
+
+  shadow_maps_end(sm);
+  shadow_maps_bind(sm);
+}
+
+// per frame state shared by the passes of the frame graph
+typedef struct {
+  scene            *s;
+  camera_component *cam;
+  int              view_width, view_height;
+  bool             offscreen;
+  fg_handle        color;
+} scene_frame;
+
+static void shadow_pass(frame_graph *fg, void *ctx) {
+  (void)fg;
+  scene_frame *f = ctx;
+  render_shadows(f->s, f->cam);
+}
+
+static int compare_draws(const void *a, const void *b) {
+  float da = ((const scene_draw *)a)->distance;
+  float db = ((const scene_draw *)b)->distance;
+  return (da > db) - (da < db);
+}
+
+// gathers the draws surviving occlusion with their lod, sorted front to back
+// so early depth testing rejects as much as possible in whichever pass runs first
+static void collect_draws(scene *s, const camera_component *cam, int view_height) {
+  if (s->mesh_renderer_count > draw_capacity) {
+    draw_capacity = s->mesh_renderer_count;
+    draws = realloc(draws, draw_capacity * sizeof(scene_draw));
+  }
+  draw_count = 0;
+
+  vec3 eye = camera_position(cam);
+  float pixels_per_unit = cam->projection_matrix.m[1][1] * 0.5f * (float)view_height;
 
   for (size_t i = 0; i < s->mesh_renderer_count; i++) {
     mesh_renderer_component *mr = &s->mesh_renderers[i];
@@ -173,15 +628,242 @@ void scene_render(scene *s) {
     transform_component *t = scene_get_transform(s, mr->entity);
     if (!t) continue;
 
-    mat4 model = t->world_matrix;
-    mat4 normal_mat = mat4_transpose(mat4_inverse(model));
+    mat4 world = t->world_matrix;
+    if (s->occlusion_culling && !mr->occluder &&
+        !occlusion_test_aabb(&s->occlusion, mr->mesh_data->bounds_min,
+                             mr->mesh_data->bounds_max, &world)) {
+      s->stats.objects_occluded++;
+      continue;
+    }
+
+    vec3 center;
+    float scale;
+    float radius = world_bounds(mr->mesh_data, &world, &center, &scale);
+    draws[draw_count++] = (scene_draw){
+      mr, world, select_lod(s, mr, &world, eye, pixels_per_unit),
+      vec_distance(center, eye) - radius
+    };
+  }
+
+  qsort(draws, draw_count, sizeof(scene_draw), compare_draws);
+}
+
+static size_t draw_index_size(const mesh_renderer_component *mr) {
+  return mr->index_type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// the offscreen target is output sized, only its corner is rendered
+static void begin_offscreen(const scene_frame *f, GLbitfield clear) {
+  if (!f->offscreen) return;
+  glViewport(0, 0, f->view_width, f->view_height);
+  glClear(clear);
+}
+
+// lays down depth for the same lods the lit pass draws, meshlets are not culled
+// here since the triangles culling would drop produce no fragments anyway
+static void prepass_pass(frame_graph *fg, void *ctx) {
+  (void)fg;
+  scene_frame *f = ctx;
+  scene *s = f->s;
+
+  begin_offscreen(f, GL_DEPTH_BUFFER_BIT);
+  depth_prepass_begin(&s->prepass, &f->cam->view_matrix, &f->cam->projection_matrix);
+
+  for (size_t i = 0; i < draw_count; i++) {
+    const scene_draw *d = &draws[i];
+    mat4 model = vertex_model(d->mr, &d->world);
+    depth_prepass_set_model(&s->prepass, &model);
+
+    glBindVertexArray(d->mr->vao);
+    glDrawElements(GL_TRIANGLES, (GLsizei)d->mr->lods[d->lod].index_count, d->mr->index_type,
+                   (void*)(d->mr->lods[d->lod].index_offset * draw_index_size(d->mr)));
+    s->stats.prepass_draw_calls++;
+  }
+
+  depth_prepass_end(&s->prepass);
+}
 
-    glUniformMatrix4fv(model_loc, 1, GL_TRUE, &model.m[0][0]);
-    glUniformMatrix4fv(view_loc, 1, GL_TRUE, &cam->view_matrix.m[0][0]);
-    glUniformMatrix4fv(proj_loc, 1, GL_TRUE, &cam->projection_matrix.m[0][0]);
-    glUniformMatrix4fv(normal_loc, 1, GL_TRUE, &normal_mat.m[0][0]);
+// the cheapest variant drawing mr with the scene's lighting this frame
+static uint32_t draw_features(const scene *s, const mesh_renderer_component *mr) {
+  uint32_t features = 0;
+  if (mr->format != VERTEX_FORMAT_FLOAT) features |= LIT_PACKED_NORMALS;
+  if (mr->flat_shading) features |= LIT_FLAT_SHADING;
+  if (s->clustered_lighting) {
+    features |= LIT_CLUSTERED;
+    if (s->shadows.active) features |= LIT_SHADOWS;
+  }
+  return features;
+}
+
+// uniforms shared by every draw of the pass, uploaded whenever a draw
+// switches variant. unclustered variants are lit by the first light
+static void bind_lit_variant(scene *s, const lit_variant *v, const camera_component *cam, vec3 eye) {
+  glUniformMatrix4fv(v->view_loc, 1, GL_TRUE, &cam->view_matrix.m[0][0]);
+  glUniformMatrix4fv(v->proj_loc, 1, GL_TRUE, &cam->projection_matrix.m[0][0]);
+  glUniform3fv(v->ambient_loc, 1, &s->ambient.x);
+
+  if (v->light_pos_loc < 0 || s->light_count == 0) return;
+  const light_component *l = &s->lights[0];
+  vec3 pos = l->position;
+  if (l->type == LIGHT_DIRECTIONAL) {
+    pos = vec_sum(eye, vec_scale(vec_normalize(l->direction), -cam->far_plane));
+  }
+  vec3 color = vec_scale(l->color, l->intensity);
+  glUniform3fv(v->light_pos_loc, 1, &pos.x);
+  glUniform3fv(v->light_color_loc, 1, &color.x);
+  glUniform3fv(v->view_pos_loc, 1, &eye.x);
+}
+
+static void opaque_pass(frame_graph *fg, void *ctx) {
+  (void)fg;
+  scene_frame *f = ctx;
+  scene *s = f->s;
+  camera_component *cam = f->cam;
+
+  // after the prepass only the nearest surface of each pixel passes
+  if (s->depth_prepass) {
+    begin_offscreen(f, GL_COLOR_BUFFER_BIT);
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+  } else {
+    begin_offscreen(f, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
+
+  vec3 eye = camera_position(cam);
+  const lit_variant *v = NULL;
+  uint32_t bound = UINT32_MAX;
+
+  for (size_t i = 0; i < draw_count; i++) {
+    scene_draw *d = &draws[i];
+    mesh_renderer_component *mr = d->mr;
+
+    uint32_t features = draw_features(s, mr);
+    if (features != bound) {
+      bound = features;
+      v = lit_shaders_use(&s->lit, features);
+      if (v) bind_lit_variant(s, v, cam, eye);
+    }
+    if (!v) continue;
+
+    mat4 model = vertex_model(mr, &d->world);
+    mat4 normal_mat = mat4_transpose(mat4_inverse(d->world));
+    glUniformMatrix4fv(v->model_loc, 1, GL_TRUE, &model.m[0][0]);
+    glUniformMatrix4fv(v->normal_loc, 1, GL_TRUE, &normal_mat.m[0][0]);
+    glUniform3fv(v->color_loc, 1, mr->color);
 
     glBindVertexArray(mr->vao);
-    glDrawElements(GL_TRIANGLES, (GLsizei)*mr->mesh_data->idx_count, GL_UNSIGNED_INT, 0);
+    size_t index_size = draw_index_size(mr);
+    s->stats.triangles_submitted += mr->lods[d->lod].index_count / 3;
+
+    if (d->lod == 0 && s->cluster_culling && mr->mesh_data->meshlet_count) {
+      draw_meshlets(s, mr, &d->world, cam, eye, index_size);
+      continue;
+    }
+
+    glDrawElements(GL_TRIANGLES, (GLsizei)mr->lods[d->lod].index_count, mr->index_type,
+                   (void*)(mr->lods[d->lod].index_offset * index_size));
+    s->stats.triangles_rendered += mr->lods[d->lod].index_count / 3;
+    s->stats.draw_calls++;
+  }
+
+  if (s->depth_prepass) {
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+  }
+}
+
+static void upscale_pass(frame_graph *fg, void *ctx) {
+  scene_frame *f = ctx;
+  resolution_scaler_upscale(&f->s->resolution, frame_graph_texture(fg, f->color), width, height);
+}
+
+void scene_render(scene *s) {
+  camera_component *cam = scene_get_camera(s, s->active_camera);
+  if (!cam) return;
+
+  memset(&s->stats, 0, sizeof(s->stats));
+  if (s->stream_count) stream_meshes(s);
+
+  // the resolution controller is driven by the profiler's frame times
+  gpu_profiler *prof = &s->profiler;
+  bool profiling = s->gpu_profiling || s->dynamic_resolution;
+  if (profiling) {
+    gpu_profiler_begin_frame(prof);
+    s->stats.gpu_frame_ms = prof->frame_ms;
+  }
+
+  scene_frame frame = { s, cam, width, height, s->dynamic_resolution, FG_HANDLE_NONE };
+  s->stats.resolution_scale = 1.0f;
+  if (s->dynamic_resolution) {
+    resolution_scaler_update(&s->resolution, prof->frame_ms, prof->result_frame);
+    resolution_scaler_prepare(&s->resolution, width, height);
+    frame.view_width = s->resolution.render_width;
+    frame.view_height = s->resolution.render_height;
+    s->stats.resolution_scale = s->resolution.scale;
+  }
+
+  if (s->occlusion_culling) {
+    render_occluders(s, cam);
+  }
+
+  if (s->clustered_lighting) {
+    gpu_profiler_begin(prof, "clusters");
+    light_clusters_build(&s->clusters, s->lights, s->light_count, cam,
+                         frame.view_width, frame.view_height);
+    light_clusters_bind(&s->clusters);
+    s->stats.light_references = s->clusters.index_count;
+    gpu_profiler_end(prof);
+  }
+
+  collect_draws(s, cam, frame.view_height);
+
+  GLint output_fbo;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &output_fbo);
+
+  frame_graph *fg = &s->graph;
+  fg->profiler = profiling ? prof : NULL;
+  frame_graph_reset(fg);
+
+  fg_handle output = frame_graph_import_framebuffer(fg, "output", (uint32_t)output_fbo, width, height);
+  fg_handle shadow_map = frame_graph_import_texture(fg, "shadow_map", s->shadows.texture);
+
+  // shadow_maps_bind also uploads the disabled state, so the pass always runs
+  fg_handle shadows = frame_graph_add_pass(fg, "shadows", shadow_pass, &frame);
+  frame_graph_write(fg, shadows, shadow_map);
+
+  // the prepass and the lit pass share one depth target
+  fg_handle depth = output;
+  if (frame.offscreen) {
+    frame.color = frame_graph_create_texture(fg, "scene_color", width, height, GL_RGBA8);
+    depth = frame_graph_create_texture(fg, "scene_depth", width, height, GL_DEPTH_COMPONENT24);
+  }
+
+  if (s->depth_prepass) {
+    fg_handle prepass = frame_graph_add_pass(fg, "depth prepass", prepass_pass, &frame);
+    frame_graph_write(fg, prepass, depth);
+  }
+
+  fg_handle opaque = frame_graph_add_pass(fg, "opaque", opaque_pass, &frame);
+  frame_graph_read(fg, opaque, shadow_map);
+  if (s->depth_prepass) {
+    frame_graph_read(fg, opaque, depth);
+  }
+
+  if (frame.offscreen) {
+    frame_graph_write(fg, opaque, frame.color);
+    frame_graph_write(fg, opaque, depth);
+
+    fg_handle upscale = frame_graph_add_pass(fg, "upscale", upscale_pass, &frame);
+    frame_graph_read(fg, upscale, frame.color);
+    frame_graph_write(fg, upscale, output);
+  } else {
+    frame_graph_write(fg, opaque, output);
+  }
+
+  frame_graph_compile(fg);
+  frame_graph_execute(fg);
+
+  if (profiling) {
+    gpu_profiler_end_frame(prof);
   }
 }
@@ -0,0 +1,220 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/archive.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../check.h"
+
+#define BIG_SIZE   200000  // four chunks, compresses well
+#define NOISE_SIZE 70000   // does not compress, so it is stored
+
+static char dir[] = "/tmp/atom_archive_XXXXXX";
+static uint8_t big[BIG_SIZE];
+static uint8_t noise[NOISE_SIZE];
+
+// a few results stay valid at once, enough for one archive_source list
+static const char *path_of(const char *name) {
+  static char path[8][256];
+  static int next;
+  char *p = path[next++ & 7];
+  snprintf(p, sizeof(path[0]), "%s/%s", dir, name);
+  return p;
+}
+
+static void write_file(const char *path, const void *data, size_t size) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return;
+  fwrite(data, 1, size, f);
+  fclose(f);
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return NULL;
+  fseek(f, 0, SEEK_END);
+  *size = (size_t)ftell(f);
+  rewind(f);
+  uint8_t *data = malloc(*size);
+  if (fread(data, 1, *size, f) != *size) *size = 0;
+  fclose(f);
+  return data;
+}
+
+static bool maps_to(archive *a, const char *name, const uint8_t *expected, size_t size) {
+  asset_file f;
+  if (!archive_map(a, name, false, &f)) return false;
+  bool same = f.size == size && (size == 0 || memcmp(f.data, expected, size) == 0);
+  asset_file_unmap(&f);
+  return same;
+}
+
+static bool write_archive(void) {
+  uint32_t rng = 1;
+  for (size_t i = 0; i < BIG_SIZE; i++) big[i] = (uint8_t)((i / 3) % 50);
+  for (size_t i = 0; i < NOISE_SIZE; i++) {
+    rng = rng * 1103515245u + 12345u;
+    noise[i] = (uint8_t)(rng >> 16);
+  }
+  write_file(path_of("big.bin"), big, BIG_SIZE);
+  write_file(path_of("noise.bin"), noise, NOISE_SIZE);
+  write_file(path_of("empty.bin"), "", 0);
+  write_file(path_of("mesh.amesh"), big, 5000);
+
+  archive_source sources[] = {
+    { "big.bin", path_of("big.bin"), true },
+    { "noise.bin", path_of("noise.bin"), true },
+    { "empty.bin", path_of("empty.bin"), true },
+    { "sub/mesh.amesh", path_of("mesh.amesh"), false }
+  };
+  return archive_write(path_of("test.apak"), sources, sizeof(sources) / sizeof(sources[0]));
+}
+
+static void test_round_trip(void) {
+  archive *a = archive_open(path_of("test.apak"));
+  CHECK(a != NULL);
+  if (!a) return;
+
+  CHECK(maps_to(a, "big.bin", big, BIG_SIZE));
+  CHECK(maps_to(a, "noise.bin", noise, NOISE_SIZE));
+  CHECK(maps_to(a, "empty.bin", NULL, 0));
+  CHECK(maps_to(a, "sub/mesh.amesh", big, 5000));
+
+  asset_file f;
+  CHECK(!archive_map(a, "missing.bin", false, &f));
+  CHECK(!archive_map(a, "sub", false, &f));
+
+  // writable mappings are private copies
+  CHECK(archive_map(a, "big.bin", true, &f));
+  if (f.data) f.data[0] ^= 0xff;
+  asset_file_unmap(&f);
+  CHECK(maps_to(a, "big.bin", big, BIG_SIZE));
+  archive_close(a);
+
+  // duplicate names are refused
+  archive_source twice[] = {
+    { "a", path_of("big.bin"), true },
+    { "a", path_of("noise.bin"), true }
+  };
+  CHECK(!archive_write(path_of("twice.apak"), twice, 2));
+}
+
+// the loose file wins while it exists, the archive serves it once removed
+static void test_mount(void) {
+  CHECK(archive_mount(path_of("test.apak"), dir));
+  asset_file f;
+  CHECK(asset_file_map(path_of("big.bin"), false, &f) && f.size == BIG_SIZE);
+  asset_file_unmap(&f);
+
+  unlink(path_of("big.bin"));
+  CHECK(asset_file_map(path_of("big.bin"), false, &f));
+  CHECK(f.size == BIG_SIZE && memcmp(f.data, big, BIG_SIZE) == 0);
+  asset_file_unmap(&f);
+  CHECK(!asset_file_map(path_of("gone.bin"), false, &f));
+  archive_unmount_all();
+  CHECK(!asset_file_map(path_of("big.bin"), false, &f));
+}
+
+static bool opens(const uint8_t *data, size_t size) {
+  write_file(path_of("corrupt.apak"), data, size);
+  archive *a = archive_open(path_of("corrupt.apak"));
+  archive_close(a);
+  return a != NULL;
+}
+
+static void test_corrupt_header(void) {
+  size_t size = 0;
+  uint8_t *good = read_file(path_of("test.apak"), &size);
+  CHECK(good && size > sizeof(archive_header));
+  if (!good || size <= sizeof(archive_header)) return;
+  uint8_t *bad = malloc(size);
+  const archive_header *h = (const archive_header *)good;
+  archive_header *b = (archive_header *)bad;
+  CHECK(opens(good, size));
+
+  // cut short anywhere, including inside the header
+  CHECK(!opens(good, 0));
+  CHECK(!opens(good, sizeof(archive_header) - 1));
+  CHECK(!opens(good, sizeof(archive_header)));
+  CHECK(!opens(good, size - 1));
+
+  memcpy(bad, good, size);
+  b->magic[0] = 'X';
+  CHECK(!opens(bad, size));
+
+  memcpy(bad, good, size);
+  b->version = ARCHIVE_VERSION + 1;
+  CHECK(!opens(bad, size));
+
+  memcpy(bad, good, size);
+  b->chunk_size = ARCHIVE_CHUNK_SIZE / 2;
+  CHECK(!opens(bad, size));
+
+  memcpy(bad, good, size);
+  b->slot_count = 3;
+  CHECK(!opens(bad, size));
+
+  memcpy(bad, good, size);
+  b->entry_count = b->slot_count;
+  CHECK(!opens(bad, size));
+
+  memcpy(bad, good, size);
+  b->entries_offset = size;
+  CHECK(!opens(bad, size));
+
+  memcpy(bad, good, size);
+  b->chunk_count = UINT64_MAX / 2;
+  CHECK(!opens(bad, size));
+
+  memcpy(bad, good, size);
+  b->names_size = size;
+  CHECK(!opens(bad, size));
+
+  // a renamed entry no longer matches its hash
+  memcpy(bad, good, size);
+  bad[h->names_offset] ^= 0x20;
+  CHECK(!opens(bad, size));
+
+  // a chunk claiming more data than the file holds
+  memcpy(bad, good, size);
+  archive_chunk *chunks = (archive_chunk *)(bad + h->chunks_offset);
+  chunks[0].offset = size - 1;
+  CHECK(!opens(bad, size));
+
+  // a compressed chunk cut short opens but fails to decompress
+  memcpy(bad, good, size);
+  chunks[0].size -= 1;
+  write_file(path_of("corrupt.apak"), bad, size);
+  archive *a = archive_open(path_of("corrupt.apak"));
+  CHECK(a != NULL);
+  if (a) {
+    asset_file f;
+    CHECK(!archive_map(a, "big.bin", false, &f));
+    CHECK(maps_to(a, "noise.bin", noise, NOISE_SIZE));
+    archive_close(a);
+  }
+
+  free(good);
+  free(bad);
+}
+
+static void remove_files(void) {
+  static const char *names[] = {
+    "big.bin", "noise.bin", "empty.bin", "mesh.amesh", "test.apak", "twice.apak", "corrupt.apak"
+  };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) unlink(path_of(names[i]));
+  rmdir(dir);
+}
+
+int main(void) {
+  if (!mkdtemp(dir)) {
+    perror("archive_test: mkdtemp");
+    return 1;
+  }
+  CHECK(write_archive());
+  test_round_trip();
+  test_corrupt_header();
+  test_mount();
+  remove_files();
+  return check_report("archive_test");
+}
@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/assets.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../check.h"
+
+static char dir[] = "/tmp/atom_assets_XXXXXX";
+
+static const char *path_of(const char *name) {
+  static char path[4][256];
+  static int next;
+  char *p = path[next++ & 3];
+  snprintf(p, sizeof(path[0]), "%s/%s", dir, name);
+  return p;
+}
+
+static void write_triangle(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) return;
+  fputs("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", f);
+  fclose(f);
+}
+
+// publishes every async load, including ones nobody holds a handle to any more
+static void finish_loads(void) {
+  struct timespec nap = { 0, 1000000 };
+  while (asset_get_stats().loading) {
+    assets_dispatch();
+    nanosleep(&nap, NULL);
+  }
+}
+
+static void test_dedup(void) {
+  asset_stats before = asset_get_stats();
+  asset_handle a = asset_load_mesh(path_of("tri.obj"), NULL);
+  asset_handle b = asset_load_mesh(path_of("./sub/../tri.obj"), NULL);
+  CHECK(a != ASSET_HANDLE_NONE);
+  CHECK(a == b);
+  CHECK(asset_mesh(a) && asset_mesh(a) == asset_mesh(b));
+  CHECK(asset_mesh(a) && asset_mesh(a)->vert_count == 3);
+  CHECK(asset_ref_count(a) == 2);
+  CHECK(asset_get_stats().hits == before.hits + 1);
+
+  // options are part of the key, those of disabled steps are not
+  mesh_import_options normals = { .flags = MESH_IMPORT_NORMALS };
+  mesh_import_options ignored = { .flags = MESH_IMPORT_NORMALS, .lods = { .reduction = 0.5f } };
+  asset_handle c = asset_load_mesh(path_of("tri.obj"), &normals);
+  asset_handle d = asset_load_mesh(path_of("tri.obj"), &ignored);
+  CHECK(c != a && c == d);
+
+  asset_release(a);
+  asset_release(b);
+  asset_release(c);
+  asset_release(d);
+  CHECK(asset_get_state(a) == ASSET_NONE && asset_get_state(c) == ASSET_NONE);
+}
+
+static void test_refs(void) {
+  asset_handle h = asset_load_mesh(path_of("tri.obj"), NULL);
+  asset_weak_handle w = asset_weak(h);
+  CHECK(asset_retain(h) == h);
+  CHECK(asset_ref_count(h) == 2);
+
+  asset_handle locked = asset_lock(w);
+  CHECK(locked == h && asset_ref_count(h) == 3);
+  asset_release(locked);
+  asset_release(h);
+  CHECK(asset_ref_count(h) == 1 && asset_mesh(h) != NULL);
+
+  // the last strong reference unloads, stale handles stay stale when the
+  // slot is reused
+  asset_release(h);
+  CHECK(asset_lock(w) == ASSET_HANDLE_NONE);
+  CHECK(asset_mesh(h) == NULL && asset_ref_count(h) == 0);
+  CHECK(asset_retain(h) == ASSET_HANDLE_NONE);
+  asset_release(h);
+
+  asset_handle again = asset_load_mesh(path_of("tri.obj"), NULL);
+  CHECK(again != ASSET_HANDLE_NONE && again != h);
+  CHECK(asset_lock(w) == ASSET_HANDLE_NONE);
+  asset_release(again);
+}
+
+static void test_release_while_loading(void) {
+  asset_stats before = asset_get_stats();
+  asset_handle h = asset_load_mesh_async(path_of("tri.obj"), NULL);
+  CHECK(h != ASSET_HANDLE_NONE);
+  asset_release(h);
+  CHECK(asset_get_state(h) == ASSET_NONE);
+  finish_loads();
+  CHECK(asset_get_stats().loaded == before.loaded);
+
+  // a fresh request loads again instead of finding the dropped entry
+  asset_handle next = asset_load_mesh_async(path_of("tri.obj"), NULL);
+  finish_loads();
+  CHECK(asset_get_state(next) == ASSET_READY && asset_mesh(next) != NULL);
+  asset_release(next);
+
+  // a blocking request joins a load already in flight
+  asset_handle async = asset_load_mesh_async(path_of("tri.obj"), NULL);
+  asset_handle sync = asset_load_mesh(path_of("tri.obj"), NULL);
+  CHECK(sync == async && asset_get_state(async) == ASSET_READY);
+  asset_release(async);
+  asset_release(sync);
+  finish_loads();
+}
+
+static void test_retry_after_failure(void) {
+  char late[256];
+  snprintf(late, sizeof(late), "%s", path_of("late.obj"));
+  asset_handle failed = asset_load_mesh_async(late, NULL);
+  finish_loads();
+  CHECK(asset_get_state(failed) == ASSET_FAILED);
+  CHECK(asset_load_mesh(late, NULL) == ASSET_HANDLE_NONE);
+
+  // enough other assets to grow the key table while the failed entry is alive
+  asset_handle others[40];
+  for (int i = 0; i < 40; i++) {
+    mesh_import_options o = { .flags = MESH_IMPORT_NORMALS, .crease_angle = 0.01f * (float)(i + 1) };
+    others[i] = asset_load_mesh(path_of("tri.obj"), &o);
+    CHECK(others[i] != ASSET_HANDLE_NONE);
+  }
+  asset_release(failed);
+
+  write_triangle(late);
+  asset_handle h = asset_load_mesh(late, NULL);
+  CHECK(h != ASSET_HANDLE_NONE && asset_mesh(h) != NULL);
+  CHECK(h != failed);
+  asset_release(h);
+  for (int i = 0; i < 40; i++) asset_release(others[i]);
+}
+
+int main(void) {
+  if (!mkdtemp(dir)) {
+    perror("assets_test: mkdtemp");
+    return 1;
+  }
+  write_triangle(path_of("tri.obj"));
+
+  test_dedup();
+  test_refs();
+  test_release_while_loading();
+  test_retry_after_failure();
+  CHECK(asset_get_stats().loaded == 0);
+  assets_shutdown();
+
+  unlink(path_of("tri.obj"));
+  unlink(path_of("late.obj"));
+  rmdir(dir);
+  return check_report("assets_test");
+}
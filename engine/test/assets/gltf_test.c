@@ -0,0 +1,216 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/gltf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../check.h"
+
+// one triangle under a translated root node, float positions and uint16
+// indices in a 44 byte buffer
+static const float tri_positions[9] = { 0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f };
+
+static const char *tri_json =
+  "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+  "\"nodes\":[{\"name\":\"root\",\"translation\":[1,2,3],\"children\":[1]},{\"name\":\"tri\",\"mesh\":0}],"
+  "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0},\"indices\":1}]}],"
+  "\"buffers\":[{%s\"byteLength\":44}],"
+  "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},{\"buffer\":0,\"byteOffset\":36,\"byteLength\":6}],"
+  "\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\","
+  "\"min\":[0,0,0],\"max\":[1,1,0]},{\"bufferView\":1,\"componentType\":5123,\"count\":3,\"type\":\"SCALAR\"}]}";
+
+static char dir[] = "/tmp/atom_gltf_XXXXXX";
+
+static void tri_buffer(uint8_t out[44], uint16_t last_index) {
+  uint16_t indices[4] = { 0, 1, last_index, 0 };
+  memcpy(out, tri_positions, sizeof(tri_positions));
+  memcpy(out + 36, indices, sizeof(indices));
+}
+
+static char *base64(const uint8_t *data, size_t size) {
+  static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  char *out = malloc((size + 2) / 3 * 4 + 1);
+  size_t n = 0;
+  for (size_t i = 0; i < size; i += 3) {
+    uint32_t bits = (uint32_t)data[i] << 16;
+    if (i + 1 < size) bits |= (uint32_t)data[i + 1] << 8;
+    if (i + 2 < size) bits |= data[i + 2];
+    out[n++] = digits[(bits >> 18) & 63];
+    out[n++] = digits[(bits >> 12) & 63];
+    out[n++] = i + 1 < size ? digits[(bits >> 6) & 63] : '=';
+    out[n++] = i + 2 < size ? digits[bits & 63] : '=';
+  }
+  out[n] = '\0';
+  return out;
+}
+
+static const char *write_file(const char *name, const void *data, size_t size) {
+  static char path[256];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE *f = fopen(path, "wb");
+  if (!f) return path;
+  fwrite(data, 1, size, f);
+  fclose(f);
+  return path;
+}
+
+static size_t make_json(char *out, size_t capacity, const char *uri, int position_count) {
+  char field[512] = "";
+  if (uri) snprintf(field, sizeof(field), "\"uri\":\"%s\",", uri);
+  return (size_t)snprintf(out, capacity, tri_json, field, position_count);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+// json padded with spaces and the buffer as the binary chunk
+static size_t make_glb(uint8_t *out, const char *json, size_t json_size, const uint8_t *bin, size_t bin_size) {
+  size_t json_padded = (json_size + 3) & ~(size_t)3;
+  size_t total = 12 + 8 + json_padded + 8 + bin_size;
+  put_u32(out, GLB_MAGIC);
+  put_u32(out + 4, 2);
+  put_u32(out + 8, (uint32_t)total);
+  put_u32(out + 12, (uint32_t)json_padded);
+  put_u32(out + 16, GLB_CHUNK_JSON);
+  memset(out + 20, ' ', json_padded);
+  memcpy(out + 20, json, json_size);
+  put_u32(out + 20 + json_padded, (uint32_t)bin_size);
+  put_u32(out + 24 + json_padded, GLB_CHUNK_BIN);
+  memcpy(out + 28 + json_padded, bin, bin_size);
+  return total;
+}
+
+static void check_triangle(const char *path) {
+  gltf_model model;
+  bool ok = gltf_load_model(path, &model);
+  CHECK(ok);
+  if (!ok) return;
+
+  CHECK(model.mesh_count == 1 && model.node_count == 2);
+  if (model.mesh_count == 1) {
+    const mesh *m = &model.meshes[0];
+    CHECK(m->vert_count == 3 && m->idx_count == 3);
+    CHECK(memcmp(m->positions, tri_positions, sizeof(tri_positions)) == 0);
+    CHECK(m->indices[0] == 0 && m->indices[1] == 1 && m->indices[2] == 2);
+  }
+  if (model.node_count == 2) {
+    CHECK(model.nodes[0].parent == -1 && model.nodes[1].parent == 0);
+    CHECK(model.nodes[0].mesh == -1 && model.nodes[1].mesh == 0);
+    CHECK(strcmp(model.nodes[1].name, "tri") == 0);
+    CHECK(model.nodes[0].translation[2] == 3.0f && model.nodes[1].scale[0] == 1.0f);
+  }
+
+  // the root's translation is baked into the flattened copy
+  mesh flat;
+  CHECK(gltf_flatten(&model, &flat));
+  CHECK(flat.vert_count == 3);
+  if (flat.vert_count == 3) {
+    CHECK(flat.positions[3] == 2.0f && flat.positions[4] == 2.0f && flat.positions[5] == 3.0f);
+    destroy_mesh(&flat);
+  }
+  gltf_model_destroy(&model);
+}
+
+static bool loads(const char *path) {
+  gltf_model model;
+  if (!gltf_load_model(path, &model)) return false;
+  gltf_model_destroy(&model);
+  return true;
+}
+
+static void test_gltf(void) {
+  uint8_t bin[44];
+  char json[2048];
+  tri_buffer(bin, 2);
+
+  write_file("tri.bin", bin, sizeof(bin));
+  size_t n = make_json(json, sizeof(json), "tri.bin", 3);
+  check_triangle(write_file("tri.gltf", json, n));
+
+  char *encoded = base64(bin, sizeof(bin));
+  char uri[256];
+  snprintf(uri, sizeof(uri), "data:application/octet-stream;base64,%s", encoded);
+  free(encoded);
+  n = make_json(json, sizeof(json), uri, 3);
+  check_triangle(write_file("embedded.gltf", json, n));
+
+  // an accessor reading past its bufferView
+  n = make_json(json, sizeof(json), "tri.bin", 4);
+  CHECK(!loads(write_file("overrun.gltf", json, n)));
+
+  // an index past the last vertex
+  tri_buffer(bin, 3);
+  write_file("bad_index.bin", bin, sizeof(bin));
+  n = make_json(json, sizeof(json), "bad_index.bin", 3);
+  CHECK(!loads(write_file("bad_index.gltf", json, n)));
+
+  n = make_json(json, sizeof(json), "missing.bin", 3);
+  CHECK(!loads(write_file("missing.gltf", json, n)));
+  CHECK(!loads(write_file("broken.gltf", json, n / 2)));
+}
+
+static void test_glb(void) {
+  uint8_t bin[44];
+  char json[2048];
+  uint8_t glb[4096];
+  tri_buffer(bin, 2);
+  size_t json_size = make_json(json, sizeof(json), NULL, 3);
+  size_t size = make_glb(glb, json, json_size, bin, sizeof(bin));
+
+  glb_chunks chunks;
+  CHECK(glb_parse(glb, size, &chunks));
+  CHECK(chunks.json_size == ((json_size + 3) & ~(size_t)3) && chunks.bin_size == sizeof(bin));
+  CHECK(chunks.bin && memcmp(chunks.bin, bin, sizeof(bin)) == 0);
+  check_triangle(write_file("tri.glb", glb, size));
+
+  // containers cut short or lying about their sizes
+  CHECK(!glb_parse(glb, size - 1, &chunks));
+  CHECK(!glb_parse(glb, 16, &chunks));
+  CHECK(!loads(write_file("truncated.glb", glb, size - 8)));
+
+  uint8_t bad[4096];
+  memcpy(bad, glb, size);
+  bad[0] = 'x';
+  CHECK(!glb_parse(bad, size, &chunks));
+
+  memcpy(bad, glb, size);
+  put_u32(bad + 4, 1);
+  CHECK(!glb_parse(bad, size, &chunks));
+
+  memcpy(bad, glb, size);
+  put_u32(bad + 12, 0xfffffff0u);
+  CHECK(!glb_parse(bad, size, &chunks));
+
+  memcpy(bad, glb, size);
+  put_u32(bad + 16, GLB_CHUNK_BIN);
+  CHECK(!glb_parse(bad, size, &chunks));
+  CHECK(!loads(write_file("bad_chunk.glb", bad, size)));
+}
+
+static void remove_files(void) {
+  static const char *names[] = {
+    "tri.bin", "tri.gltf", "embedded.gltf", "overrun.gltf", "bad_index.bin", "bad_index.gltf",
+    "missing.gltf", "broken.gltf", "tri.glb", "truncated.glb", "bad_chunk.glb"
+  };
+  char path[256];
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+    unlink(path);
+  }
+  rmdir(dir);
+}
+
+int main(void) {
+  if (!mkdtemp(dir)) {
+    perror("gltf_test: mkdtemp");
+    return 1;
+  }
+  test_gltf();
+  test_glb();
+  remove_files();
+  return check_report("gltf_test");
+}
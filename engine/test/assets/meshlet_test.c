@@ -0,0 +1,68 @@
+#include <assets/mesh.h>
+#include <string.h>
+#include <math.h>
+#include "../check.h"
+
+// a v shaped trough, both walls face the middle of the cluster so its bounds
+// center sits in front of every triangle
+static void build_trough(mesh *m) {
+  static const float positions[] = {
+    -1.0f, 1.0f, 0.0f,   0.0f, 0.0f, 0.0f,   -1.0f, 1.0f, 1.0f,
+     0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 0.0f,    1.0f, 1.0f, 1.0f
+  };
+  static const uint32_t indices[] = { 0, 2, 1,  1, 2, 3,  1, 3, 4,  4, 3, 5 };
+
+  memset(m, 0, sizeof(mesh));
+  mesh_allocate(m, 6, 12, 0, NULL);
+  memcpy(m->positions, positions, sizeof(positions));
+  memcpy(m->indices, indices, sizeof(indices));
+  m->vert_count = 6;
+  m->idx_count = 12;
+}
+
+static void face_normal(const mesh *m, const uint32_t *tri, float n[3], const float **p0) {
+  const float *a = &m->positions[3 * tri[0]];
+  const float *b = &m->positions[3 * tri[1]];
+  const float *c = &m->positions[3 * tri[2]];
+  float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+  float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+  n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+  n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+  n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+  float len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+  for (int k = 0; k < 3; k++) n[k] /= len;
+  *p0 = a;
+}
+
+static void test_concave_cone(void) {
+  mesh m;
+  build_trough(&m);
+  mesh_build_meshlets(&m);
+  CHECK(m.meshlet_count == 1);
+  if (m.meshlet_count != 1) {
+    destroy_mesh(&m);
+    return;
+  }
+
+  const meshlet *ml = &m.meshlets[0];
+  CHECK(ml->cone_cutoff < 1.0f);
+  CHECK(fabsf(ml->cone_axis[1] - 1.0f) < 1e-4f);
+
+  // a viewer at the apex must not see the front of any triangle in the cone
+  for (uint32_t t = 0; t < ml->triangle_count; t++) {
+    float n[3];
+    const float *p0;
+    face_normal(&m, &m.indices[ml->index_offset + 3 * t], n, &p0);
+    float facing = n[0]*ml->cone_axis[0] + n[1]*ml->cone_axis[1] + n[2]*ml->cone_axis[2];
+    if (facing <= 0.0f) continue;
+    float side = (ml->cone_apex[0] - p0[0]) * n[0] + (ml->cone_apex[1] - p0[1]) * n[1] +
+                 (ml->cone_apex[2] - p0[2]) * n[2];
+    CHECK(side <= 1e-5f);
+  }
+  destroy_mesh(&m);
+}
+
+int main(void) {
+  test_concave_cone();
+  return check_report("meshlet_test");
+}
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/mesh.h>
+#include <lib/jobs.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/stat.h>
+
+void legacy_load_obj(const char *path, mesh *out);
+
+static void load_serial(const char *path, mesh *out) {
+  load_obj_chunked(path, out, 1);
+}
+
+typedef void (*loader_fn)(const char *path, mesh *out);
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static size_t file_size(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+static void free_mesh(mesh *m) {
+  destroy_mesh(m);
+  memset(m, 0, sizeof(mesh));
+}
+
+// a displaced grid with positions, texcoords, normals and one triangle per
+// face line, written in the short lines the fgets loader can still read
+static bool write_synthetic(const char *path, size_t target_bytes) {
+  FILE *f = fopen(path, "w");
+  if (!f) return false;
+
+  size_t side = 2;
+  while (side * side * 215 < target_bytes) side++;
+
+  srand(1);
+  for (size_t y = 0; y < side; y++) {
+    for (size_t x = 0; x < side; x++) {
+      float h = (float)rand() / (float)RAND_MAX;
+      fprintf(f, "v %.6f %.6f %.6f\n", (float)x * 0.01f, h * 0.25f, (float)y * 0.01f);
+      fprintf(f, "vt %.6f %.6f\n", (float)x / (float)side, (float)y / (float)side);
+      fprintf(f, "vn %.6f %.6f %.6f\n", h - 0.5f, 1.0f, 0.5f - h);
+    }
+  }
+  for (size_t y = 0; y + 1 < side; y++) {
+    for (size_t x = 0; x + 1 < side; x++) {
+      size_t a = y * side + x + 1, b = a + 1, c = a + side, d = c + 1;
+      fprintf(f, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, c, c, c, b, b, b);
+      fprintf(f, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", b, b, b, c, c, c, d, d, d);
+    }
+  }
+
+  fclose(f);
+  return true;
+}
+
+// best of several runs, repeated until min_seconds have passed
+static double measure(loader_fn load, const char *path, double min_seconds, mesh *out) {
+  double best = 1e30, total = 0.0;
+  int runs = 0;
+  while (runs < 3 || total < min_seconds) {
+    mesh m = {0};
+    double start = now_seconds();
+    load(path, &m);
+    double elapsed = now_seconds() - start;
+
+    total += elapsed;
+    if (elapsed < best) best = elapsed;
+    runs++;
+
+    if (out->positions) free_mesh(out);
+    *out = m;
+    if (elapsed > min_seconds) break;
+  }
+  return best;
+}
+
+static bool same_mesh(const mesh *a, const mesh *b) {
+  if (!a->vert_count || !b->vert_count) return false;
+  if (a->vert_count != b->vert_count || a->idx_count != b->idx_count) return false;
+  if (memcmp(a->indices, b->indices, a->idx_count * sizeof(uint32_t)) != 0) return false;
+  return memcmp(a->positions, b->positions, a->vert_count * 3 * sizeof(float)) == 0;
+}
+
+static void bench(const char *path, double min_seconds) {
+  size_t bytes = file_size(path);
+  if (!bytes) {
+    fprintf(stderr, "obj_bench: cannot read '%s'\n", path);
+    return;
+  }
+
+  mesh legacy = {0}, mapped = {0}, chunked = {0};
+  double legacy_s = measure(legacy_load_obj, path, min_seconds, &legacy);
+  double mapped_s = measure(load_serial, path, min_seconds, &mapped);
+  double chunked_s = measure(load_obj, path, min_seconds, &chunked);
+  double mb = (double)bytes / (1024.0 * 1024.0);
+
+  printf("%s (%.1f MB, %zu vertices, %zu indices)\n", path, mb,
+         mapped.vert_count ? mapped.vert_count : 0, mapped.idx_count ? mapped.idx_count : 0);
+  printf("  fgets/sscanf:  %8.1f MB/s  %9.2f ms\n", mb / legacy_s, legacy_s * 1e3);
+  printf("  mmap serial:   %8.1f MB/s  %9.2f ms  (%.1fx)\n", mb / mapped_s, mapped_s * 1e3, legacy_s / mapped_s);
+  printf("  mmap %2zu threads:%7.1f MB/s  %9.2f ms  (%.1fx)\n", jobs_worker_count() + 1,
+         mb / chunked_s, chunked_s * 1e3, legacy_s / chunked_s);
+  printf("  serial output %s, threaded output %s\n",
+         same_mesh(&legacy, &mapped) ? "identical" : "differs",
+         same_mesh(&mapped, &chunked) ? "identical" : "differs");
+
+  free_mesh(&legacy);
+  free_mesh(&mapped);
+  free_mesh(&chunked);
+}
+
+int main(int argc, char **argv) {
+  const char *teapot = "../../../test/models/obj/teapot.obj";
+  const char *synthetic = "/tmp/atom_bench.obj";
+  size_t synthetic_mb = 500;
+  size_t threads = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--synthetic-mb") == 0 && i + 1 < argc) {
+      synthetic_mb = (size_t)atol(argv[++i]);
+    } else if (strcmp(argv[i], "--synthetic") == 0 && i + 1 < argc) {
+      synthetic = argv[++i];
+    } else if (strcmp(argv[i], "--teapot") == 0 && i + 1 < argc) {
+      teapot = argv[++i];
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = (size_t)atol(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--teapot path] [--synthetic path] [--synthetic-mb n] [--threads n]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  // the calling thread takes part, 0 workers lets the pool pick one per core
+  jobs_init(threads > 1 ? threads - 1 : 0);
+  bench(teapot, 1.0);
+
+  // regenerated only when missing or a different size was asked for
+  size_t target = synthetic_mb * 1024 * 1024;
+  size_t existing = file_size(synthetic);
+  if (synthetic_mb && (existing < target * 9 / 10 || existing > target * 11 / 10)) {
+    printf("writing %zu MB synthetic obj to %s\n", synthetic_mb, synthetic);
+    if (!write_synthetic(synthetic, target)) {
+      fprintf(stderr, "obj_bench: cannot write '%s'\n", synthetic);
+      return 1;
+    }
+  }
+  if (synthetic_mb) bench(synthetic, 0.0);
+
+  jobs_shutdown();
+  return 0;
+}
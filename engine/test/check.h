@@ -0,0 +1,27 @@
+#ifndef ATOM_TEST_CHECK_H
+#define ATOM_TEST_CHECK_H
+
+#include <stdio.h>
+
+// failed checks are reported and counted, every check still runs so one
+// broken case does not hide the others
+static int check_failures;
+
+#define CHECK(cond)                                                       \
+  do {                                                                    \
+    if (!(cond)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      check_failures++;                                                   \
+    }                                                                     \
+  } while (0)
+
+static inline int check_report(const char *suite) {
+  if (check_failures) {
+    fprintf(stderr, "%s: %d checks failed\n", suite, check_failures);
+    return 1;
+  }
+  fprintf(stderr, "%s: all checks passed\n", suite);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include <lib/inflate.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../check.h"
+
+// zlib streams written by zlib itself
+
+// empty input, a single fixed block holding only the end code
+static const uint8_t empty_stream[] = {
+  0x78, 0x9c, 0x03, 0x00, 0x00, 0x00, 0x00, 0x01
+};
+
+// "atom stored block" in a stored block
+static const uint8_t stored_stream[] = {
+  0x78, 0x01, 0x01, 0x11, 0x00, 0xee, 0xff, 0x61, 0x74, 0x6f, 0x6d, 0x20,
+  0x73, 0x74, 0x6f, 0x72, 0x65, 0x64, 0x20, 0x62, 0x6c, 0x6f, 0x63, 0x6b,
+  0x3b, 0x4d, 0x06, 0x8e
+};
+
+// "hello hello hello hello", fixed huffman codes with a back reference
+static const uint8_t fixed_stream[] = {
+  0x78, 0xda, 0xcb, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0xc8, 0x40, 0x27, 0x01,
+  0x68, 0x03, 0x08, 0xb1
+};
+
+// fox_lines(), dynamic huffman codes
+static const uint8_t dynamic_stream[] = {
+  0x78, 0xda, 0x7d, 0xd4, 0x4b, 0x0e, 0x81, 0x51, 0x0c, 0x80, 0xd1, 0xb9,
+  0x55, 0xdc, 0x25, 0xe8, 0xc3, 0x73, 0x39, 0x84, 0xf8, 0x43, 0x08, 0x21,
+  0x2c, 0x5f, 0x2c, 0xc0, 0x19, 0x7f, 0xa3, 0x9e, 0xb4, 0xbd, 0x4c, 0xd7,
+  0xc3, 0x98, 0x6f, 0xc7, 0xf3, 0x74, 0x18, 0xf7, 0xd7, 0xb4, 0x3f, 0x8f,
+  0xdd, 0xe3, 0xf6, 0xbe, 0x8e, 0xe3, 0xed, 0x33, 0xbb, 0xfc, 0x5a, 0xa0,
+  0x25, 0x5a, 0xa1, 0x35, 0xda, 0x02, 0x6d, 0x89, 0xb6, 0x42, 0x5b, 0xa3,
+  0x6d, 0x34, 0x3b, 0x61, 0x24, 0x13, 0xa2, 0x09, 0xd9, 0x84, 0x70, 0x42,
+  0x3a, 0x21, 0x9e, 0x90, 0x4f, 0x08, 0x28, 0x24, 0x94, 0x12, 0x4a, 0xee,
+  0x8e, 0x84, 0x52, 0x42, 0x29, 0xa1, 0x94, 0x50, 0x4a, 0x28, 0x25, 0x94,
+  0x12, 0x4a, 0x09, 0x95, 0x84, 0x4a, 0x42, 0xc5, 0xf3, 0x92, 0x50, 0x49,
+  0xa8, 0x24, 0x54, 0x12, 0x2a, 0x09, 0x95, 0x84, 0x4a, 0x42, 0x2d, 0xa1,
+  0x96, 0x50, 0x4b, 0xa8, 0xf9, 0x81, 0x24, 0xd4, 0x12, 0x6a, 0x09, 0xb5,
+  0x84, 0x5a, 0x42, 0xfd, 0x47, 0xe8, 0x0b, 0x86, 0xa9, 0xe6, 0xc3
+};
+
+// 100000 zero bytes, matches overlapping their own output
+static const uint8_t zeros_stream[] = {
+  0x78, 0xda, 0xed, 0xc1, 0x31, 0x01, 0x00, 0x00, 0x00, 0xc2, 0xa0, 0xf5,
+  0x4f, 0x6d, 0x0d, 0x0f, 0xa0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x57, 0x03, 0x86, 0xaf, 0x00, 0x01
+};
+
+// "line N: the quick brown fox\n" for N from 0 to 49
+static size_t fox_lines(char *out, size_t capacity) {
+  size_t n = 0;
+  for (int i = 0; i < 50; i++) {
+    n += (size_t)snprintf(out + n, capacity - n, "line %d: the quick brown fox\n", i);
+  }
+  return n;
+}
+
+// the stream must inflate to exactly expected, and to nothing one byte shorter or longer
+static void check_stream(const uint8_t *src, size_t src_size, const uint8_t *expected, size_t size) {
+  uint8_t *out = malloc(size + 1);
+  CHECK(zlib_inflate(src, src_size, out, size));
+  CHECK(size == 0 || memcmp(out, expected, size) == 0);
+  CHECK(!zlib_inflate(src, src_size, out, size + 1));
+  if (size) CHECK(!zlib_inflate(src, src_size, out, size - 1));
+
+  // the same deflate data without the two byte header and the adler-32 trailer
+  memset(out, 0xaa, size);
+  CHECK(inflate_raw(src + 2, src_size - 6, out, size));
+  CHECK(size == 0 || memcmp(out, expected, size) == 0);
+  free(out);
+}
+
+static void test_known_streams(void) {
+  char fox[2048];
+  size_t fox_size = fox_lines(fox, sizeof(fox));
+  uint8_t *zeros = calloc(100000, 1);
+
+  check_stream(empty_stream, sizeof(empty_stream), (const uint8_t *)"", 0);
+  check_stream(stored_stream, sizeof(stored_stream), (const uint8_t *)"atom stored block", 17);
+  check_stream(fixed_stream, sizeof(fixed_stream), (const uint8_t *)"hello hello hello hello", 23);
+  check_stream(dynamic_stream, sizeof(dynamic_stream), (const uint8_t *)fox, fox_size);
+  check_stream(zeros_stream, sizeof(zeros_stream), zeros, 100000);
+  free(zeros);
+}
+
+static void test_corrupt_streams(void) {
+  char fox[2048];
+  size_t fox_size = fox_lines(fox, sizeof(fox));
+  uint8_t out[2048];
+  uint8_t bad[sizeof(dynamic_stream)];
+
+  // every truncation fails rather than reading past the end
+  for (size_t n = 0; n < sizeof(dynamic_stream); n++) {
+    CHECK(!zlib_inflate(dynamic_stream, n, out, fox_size));
+  }
+
+  // header check bits, compression method and preset dictionary
+  memcpy(bad, dynamic_stream, sizeof(bad));
+  bad[1] ^= 0x01;
+  CHECK(!zlib_inflate(bad, sizeof(bad), out, fox_size));
+  memcpy(bad, dynamic_stream, sizeof(bad));
+  bad[0] = 0x79;
+  CHECK(!zlib_inflate(bad, sizeof(bad), out, fox_size));
+  memcpy(bad, dynamic_stream, sizeof(bad));
+  bad[1] = 0xbb;
+  CHECK(!zlib_inflate(bad, sizeof(bad), out, fox_size));
+
+  // checksum mismatch
+  memcpy(bad, dynamic_stream, sizeof(bad));
+  bad[sizeof(bad) - 1] ^= 0x01;
+  CHECK(!zlib_inflate(bad, sizeof(bad), out, fox_size));
+
+  // a stored block whose length and its complement disagree
+  uint8_t stored[sizeof(stored_stream)];
+  memcpy(stored, stored_stream, sizeof(stored));
+  stored[5] ^= 0x01;
+  CHECK(!zlib_inflate(stored, sizeof(stored), out, 17));
+
+  // the reserved block type
+  uint8_t reserved[] = { 0x78, 0x9c, 0x07, 0x00, 0x00, 0x00, 0x00, 0x01 };
+  CHECK(!zlib_inflate(reserved, sizeof(reserved), out, 0));
+
+  // flipping any bit of the compressed data never crashes, and an accepted
+  // stream still has to match its checksum
+  for (size_t i = 2; i < sizeof(dynamic_stream) - 4; i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      memcpy(bad, dynamic_stream, sizeof(bad));
+      bad[i] ^= (uint8_t)(1u << bit);
+      if (zlib_inflate(bad, sizeof(bad), out, fox_size)) CHECK(memcmp(out, fox, fox_size) == 0);
+    }
+  }
+}
+
+int main(void) {
+  test_known_streams();
+  test_corrupt_streams();
+  return check_report("inflate_test");
+}
@@ -0,0 +1,111 @@
+#include <lib/json.h>
+#include <string.h>
+#include <stdlib.h>
+#include "../check.h"
+
+static bool parses(const char *text) {
+  json_document doc;
+  bool ok = json_parse(&doc, text, strlen(text));
+  if (ok) json_destroy(&doc);
+  return ok;
+}
+
+static void test_values(void) {
+  const char *text = " { \"a\": [1, -2.5e1, true, null], \"b\": { \"c\": \"x\\ny\" }, \"d\": false } ";
+  json_document doc;
+  CHECK(json_parse(&doc, text, strlen(text)));
+  if (doc.count == 0) return;
+
+  uint32_t a = json_get(&doc, 0, "a");
+  CHECK(json_count(&doc, 0) == 3);
+  CHECK(json_count(&doc, a) == 4);
+  CHECK(json_int(&doc, json_at(&doc, a, 0), 0) == 1);
+  CHECK(json_float(&doc, json_at(&doc, a, 1), 0.0f) == -25.0f);
+  CHECK(json_bool(&doc, json_at(&doc, a, 2), false));
+  CHECK(doc.tokens[json_at(&doc, a, 3)].type == JSON_NULL);
+  CHECK(json_at(&doc, a, 4) == JSON_NONE);
+
+  // lookups skip over nested values
+  uint32_t c = json_get(&doc, json_get(&doc, 0, "b"), "c");
+  CHECK(json_string_eq(&doc, c, "x\ny"));
+  CHECK(!json_bool(&doc, json_get(&doc, 0, "d"), true));
+  CHECK(json_get(&doc, 0, "c") == JSON_NONE);
+  CHECK(json_get(&doc, a, "a") == JSON_NONE);
+
+  // wrong types and missing tokens fall back
+  CHECK(json_int(&doc, c, 7) == 7);
+  CHECK(json_int(&doc, JSON_NONE, 7) == 7);
+
+  char out[3];
+  CHECK(json_string(&doc, c, out, sizeof(out)) == 3);
+  CHECK(strcmp(out, "x\n") == 0);
+  json_destroy(&doc);
+}
+
+static void test_malformed(void) {
+  static const char *bad[] = {
+    "", " ", "{", "}", "[1,]", "[,1]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "{1:2}", "{\"a\"}",
+    "01", "1.", ".5", "-", "1e", "+1", "tru", "nul", "\"abc", "\"a\\x\"", "\"\\u12G4\"",
+    "\"\\u12\"", "\"a\nb\"", "[1] 2", "[\"a\\", "{\"a\":[}"
+  };
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    if (parses(bad[i])) {
+      fprintf(stderr, "json_test: accepted '%s'\n", bad[i]);
+      check_failures++;
+    }
+  }
+
+  // the length bounds the text even without a terminator
+  json_document doc;
+  CHECK(!json_parse(&doc, "[1, 2]", 5));
+  CHECK(json_parse(&doc, "[1, 2]x", 6));
+  json_destroy(&doc);
+}
+
+static void test_surrogates(void) {
+  const char *text = "[\"\\ud83d\\ude00\", \"\\u00e9\\u20ac\", \"\\ud83d\", \"\\ud83d\\u0041\", \"\\uDBFF\\uDFFF\"]";
+  json_document doc;
+  CHECK(json_parse(&doc, text, strlen(text)));
+  if (doc.count == 0) return;
+
+  // a pair decodes to one four byte code point
+  CHECK(json_string_eq(&doc, json_at(&doc, 0, 0), "\xf0\x9f\x98\x80"));
+  CHECK(json_string_eq(&doc, json_at(&doc, 0, 1), "\xc3\xa9\xe2\x82\xac"));
+  CHECK(json_string_eq(&doc, json_at(&doc, 0, 4), "\xf4\x8f\xbf\xbf"));
+
+  // an unpaired high surrogate stays a lone code point and never swallows
+  // the escape after it
+  char out[16];
+  CHECK(json_string(&doc, json_at(&doc, 0, 2), out, sizeof(out)) == 3);
+  CHECK(json_string(&doc, json_at(&doc, 0, 3), out, sizeof(out)) == 4);
+  CHECK(out[3] == 'A');
+  json_destroy(&doc);
+}
+
+static char *nested(size_t depth) {
+  char *text = malloc(2 * depth + 1);
+  memset(text, '[', depth);
+  memset(text + depth, ']', depth);
+  text[2 * depth] = '\0';
+  return text;
+}
+
+static void test_depth(void) {
+  char *ok = nested(128);
+  char *deep = nested(129);
+  char *huge = nested(100000);
+  CHECK(parses(ok));
+  CHECK(!parses(deep));
+  CHECK(!parses(huge));
+  free(ok);
+  free(deep);
+  free(huge);
+}
+
+int main(void) {
+  test_values();
+  test_malformed();
+  test_surrogates();
+  test_depth();
+  return check_report("json_test");
+}
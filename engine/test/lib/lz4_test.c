@@ -0,0 +1,145 @@
+#include <lib/lz4.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../check.h"
+
+// blocks encoded by hand from the lz4 block format description
+typedef struct {
+  const uint8_t *block;
+  size_t        block_size;
+  const char    *expected;
+  size_t        size;
+} lz4_vector;
+
+// "abc", a match 3 back of length 21, then "xyz12"
+static const uint8_t overlap_block[] = {
+  0x3f, 'a', 'b', 'c', 0x03, 0x00, 0x02, 0x50, 'x', 'y', 'z', '1', '2'
+};
+
+// 20 literals, the length continuing into one extra byte
+static const uint8_t literal_block[] = {
+  0xf0, 0x05, '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+  'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j'
+};
+
+// "abcd", a non overlapping match 4 back of length 4, "0123" and a match 8
+// back of length 5, then five literals
+static const uint8_t match_block[] = {
+  0x40, 'a', 'b', 'c', 'd', 0x04, 0x00, 0x41, '0', '1', '2', '3', 0x08, 0x00,
+  0x50, 'v', 'w', 'x', 'y', 'z'
+};
+
+static const uint8_t empty_block[] = { 0x00 };
+
+static void test_known_blocks(void) {
+  const lz4_vector vectors[] = {
+    { overlap_block, sizeof(overlap_block), "abcabcabcabcabcabcabcabcxyz12", 29 },
+    { literal_block, sizeof(literal_block), "0123456789abcdefghij", 20 },
+    { match_block, sizeof(match_block), "abcdabcd0123abcd0vwxyz", 22 },
+    { empty_block, sizeof(empty_block), "", 0 }
+  };
+
+  for (size_t i = 0; i < sizeof(vectors) / sizeof(vectors[0]); i++) {
+    const lz4_vector *v = &vectors[i];
+    uint8_t out[64];
+    CHECK(lz4_decompress(v->block, v->block_size, out, v->size));
+    CHECK(memcmp(out, v->expected, v->size) == 0);
+    CHECK(!lz4_decompress(v->block, v->block_size, out, v->size + 1));
+    if (v->size) CHECK(!lz4_decompress(v->block, v->block_size, out, v->size - 1));
+
+    // every truncation fails
+    for (size_t n = 0; n < v->block_size; n++) {
+      CHECK(!lz4_decompress(v->block, n, out, v->size));
+    }
+  }
+
+  // a 270 byte literal run, 15 in the token then 255 and 0
+  uint8_t long_block[3 + 270];
+  long_block[0] = 0xf0;
+  long_block[1] = 0xff;
+  long_block[2] = 0x00;
+  for (int i = 0; i < 270; i++) long_block[3 + i] = (uint8_t)i;
+  uint8_t out[270];
+  CHECK(lz4_decompress(long_block, sizeof(long_block), out, sizeof(out)));
+  CHECK(memcmp(out, long_block + 3, sizeof(out)) == 0);
+}
+
+static void test_bad_offsets(void) {
+  uint8_t out[64];
+  uint8_t block[sizeof(match_block)];
+
+  // offset zero
+  memcpy(block, match_block, sizeof(block));
+  block[5] = 0x00;
+  CHECK(!lz4_decompress(block, sizeof(block), out, 22));
+
+  // reaching back before the start of the output
+  memcpy(block, match_block, sizeof(block));
+  block[5] = 0x05;
+  CHECK(!lz4_decompress(block, sizeof(block), out, 22));
+  memcpy(block, match_block, sizeof(block));
+  block[13] = 0x01;
+  CHECK(!lz4_decompress(block, sizeof(block), out, 22));
+}
+
+static uint32_t rng = 12345;
+
+static uint8_t next_byte(void) {
+  rng = rng * 1103515245u + 12345u;
+  return (uint8_t)(rng >> 16);
+}
+
+// noise, short periods, a small alphabet and copies of recent bytes
+static void fill(uint8_t *data, size_t size, int kind) {
+  for (size_t i = 0; i < size; i++) {
+    switch (kind) {
+    case 0:  data[i] = next_byte(); break;
+    case 1:  data[i] = (uint8_t)(i % 7); break;
+    case 2:  data[i] = next_byte() & 3; break;
+    default: data[i] = i > 64 ? data[i - 1 - next_byte() % 64] : next_byte(); break;
+    }
+  }
+}
+
+static void test_round_trips(void) {
+  static const size_t sizes[] = { 0, 1, 5, 12, 13, 64, 255, 256, 4096, 65535, 65536 };
+  uint8_t *data = malloc(65536);
+  uint8_t *packed = malloc(lz4_compress_bound(65536));
+  uint8_t *out = malloc(65536);
+
+  for (int kind = 0; kind < 4; kind++) {
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      size_t size = sizes[i];
+      fill(data, size, kind);
+
+      size_t bound = lz4_compress_bound(size);
+      size_t packed_size = lz4_compress(data, size, packed, bound);
+      CHECK(packed_size > 0 && packed_size <= bound);
+      CHECK(lz4_decompress(packed, packed_size, out, size));
+      CHECK(memcmp(out, data, size) == 0);
+      if (size) CHECK(!lz4_decompress(packed, packed_size, out, size - 1));
+      if (bound) CHECK(lz4_compress(data, size, packed, bound - 1) == 0);
+
+      // repetitive data has to shrink
+      if (kind == 1 && size >= 4096) CHECK(packed_size < size / 8);
+
+      // flipped bits never write past the output, whatever they decode to
+      for (int k = 0; packed_size && k < 32; k++) {
+        size_t at = next_byte() * 257u % packed_size;
+        packed[at] ^= (uint8_t)(1u << (k & 7));
+        lz4_decompress(packed, packed_size, out, size);
+        packed[at] ^= (uint8_t)(1u << (k & 7));
+      }
+    }
+  }
+  free(data);
+  free(packed);
+  free(out);
+}
+
+int main(void) {
+  test_known_blocks();
+  test_bad_offsets();
+  test_round_trips();
+  return check_report("lz4_test");
+}
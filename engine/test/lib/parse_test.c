@@ -0,0 +1,45 @@
+#include <lib/parse.h>
+#include <string.h>
+#include <stdint.h>
+#include <locale.h>
+#include "../check.h"
+
+static uint32_t parse_bits(const char *s) {
+  float f = 0.0f;
+  const char *end = s + strlen(s);
+  CHECK(parse_float(s, end, &f) == end);
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+// literals longer than 19 digits whose dropped digits decide the rounding
+static void test_long_literals(void) {
+  CHECK(parse_bits("3.14159265358979323846264338327950288") == 0x40490fdbu);
+  CHECK(parse_bits("-3.14159265358979323846264338327950288") == 0xc0490fdbu);
+
+  // exactly between 1 and the float after it ties to even, anything above rounds up
+  CHECK(parse_bits("1.000000059604644775390625") == 0x3f800000u);
+  CHECK(parse_bits("1.0000000596046447753906250000000000000000000000000001") == 0x3f800001u);
+  CHECK(parse_bits("1.0000000596046447753906249999999999999999999999999999") == 0x3f800000u);
+  // past the digits kept for the comparison a nonzero digit still breaks the tie
+  CHECK(parse_bits("1.00000005960464477539062500000000000000000000000000000000000000000000000000"
+                   "000000000000000000000000000000000000000000000000000000000000000000000001") == 0x3f800001u);
+
+  // half of the smallest subnormal ties to zero, anything above rounds up
+  CHECK(parse_bits("7.00649232162408535461864791644958065640130970938257885878534141944895541342930300743319094181060791015625e-46") == 0x00000000u);
+  CHECK(parse_bits("7.00649232162408535461864791644958065640130970938257885878534141944895541342930300743319094181060791015626e-46") == 0x00000001u);
+
+  CHECK(parse_bits("0.000000000000000000000000000000000000011754943508222875079687365372222456778186655567720875215087517062784172594547271728515625") == 0x00800000u);
+  CHECK(parse_bits("340282356779733661637539395458142568447.99999999999999999999") == 0x7f7fffffu);
+  CHECK(parse_bits("340282356779733661637539395458142568448") == 0x7f800000u);
+}
+
+int main(void) {
+  test_long_literals();
+  // the result must not depend on the decimal separator of the locale
+  if (setlocale(LC_NUMERIC, "de_DE.UTF-8") || setlocale(LC_NUMERIC, "fr_FR.UTF-8")) {
+    test_long_literals();
+  }
+  return check_report("parse_test");
+}
@@ -1,23 +1,120 @@
-#version 330 core
+#version 430 core
+// features: FLAT_SHADING, CLUSTERED (scene lights from the cluster grid),
+// SHADOWS (cascaded sun shadows, needs CLUSTERED)
 in vec3 FragPos;
+#ifdef FLAT_SHADING
+flat in vec3 Normal;
+#else
 in vec3 Normal;
+#endif
 out vec4 FragColor;
 
+uniform vec3 uObjectColor;
+
+vec3 shade(vec3 norm, vec3 viewDir, vec3 lightDir, vec3 color) {
+  float diff = max(dot(norm, lightDir), 0.0);
+  vec3 reflectDir = reflect(-lightDir, norm);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+  return (diff + 0.8 * spec) * color;
+}
+
+#ifdef CLUSTERED
+struct Light {
+  vec4 positionRange;
+  vec4 color;
+};
+
+layout(std430, binding = 0) readonly buffer Lights { Light lights[]; };
+layout(std430, binding = 1) readonly buffer Grid { uvec2 clusters[]; };
+layout(std430, binding = 2) readonly buffer Indices { uint lightIndices[]; };
+
+layout(std140, binding = 0) uniform ClusterParams {
+  uvec4 uGrid;
+  vec4 uSlice;
+  vec4 uEye;
+  vec4 uSunDirection;
+  vec4 uSunColor;
+};
+
+uniform mat4 uView;
+uniform vec3 uAmbient;
+
+#ifdef SHADOWS
+layout(std140, binding = 1) uniform ShadowParams {
+  layout(row_major) mat4 uShadowMatrices[4];
+  vec4 uCascadeSplits;
+  vec4 uCascadeTexels;
+  vec4 uShadowInfo;
+};
+
+layout(binding = 4) uniform sampler2DArrayShadow uShadowMap;
+
+float sunShadow(vec3 norm, float depth) {
+  int cascades = int(uShadowInfo.z);
+  if (uShadowInfo.x == 0.0 || depth > uCascadeSplits[cascades - 1]) return 1.0;
+
+  int cascade = 0;
+  while (cascade < cascades - 1 && depth > uCascadeSplits[cascade]) cascade++;
+
+  // normal offset keeps lit surfaces from shadowing themselves
+  vec3 pos = FragPos + norm * uCascadeTexels[cascade] * 1.5;
+  vec4 coord = uShadowMatrices[cascade] * vec4(pos, 1.0);
+  vec2 texel = 1.0 / vec2(textureSize(uShadowMap, 0).xy);
+
+  float lit = 0.0;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      lit += texture(uShadowMap, vec4(coord.xy + vec2(x, y) * texel, float(cascade),
+                                      coord.z - uShadowInfo.y));
+    }
+  }
+  return lit / 9.0;
+}
+#endif
+
+void main() {
+  float depth = -(uView * vec4(FragPos, 1.0)).z;
+  uint slice = uint(clamp(log(depth) * uSlice.x - uSlice.y, 0.0, float(uGrid.z - 1u)));
+  uvec2 tile = min(uvec2(gl_FragCoord.xy * uSlice.zw), uGrid.xy - 1u);
+  uvec2 cluster = clusters[(slice * uGrid.y + tile.y) * uGrid.x + tile.x];
+
+  vec3 norm = normalize(Normal);
+  vec3 viewDir = normalize(uEye.xyz - FragPos);
+  vec3 result = uAmbient;
+
+  if (uSunDirection.w != 0.0) {
+    vec3 sun = shade(norm, viewDir, -uSunDirection.xyz, uSunColor.rgb);
+#ifdef SHADOWS
+    sun *= sunShadow(norm, depth);
+#endif
+    result += sun;
+  }
+
+  for (uint i = 0u; i < cluster.y; i++) {
+    Light light = lights[lightIndices[cluster.x + i]];
+    vec3 toLight = light.positionRange.xyz - FragPos;
+    float dist = length(toLight);
+    float falloff = clamp(1.0 - pow(dist / light.positionRange.w, 4.0), 0.0, 1.0);
+    falloff *= falloff;
+
+    result += shade(norm, viewDir, toLight / dist, light.color.rgb) * falloff;
+  }
+
+  FragColor = vec4(result * uObjectColor, 1.0);
+}
+
+#else
+
 uniform vec3 uLightPos;
 uniform vec3 uViewPos;
 uniform vec3 uLightColor;
-uniform vec3 uObjectColor;
 
 void main() {
-  vec3 ambient = 0.3 * uLightColor;
   vec3 norm = normalize(Normal);
   vec3 lightDir = normalize(uLightPos - FragPos);
-  float diff = max(dot(norm, lightDir), 0.0);
-  vec3 diffuse = diff * uLightColor;
   vec3 viewDir = normalize(uViewPos - FragPos);
-  vec3 reflectDir = reflect(-lightDir, norm);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-  vec3 specular = 0.8 * spec * uLightColor;
-  vec3 result = (ambient + diffuse + specular) * uObjectColor;
-  FragColor = vec4(result, 1.0);
+  vec3 result = 0.3 * uLightColor + shade(norm, viewDir, lightDir, uLightColor);
+  FragColor = vec4(result * uObjectColor, 1.0);
 }
+
+#endif
@@ -1,17 +1,43 @@
-#version 330 core
+#version 430 core
+// features: PACKED_NORMALS (octahedral vec2 normals), FLAT_SHADING
 layout(location = 0) in vec3 aPos;
+#ifdef PACKED_NORMALS
+layout(location = 1) in vec2 aNormal;
+#else
 layout(location = 1) in vec3 aNormal;
+#endif
 
 uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProj;
 uniform mat4 uNormalMat;
 
+// matches the depth prepass so its GL_EQUAL test passes
+invariant gl_Position;
+
 out vec3 FragPos;
+#ifdef FLAT_SHADING
+flat out vec3 Normal;
+#else
 out vec3 Normal;
+#endif
+
+#ifdef PACKED_NORMALS
+vec3 oct_decode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+#endif
 
 void main() {
   FragPos = vec3(uModel * vec4(aPos, 1.0));
+#ifdef PACKED_NORMALS
+  Normal = mat3(uNormalMat) * oct_decode(aNormal);
+#else
   Normal = mat3(uNormalMat) * aNormal;
+#endif
   gl_Position = uProj * uView * vec4(FragPos, 1.0);
 }
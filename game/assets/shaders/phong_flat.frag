@@ -1,23 +0,0 @@
-#version 330 core
-in vec3 FragPos;
-flat in vec3 Normal;
-out vec4 FragColor;
-
-uniform vec3 uLightPos;
-uniform vec3 uViewPos;
-uniform vec3 uLightColor;
-uniform vec3 uObjectColor;
-
-void main() {
-  vec3 ambient = 0.3 * uLightColor;
-  vec3 norm = normalize(Normal);
-  vec3 lightDir = normalize(uLightPos - FragPos);
-  float diff = max(dot(norm, lightDir), 0.0);
-  vec3 diffuse = diff * uLightColor;
-  vec3 viewDir = normalize(uViewPos - FragPos);
-  vec3 reflectDir = reflect(-lightDir, norm);
-  float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-  vec3 specular = 0.8 * spec * uLightColor;
-  vec3 result = (ambient + diffuse + specular) * uObjectColor;
-  FragColor = vec4(result, 1.0);
-}
@@ -1,17 +0,0 @@
-#version 330 core
-layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 aNormal;
-
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProj;
-uniform mat4 uNormalMat;
-
-out vec3 FragPos;
-flat out vec3 Normal;
-
-void main() {
-  FragPos = vec3(uModel * vec4(aPos, 1.0));
-  Normal = mat3(uNormalMat) * aNormal;
-  gl_Position = uProj * uView * vec4(FragPos, 1.0);
-}
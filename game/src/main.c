@@ -1,5 +1,7 @@
 #include <stdio.h>
-#include <float.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
 
 #include <GLES2/gl2.h>
 #include <engine.h>
@@ -9,18 +11,39 @@
 #include <lib/la.h>
 #include <lib/trig.h>
 #include <assets/mesh.h>
+#include <assets/assets.h>
+#include <assets/archive.h>
 #include <lib/graphics.h>
+#include <opengl/program_cache.h>
+#include <opengl/shader_variants.h>
+#include <lib/watcher.h>
 
 static scene game_scene;
-static mesh teapot_mesh;
+static asset_handle teapot;
+static mesh *teapot_mesh;  // NULL until the streamed teapot is ready
+static const char *teapot_source;
+static mesh placeholder_mesh;
+static mesh ground_mesh;
 static entity_id teapot_entity;
+static entity_id ground_entity;
 static entity_id camera_entity;
 static entity_id light_entity;
+static entity_id point_light_entities[256];
+static float light_orbit;
 static entity_id controller_entity;
+static float stats_timer;
 
-static GLuint program;
-GLint model_loc, view_loc, proj_loc, normal_loc;
-static GLint light_pos_loc, view_pos_loc, light_color_loc, object_color_loc;
+static const char *teapot_path = "./test/models/obj/teapot.obj";
+static const char *teapot_cooked_path = "./bin/assets/teapot.amesh";
+static const char *game_archive_path = "./bin/game.apak";
+static const mesh_import_options teapot_options = {
+  .flags = MESH_IMPORT_NORMALS | MESH_IMPORT_OPTIMIZE | MESH_IMPORT_LODS | MESH_IMPORT_MESHLETS,
+  .lods  = { .max_lods = 4, .reduction = 0.5f, .error_budget = 0.05f }
+};
+
+static const char *phong_vs_path = "./game/assets/shaders/phong.vert";
+static const char *phong_fs_path = "./game/assets/shaders/phong.frag";
+static const float object_color[3] = { 1.0f, 0.75f, 0.2f };
 
 extern int width, height;
 
@@ -32,86 +55,85 @@ static void cam_move_up(float dt);
 static void cam_move_down(float dt);
 static void handle_mouse_look(float dx, float dy);
 
-void game_init(void) {
-  load_mesh("./test/models/obj/teapot.obj", &teapot_mesh);
-  generate_normals(&teapot_mesh);
-
-  fprintf(stderr, "Loaded mesh: %zu vertices, %zu indices\n",
-          *teapot_mesh.vert_count, *teapot_mesh.idx_count);
-
-  program = make_program_from_files(
-    "./game/assets/shaders/phong.vert",
-    "./game/assets/shaders/phong.frag"
-  );
-  glUseProgram(program);
+// square at height y facing up, for the teapot to cast shadows onto
+static void make_ground(mesh *m, float half_size, float y) {
+  static const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+  static const uint32_t quad[6] = { 0, 2, 1, 0, 3, 2 };
+
+  memset(m, 0, sizeof(mesh));
+  if (!mesh_allocate(m, 4, 6, MESH_HAS_NORMALS | MESH_HAS_TEXCOORDS, NULL)) return;
+
+  for (int v = 0; v < 4; v++) {
+    m->positions[3*v + 0] = corners[v][0] * half_size;
+    m->positions[3*v + 1] = y;
+    m->positions[3*v + 2] = corners[v][1] * half_size;
+    m->normals[3*v + 0] = 0.0f;
+    m->normals[3*v + 1] = 1.0f;
+    m->normals[3*v + 2] = 0.0f;
+    m->texcoords[2*v + 0] = 0.5f + 0.5f * corners[v][0];
+    m->texcoords[2*v + 1] = 0.5f + 0.5f * corners[v][1];
+  }
+  memcpy(m->indices, quad, sizeof(quad));
+  mesh_compute_bounds(m);
+}
 
-  model_loc = glGetUniformLocation(program, "uModel");
-  view_loc = glGetUniformLocation(program, "uView");
-  proj_loc = glGetUniformLocation(program, "uProj");
-  normal_loc = glGetUniformLocation(program, "uNormalMat");
-  light_pos_loc = glGetUniformLocation(program, "uLightPos");
-  view_pos_loc = glGetUniformLocation(program, "uViewPos");
-  light_color_loc = glGetUniformLocation(program, "uLightColor");
-  object_color_loc = glGetUniformLocation(program, "uObjectColor");
+// stand-in drawn while the teapot streams in
+static void make_box(mesh *m, float half_size) {
+  static const float corners[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+  static const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+
+  memset(m, 0, sizeof(mesh));
+  if (!mesh_allocate(m, 24, 36, MESH_HAS_NORMALS | MESH_HAS_TEXCOORDS, NULL)) return;
+
+  for (int f = 0; f < 6; f++) {
+    // faces on the negative side mirror v so they still wind counter clockwise
+    int axis = f / 2, u = (axis + 1) % 3, v = (axis + 2) % 3;
+    float sign = (f & 1) ? -1.0f : 1.0f;
+    for (int c = 0; c < 4; c++) {
+      int i = 4 * f + c;
+      m->positions[3*i + axis] = sign * half_size;
+      m->positions[3*i + u] = corners[c][0] * half_size;
+      m->positions[3*i + v] = sign * corners[c][1] * half_size;
+      m->normals[3*i + axis] = sign;
+      m->texcoords[2*i + 0] = 0.5f + 0.5f * corners[c][0];
+      m->texcoords[2*i + 1] = 0.5f + 0.5f * corners[c][1];
+    }
+    for (int k = 0; k < 6; k++) m->indices[6*f + k] = (uint32_t)(4*f) + quad[k];
+  }
+  mesh_compute_bounds(m);
+}
 
-  glEnable(GL_DEPTH_TEST);
-  glDepthFunc(GL_LESS);
+// the copy written by `make cook` is used while it is newer than the source
+static const char *teapot_import_path(void) {
+  // without the loose source this is a packed build, the cooked mesh comes
+  // out of the archive and the source is only the fallback
+  struct stat source, cooked;
+  if (stat(teapot_path, &source) != 0) return teapot_cooked_path;
+  if (stat(teapot_cooked_path, &cooked) != 0 || cooked.st_mtime < source.st_mtime) {
+    return teapot_path;
+  }
+  return teapot_cooked_path;
+}
 
-  scene_init(&game_scene);
+static void print_mesh(const char *path, const mesh *m) {
+  for (size_t l = 0; l < m->lod_count; l++) {
+    fprintf(stderr, "LOD %zu: %zu triangles, error %.4f\n",
+            l + 1, m->lods[l].idx_count / 3, m->lods[l].error);
+  }
+  fprintf(stderr, "Loaded %s: %zu vertices, %zu indices, %zu lods, %zu meshlets\n",
+          path, m->vert_count, m->idx_count, m->lod_count, m->meshlet_count);
+}
 
-  teapot_entity = scene_create_entity(&game_scene);
-  transform_component *t = scene_add_transform(&game_scene, teapot_entity);
-  t->position = (vec3){0, 0, 0};
-  t->rotation = (vec3){0, 0, 0};
-  t->scale = (vec3){1, 1, 1};
-  t->dirty = true;
+static void stream_teapot(const char *path) {
+  teapot_source = path;
+  teapot = asset_load_mesh_async(path, &teapot_options);
+}
 
-  mesh_renderer_component *mr = scene_add_mesh_renderer(&game_scene, teapot_entity);
-  mr->mesh_data = &teapot_mesh;
-
-  glGenVertexArrays(1, &mr->vao);
-  glBindVertexArray(mr->vao);
-
-  glGenBuffers(1, &mr->vbo_pos);
-  glBindBuffer(GL_ARRAY_BUFFER, mr->vbo_pos);
-  glBufferData(GL_ARRAY_BUFFER,
-               3 * (*teapot_mesh.vert_count) * sizeof(float),
-               teapot_mesh.positions,
-               GL_STATIC_DRAW);
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-  glGenBuffers(1, &mr->vbo_norm);
-  glBindBuffer(GL_ARRAY_BUFFER, mr->vbo_norm);
-  glBufferData(GL_ARRAY_BUFFER,
-               3 * (*teapot_mesh.vert_count) * sizeof(float),
-               teapot_mesh.normals,
-               GL_STATIC_DRAW);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-  glGenBuffers(1, &mr->ebo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mr->ebo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-               (*teapot_mesh.idx_count) * sizeof(uint32_t),
-               teapot_mesh.indices,
-               GL_STATIC_DRAW);
-
-  glBindVertexArray(0);
-  mr->initialized = true;
-
-  vec3 bb_min = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
-  vec3 bb_max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
-
-  for (size_t i = 0; i < *teapot_mesh.vert_count; i++) {
-    vec3 p = {
-      teapot_mesh.positions[3*i + 0],
-      teapot_mesh.positions[3*i + 1],
-      teapot_mesh.positions[3*i + 2]
-    };
-    bb_min = vec3_min(bb_min, p);
-    bb_max = vec3_max(bb_max, p);
-  }
+// camera, ground and lights sized around m, redone once the teapot
+// replaces its placeholder
+static void frame_level(const mesh *m) {
+  vec3 bb_min = { m->bounds_min[0], m->bounds_min[1], m->bounds_min[2] };
+  vec3 bb_max = { m->bounds_max[0], m->bounds_max[1], m->bounds_max[2] };
 
   vec3 center = vec_scale(vec_sum(bb_min, bb_max), 0.5f);
   vec3 diag = vec_sum(bb_max, vec_negate(bb_min));
@@ -120,19 +142,18 @@ void game_init(void) {
   float fov = to_radians(45.0f);
   float cam_d = (radius * 1.5f) / tanf(fov * 0.5f);
 
-  camera_entity = scene_create_entity(&game_scene);
-  transform_component *cam_t = scene_add_transform(&game_scene, camera_entity);
-  cam_t->position = (vec3){0, 0, cam_d};
+  transform_component *cam_t = scene_get_transform(&game_scene, camera_entity);
+  cam_t->position = (vec3){0, center.y + radius, cam_d};
   cam_t->dirty = true;
 
-  camera_component *cam = scene_add_camera(&game_scene, camera_entity);
+  camera_component *cam = scene_get_camera(&game_scene, camera_entity);
   cam->fov = fov;
   cam->aspect = (float)width / (float)height;
   cam->near_plane = 0.1f;
   cam->far_plane = cam_d + radius * 2.0f;
   cam->view_matrix = look_at(
-    (vec3){ 0.0f, 0.0f, cam_d },
-    (vec3){ 0.0f, 0.0f, 0.0f },
+    cam_t->position,
+    center,
     (vec3){ 0.0f, 1.0f, 0.0f }
   );
   cam->projection_matrix = perspective_mat4(
@@ -141,24 +162,157 @@ void game_init(void) {
     0.1f,
     cam_d + radius * 2.0f
   );
+  game_scene.shadows.max_distance = cam_d + radius * 2.0f;
+
+  destroy_mesh(&ground_mesh);
+  make_ground(&ground_mesh, radius * 4.0f, bb_min.y);
+  mesh_renderer_component *ground = scene_get_mesh_renderer(&game_scene, ground_entity);
+  mesh_renderer_component_upload(ground, &ground_mesh, VERTEX_FORMAT_PACKED_QUANTIZED);
+
+  size_t point_lights = sizeof(point_light_entities) / sizeof(point_light_entities[0]);
+  for (size_t i = 0; i < point_lights; i++) {
+    scene_get_light(&game_scene, point_light_entities[i])->range = radius * 0.5f;
+  }
+  light_orbit = radius * 1.1f;
+
+  controller_component *ctrl = scene_get_controller(&game_scene, controller_entity);
+  ctrl->pitch = -atanf(radius / cam_d);
+}
+
+// the level is framed around the teapot as soon as its import lands
+static void poll_teapot(void) {
+  if (teapot_mesh || teapot == ASSET_HANDLE_NONE) return;
+
+  asset_state state = asset_get_state(teapot);
+  if (state == ASSET_READY) {
+    teapot_mesh = asset_mesh(teapot);
+    print_mesh(teapot_source, teapot_mesh);
+    frame_level(teapot_mesh);
+  } else if (state == ASSET_FAILED && teapot_source != teapot_path) {
+    // a cooked file that cannot be read falls back to the source
+    asset_release(teapot);
+    stream_teapot(teapot_path);
+    scene_stream_mesh(&game_scene, teapot_entity, teapot, VERTEX_FORMAT_PACKED_QUANTIZED, NULL);
+  } else if (state == ASSET_FAILED) {
+    fprintf(stderr, "Failed to load %s\n", teapot_path);
+    asset_release(teapot);
+    teapot = ASSET_HANDLE_NONE;
+  }
+}
+
+static void reload_shader(const char *path, void *ctx) {
+  (void)ctx;
+  size_t count = shader_variants_reload(path);
+  if (count > 0) {
+    fprintf(stderr, "Reloading %s: %zu variants\n", path, count);
+  }
+}
+
+static void reload_teapot(const char *path, void *ctx) {
+  (void)ctx;
+  if (!teapot_mesh) return;
+  mesh fresh;
+  if (!asset_import_mesh(teapot_path, &teapot_options, &fresh)) {
+    fprintf(stderr, "Reloading %s failed, keeping the previous mesh\n", path);
+    return;
+  }
+  // the shared copy is replaced in place so every holder of the handle sees it
+  size_t count = scene_replace_mesh(&game_scene, teapot_mesh, &fresh);
+  fprintf(stderr, "Reloaded %s into %zu renderers\n", path, count);
+}
+
+void game_init(void) {
+  // loose files are still read first, so the archive only serves what was
+  // removed from the tree
+  struct stat archive_st;
+  if (stat(game_archive_path, &archive_st) == 0 && archive_mount(game_archive_path, ".")) {
+    fprintf(stderr, "Mounted %s\n", game_archive_path);
+  }
+
+  // the import runs on the loader threads while the shaders compile
+  stream_teapot(teapot_import_path());
+
+  scene_init(&game_scene);
+
+  // every variant the level draws with is built before the first frame,
+  // the scene picks one per draw from the vertex format and lighting
+  const uint32_t level_variants[] = {
+    LIT_PACKED_NORMALS | LIT_CLUSTERED | LIT_SHADOWS,
+    LIT_PACKED_NORMALS | LIT_CLUSTERED
+  };
+  lit_shaders_init(&game_scene.lit, phong_vs_path, phong_fs_path);
+  lit_shaders_warm_up(&game_scene.lit, level_variants, sizeof(level_variants) / sizeof(level_variants[0]));
+
+  program_cache_stats cache = program_cache_get_stats();
+  fprintf(stderr, "Shader cache: %zu hits, %zu misses, %zu stale (%s compile)\n",
+          cache.hits, cache.misses, cache.stale, shader_compile_mode());
+
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_LESS);
+  glEnable(GL_CULL_FACE);
+
+  teapot_entity = scene_create_entity(&game_scene);
+  transform_component *t = scene_add_transform(&game_scene, teapot_entity);
+  t->position = (vec3){0, 0, 0};
+  t->rotation = (vec3){0, 0, 0};
+  t->scale = (vec3){1, 1, 1};
+  t->dirty = true;
+
+  make_box(&placeholder_mesh, 1.0f);
+  mesh_renderer_component *teapot_renderer =
+    scene_stream_mesh(&game_scene, teapot_entity, teapot, VERTEX_FORMAT_PACKED_QUANTIZED,
+                      &placeholder_mesh);
+  memcpy(teapot_renderer->color, object_color, sizeof(object_color));
 
+  camera_entity = scene_create_entity(&game_scene);
+  scene_add_transform(&game_scene, camera_entity);
+  scene_add_camera(&game_scene, camera_entity);
   game_scene.active_camera = camera_entity;
 
   light_entity = scene_create_entity(&game_scene);
   light_component *light = scene_add_light(&game_scene, light_entity);
-  light->position = (vec3){-5.0f, 5.0f, 5.0f};
+  light->type = LIGHT_DIRECTIONAL;
+  light->direction = (vec3){1.0f, -1.0f, -1.0f};
   light->color = (vec3){3.0f, 3.0f, 3.0f};
-  light->intensity = 1.0f;
+  light->intensity = 0.6f;
+  light->cast_shadows = true;
+  game_scene.ambient = vec_scale(light->color, 0.15f);
+
+  ground_entity = scene_create_entity(&game_scene);
+  scene_add_transform(&game_scene, ground_entity);
+  mesh_renderer_component *ground = scene_add_mesh_renderer(&game_scene, ground_entity);
+  ground->is_static = true;
+  memcpy(ground->color, object_color, sizeof(object_color));
+
+  // small colored point lights orbiting the teapot, binned per cluster every frame
+  size_t point_lights = sizeof(point_light_entities) / sizeof(point_light_entities[0]);
+  for (size_t i = 0; i < point_lights; i++) {
+    point_light_entities[i] = scene_create_entity(&game_scene);
+    light_component *pl = scene_add_light(&game_scene, point_light_entities[i]);
+    float hue = (float)i / (float)point_lights;
+    pl->color = (vec3){
+      0.5f + 0.5f * cosf(6.2831853f * hue),
+      0.5f + 0.5f * cosf(6.2831853f * (hue + 0.333f)),
+      0.5f + 0.5f * cosf(6.2831853f * (hue + 0.667f))
+    };
+    pl->intensity = 0.5f;
+  }
+  game_scene.clustered_lighting = true;
+  game_scene.gpu_profiling = true;
+  game_scene.dynamic_resolution = true;
+  game_scene.depth_prepass = true;
+  game_scene.resolution.target_ms = 1000.0f / 60.0f;
+  resolution_scaler_set_preset(&game_scene.resolution, RESOLUTION_PRESET_QUALITY);
 
-  vec3 object_color = { 1.0f, 0.75f, 0.2f };
-  glUseProgram(program);
-  glUniform3fv(light_pos_loc, 1, &light->position.x);
-  glUniform3fv(view_pos_loc, 1, &cam_t->position.x);
-  glUniform3fv(light_color_loc, 1, &light->color.x);
-  glUniform3fv(object_color_loc, 1, &object_color.x);
+  watcher_add(phong_vs_path, reload_shader, NULL);
+  watcher_add(phong_fs_path, reload_shader, NULL);
+  watcher_add(teapot_path, reload_teapot, NULL);
 
   controller_entity = scene_create_entity(&game_scene);
-  controller_component *ctrl = scene_add_controller(&game_scene, controller_entity, camera_entity);
+  scene_add_controller(&game_scene, controller_entity, camera_entity);
+
+  frame_level(&placeholder_mesh);
+  poll_teapot();
 
   input_bind_key(ATOM_KEY_W, NULL, cam_move_forward, NULL);
   input_bind_key(ATOM_KEY_S, NULL, cam_move_backward, NULL);
@@ -207,6 +361,8 @@ static void handle_mouse_look(float dx, float dy) {
 }
 
 void game_update(float dt) {
+  poll_teapot();
+
   transform_component *t = scene_get_transform(&game_scene, teapot_entity);
   if (t) {
     t->rotation.y += dt;
@@ -227,7 +383,42 @@ void game_update(float dt) {
     );
   }
 
+  static float light_time;
+  light_time += dt;
+  size_t point_lights = sizeof(point_light_entities) / sizeof(point_light_entities[0]);
+  for (size_t i = 0; i < point_lights; i++) {
+    light_component *pl = scene_get_light(&game_scene, point_light_entities[i]);
+    if (!pl) continue;
+    float a = 6.2831853f * (float)i / (float)point_lights + light_time * 0.5f;
+    float h = sinf(a * 7.0f + light_time) * 0.5f;
+    pl->position = (vec3){ cosf(a) * light_orbit, h * light_orbit, sinf(a) * light_orbit };
+  }
+
   scene_update_transforms(&game_scene);
+
+  stats_timer += dt;
+  if (stats_timer >= 1.0f) {
+    stats_timer = 0.0f;
+    render_stats *st = &game_scene.stats;
+    fprintf(stderr, "Frame: %zu draws, %zu/%zu triangles rendered/submitted, %zu meshlets culled, "
+            "%zu objects occluded, %zu light references, %zu shadow cascades redrawn, %zu prepass draws\n",
+            st->draw_calls, st->triangles_rendered, st->triangles_submitted, st->meshlets_culled,
+            st->objects_occluded, st->light_references, st->shadow_cascades_rendered,
+            st->prepass_draw_calls);
+
+    const gpu_profiler *prof = &game_scene.profiler;
+    fprintf(stderr, "GPU: %.3f ms at %.0f%% resolution", st->gpu_frame_ms, st->resolution_scale * 100.0f);
+    for (size_t i = 0; i < prof->timing_count; i++) {
+      fprintf(stderr, "%s%s %.3f ms", i == 0 ? " (" : ", ", prof->timings[i].name, prof->timings[i].ms);
+    }
+    fprintf(stderr, "%s\n", prof->timing_count ? ")" : "");
+
+    const frame_graph_stats *fgs = &game_scene.graph.stats;
+    fprintf(stderr, "Frame graph: %zu passes, %zu culled, %zu transients in %zu textures "
+            "(%.2f MB aliased to %.2f MB, pool %.2f MB)\n",
+            fgs->passes, fgs->passes_culled, fgs->transient_textures, fgs->physical_textures,
+            fgs->transient_bytes / 1048576.0, fgs->aliased_bytes / 1048576.0, fgs->pool_bytes / 1048576.0);
+  }
 }
 
 void game_render(void) {
@@ -235,13 +426,15 @@ void game_render(void) {
   glClearColor(0.1f, 0.1f, 0.12f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  glUseProgram(program);
   scene_render(&game_scene);
 }
 
 void game_cleanup(void) {
   scene_destroy(&game_scene);
-  destroy_mesh(&teapot_mesh);
+  asset_release(teapot);
+  destroy_mesh(&placeholder_mesh);
+  destroy_mesh(&ground_mesh);
+  shader_variants_destroy();
 }
 
 int main(void) {
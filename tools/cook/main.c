@@ -0,0 +1,97 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/mesh.h>
+#include <assets/amesh.h>
+#include <assets/assets.h>
+#include <lib/trig.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+// converts source meshes into .amesh files, running the same processing
+// chain the game runs on import so loading the result needs no work at all
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static bool parse_format(const char *name, vertex_format *out) {
+  if (strcmp(name, "float") == 0) *out = VERTEX_FORMAT_FLOAT;
+  else if (strcmp(name, "packed") == 0) *out = VERTEX_FORMAT_PACKED;
+  else if (strcmp(name, "quantized") == 0) *out = VERTEX_FORMAT_PACKED_QUANTIZED;
+  else return false;
+  return true;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--format float|packed|quantized] [--lods n] [--crease degrees]\n"
+          "       [--no-meshlets] input output.amesh\n", argv0);
+}
+
+int main(int argc, char **argv) {
+  vertex_format format = VERTEX_FORMAT_PACKED_QUANTIZED;
+  mesh_import_options options = {
+    .flags = MESH_IMPORT_NORMALS | MESH_IMPORT_OPTIMIZE | MESH_IMPORT_LODS | MESH_IMPORT_MESHLETS,
+    .lods  = { .max_lods = 4, .reduction = 0.5f, .error_budget = 0.05f }
+  };
+  const char *input = NULL, *output = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      if (!parse_format(argv[++i], &format)) {
+        usage(argv[0]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+      options.lods.max_lods = (size_t)atol(argv[++i]);
+    } else if (strcmp(argv[i], "--crease") == 0 && i + 1 < argc) {
+      options.crease_angle = (float)atof(argv[++i]) * PI / 180.0f;
+    } else if (strcmp(argv[i], "--no-meshlets") == 0) {
+      options.flags &= ~MESH_IMPORT_MESHLETS;
+    } else if (argv[i][0] != '-' && !input) {
+      input = argv[i];
+    } else if (argv[i][0] != '-' && !output) {
+      output = argv[i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!input || !output) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  double start = now_seconds();
+  mesh m;
+  if (!asset_import_mesh(input, &options, &m)) {
+    fprintf(stderr, "Failed to load %s\n", input);
+    return 1;
+  }
+  double imported = now_seconds();
+
+  bool ok = amesh_write(&m, format, output);
+  fprintf(stderr, "%s: %zu vertices, %zu indices, %zu lods, %zu meshlets\n",
+          input, m.vert_count, m.idx_count, m.lod_count, m.meshlet_count);
+  destroy_mesh(&m);
+  if (!ok) return 1;
+
+  // the cooked file is loaded back once so both paths can be compared
+  double reload = now_seconds();
+  mesh cooked;
+  load_mesh(output, &cooked);
+  double loaded = now_seconds();
+  if (cooked.storage_kind != MESH_STORAGE_MAPPED) {
+    fprintf(stderr, "Failed to read back %s\n", output);
+    destroy_mesh(&cooked);
+    return 1;
+  }
+  fprintf(stderr, "%s: import %.2f ms, cooked load %.3f ms\n",
+          output, (imported - start) * 1e3, (loaded - reload) * 1e3);
+  destroy_mesh(&cooked);
+  return 0;
+}
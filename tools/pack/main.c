@@ -0,0 +1,168 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assets/archive.h>
+#include <assets/assets.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+// packs loose assets into one .apak archive, named by their path relative
+// to the root the game mounts the archive at
+
+#define MAX_STORED 16
+
+typedef struct {
+  archive_source *sources;
+  size_t         count;
+  size_t         capacity;
+  uint64_t       bytes;
+  const char     *root;      // normalized
+  const char     *output;    // normalized, never packed into itself
+  const char     *stored[MAX_STORED];
+  size_t         stored_count;
+} pack_list;
+
+static double now_seconds(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static char *copy_string(const char *s) {
+  size_t len = strlen(s);
+  char *out = malloc(len + 1);
+  memcpy(out, s, len + 1);
+  return out;
+}
+
+static bool is_stored(const pack_list *l, const char *path) {
+  const char *dot = strrchr(path, '.');
+  if (!dot || strchr(dot, '/')) return false;
+  for (size_t i = 0; i < l->stored_count; i++) {
+    if (strcmp(dot + 1, l->stored[i]) == 0) return true;
+  }
+  return false;
+}
+
+static bool add_path(pack_list *l, const char *path) {
+  char normalized[PATH_MAX];
+  if (!asset_normalize_path(path, normalized, sizeof(normalized))) {
+    fprintf(stderr, "atom-pack: cannot resolve '%s'\n", path);
+    return false;
+  }
+  struct stat st;
+  if (stat(normalized, &st) != 0) {
+    fprintf(stderr, "atom-pack: cannot stat '%s'\n", path);
+    return false;
+  }
+
+  if (S_ISDIR(st.st_mode)) {
+    DIR *dir = opendir(normalized);
+    if (!dir) {
+      fprintf(stderr, "atom-pack: cannot read '%s'\n", path);
+      return false;
+    }
+    bool ok = true;
+    struct dirent *d;
+    while (ok && (d = readdir(dir))) {
+      if (d->d_name[0] == '.') continue;
+      char child[PATH_MAX];
+      int n = snprintf(child, sizeof(child), "%s/%s", normalized, d->d_name);
+      ok = n > 0 && (size_t)n < sizeof(child) && add_path(l, child);
+    }
+    closedir(dir);
+    return ok;
+  }
+  if (!S_ISREG(st.st_mode) || strcmp(normalized, l->output) == 0) return true;
+
+  // names are what the game asks for, relative to where it mounts the archive
+  size_t root_len = strlen(l->root);
+  if (root_len == 1) root_len = 0;
+  if (strncmp(normalized, l->root, root_len) != 0 || normalized[root_len] != '/') {
+    fprintf(stderr, "atom-pack: '%s' is outside of '%s'\n", path, l->root);
+    return false;
+  }
+
+  if (l->count == l->capacity) {
+    l->capacity = l->capacity ? l->capacity * 2 : 64;
+    l->sources = realloc(l->sources, l->capacity * sizeof(archive_source));
+  }
+  l->sources[l->count++] = (archive_source){
+    copy_string(normalized + root_len + 1), copy_string(normalized), !is_stored(l, normalized)
+  };
+  l->bytes += (uint64_t)st.st_size;
+  return true;
+}
+
+// sorted so packing the same tree twice gives the same archive
+static int compare_sources(const void *a, const void *b) {
+  return strcmp(((const archive_source *)a)->name, ((const archive_source *)b)->name);
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--root dir] [--store extension]... output.apak inputs...\n"
+          "       directories are packed recursively, .amesh files are stored by default\n", argv0);
+}
+
+int main(int argc, char **argv) {
+  pack_list l = { .stored = { "amesh" }, .stored_count = 1 };
+  const char *root = ".";
+  const char *output = NULL;
+  int first_input = argc;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--root") == 0 && i + 1 < argc) {
+      root = argv[++i];
+    } else if (strcmp(argv[i], "--store") == 0 && i + 1 < argc && l.stored_count < MAX_STORED) {
+      l.stored[l.stored_count++] = argv[++i];
+    } else if (argv[i][0] != '-' && !output) {
+      output = argv[i];
+    } else if (argv[i][0] != '-') {
+      first_input = i;
+      break;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!output || first_input == argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  char root_path[PATH_MAX], output_path[PATH_MAX];
+  if (!asset_normalize_path(root, root_path, sizeof(root_path)) ||
+      !asset_normalize_path(output, output_path, sizeof(output_path))) {
+    fprintf(stderr, "atom-pack: cannot resolve the root or output path\n");
+    return 1;
+  }
+  l.root = root_path;
+  l.output = output_path;
+
+  double start = now_seconds();
+  bool ok = true;
+  for (int i = first_input; i < argc && ok; i++) ok = add_path(&l, argv[i]);
+  if (ok) {
+    qsort(l.sources, l.count, sizeof(archive_source), compare_sources);
+    ok = archive_write(output, l.sources, l.count);
+  }
+
+  struct stat st;
+  if (ok && stat(output, &st) == 0) {
+    fprintf(stderr, "%s: %zu files, %.1f KB packed into %.1f KB in %.2f ms\n",
+            output, l.count, (double)l.bytes / 1024.0, (double)st.st_size / 1024.0,
+            (now_seconds() - start) * 1e3);
+  }
+
+  for (size_t i = 0; i < l.count; i++) {
+    free((char *)l.sources[i].name);
+    free((char *)l.sources[i].path);
+  }
+  free(l.sources);
+  return ok ? 0 : 1;
+}